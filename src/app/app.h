@@ -96,7 +96,28 @@ class Application {
   }
 
   static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    auto camera = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window))->engine->getScene()->getCamera();
+    auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+    auto scene = app->engine->getScene();
+    auto camera = scene->getCamera();
+
+    // Выбор объекта лучом из камеры
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+      if (app->engine->getRender()->getInterface()->options.menuHovered)
+        return;
+      glm::double2 cursor;
+      glfwGetCursorPos(window, &cursor.x, &cursor.y);
+      // Курсор задан в экранных координатах окна, а не в пикселях кадрового буфера (HiDPI)
+      int width, height;
+      glfwGetWindowSize(window, &width, &height);
+      if (width == 0 || height == 0)
+        return;
+      glm::float3 origin, direction;
+      camera->getRay(cursor, static_cast<uint32_t>(width), static_cast<uint32_t>(height), origin, direction);
+      uint32_t picked = scene->pick(origin, direction);
+      if (picked != UINT32_MAX)
+        scene->currentObject = picked;
+    }
+
     if (button == GLFW_MOUSE_BUTTON_RIGHT) {
       if (action == GLFW_PRESS) {
         glfwGetCursorPos(window, &camera->mouse.pos.x, &camera->mouse.pos.y);
@@ -47,10 +47,10 @@ void Commands::destroyCommandBufferPool(VkCommandPool cmdPool) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VkCommandBuffer Commands::createCommandBuffer(VkCommandPool cmdPool) {
+VkCommandBuffer Commands::createCommandBuffer(VkCommandPool cmdPool, VkCommandBufferLevel level) {
   VkCommandBufferAllocateInfo cmdBufferInfo{};
   cmdBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  cmdBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cmdBufferInfo.level = level;
   cmdBufferInfo.commandPool = cmdPool;
   cmdBufferInfo.commandBufferCount = 1;
 
@@ -161,6 +161,12 @@ void Commands::changeImageLayout(VkCommandBuffer cmdBuffer, VkImage image, VkIma
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
     sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
     destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  } else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
+             newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
   } else {
     throw std::invalid_argument("ERROR: Unsupported layout transition!");
   }
@@ -25,7 +25,7 @@ class Commands {
   //=========================================================================
   // Выделенные командные буферы
 
-  VkCommandBuffer createCommandBuffer(VkCommandPool);
+  VkCommandBuffer createCommandBuffer(VkCommandPool, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
   void resetCommandBuffer(VkCommandBuffer);                   // Сбросит буфер, сохранит ресурсы
   void freeCommandBuffer(VkCommandBuffer);                    // Сбросит буфер, освободит ресурсы (вернёт их в пул)
   void destroyCommandBuffer(VkCommandPool, VkCommandBuffer);  // Уничтожет буфер, освободит ресурсы (вернёт их в пул)
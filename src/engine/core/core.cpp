@@ -133,6 +133,15 @@ void Core::choosePhysicalDevice() {
       this->physicalDevice.handler = currentDevice;
       vkGetPhysicalDeviceProperties(this->physicalDevice.handler, &(this->physicalDevice.properties));
       vkGetPhysicalDeviceFeatures(this->physicalDevice.handler, &(this->physicalDevice.features));
+
+      // Число косвенных команд из буфера устройства (отсечение на GPU)
+      VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+      supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+      VkPhysicalDeviceFeatures2 supportedFeatures2{};
+      supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+      supportedFeatures2.pNext = &supportedFeatures12;
+      vkGetPhysicalDeviceFeatures2(this->physicalDevice.handler, &supportedFeatures2);
+      this->physicalDevice.drawIndirectCount = supportedFeatures12.drawIndirectCount;
       std::cout << "GPU: " << this->physicalDevice.properties.deviceName << std::endl;
       break;
     }
@@ -161,6 +170,7 @@ bool Core::isDeviceSuitable(VkPhysicalDevice device) {
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
   if (!supportedFeatures.samplerAnisotropy) return false;
 
+  // Косвенный рендер и отсечение на GPU необязательны - без них выбираются более простые режимы
   return true;
 }
 
@@ -257,20 +267,28 @@ void Core::createDevice() {
   VkPhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
   deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
-
-  VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
-  indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
-  indexingFeatures.pNext = nullptr;
-  indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
-  indexingFeatures.runtimeDescriptorArray = VK_TRUE;
-  indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
-  indexingFeatures.shaderStorageImageArrayNonUniformIndexing = VK_TRUE;
-  indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  deviceFeatures.multiDrawIndirect = physicalDevice.features.multiDrawIndirect;  // Режимы рендера без них понижаются
+  deviceFeatures.drawIndirectFirstInstance = physicalDevice.features.drawIndirectFirstInstance;
+  deviceFeatures.pipelineStatisticsQuery = physicalDevice.features.pipelineStatisticsQuery;  // Замер перерисовки, если есть
+
+  // Особенности Vulkan 1.2 - индексация дескрипторов и число косвенных команд из буфера
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.pNext = nullptr;
+  vulkan12Features.drawIndirectCount = physicalDevice.drawIndirectCount ? VK_TRUE : VK_FALSE;
+  vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+  vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+  vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  vulkan12Features.shaderStorageImageArrayNonUniformIndexing = VK_TRUE;
+  vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  vulkan12Features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+  vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
 
   // Описание логического устройства
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-  createInfo.pNext = &indexingFeatures;
+  createInfo.pNext = &vulkan12Features;
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
   createInfo.pEnabledFeatures = &deviceFeatures;
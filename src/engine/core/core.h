@@ -51,6 +51,7 @@ class Core {
     VkPhysicalDevice handler;
     VkPhysicalDeviceProperties properties;
     VkPhysicalDeviceFeatures features;
+    bool drawIndirectCount;  // Число косвенных команд из буфера устройства (Vulkan 1.2)
   } physicalDevice;
 
   // Логическое устройство (Интерфейс)
@@ -123,6 +124,10 @@ class Core {
   void createSwapchain();
   void destroySwapchain();
 
+  // Кадры в работе - CPU готовит следующие, пока GPU выполняет прошлые.
+  // Ресурсы кадра (команды, константы, дескрипторы) - по копии на кадр, а не на изображение показа
+  uint32_t framesInFlight = 2;
+
  private:
   VkSurfaceFormatKHR chooseSwapchainSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
   VkPresentModeKHR chooseSwapchainPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
@@ -7,6 +7,8 @@ Resources::Resources(Core::Manager core) {
 }
 
 Resources::~Resources() {
+  for (auto& el : samplers)
+    vkDestroySampler(core->device, el.second, nullptr);
   destroyDescriptorPool(this->descriptorPool);
 }
 
@@ -20,6 +22,13 @@ uint32_t Resources::findMemoryTypeIndex(uint32_t type, VkMemoryPropertyFlags pro
   throw std::runtime_error("ERROR: Failed to find suitable memory type!");
 }
 
+bool Resources::hasMemoryType(uint32_t type, VkMemoryPropertyFlags properties) {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    if ((type & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      return true;
+  return false;
+}
+
 VkFormat Resources::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
   for (VkFormat format : candidates) {
     VkFormatProperties props;
@@ -127,6 +136,19 @@ void Resources::destroyBuffer(VkBuffer buffer, VkDeviceMemory bufferMemory) {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Resources::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+  createImage(width, height, format, tiling, usage, image);
+
+  //===================================================
+  // Выделение памяти, на которую будет опираться изображение
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(core->device, image, &memRequirements);
+  imageMemory = allocateMemory(memRequirements, properties);
+
+  vkBindImageMemory(core->device, image, imageMemory, 0);
+}
+
+void Resources::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage& image) {
   //===================================================
   // Создание изображения
 
@@ -157,22 +179,18 @@ void Resources::createImage(uint32_t width, uint32_t height, VkFormat format, Vk
 
   if (vkCreateImage(core->device, &imageInfo, nullptr, &image) != VK_SUCCESS)
     throw std::runtime_error("ERROR: Failed to create image!");
+}
 
-  //===================================================
-  // Выделение памяти, на которую будет опираться изображение
-
-  VkMemoryRequirements memRequirements;
-  vkGetImageMemoryRequirements(core->device, image, &memRequirements);
-
+VkDeviceMemory Resources::allocateMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) {
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryTypeIndex(memRequirements.memoryTypeBits, properties);
+  allocInfo.allocationSize = requirements.size;
+  allocInfo.memoryTypeIndex = findMemoryTypeIndex(requirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(core->device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(core->device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
     throw std::runtime_error("ERROR: Failed to allocate image memory!");
-
-  vkBindImageMemory(core->device, image, imageMemory, 0);
+  return memory;
 }
 
 void Resources::destroyImage(VkImage image, VkDeviceMemory imageMemory) {
@@ -180,10 +198,11 @@ void Resources::destroyImage(VkImage image, VkDeviceMemory imageMemory) {
   vkFreeMemory(core->device, imageMemory, nullptr);
 }
 
-VkImageView Resources::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView Resources::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkComponentMapping components) {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.components = components;
 
   viewInfo.image = image;
   viewInfo.format = format;
@@ -219,29 +238,78 @@ std::vector<VkImageView> Resources::createImageViews(std::vector<VkImage>& image
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VkSampler Resources::createImageSampler(VkSamplerAddressMode mode) {
+VkSampler Resources::getSampler(VkSamplerAddressMode mode) {
+  sampler_t state;
+  state.address = mode;
+  return getSampler(state);
+}
+
+VkSampler Resources::getSampler(const sampler_t& request) {
+  sampler_t state = resolveSampler(request);
+  auto el = samplers.find(state);
+  if (el != samplers.end())
+    return el->second;
+
   VkSamplerCreateInfo samplerInfo{};
   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  samplerInfo.magFilter = VK_FILTER_LINEAR;
-  samplerInfo.minFilter = VK_FILTER_LINEAR;
-  samplerInfo.anisotropyEnable = VK_TRUE;
-  samplerInfo.maxAnisotropy = core->physicalDevice.properties.limits.maxSamplerAnisotropy;
-  samplerInfo.addressModeU = mode;
-  samplerInfo.addressModeV = mode;
-  samplerInfo.addressModeW = mode;
+  samplerInfo.magFilter = state.filter;
+  samplerInfo.minFilter = state.filter;
+  samplerInfo.anisotropyEnable = state.anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+  samplerInfo.maxAnisotropy = state.anisotropy;
+  samplerInfo.addressModeU = state.address;
+  samplerInfo.addressModeV = state.address;
+  samplerInfo.addressModeW = state.address;
   samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
   samplerInfo.unnormalizedCoordinates = VK_FALSE;
   samplerInfo.compareEnable = VK_FALSE;
   samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.mipmapMode = state.mipmap;
+  samplerInfo.mipLodBias = state.lodBias;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
   VkSampler sampler;
   if (vkCreateSampler(core->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
     throw std::runtime_error("ERROR: Failed to create texture sampler!");
+  samplers.insert(std::make_pair(state, sampler));
   return sampler;
 }
 
-void Resources::destroyImageSampler(VkSampler sampler) {
-  if (sampler != nullptr)
-    vkDestroySampler(core->device, sampler, nullptr);
+Resources::sampler_t Resources::resolveSampler(const sampler_t& request) {
+  sampler_t state = request;
+
+  float limit = core->physicalDevice.properties.limits.maxSamplerAnisotropy;
+  switch (samplerQuality) {
+    case SAMPLER_QUALITY_LOW:
+      limit = 1.0f;
+      if (state.mipmap == VK_SAMPLER_MIPMAP_MODE_LINEAR)
+        state.mipmap = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+      break;
+    case SAMPLER_QUALITY_MEDIUM:
+      limit = std::min(limit, 2.0f);
+      break;
+    case SAMPLER_QUALITY_HIGH:
+      limit = std::min(limit, 8.0f);
+      break;
+    case SAMPLER_QUALITY_ULTRA:
+      break;
+  }
+
+  state.anisotropy = std::max(1.0f, std::min(state.anisotropy, limit));
+  if (state.filter == VK_FILTER_NEAREST)
+    state.anisotropy = 1.0f;
+
+  // Смещение уровня детализации из материала - в пределах устройства
+  float maxBias = core->physicalDevice.properties.limits.maxSamplerLodBias;
+  state.lodBias = std::clamp(state.lodBias, -maxBias, maxBias);
+  return state;
+}
+
+size_t Resources::samplerHash::operator()(const sampler_t& state) const {
+  size_t result = std::hash<uint32_t>()(state.filter);
+  result = result * 31 + std::hash<uint32_t>()(state.mipmap);
+  result = result * 31 + std::hash<uint32_t>()(state.address);
+  result = result * 31 + std::hash<float>()(state.anisotropy);
+  result = result * 31 + std::hash<float>()(state.lodBias);
+  return result;
 }
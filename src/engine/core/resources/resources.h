@@ -4,8 +4,11 @@
 #include "core.h"
 
 // Стандартные библиотеки
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
+#include <functional>
+#include <unordered_map>
 
 class Core;
 
@@ -21,6 +24,7 @@ class Resources {
 
   VkPhysicalDeviceMemoryProperties memoryProperties;
   uint32_t findMemoryTypeIndex(uint32_t type, VkMemoryPropertyFlags);
+  bool hasMemoryType(uint32_t type, VkMemoryPropertyFlags);
   VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
   //=========================================================================
@@ -42,16 +46,48 @@ class Resources {
   // Изображения - хранилище структурированных данных
 
   void createImage(uint32_t width, uint32_t height, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkImage&, VkDeviceMemory&);
+  void createImage(uint32_t width, uint32_t height, VkFormat, VkImageTiling, VkImageUsageFlags, VkImage&);  // Без памяти - её привязывает владелец
   void destroyImage(VkImage, VkDeviceMemory);
 
-  VkImageView createImageView(VkImage, VkFormat, VkImageAspectFlags);
+  VkDeviceMemory allocateMemory(const VkMemoryRequirements&, VkMemoryPropertyFlags);
+
+  VkImageView createImageView(VkImage, VkFormat, VkImageAspectFlags, VkComponentMapping = {});
   void destroyImageView(VkImageView);
 
   std::vector<VkImageView> createImageViews(std::vector<VkImage>&, VkFormat, VkImageAspectFlags);
   void destroyImageViews(std::vector<VkImageView>&);
 
-  VkSampler createImageSampler(VkSamplerAddressMode);
-  void destroyImageSampler(VkSampler);
+  //=========================================================================
+  // Сэмплеры - общие неизменяемые объекты, кэшируются по полному состоянию
+
+  // Глобальный уровень качества фильтрации (ограничивает запросы материалов)
+  enum SamplerQuality {
+    SAMPLER_QUALITY_LOW,     // Билинейная фильтрация без анизотропии
+    SAMPLER_QUALITY_MEDIUM,  // Трилинейная фильтрация, анизотропия x2
+    SAMPLER_QUALITY_HIGH,    // Трилинейная фильтрация, анизотропия x8
+    SAMPLER_QUALITY_ULTRA,   // Максимальная анизотропия устройства
+  };
+  SamplerQuality samplerQuality = SAMPLER_QUALITY_ULTRA;
+
+  struct sampler_t {
+    VkFilter filter = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmap = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode address = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    float anisotropy = 16.0f;  // Запрошенная анизотропия (1 - выключена)
+    float lodBias = 0.0f;
+
+    bool operator==(const sampler_t&) const = default;
+  };
+
+  VkSampler getSampler(const sampler_t&);
+  VkSampler getSampler(VkSamplerAddressMode);
+  sampler_t resolveSampler(const sampler_t&);  // Состояние с учётом уровня качества
+
+ private:
+  struct samplerHash {
+    size_t operator()(const sampler_t&) const;
+  };
+  std::unordered_map<sampler_t, VkSampler, samplerHash> samplers;
 
   //=========================================================================
 };
@@ -11,34 +11,62 @@ Frames::Frames(Core::Manager core) {
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
   currentFrameIndex = 0;
-  for (uint32_t i = 0; i < core->swapchain.count; ++i) {
+  for (uint32_t i = 0; i < core->framesInFlight; ++i) {
     auto frame = new frame_t;
     frame->cmdPool = core->commands->createCommandBufferPool();
+    frame->sceneCmdBuffer = core->commands->createCommandBuffer(frame->cmdPool);
     frame->cmdBuffer = core->commands->createCommandBuffer(frame->cmdPool);
 
     vkCreateFence(core->device, &fenceInfo, nullptr, &frame->drawing);
-    vkCreateFence(core->device, &fenceInfo, nullptr, &frame->showing);
-    fences.push_back(frame->drawing);
-    fences.push_back(frame->showing);
-
     vkCreateSemaphore(core->device, &semaphoreInfo, nullptr, &frame->imageAvailable);
-    vkCreateSemaphore(core->device, &semaphoreInfo, nullptr, &frame->imageRendered);
-    semaphores.push_back(frame->imageAvailable);
-    semaphores.push_back(frame->imageRendered);
+    frame->pending = false;
 
     handlers.push_back(frame);
   }
+
+  createImages();
 }
 
 Frames::~Frames() {
-  for (auto frame : handlers)
+  destroyImages();
+  for (auto frame : handlers) {
     core->commands->destroyCommandBufferPool(frame->cmdPool);
-  for (auto fence : fences)
-    vkDestroyFence(core->device, fence, nullptr);
-  for (auto semaphore : semaphores)
-    vkDestroySemaphore(core->device, semaphore, nullptr);
+    vkDestroyFence(core->device, frame->drawing, nullptr);
+    vkDestroySemaphore(core->device, frame->imageAvailable, nullptr);
+    delete frame;
+  }
+}
+
+void Frames::resize() {
+  destroyImages();
+  createImages();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Frames::createImages() {
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  // Семафор показа - по изображению: его ждёт показ, а не следующий кадр того же контекста
+  for (uint32_t i = 0; i < core->swapchain.count; ++i) {
+    auto image = new image_t;
+    image->showing = VK_NULL_HANDLE;
+    vkCreateSemaphore(core->device, &semaphoreInfo, nullptr, &image->imageRendered);
+    images.push_back(image);
+  }
+}
+
+void Frames::destroyImages() {
+  for (auto image : images) {
+    vkDestroySemaphore(core->device, image->imageRendered, nullptr);
+    delete image;
+  }
+  images.clear();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 Frames::Instance Frames::getFrame(uint32_t id) {
   return handlers[id];
 }
@@ -46,3 +74,11 @@ Frames::Instance Frames::getFrame(uint32_t id) {
 Frames::Instance Frames::getCurrentFrame() {
   return handlers[currentFrameIndex];
 }
+
+Frames::Image Frames::getImage(uint32_t index) {
+  return images[index];
+}
+
+void Frames::next() {
+  currentFrameIndex = (currentFrameIndex + 1) % static_cast<uint32_t>(handlers.size());
+}
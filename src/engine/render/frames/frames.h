@@ -4,38 +4,55 @@
 #include "core.h"
 
 // Стандартные библиотеки
+#include <chrono>
 #include <vector>
 
+// Кадры в работе (core->framesInFlight) и изображения цепочки показа - независимо друг от друга:
+// кадр получает любое свободное изображение, изображение помнит кадр, который в него рисует
 class Frames {
  public:
   typedef Frames* Manager;
 
   typedef struct frame_t {
-    // Задания кадра
+    // Задания кадра: проходы до изображения показа отправляются без ожидания его получения
     VkCommandPool cmdPool;
+    VkCommandBuffer sceneCmdBuffer;
     VkCommandBuffer cmdBuffer;
 
     // Синхронизация кадров
     VkFence drawing;
-    VkFence showing;
 
     // Синхронизация внутри кадра
     VkSemaphore imageAvailable;
-    VkSemaphore imageRendered;
+
+    // Начало подготовки кадра - задержка до завершения на GPU
+    std::chrono::high_resolution_clock::time_point started;
+    bool pending;
   } * Instance;
 
+  typedef struct image_t {
+    VkFence showing;           // Забор кадра, рисующего в изображение (не владеет)
+    VkSemaphore imageRendered;  // Показ ждёт команд рендера
+  } * Image;
+
  private:
   Core::Manager core;
 
   std::vector<Instance> handlers;
-  std::vector<VkFence> fences;
-  std::vector<VkSemaphore> semaphores;
+  std::vector<Image> images;
+
+  void createImages();
+  void destroyImages();
 
  public:
   explicit Frames(Core::Manager);
   ~Frames();
 
+  void resize();  // Новая цепочка показа
+
   uint32_t currentFrameIndex;
   Instance getFrame(uint32_t id);
   Instance getCurrentFrame();
+  Image getImage(uint32_t index);
+  void next();
 };
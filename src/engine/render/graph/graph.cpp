@@ -0,0 +1,707 @@
+#include "graph.h"
+
+Graph::Graph(Core::Manager core) {
+  this->core = core;
+}
+
+Graph::~Graph() {
+  destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Graph::Resource Graph::createImage(const std::string& name, const image_t& desc) {
+  resource_t resource{};
+  resource.name = name;
+  resource.desc = desc;
+  resource.imported = false;
+  resource.usage = desc.usage;
+  resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resource.outputLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resources.push_back(resource);
+  compiled = false;
+  return static_cast<Resource>(resources.size() - 1);
+}
+
+Graph::Resource Graph::importSwapchain(const std::string& name) {
+  resource_t resource{};
+  resource.name = name;
+  resource.desc.format = core->swapchain.format;
+  resource.desc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+  resource.imported = true;
+  resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resource.outputLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resources.push_back(resource);
+  compiled = false;
+  return static_cast<Resource>(resources.size() - 1);
+}
+
+Graph::Resource Graph::importBuffer(const std::string& name) {
+  resource_t resource{};
+  resource.name = name;
+  resource.imported = false;
+  resource.buffer = true;
+  resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resource.outputLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  resources.push_back(resource);
+  compiled = false;
+  return static_cast<Resource>(resources.size() - 1);
+}
+
+void Graph::setOutput(Resource id, VkImageLayout layout) {
+  resources[id].output = true;
+  resources[id].outputLayout = layout;
+  compiled = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkExtent2D Graph::getExtent(Resource id) {
+  create();
+  return resources[id].extent;
+}
+
+VkFormat Graph::getFormat(Resource id) {
+  return resources[id].desc.format;
+}
+
+const std::vector<VkImage>& Graph::getImages(Resource id) {
+  create();
+  return resources[id].images;
+}
+
+const std::vector<VkImageView>& Graph::getViews(Resource id) {
+  create();
+  return resources[id].views;
+}
+
+Graph::memory_t Graph::getMemory() {
+  create();
+  return memory;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Graph::Node Graph::addPass(const std::string& name, Record record, Resize resize) {
+  node_t node{};
+  node.name = name;
+  node.record = record;
+  node.resize = resize;
+  node.enabled = true;
+  node.executed = false;
+  nodes.push_back(node);
+  compiled = false;
+  return static_cast<Node>(nodes.size() - 1);
+}
+
+void Graph::use(Node id, Resource resource, Access access, bool discard, VkImageLayout leave) {
+  nodes[id].uses.push_back({resource, access, discard, leave});
+
+  // Новый доступ меняет назначения и времена жизни - изображения пересоздаются при сборке
+  auto& target = resources[resource];
+  target.usage |= getUsage(access);
+  target.history |= access == ACCESS_HISTORY;
+  if (created)
+    target.stale = true;
+  compiled = false;
+}
+
+void Graph::setEnabled(Node id, bool enabled) {
+  if (nodes[id].enabled == enabled)
+    return;
+  nodes[id].enabled = enabled;
+  compiled = false;
+}
+
+bool Graph::isExecuted(Node id) {
+  if (!compiled)
+    compile();
+  return nodes[id].executed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Graph::compile() {
+  // Изображения, получившие новые назначения, пересоздаются со всеми проходами
+  bool stale = false;
+  for (auto& resource : resources)
+    stale |= resource.stale;
+
+  // Проходы добавлены после создания - меняются порядок и времена жизни изображений
+  if (sequence.size() != nodes.size()) {
+    if (created)
+      stale = true;
+    else
+      sort();
+  }
+  if (stale) {
+    vkDeviceWaitIdle(core->device);
+    resize();
+  }
+
+  //=========================================================================
+  // Отбрасывание проходов: обратный обход от выходов графа
+
+  std::vector<bool> needed(resources.size(), false);
+  for (uint32_t i = 0; i < resources.size(); ++i)
+    needed[i] = resources[i].output;
+
+  for (uint32_t i = static_cast<uint32_t>(sequence.size()); i-- > 0;) {
+    auto& node = nodes[sequence[i]];
+    node.executed = false;
+    if (!node.enabled)
+      continue;
+
+    for (auto& use : node.uses)
+      node.executed |= isWrite(use.access) && needed[use.resource];
+    if (!node.executed)
+      continue;
+
+    // Перезаписанное целиком изображение не зависит от прошлых проходов,
+    // прочитанное - зависит от проходов, записавших его раньше. Копия прошлого кадра - не от них
+    for (auto& use : node.uses)
+      if (isWrite(use.access) && use.discard)
+        needed[use.resource] = false;
+    for (auto& use : node.uses)
+      if (use.access != ACCESS_HISTORY && (!isWrite(use.access) || !use.discard))
+        needed[use.resource] = true;
+  }
+
+  order.clear();
+  for (auto id : sequence)
+    if (nodes[id].executed)
+      order.push_back(id);
+
+  //=========================================================================
+  // Барьеры: дважды проходим кадр - второй раз начиная с состояний конца первого,
+  // так барьеры первых доступов учитывают последние доступы прошлого кадра
+
+  std::vector<state_t> states(resources.size(), {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, false});
+  std::vector<bool> used(resources.size(), false);
+  for (uint32_t round = 0; round < 2; ++round) {
+    std::vector<bool> touched(resources.size(), false);
+    for (auto id : order) {
+      auto& node = nodes[id];
+      node.barriers.clear();
+      for (auto& use : node.uses) {
+        // Копия прошлого кадра переведена к чтению в его конце - доступ к копии этого кадра не меняется
+        if (use.access == ACCESS_HISTORY)
+          continue;
+
+        auto& resource = resources[use.resource];
+        state_t& current = states[use.resource];
+        state_t next = getState(use.access);
+        used[use.resource] = true;
+
+        // У буфера нет раскладок, вычислительный проход заполняет его и копированием
+        if (resource.buffer) {
+          next.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+          if (use.access == ACCESS_STORAGE) {
+            next.stage |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+            next.access |= VK_ACCESS_TRANSFER_WRITE_BIT;
+          }
+        }
+
+        // Память совмещённого изображения перед его первым доступом кадра занимали другие
+        if (!touched[use.resource] && resource.transient && resource.block != UINT32_MAX &&
+            blocks[resource.block].resources.size() > 1) {
+          current.stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+          current.access = VK_ACCESS_MEMORY_WRITE_BIT;
+          current.write = true;
+        }
+        touched[use.resource] = true;
+
+        // Раскладка меняется, либо один из доступов - запись
+        if (current.layout != next.layout || current.write || next.write) {
+          barrier_t barrier{};
+          barrier.resource = use.resource;
+          barrier.oldLayout = use.discard ? VK_IMAGE_LAYOUT_UNDEFINED : current.layout;
+          barrier.newLayout = next.layout;
+          barrier.srcStage = current.stage;
+          barrier.dstStage = next.stage;
+          barrier.srcAccess = current.write ? current.access : 0;
+          barrier.dstAccess = next.access;
+          node.barriers.push_back(barrier);
+        }
+
+        // Проход сам переводит изображение - его последний доступ неизвестен
+        if (use.leave != VK_IMAGE_LAYOUT_UNDEFINED) {
+          next.layout = use.leave;
+          next.stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        }
+        current = next;
+      }
+    }
+
+    // Выходы в конце кадра переводятся в заданные раскладки, истории - к чтению в шейдере:
+    // следующий кадр читает копию этого без барьеров, их порядок задаёт очередь
+    finalBarriers.clear();
+    for (uint32_t i = 0; i < resources.size(); ++i) {
+      auto& resource = resources[i];
+      if (!used[i])
+        continue;
+
+      state_t next;
+      if (resource.history) {
+        next = getState(ACCESS_HISTORY);
+        if (states[i].layout == next.layout && !states[i].write)
+          continue;
+      } else if (resource.output && resource.outputLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+        next = getState(ACCESS_PRESENT);
+        next.layout = resource.outputLayout;
+        if (states[i].layout == next.layout)
+          continue;
+      } else {
+        continue;
+      }
+
+      barrier_t barrier{};
+      barrier.resource = i;
+      barrier.oldLayout = states[i].layout;
+      barrier.newLayout = next.layout;
+      barrier.srcStage = states[i].stage;
+      barrier.dstStage = next.stage;
+      barrier.srcAccess = states[i].write ? states[i].access : 0;
+      barrier.dstAccess = next.access;
+      finalBarriers.push_back(barrier);
+      states[i] = next;
+    }
+  }
+
+  //=========================================================================
+  // Изображения графа между кадрами находятся в раскладке конца кадра
+
+  std::vector<barrier_t> transitions;
+  for (uint32_t i = 0; i < resources.size(); ++i) {
+    auto& resource = resources[i];
+    if (resource.imported || resource.transient || !used[i] || resource.layout == states[i].layout)
+      continue;
+
+    barrier_t barrier{};
+    barrier.resource = i;
+    barrier.oldLayout = resource.layout;
+    barrier.newLayout = states[i].layout;
+    barrier.srcStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    barrier.dstStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    barrier.srcAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccess = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    transitions.push_back(barrier);
+    resource.layout = states[i].layout;
+  }
+
+  if (!transitions.empty()) {
+    // Перевод всех копий разом - кадры в работе выполняются раньше в той же очереди
+    VkCommandBuffer cmd = core->commands->beginSingleTimeCommands();
+    for (uint32_t frame = 0; frame < core->framesInFlight; ++frame)
+      recordBarriers(frame, 0, cmd, transitions);
+    core->commands->endSingleTimeCommands(cmd);
+  }
+
+  compiled = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Graph::create() {
+  if (created)
+    return;
+
+  analyze();
+  memory = {};
+  for (auto& resource : resources)
+    createImages(resource);
+  createBlocks();
+  for (auto& resource : resources)
+    createViews(resource);
+
+  created = true;
+  compiled = false;
+
+  float megabyte = 1024.0f * 1024.0f;
+  std::cout << "Render targets: " << memory.allocated / megabyte << " MB ("
+            << memory.separate / megabyte << " MB without aliasing, "
+            << memory.lazy / megabyte << " MB lazily allocated)" << std::endl;
+}
+
+void Graph::resize() {
+  destroy();
+  for (auto& resource : resources)
+    resource.stale = false;
+  create();
+
+  // Проходы получают новые изображения - в том числе выключенные
+  for (auto& node : nodes)
+    if (node.resize != nullptr)
+      node.resize();
+
+  compiled = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Graph::execute(uint32_t frame, uint32_t image, VkCommandBuffer cmd) {
+  execute(frame, image, cmd, cmd);
+}
+
+void Graph::execute(uint32_t frame, uint32_t image, VkCommandBuffer before, VkCommandBuffer after) {
+  if (!compiled)
+    compile();
+
+  VkCommandBuffer cmd = before;
+  for (auto id : order) {
+    for (auto& use : nodes[id].uses)
+      if (resources[use.resource].imported)
+        cmd = after;
+    recordBarriers(frame, image, cmd, nodes[id].barriers);
+    nodes[id].record(frame, image, cmd);
+  }
+  recordBarriers(frame, image, after, finalBarriers);
+}
+
+void Graph::recordBarriers(uint32_t frame, uint32_t image, VkCommandBuffer cmd, const std::vector<barrier_t>& barriers) {
+  if (barriers.empty())
+    return;
+
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  std::vector<VkMemoryBarrier> memoryBarriers;
+  VkPipelineStageFlags srcStage = 0, dstStage = 0;
+  for (auto& barrier : barriers) {
+    auto& resource = resources[barrier.resource];
+    srcStage |= barrier.srcStage;
+    dstStage |= barrier.dstStage;
+
+    // Буфер прохода - без дескриптора буфера достаточно глобального барьера памяти
+    if (resource.buffer) {
+      VkMemoryBarrier memoryBarrier{};
+      memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      memoryBarrier.srcAccessMask = barrier.srcAccess;
+      memoryBarrier.dstAccessMask = barrier.dstAccess;
+      memoryBarriers.push_back(memoryBarrier);
+      continue;
+    }
+
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = resource.images[resource.imported ? image : frame];
+    imageBarrier.oldLayout = barrier.oldLayout;
+    imageBarrier.newLayout = barrier.newLayout;
+    imageBarrier.srcAccessMask = barrier.srcAccess;
+    imageBarrier.dstAccessMask = barrier.dstAccess;
+    imageBarrier.subresourceRange.aspectMask = resource.desc.aspect;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = 1;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+    imageBarriers.push_back(imageBarrier);
+  }
+
+  vkCmdPipelineBarrier(
+      cmd,
+      srcStage, dstStage,
+      0,
+      static_cast<uint32_t>(memoryBarriers.size()), memoryBarriers.data(),
+      0, nullptr,
+      static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Graph::sort() {
+  // Зависимости в порядке объявления доступов к каждому ресурсу: чтение - от последней
+  // записи, запись - от последней записи и всех чтений после неё
+  std::vector<std::vector<Node>> dependents(nodes.size());
+  std::vector<uint32_t> dependencies(nodes.size(), 0);
+  auto link = [&](Node from, Node to) {
+    auto& list = dependents[from];
+    if (from == to || std::find(list.begin(), list.end(), to) != list.end())
+      return;
+    list.push_back(to);
+    dependencies[to]++;
+  };
+
+  std::vector<uint32_t> writers(resources.size(), UINT32_MAX);
+  std::vector<std::vector<Node>> readers(resources.size());
+  for (Node i = 0; i < nodes.size(); ++i) {
+    for (auto& use : nodes[i].uses) {
+      if (use.access == ACCESS_HISTORY)
+        continue;  // Копию прошлого кадра записал прошлый кадр
+      if (writers[use.resource] != UINT32_MAX)
+        link(writers[use.resource], i);
+      if (!isWrite(use.access)) {
+        readers[use.resource].push_back(i);
+        continue;
+      }
+      for (auto reader : readers[use.resource])
+        link(reader, i);
+      readers[use.resource].clear();
+      writers[use.resource] = i;
+    }
+  }
+
+  auto presents = [this](Node id) {
+    for (auto& use : nodes[id].uses)
+      if (resources[use.resource].imported)
+        return true;
+    return false;
+  };
+
+  // Из готовых проходов первым идёт не использующий изображение показа - такие проходы
+  // записываются в буфер, отправляемый до получения изображения. Иначе - по объявлению.
+  // Зависимости ведут только к проходам, объявленным позже, - циклов нет
+  sequence.clear();
+  std::vector<bool> placed(nodes.size(), false);
+  while (sequence.size() < nodes.size()) {
+    Node next = UINT32_MAX;
+    for (Node i = 0; i < nodes.size(); ++i) {
+      if (placed[i] || dependencies[i] != 0)
+        continue;
+      if (next == UINT32_MAX || (presents(next) && !presents(i)))
+        next = i;
+    }
+
+    placed[next] = true;
+    sequence.push_back(next);
+    for (auto dependent : dependents[next])
+      dependencies[dependent]--;
+  }
+}
+
+void Graph::analyze() {
+  sort();
+  for (auto& resource : resources) {
+    resource.first = UINT32_MAX;
+    resource.last = 0;
+    resource.transient = false;
+    resource.block = UINT32_MAX;
+  }
+
+  // Позиции в порядке зависимостей всех проходов: времена жизни не зависят от выключенных
+  for (uint32_t i = 0; i < sequence.size(); ++i) {
+    for (auto& use : nodes[sequence[i]].uses) {
+      if (use.access == ACCESS_HISTORY)
+        continue;
+      auto& resource = resources[use.resource];
+      if (resource.first == UINT32_MAX)
+        resource.transient = isWrite(use.access) && use.discard;
+      resource.first = std::min(resource.first, i);
+      resource.last = std::max(resource.last, i);
+    }
+  }
+
+  // Содержимое переходных изображений не нужно ни после кадра, ни приложению
+  VkImageUsageFlags attachments = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  for (auto& resource : resources) {
+    resource.transient &= !resource.imported && !resource.buffer && !resource.output && !resource.history;
+    resource.lazy = resource.transient && (resource.usage & ~attachments) == 0;
+  }
+}
+
+void Graph::createImages(resource_t& resource) {
+  if (resource.buffer)
+    return;
+
+  if (resource.imported) {
+    resource.desc.format = core->swapchain.format;
+    resource.extent = core->swapchain.extent;
+    resource.images = core->swapchain.images;
+    resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return;
+  }
+
+  resource.extent.width = std::max(core->swapchain.extent.width / resource.desc.divisor, 1u);
+  resource.extent.height = std::max(core->swapchain.extent.height / resource.desc.divisor, 1u);
+
+  // Раскладку начала кадра изображения получат при сборке графа
+  resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  VkImageUsageFlags usage = resource.usage;
+  if (resource.lazy)
+    usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+  uint32_t count = resource.transient ? 1 : core->framesInFlight;
+  resource.images.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    core->resources->createImage(
+        resource.extent.width, resource.extent.height, resource.desc.format,
+        VK_IMAGE_TILING_OPTIMAL,
+        usage,
+        resource.images[i]);
+  }
+  vkGetImageMemoryRequirements(core->device, resource.images[0], &resource.requirements);
+  memory.separate += resource.requirements.size * count;
+
+  // Подключение без чтения - память по требованию, если устройство её поддерживает
+  VkMemoryPropertyFlags lazyProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+  resource.lazy &= core->resources->hasMemoryType(resource.requirements.memoryTypeBits, lazyProperties);
+  if (resource.lazy) {
+    resource.memory.push_back(core->resources->allocateMemory(resource.requirements, lazyProperties));
+    memory.lazy += resource.requirements.size;
+  } else if (resource.transient) {
+    return;  // Память - общий блок
+  } else {
+    for (uint32_t i = 0; i < count; ++i)
+      resource.memory.push_back(core->resources->allocateMemory(resource.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+    memory.allocated += resource.requirements.size * count;
+  }
+
+  for (uint32_t i = 0; i < count; ++i)
+    vkBindImageMemory(core->device, resource.images[i], resource.memory[i], 0);
+}
+
+void Graph::createBlocks() {
+  // Крупные изображения первыми - меньшие занимают их блоки в свободное время
+  std::vector<Resource> candidates;
+  for (uint32_t i = 0; i < resources.size(); ++i)
+    if (resources[i].transient && !resources[i].lazy)
+      candidates.push_back(i);
+  std::sort(candidates.begin(), candidates.end(), [this](Resource a, Resource b) {
+    return resources[a].requirements.size > resources[b].requirements.size;
+  });
+
+  for (auto id : candidates) {
+    auto& resource = resources[id];
+    for (uint32_t i = 0; i < blocks.size() && resource.block == UINT32_MAX; ++i) {
+      auto& block = blocks[i];
+      uint32_t types = block.requirements.memoryTypeBits & resource.requirements.memoryTypeBits;
+      if (!core->resources->hasMemoryType(types, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+        continue;
+
+      bool overlap = false;
+      for (auto other : block.resources)
+        overlap |= resources[other].first <= resource.last && resource.first <= resources[other].last;
+      if (overlap)
+        continue;
+
+      block.requirements.size = std::max(block.requirements.size, resource.requirements.size);
+      block.requirements.alignment = std::max(block.requirements.alignment, resource.requirements.alignment);
+      block.requirements.memoryTypeBits = types;
+      block.resources.push_back(id);
+      resource.block = i;
+    }
+
+    if (resource.block == UINT32_MAX) {
+      blocks.push_back({VK_NULL_HANDLE, resource.requirements, {id}});
+      resource.block = static_cast<uint32_t>(blocks.size() - 1);
+    }
+  }
+
+  // Все изображения блока - с начала его памяти
+  for (auto& block : blocks) {
+    block.memory = core->resources->allocateMemory(block.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    memory.allocated += block.requirements.size;
+    for (auto id : block.resources)
+      vkBindImageMemory(core->device, resources[id].images[0], block.memory, 0);
+  }
+}
+
+void Graph::createViews(resource_t& resource) {
+  if (resource.buffer)
+    return;
+
+  resource.views.resize(resource.images.size());
+  for (uint32_t i = 0; i < resource.images.size(); ++i)
+    resource.views[i] = core->resources->createImageView(resource.images[i], resource.desc.format, resource.desc.aspect);
+
+  // Переходное изображение общее для всех кадров в работе
+  if (!resource.imported) {
+    resource.images.resize(core->framesInFlight, resource.images[0]);
+    resource.views.resize(core->framesInFlight, resource.views[0]);
+  }
+}
+
+void Graph::destroy() {
+  if (!created)
+    return;
+
+  for (auto& resource : resources) {
+    uint32_t count = resource.transient ? 1 : static_cast<uint32_t>(resource.views.size());
+    for (uint32_t i = 0; i < count; ++i) {
+      core->resources->destroyImageView(resource.views[i]);
+      if (!resource.imported)
+        vkDestroyImage(core->device, resource.images[i], nullptr);
+    }
+    for (auto allocation : resource.memory)
+      vkFreeMemory(core->device, allocation, nullptr);
+
+    resource.images.clear();
+    resource.memory.clear();
+    resource.views.clear();
+  }
+
+  for (auto& block : blocks)
+    vkFreeMemory(core->device, block.memory, nullptr);
+  blocks.clear();
+
+  created = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Graph::state_t Graph::getState(Access access) {
+  switch (access) {
+    case ACCESS_COLOR:
+      return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+              VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+              VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+              true};
+    case ACCESS_DEPTH:
+      return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+              true};
+    case ACCESS_SAMPLED:
+    case ACCESS_HISTORY:
+      return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT,
+              false};
+    case ACCESS_STORAGE:
+      return {VK_IMAGE_LAYOUT_GENERAL,
+              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+              true};
+    case ACCESS_TRANSFER_SRC:
+      return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+              VK_PIPELINE_STAGE_TRANSFER_BIT,
+              VK_ACCESS_TRANSFER_READ_BIT,
+              false};
+    case ACCESS_INDIRECT:
+      return {VK_IMAGE_LAYOUT_UNDEFINED,
+              VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+              VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+              false};
+    case ACCESS_PRESENT:
+      // Этап ожидания семафора получения изображения - с ним связан первый доступ кадра
+      return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+              VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+              0,
+              false};
+  }
+  throw std::runtime_error("ERROR: Unknown render graph access!");
+}
+
+VkImageUsageFlags Graph::getUsage(Access access) {
+  switch (access) {
+    case ACCESS_COLOR:
+      return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case ACCESS_DEPTH:
+      return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case ACCESS_SAMPLED:
+    case ACCESS_HISTORY:
+      return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case ACCESS_STORAGE:
+      return VK_IMAGE_USAGE_STORAGE_BIT;
+    case ACCESS_TRANSFER_SRC:
+      return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case ACCESS_PRESENT:
+    case ACCESS_INDIRECT:
+      return 0;
+  }
+  return 0;
+}
+
+bool Graph::isWrite(Access access) {
+  return getState(access).write;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+// Внутренние библиотеки
+#include "core.h"
+
+// Стандартные библиотеки
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Граф рендера - проходы объявляют изображения и буферы, которые читают и пишут.
+// По объявлениям граф строит порядок выполнения, отбрасывает проходы, не влияющие
+// на выходы, расставляет барьеры между ними и (пере)создаёт свои изображения
+// при смене размера цепочки показа. Изображения - по копии на кадр в работе,
+// кроме переходных: они живут внутри кадра и совмещаются в памяти с другими переходными.
+// Изображения цепочки показа выбираются по номеру полученного изображения
+class Graph {
+ public:
+  typedef Graph* Manager;
+  typedef uint32_t Resource;
+  typedef uint32_t Node;
+
+  explicit Graph(Core::Manager);
+  ~Graph();
+
+  //=========================================================================
+  // Ресурсы графа
+
+  // Описание изображения, которым владеет граф
+  struct image_t {
+    VkFormat format;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    uint32_t divisor = 1;        // Размер - доля размера цепочки показа
+    VkImageUsageFlags usage = 0;  // Дополнительно к назначениям из объявленных доступов
+  };
+
+  Resource createImage(const std::string& name, const image_t&);
+  Resource importSwapchain(const std::string& name);
+
+  // Буфер, которым владеет проход - граф только упорядочивает доступы к нему и ставит барьеры памяти
+  Resource importBuffer(const std::string& name);
+
+  // Выходы графа - проходы, от которых они не зависят, не выполняются
+  void setOutput(Resource, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);  // Раскладка в конце кадра
+
+  VkExtent2D getExtent(Resource);
+  VkFormat getFormat(Resource);
+  const std::vector<VkImage>& getImages(Resource);
+  const std::vector<VkImageView>& getViews(Resource);
+
+  // Память изображений графа
+  struct memory_t {
+    VkDeviceSize allocated;  // Выделено
+    VkDeviceSize separate;   // Без совмещения - каждое изображение в своей памяти
+    VkDeviceSize lazy;       // Выделяется устройством по требованию, в allocated не входит
+  };
+  memory_t getMemory();
+
+  //=========================================================================
+  // Проходы графа
+
+  // Способ использования ресурса проходом
+  enum Access {
+    ACCESS_COLOR,         // Цветовое подключение
+    ACCESS_DEPTH,         // Подключение глубины
+    ACCESS_SAMPLED,       // Чтение в шейдере
+    ACCESS_STORAGE,       // Чтение и запись в вычислительном шейдере
+    ACCESS_TRANSFER_SRC,  // Источник копирования
+    ACCESS_PRESENT,       // Показ
+    ACCESS_INDIRECT,      // Косвенные команды и вершинный поток (буфер)
+    ACCESS_HISTORY,       // Чтение в шейдере копии прошлого кадра - её готовит конец прошлого кадра
+  };
+
+  // frame - кадр в работе (копии изображений графа), image - изображение цепочки показа
+  typedef std::function<void(uint32_t frame, uint32_t image, VkCommandBuffer)> Record;
+  typedef std::function<void()> Resize;
+
+  // Порядок выполнения - по зависимостям через ресурсы: доступ зависит от доступов к тому же
+  // ресурсу, добавленных раньше (чтение - от записи, запись - от чтения и записи).
+  // Независимые проходы граф переставляет: проходы без изображения показа идут первыми.
+  // Изображения создаются при первом запросе: все доступы к ним объявляются до этого,
+  // новое назначение созданного изображения пересоздаёт их вместе с проходами
+  Node addPass(const std::string& name, Record, Resize = nullptr);
+
+  // discard - прошлое содержимое не нужно (очистка)
+  // leave - раскладка, в которой проход оставляет изображение, если её меняет сам проход рендера
+  void use(Node, Resource, Access, bool discard = false, VkImageLayout leave = VK_IMAGE_LAYOUT_UNDEFINED);
+
+  void setEnabled(Node, bool);
+  bool isExecuted(Node);  // Проход включён и не отброшен
+
+  //=========================================================================
+  // Выполнение
+
+  void compile();  // Выполняется автоматически после изменения графа
+  void create();   // Создание изображений графа по текущему размеру цепочки показа
+  void resize();   // Пересоздание изображений и обновление проходов
+
+  void execute(uint32_t frame, uint32_t image, VkCommandBuffer);
+
+  // Проходы до первого доступа к изображению цепочки показа записываются в before -
+  // их можно отправить, не дожидаясь получения изображения, остальные - в after
+  void execute(uint32_t frame, uint32_t image, VkCommandBuffer before, VkCommandBuffer after);
+
+  //=========================================================================
+
+ private:
+  Core::Manager core;
+
+  struct resource_t {
+    std::string name;
+    image_t desc;
+    bool imported;
+    bool buffer;   // Буфер прохода - без изображений и раскладок
+    bool history;  // Копию читает следующий кадр - не бывает переходным, в конце кадра готова к чтению
+    VkImageUsageFlags usage;
+    bool stale;            // Назначения изменились после создания
+    VkImageLayout layout;  // Раскладка всех копий между кадрами
+    VkImageLayout outputLayout;
+    bool output;
+
+    // Время жизни - первый и последний узел, использующие изображение (позиции в sequence)
+    uint32_t first, last;
+    bool transient;  // Первый доступ кадра перезаписывает изображение - достаточно одной копии
+    bool lazy;       // Только подключение прохода рендера - память по требованию
+    uint32_t block;  // Общий блок памяти переходного изображения
+
+    VkExtent2D extent;
+    VkMemoryRequirements requirements;
+    std::vector<VkImage> images;          // По копии на кадр в работе
+    std::vector<VkDeviceMemory> memory;  // Собственная память копий
+    std::vector<VkImageView> views;
+  };
+  std::vector<resource_t> resources;
+
+  // Блок памяти переходных изображений с непересекающимися временами жизни
+  struct block_t {
+    VkDeviceMemory memory;
+    VkMemoryRequirements requirements;
+    std::vector<Resource> resources;
+  };
+  std::vector<block_t> blocks;
+
+  bool created = false;
+  memory_t memory{};
+
+  struct use_t {
+    Resource resource;
+    Access access;
+    bool discard;
+    VkImageLayout leave;
+  };
+
+  // Барьер перед проходом - одно изображение, все его копии, или буфер
+  struct barrier_t {
+    Resource resource;
+    VkImageLayout oldLayout, newLayout;
+    VkPipelineStageFlags srcStage, dstStage;
+    VkAccessFlags srcAccess, dstAccess;
+  };
+
+  struct node_t {
+    std::string name;
+    Record record;
+    Resize resize;
+    std::vector<use_t> uses;
+    bool enabled;
+    bool executed;
+    std::vector<barrier_t> barriers;
+  };
+  std::vector<node_t> nodes;
+
+  std::vector<Node> sequence;            // Все проходы в порядке зависимостей
+  std::vector<Node> order;               // Проходы к выполнению
+  std::vector<barrier_t> finalBarriers;  // Перевод выходов в их раскладки и истории - к чтению
+  bool compiled = false;
+
+  // Состояние изображения между доступами
+  struct state_t {
+    VkImageLayout layout;
+    VkPipelineStageFlags stage;
+    VkAccessFlags access;
+    bool write;
+  };
+  static state_t getState(Access);
+  static VkImageUsageFlags getUsage(Access);
+  static bool isWrite(Access);
+
+  void sort();     // Порядок зависимостей - включённые и выключенные проходы вместе
+  void analyze();  // Времена жизни и переходные изображения по объявленным доступам
+  void createImages(resource_t&);
+  void createBlocks();
+  void createViews(resource_t&);
+  void destroy();
+  void recordBarriers(uint32_t frame, uint32_t image, VkCommandBuffer, const std::vector<barrier_t>&);
+};
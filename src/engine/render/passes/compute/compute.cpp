@@ -0,0 +1,130 @@
+#include "compute.h"
+
+void ComputePass::createShaderModules() {
+  computeShader = loadShaderModule("computeMain", computeShader);
+}
+
+VkShaderModule ComputePass::loadShaderModule(const std::string& entry, VkShaderModule old) {
+  try {
+    // Попытка (пере)компиляции нового шейдера в SPIR-V
+    Shaders::Instance instanceCompute = shader.manager->loadShader(shader.name, entry, SLANG_STAGE_COMPUTE, shader.defines);
+
+    // Удаление старого модуля
+    if (old != VK_NULL_HANDLE)
+      vkDestroyShaderModule(core->device, old, nullptr);
+
+    std::cout << "Shader \"" << shader.name << "\" (" << entry << ") was loaded successfully" << std::endl;
+    return instanceCompute->module;
+  } catch (std::exception& error) {
+    // Выведем ошибку компиляции шейдера
+    std::cerr << error.what();
+
+    // Вернём старый модуль
+    if (old != VK_NULL_HANDLE)
+      return old;
+    throw std::runtime_error("ERROR: shader was never loaded: " + shader.name);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputePass::createRenderPass() {
+  pipeline.pass = VK_NULL_HANDLE;
+}
+
+uint32_t ComputePass::getGroupCount(uint32_t count, uint32_t groupSize) {
+  return (count + groupSize - 1) / groupSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<VkExtent2D> ComputePass::getSupportedGroupSizes(const std::vector<VkExtent2D>& candidates) {
+  // Гарантированный минимум - 128 потоков в группе, больше даёт не каждое устройство
+  auto& limits = core->physicalDevice.properties.limits;
+  std::vector<VkExtent2D> supported;
+  for (auto size : candidates) {
+    if (size.width > limits.maxComputeWorkGroupSize[0] || size.height > limits.maxComputeWorkGroupSize[1])
+      continue;
+    if (size.width * size.height > limits.maxComputeWorkGroupInvocations)
+      continue;
+    supported.push_back(size);
+  }
+
+  if (supported.empty())
+    throw std::runtime_error("ERROR: No supported compute group size for shader: " + shader.name);
+  return supported;
+}
+
+std::string ComputePass::getEntryPoint(VkExtent2D groupSize) {
+  return "computeMain" + std::to_string(groupSize.width) + "x" + std::to_string(groupSize.height);
+}
+
+void ComputePass::dispatch(VkCommandBuffer cmd, uint32_t width, uint32_t height, VkExtent2D groupSize) {
+  vkCmdDispatch(cmd, getGroupCount(width, groupSize.width), getGroupCount(height, groupSize.height), 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkDescriptorSetLayoutBinding ComputePass::getImageBinding(uint32_t binding, VkDescriptorType type, uint32_t count) {
+  VkDescriptorSetLayoutBinding layout{};
+  layout.binding = binding;
+  layout.descriptorCount = count;
+  layout.descriptorType = type;
+  layout.pImmutableSamplers = nullptr;
+  layout.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  return layout;
+}
+
+VkWriteDescriptorSet ComputePass::getImageWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type,
+                                                const std::vector<VkDescriptorImageInfo>& infos) {
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = set;
+  write.dstBinding = binding;
+  write.dstArrayElement = 0;
+  write.descriptorCount = static_cast<uint32_t>(infos.size());
+  write.descriptorType = type;
+  write.pImageInfo = infos.data();
+  return write;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputePass::createPipeline() {
+  createPipelineLayout();
+  pipeline.instance = buildPipeline(computeShader);
+}
+
+void ComputePass::createPipelineLayout() {
+  auto pushConstantRange = getPushConstantRange();
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.pushConstantRangeCount = pushConstantRange.size > 0 ? 1 : 0;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptor.layouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptor.layouts.data();
+
+  if (vkCreatePipelineLayout(core->device, &pipelineLayoutInfo, nullptr, &pipeline.layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create pipeline layout!");
+}
+
+VkPipeline ComputePass::buildPipeline(VkShaderModule module) {
+  // Вычислительный шейдер - единственная стадия конвейера
+  VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+  compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  compShaderStageInfo.module = module;
+  compShaderStageInfo.pName = "main";
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage = compShaderStageInfo;
+  pipelineInfo.layout = pipeline.layout;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  VkPipeline instance;
+  if (vkCreateComputePipelines(core->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &instance) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create compute pipeline!");
+  return instance;
+}
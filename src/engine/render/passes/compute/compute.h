@@ -0,0 +1,50 @@
+#pragma once
+
+// Внутренние библиотеки
+#include "passes/pass.h"
+
+// Стандартные библиотеки
+#include <vector>
+#include <string>
+
+class ComputePass : public Pass {
+  //=========================================================================
+  // Обработчики конвейера и прохода рендера
+
+ protected:
+  virtual void createPipeline();
+  virtual void createRenderPass();  // Вычислительный конвейер работает вне прохода рендера
+
+  void createPipelineLayout();
+  VkPipeline buildPipeline(VkShaderModule);  // Конвейер на общей раскладке
+
+  // Опции вычислительного конвейера
+  virtual VkPushConstantRange getPushConstantRange() = 0;
+
+  // Число групп потоков, покрывающих count элементов
+  static uint32_t getGroupCount(uint32_t count, uint32_t groupSize);
+
+  //=========================================================================
+  // Обработка изображений - группа потоков покрывает прямоугольник пикселей.
+  // Шейдер объявляет точку входа на каждый размер группы: computeMain8x8, computeMain16x16, ...
+
+  // Размеры из candidates, допустимые устройством, - в их порядке
+  std::vector<VkExtent2D> getSupportedGroupSizes(const std::vector<VkExtent2D>& candidates);
+  static std::string getEntryPoint(VkExtent2D groupSize);
+
+  void dispatch(VkCommandBuffer, uint32_t width, uint32_t height, VkExtent2D groupSize);
+
+  // Привязка изображений, доступных вычислительному шейдеру
+  static VkDescriptorSetLayoutBinding getImageBinding(uint32_t binding, VkDescriptorType, uint32_t count);
+  static VkWriteDescriptorSet getImageWrite(VkDescriptorSet, uint32_t binding, VkDescriptorType, const std::vector<VkDescriptorImageInfo>&);
+
+  //=========================================================================
+  // Шейдеры - ядро любого прохода
+
+  VkShaderModule computeShader = VK_NULL_HANDLE;
+
+  void createShaderModules() override;
+  VkShaderModule loadShaderModule(const std::string& entry, VkShaderModule old);  // Старый модуль при ошибке
+
+  //=========================================================================
+};
@@ -0,0 +1,142 @@
+#include "effect.h"
+
+// Шейдер эффекта объявляет точку входа на каждый размер
+const std::vector<VkExtent2D> ComputeEffect::groupCandidates = {{8, 8}, {16, 16}};
+
+void ComputeEffect::init() {
+  groupSizes = getSupportedGroupSizes(groupCandidates);
+  if (group >= groupSizes.size())
+    group = static_cast<uint32_t>(groupSizes.size()) - 1;
+  ComputePass::init();
+}
+
+void ComputeEffect::reload() {
+  destroyPipelines();
+  ComputePass::reload();
+}
+
+void ComputeEffect::resize() {
+  // Конвейеры не зависят от размера - меняются только изображения
+  updateDescriptorSets();
+}
+
+void ComputeEffect::destroy() {
+  destroyPipelines();
+  ComputePass::destroy();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeEffect::record(uint32_t frame, VkCommandBuffer cmd) {
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[group]);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &descriptor.sets[0], 0, nullptr);
+
+  // Объявление констант шейдера
+  instance.colorImageIndex = frame;
+  instance.colorImageCount = static_cast<uint32_t>(colorImageViews.size());
+  vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Fullscreen::instance_t), &instance);
+
+  dispatch(cmd, target.width, target.height, groupSizes[group]);
+}
+
+VkPushConstantRange ComputeEffect::getPushConstantRange() {
+  VkPushConstantRange pushConstant{};
+  pushConstant.offset = 0;
+  pushConstant.size = sizeof(Fullscreen::instance_t);
+  pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  return pushConstant;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeEffect::createShaderModules() {
+  shaderModules.resize(groupSizes.size(), VK_NULL_HANDLE);
+  for (uint32_t i = 0; i < groupSizes.size(); ++i)
+    shaderModules[i] = loadShaderModule(getEntryPoint(groupSizes[i]), shaderModules[i]);
+}
+
+void ComputeEffect::createPipeline() {
+  createPipelineLayout();
+
+  // Основной конвейер прохода не используется - у каждого размера группы свой
+  pipeline.instance = VK_NULL_HANDLE;
+  for (auto module : shaderModules)
+    pipelines.push_back(buildPipeline(module));
+}
+
+void ComputeEffect::destroyPipelines() {
+  for (auto handle : pipelines)
+    vkDestroyPipeline(core->device, handle, nullptr);
+  pipelines.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeEffect::createDescriptorLayouts() {
+  uint32_t outputBinding = 2 + static_cast<uint32_t>(inputImageViews.size());
+
+  std::vector<VkDescriptorSetLayoutBinding> bindings = {
+      getImageBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, static_cast<uint32_t>(colorImageViews.size())),
+      getImageBinding(1, VK_DESCRIPTOR_TYPE_SAMPLER, 1),
+  };
+  for (uint32_t input = 0; input < inputImageViews.size(); ++input)
+    bindings.push_back(getImageBinding(2 + input, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, static_cast<uint32_t>(inputImageViews[input].size())));
+  bindings.push_back(getImageBinding(outputBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, static_cast<uint32_t>(target.views.size())));
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(core->device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create descriptor set layout!");
+
+  descriptor.layouts.push_back(layout);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeEffect::createDescriptorSets() {
+  // Копии кадров - элементы массивов, одного множества достаточно
+  descriptor.sets.resize(1);
+  descriptor.sets[0] = core->resources->createDesciptorSet(descriptor.layouts[0]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeEffect::updateDescriptorSets() {
+  //=========================================================================
+  // Инициализация ресурсов
+
+  std::vector<VkDescriptorImageInfo> imageInfo;
+  for (auto view : colorImageViews)
+    imageInfo.push_back({VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+
+  std::vector<VkDescriptorImageInfo> samplerInfo = {{colorImageSampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED}};
+
+  std::vector<std::vector<VkDescriptorImageInfo>> inputInfos(inputImageViews.size());
+  for (uint32_t input = 0; input < inputImageViews.size(); ++input)
+    for (auto view : inputImageViews[input])
+      inputInfos[input].push_back({VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+
+  // Результат пишется в общей раскладке
+  std::vector<VkDescriptorImageInfo> outputInfo;
+  for (auto view : target.views)
+    outputInfo.push_back({VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL});
+
+  //=========================================================================
+  // Запись ресурсов
+
+  VkDescriptorSet set = descriptor.sets[0];
+  std::vector<VkWriteDescriptorSet> descriptorWrites = {
+      getImageWrite(set, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageInfo),
+      getImageWrite(set, 1, VK_DESCRIPTOR_TYPE_SAMPLER, samplerInfo),
+  };
+  for (uint32_t input = 0; input < inputImageViews.size(); ++input)
+    descriptorWrites.push_back(getImageWrite(set, 2 + input, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, inputInfos[input]));
+  uint32_t outputBinding = 2 + static_cast<uint32_t>(inputImageViews.size());
+  descriptorWrites.push_back(getImageWrite(set, outputBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, outputInfo));
+
+  vkUpdateDescriptorSets(core->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// Внутренние библиотеки
+#include "passes/compute/compute.h"
+#include "passes/graphics/postprocessing/fullscreen.h"
+
+// Стандартные библиотеки
+#include <vector>
+#include <string>
+
+// Полноэкранный эффект на вычислительном конвейере - те же входы и константы, что у Fullscreen,
+// но без прохода рендера: результат пишется в изображение-хранилище, а группа потоков
+// может один раз загрузить общую окрестность в общую память вместо выборок каждым пикселем
+class ComputeEffect : public ComputePass {
+ public:
+  typedef ComputeEffect* Pass;
+
+  void init() override;
+  void destroy() override;
+  void reload() override;
+  void resize() override;
+
+  // frame - копия входов и результата
+  void record(uint32_t frame, VkCommandBuffer);
+
+  //=========================================================================
+  // Размер группы потоков - по конвейеру на каждый допустимый устройством
+
+  static const std::vector<VkExtent2D> groupCandidates;
+
+  std::vector<VkExtent2D> groupSizes;  // Допустимые - заполняются при создании
+  uint32_t group = UINT32_MAX;          // Текущий, по умолчанию - наибольший допустимый
+
+  // Время эффектов на GPU: group {0, 0} - фрагментные версии, fused - собранной цепочкой
+  struct benchmark_t {
+    VkExtent2D group;
+    double time;
+    bool fused = false;
+  };
+
+ private:
+  std::vector<VkShaderModule> shaderModules;
+  std::vector<VkPipeline> pipelines;
+
+  void createShaderModules() override;
+  void createPipeline() override;
+  void destroyPipelines();
+
+  VkPushConstantRange getPushConstantRange() override;
+
+  //=========================================================================
+  // Выделенные ресурсы, привязанные к конвейеру
+
+ public:
+  Fullscreen::instance_t instance;  // ~ ConstantBuffer - как у фрагментной версии
+
+  std::vector<VkImageView> colorImageViews;  // ~ Texture2D[]
+  VkSampler colorImageSampler;               // ~ SamplerState
+
+  // Дополнительные входы - binding 2, 3, ... по порядку, по копии на кадр в работе
+  std::vector<std::vector<VkImageView>> inputImageViews;  // ~ Texture2D[]
+
+  // Результат - следующая за входами привязка, по копии на кадр в работе
+  struct {
+    uint32_t width, height;
+    std::vector<VkImageView> views;  // ~ RWTexture2D[]
+  } target;
+
+ private:
+  void createDescriptorLayouts() override;
+  void createDescriptorSets() override;
+  void updateDescriptorSets() override;
+
+  //=========================================================================
+};
@@ -0,0 +1,235 @@
+#include "pyramid.h"
+
+void DepthPyramid::init() {
+  createPyramid();
+  ComputePass::init();
+}
+
+void DepthPyramid::resize() {
+  destroyPyramid();
+  createPyramid();
+  ComputePass::resize();
+  updateDescriptorSets();
+}
+
+void DepthPyramid::destroy() {
+  ComputePass::destroy();
+  destroyPyramid();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DepthPyramid::record(VkCommandBuffer cmd) {
+  // Прошлый кадр закончил чтение пирамиды
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.instance);
+
+  // Каждый уровень читает предыдущий
+  glm::uint2 sourceSize = {depth.width, depth.height};
+  for (uint32_t level = 0; level < pyramid.levels.size(); ++level) {
+    constants_t constants = {sourceSize, pyramid.sizes[level]};
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &descriptor.sets[level], 0, nullptr);
+    vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants_t), &constants);
+    dispatch(cmd, constants.size.x, constants.size.y, {groupSize, groupSize});
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    sourceSize = constants.size;
+  }
+}
+
+VkImageView DepthPyramid::getView() {
+  return pyramid.view;
+}
+
+uint32_t DepthPyramid::getLevelCount() {
+  return static_cast<uint32_t>(pyramid.levels.size());
+}
+
+VkPushConstantRange DepthPyramid::getPushConstantRange() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(constants_t);
+  return pushConstantRange;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DepthPyramid::createPyramid() {
+  // Размеры уровней делятся пополам с округлением вниз - крайние блоки захватывают остаток
+  pyramid.sizes.clear();
+  glm::uint2 size = {depth.width, depth.height};
+  do {
+    size = glm::max(size / 2u, glm::uint2(1));
+    pyramid.sizes.push_back(size);
+  } while ((size.x > 1 || size.y > 1) && pyramid.sizes.size() < maxLevels);
+  uint32_t levels = static_cast<uint32_t>(pyramid.sizes.size());
+
+  //===================================================
+  // Создание изображения со всеми уровнями
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.mipLevels = levels;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.format = VK_FORMAT_R32_SFLOAT;
+  imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.extent = {pyramid.sizes[0].x, pyramid.sizes[0].y, 1};
+
+  if (vkCreateImage(core->device, &imageInfo, nullptr, &pyramid.image) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create depth pyramid image!");
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(core->device, pyramid.image, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = core->resources->findMemoryTypeIndex(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if (vkAllocateMemory(core->device, &allocInfo, nullptr, &pyramid.memory) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to allocate depth pyramid memory!");
+  vkBindImageMemory(core->device, pyramid.image, pyramid.memory, 0);
+
+  //===================================================
+  // Вид всех уровней и вид каждого уровня
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.image = pyramid.image;
+  viewInfo.format = VK_FORMAT_R32_SFLOAT;
+  viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+  if (vkCreateImageView(core->device, &viewInfo, nullptr, &pyramid.view) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create depth pyramid view!");
+
+  pyramid.levels.resize(levels);
+  for (uint32_t level = 0; level < levels; ++level) {
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+    if (vkCreateImageView(core->device, &viewInfo, nullptr, &pyramid.levels[level]) != VK_SUCCESS)
+      throw std::runtime_error("ERROR: Failed to create depth pyramid view!");
+  }
+
+  //===================================================
+  // Пирамида всегда в общей раскладке: уровни пишутся и читаются вычислительными шейдерами.
+  // До первого построения - дальняя глубина, ничто не перекрыто
+
+  VkCommandBuffer cmd = core->commands->beginSingleTimeCommands();
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = pyramid.image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  VkClearColorValue far = {{1.0f, 0.0f, 0.0f, 0.0f}};
+  vkCmdClearColorImage(cmd, pyramid.image, VK_IMAGE_LAYOUT_GENERAL, &far, 1, &barrier.subresourceRange);
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  core->commands->endSingleTimeCommands(cmd);
+}
+
+void DepthPyramid::destroyPyramid() {
+  for (auto view : pyramid.levels)
+    core->resources->destroyImageView(view);
+  core->resources->destroyImageView(pyramid.view);
+  core->resources->destroyImage(pyramid.image, pyramid.memory);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DepthPyramid::createDescriptorLayouts() {
+  VkDescriptorSetLayoutBinding sourceLayout{};
+  sourceLayout.binding = 0;
+  sourceLayout.descriptorCount = 1;
+  sourceLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  sourceLayout.pImmutableSamplers = nullptr;
+  sourceLayout.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutBinding destinationLayout{};
+  destinationLayout.binding = 1;
+  destinationLayout.descriptorCount = 1;
+  destinationLayout.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  destinationLayout.pImmutableSamplers = nullptr;
+  destinationLayout.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {sourceLayout, destinationLayout};
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(core->device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create descriptor set layout!");
+
+  descriptor.layouts.push_back(layout);
+}
+
+void DepthPyramid::createDescriptorSets() {
+  // Число уровней меняется с разрешением - множества выделяются с запасом
+  descriptor.sets.resize(maxLevels);
+  for (uint32_t i = 0; i < maxLevels; ++i)
+    descriptor.sets[i] = core->resources->createDesciptorSet(descriptor.layouts[0]);
+}
+
+void DepthPyramid::updateDescriptorSets() {
+  for (uint32_t level = 0; level < pyramid.levels.size(); ++level) {
+    VkDescriptorImageInfo sourceInfo{};
+    if (level == 0) {
+      sourceInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+      sourceInfo.imageView = depth.view;
+    } else {
+      sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+      sourceInfo.imageView = pyramid.levels[level - 1];
+    }
+
+    VkDescriptorImageInfo destinationInfo{};
+    destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    destinationInfo.imageView = pyramid.levels[level];
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pImageInfo = &sourceInfo;
+    descriptorWrites[0].dstSet = descriptor.sets[level];
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo = &destinationInfo;
+    descriptorWrites[1].dstSet = descriptor.sets[level];
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    vkUpdateDescriptorSets(core->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
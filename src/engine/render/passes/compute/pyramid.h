@@ -0,0 +1,70 @@
+#pragma once
+
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+
+// Внутренние библиотеки
+#include "compute.h"
+
+// Стандартные библиотеки
+#include <array>
+#include <vector>
+
+// Пирамида глубины (Hi-Z) - каждый уровень хранит наибольшую глубину блока 2x2 предыдущего.
+// Уровень 0 строится по изображению глубины прохода геометрии в половинном разрешении
+class DepthPyramid : public ComputePass {
+ public:
+  typedef DepthPyramid* Pass;
+
+  void init() override;
+  void destroy() override;
+  void resize() override;
+
+  void record(VkCommandBuffer);
+
+  // Источник - изображение глубины прохода геометрии
+  struct {
+    VkImageView view;
+    uint32_t width, height;
+  } depth;
+
+  VkImageView getView();  // Все уровни
+  uint32_t getLevelCount();
+
+  //=========================================================================
+  // Обработчики конвейера
+
+ private:
+  VkPushConstantRange getPushConstantRange() override;
+
+  // ~ push_constant
+  struct constants_t {
+    glm::uint2 sourceSize;
+    glm::uint2 size;
+  };
+
+  static constexpr uint32_t groupSize = 8;
+  static constexpr uint32_t maxLevels = 16;
+
+  //=========================================================================
+  // Выделенные ресурсы, привязанные к конвейеру
+
+ private:
+  struct {
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+    std::vector<VkImageView> levels;
+    std::vector<glm::uint2> sizes;
+  } pyramid;
+
+  void createPyramid();
+  void destroyPyramid();
+
+  // Множество ресурсов на каждый уровень: источник и результат
+  void createDescriptorLayouts() override;
+  void createDescriptorSets() override;
+  void updateDescriptorSets() override;
+
+  //=========================================================================
+};
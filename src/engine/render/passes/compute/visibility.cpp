@@ -0,0 +1,405 @@
+#include "visibility.h"
+
+void Visibility::init() {
+  buffers.resize(core->framesInFlight);
+  for (uint32_t i = 0; i < buffers.size(); ++i)
+    createBuffers(i, capacity);
+  createHistory(capacity);
+  ComputePass::init();
+}
+
+void Visibility::resize() {
+  // Пирамида глубины пересоздаётся вместе с изображением глубины
+  ComputePass::resize();
+  updateDescriptorSets();
+}
+
+void Visibility::destroy() {
+  ComputePass::destroy();
+  for (uint32_t i = 0; i < buffers.size(); ++i)
+    destroyBuffers(i);
+  destroyHistory();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Visibility::update(uint32_t index) {
+  auto culling = scene->getCulling();
+
+  // Изменения накапливаются до использования буферов каждого изображения.
+  // Буферы прошлого набора форм всё равно записываются целиком
+  auto& changes = culling->getChanges();
+  for (auto& data : buffers)
+    if (data.version == culling->getVersion())
+      data.pending.insert(data.pending.end(), changes.begin(), changes.end());
+
+  uint32_t count = culling->getEntryCount();
+  buffers_t& data = buffers[index];
+  while (capacity < count)
+    capacity *= 2;
+
+  // Общий буфер видимости могут использовать кадры в работе
+  if (count > history.capacity) {
+    vkDeviceWaitIdle(core->device);
+    destroyHistory();
+    createHistory(capacity);
+    updateDescriptorSets();
+  }
+
+  if (data.version != culling->getVersion()) {
+    // Кадр, использовавший эти буферы, уже завершён - их можно пересоздать
+    if (count > data.capacity) {
+      destroyBuffers(index);
+      createBuffers(index, capacity);
+      writeDescriptors(index);
+    }
+
+    if (groupsVersion != culling->getVersion())
+      updateGroups();
+    writeObjects(index, nullptr, count);
+    writeGroups(index);
+    data.version = culling->getVersion();
+  } else if (!data.pending.empty()) {
+    writeObjects(index, data.pending.data(), static_cast<uint32_t>(data.pending.size()));
+  }
+  data.pending.clear();
+
+  uniform.entryCount = count;
+  uniform.groupCount = static_cast<uint32_t>(groups.size());
+  uniform.capacity = data.capacity;
+
+  void* mapped;
+  vkMapMemory(core->device, data.uniformMemory, 0, sizeof(uniform_t), 0, &mapped);
+  memcpy(mapped, &uniform, sizeof(uniform_t));
+  vkUnmapMemory(core->device, data.uniformMemory);
+}
+
+void Visibility::updateGroups() {
+  auto culling = scene->getCulling();
+  uint32_t count = culling->getEntryCount();
+
+  // Группа - форма модели: формы одной группы рисуются одной командой
+  std::unordered_map<Models::model_t::shape_t*, uint32_t> groupIndices;
+  std::vector<uint32_t> groupSizes;
+  groups.clear();
+  entryGroups.resize(count);
+  for (uint32_t entry = 0; entry < count; ++entry) {
+    auto shape = culling->getShape(entry);
+    auto found = groupIndices.find(shape);
+    if (found == groupIndices.end()) {
+      found = groupIndices.emplace(shape, static_cast<uint32_t>(groups.size())).first;
+      groups.push_back({shape->indicesCount, shape->firstIndex, shape->vertexOffset, 0});
+      groupSizes.push_back(0);
+    }
+    entryGroups[entry] = found->second;
+    groupSizes[found->second]++;
+  }
+
+  // Группы располагаются в потоке индексов подряд
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < groups.size(); ++i) {
+    groups[i].offset = offset;
+    offset += groupSizes[i];
+  }
+  groupsVersion = culling->getVersion();
+}
+
+void Visibility::writeObjects(uint32_t index, const uint32_t* entries, uint32_t count) {
+  if (count == 0)
+    return;
+
+  auto culling = scene->getCulling();
+  object_t* objects;
+  vkMapMemory(core->device, buffers[index].objectsMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&objects));
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t entry = entries != nullptr ? entries[i] : i;
+    const BVH::box_t& box = culling->getBox(entry);
+    objects[entry].min = box.min;
+    objects[entry].group = entryGroups[entry];
+    objects[entry].max = box.max;
+    objects[entry].padding = 0;
+    objects[entry].sphere = culling->getSphere(entry);
+  }
+  vkUnmapMemory(core->device, buffers[index].objectsMemory);
+}
+
+void Visibility::writeGroups(uint32_t index) {
+  if (groups.empty())
+    return;
+
+  void* mapped;
+  VkDeviceSize size = groups.size() * sizeof(group_t);
+  vkMapMemory(core->device, buffers[index].groupsMemory, 0, size, 0, &mapped);
+  memcpy(mapped, groups.data(), size);
+  vkUnmapMemory(core->device, buffers[index].groupsMemory);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Visibility::record(uint32_t index, VkCommandBuffer cmd) {
+  buffers_t& data = buffers[index];
+
+  // Обнуление счётчиков. Чтение прошлых списков обратной связью ограждает граф рендера
+  vkCmdFillBuffer(cmd, data.counts, 0, VK_WHOLE_SIZE, 0);
+
+  // Видимость форм записана поздней фазой прошлого кадра
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      cmd,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  if (uniform.entryCount == 0)
+    return;
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.instance);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &descriptor.sets[index], 0, nullptr);
+
+  // Без Hi-Z достаточно одной проверки - её результат рисуется поздним списком
+  if (uniform.occlusion) {
+    dispatch(cmd, PHASE_EARLY_TEST, uniform.entryCount);
+    dispatch(cmd, PHASE_EARLY_COMMANDS, uniform.groupCount);
+  } else {
+    dispatch(cmd, PHASE_LATE_TEST, uniform.entryCount);
+    dispatch(cmd, PHASE_LATE_COMMANDS, uniform.groupCount);
+  }
+}
+
+void Visibility::recordLate(uint32_t index, VkCommandBuffer cmd) {
+  if (uniform.entryCount == 0)
+    return;
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.instance);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &descriptor.sets[index], 0, nullptr);
+
+  dispatch(cmd, PHASE_LATE_TEST, uniform.entryCount);
+  dispatch(cmd, PHASE_LATE_COMMANDS, uniform.groupCount);
+}
+
+void Visibility::dispatch(VkCommandBuffer cmd, Phase phase, uint32_t count) {
+  uint32_t constants = phase;
+  vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &constants);
+  vkCmdDispatch(cmd, getGroupCount(count, groupSize), 1, 1);
+
+  // Команды и поток индексов читаются рендером, счётчики - CPU для статистики
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  if (phase == PHASE_EARLY_COMMANDS || phase == PHASE_LATE_COMMANDS) {
+    barrier.dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    dstStage |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT;
+  }
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Visibility::stats_t Visibility::getStats(uint32_t index) {
+  stats_t stats{};
+  if (groups.empty())
+    return stats;
+
+  // Списки, записанные при прошлом использовании, - с прошлым шагом
+  uint32_t* counts;
+  uint32_t step = buffers[index].capacity;
+  vkMapMemory(core->device, buffers[index].countsMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&counts));
+  stats.draws = counts[LIST_EARLY] + counts[LIST_LATE];
+  stats.occluded = counts[2];
+  for (uint32_t list = LIST_EARLY; list <= LIST_LATE; ++list)
+    for (uint32_t i = 0; i < groups.size() && i < step; ++i)
+      stats.visible += counts[countsHeader + list * step + i];
+  vkUnmapMemory(core->device, buffers[index].countsMemory);
+  return stats;
+}
+
+Visibility::list_t Visibility::getList(uint32_t index, List list) {
+  buffers_t& data = buffers[index];
+  list_t result;
+  result.indices = data.indices;
+  result.indicesOffset = list * data.capacity * sizeof(uint32_t);
+  result.commands = data.commands;
+  result.commandsOffset = list * data.capacity * sizeof(VkDrawIndexedIndirectCommand);
+  result.count = data.counts;
+  result.countOffset = list * sizeof(uint32_t);
+  result.maxDraws = static_cast<uint32_t>(groups.size());
+  return result;
+}
+
+VkPushConstantRange Visibility::getPushConstantRange() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);  // Фаза
+  return pushConstantRange;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Visibility::createBuffers(uint32_t index, uint32_t capacity) {
+  buffers_t& data = buffers[index];
+  data.capacity = capacity;
+  data.version = 0;
+
+  core->resources->createBuffer(
+      sizeof(uniform_t),
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.uniform, data.uniformMemory);
+
+  // Групп не больше, чем форм
+  core->resources->createBuffer(
+      capacity * sizeof(object_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.objects, data.objectsMemory);
+
+  core->resources->createBuffer(
+      capacity * sizeof(group_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.groups, data.groupsMemory);
+
+  core->resources->createBuffer(
+      (countsHeader + 2 * capacity) * sizeof(uint32_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.counts, data.countsMemory);
+
+  // Списки нового буфера пусты - их может прочитать обратная связь до первой записи
+  void* mapped;
+  vkMapMemory(core->device, data.countsMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+  memset(mapped, 0, (countsHeader + 2 * capacity) * sizeof(uint32_t));
+  vkUnmapMemory(core->device, data.countsMemory);
+
+  // Результаты пишет и читает только GPU
+  core->resources->createBuffer(
+      2 * capacity * sizeof(uint32_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      data.indices, data.indicesMemory);
+
+  core->resources->createBuffer(
+      2 * capacity * sizeof(VkDrawIndexedIndirectCommand),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      data.commands, data.commandsMemory);
+}
+
+void Visibility::destroyBuffers(uint32_t index) {
+  buffers_t& data = buffers[index];
+  core->resources->destroyBuffer(data.uniform, data.uniformMemory);
+  core->resources->destroyBuffer(data.objects, data.objectsMemory);
+  core->resources->destroyBuffer(data.groups, data.groupsMemory);
+  core->resources->destroyBuffer(data.counts, data.countsMemory);
+  core->resources->destroyBuffer(data.indices, data.indicesMemory);
+  core->resources->destroyBuffer(data.commands, data.commandsMemory);
+}
+
+void Visibility::createHistory(uint32_t capacity) {
+  history.capacity = capacity;
+  core->resources->createBuffer(
+      capacity * sizeof(uint32_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      history.buffer, history.memory);
+
+  // Прошлого кадра ещё не было - ранняя фаза ничего не рисует
+  std::vector<uint32_t> zeros(capacity, 0);
+  core->commands->copyDataToBuffer(zeros.data(), history.buffer, capacity * sizeof(uint32_t));
+}
+
+void Visibility::destroyHistory() {
+  core->resources->destroyBuffer(history.buffer, history.memory);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Visibility::createDescriptorLayouts() {
+  // ubo, objects, groups, counts, indices, commands, history, pyramid
+  std::array<VkDescriptorType, 8> types = {
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+  };
+
+  std::array<VkDescriptorSetLayoutBinding, 8> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorCount = 1;
+    bindings[i].descriptorType = types[i];
+    bindings[i].pImmutableSamplers = nullptr;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(core->device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create descriptor set layout!");
+
+  descriptor.layouts.push_back(layout);
+}
+
+void Visibility::createDescriptorSets() {
+  descriptor.sets.resize(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i)
+    descriptor.sets[i] = core->resources->createDesciptorSet(descriptor.layouts[0]);
+}
+
+void Visibility::updateDescriptorSets() {
+  for (uint32_t i = 0; i < buffers.size(); ++i)
+    writeDescriptors(i);
+}
+
+void Visibility::writeDescriptors(uint32_t index) {
+  buffers_t& data = buffers[index];
+  std::array<VkBuffer, 7> resources = {data.uniform, data.objects, data.groups, data.counts, data.indices, data.commands, history.buffer};
+
+  std::array<VkDescriptorBufferInfo, 7> buffersInfo{};
+  std::vector<VkWriteDescriptorSet> descriptorWrites(resources.size());
+  for (uint32_t i = 0; i < resources.size(); ++i) {
+    buffersInfo[i].buffer = resources[i];
+    buffersInfo[i].offset = 0;
+    buffersInfo[i].range = VK_WHOLE_SIZE;
+
+    descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[i].dstBinding = i;
+    descriptorWrites[i].dstArrayElement = 0;
+    descriptorWrites[i].descriptorCount = 1;
+    descriptorWrites[i].pBufferInfo = &buffersInfo[i];
+    descriptorWrites[i].dstSet = descriptor.sets[index];
+    descriptorWrites[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  }
+
+  VkDescriptorImageInfo pyramidInfo{};
+  pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+  pyramidInfo.imageView = pyramidView;
+
+  VkWriteDescriptorSet pyramidWrite{};
+  pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  pyramidWrite.dstBinding = 7;
+  pyramidWrite.dstArrayElement = 0;
+  pyramidWrite.descriptorCount = 1;
+  pyramidWrite.pImageInfo = &pyramidInfo;
+  pyramidWrite.dstSet = descriptor.sets[index];
+  pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  descriptorWrites.push_back(pyramidWrite);
+
+  vkUpdateDescriptorSets(core->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
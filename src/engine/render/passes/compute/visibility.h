@@ -0,0 +1,166 @@
+#pragma once
+
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+
+// Внутренние библиотеки
+#include "compute.h"
+#include "scene.h"
+
+// Стандартные библиотеки
+#include <array>
+#include <vector>
+#include <unordered_map>
+
+// Отсечение форм на GPU с построением списка косвенного рендера
+// Проверка раскладывает видимые формы по группам (форма модели),
+// затем на каждую непустую группу записывается команда под атомарным счётчиком.
+// Результат расходуется vkCmdDrawIndexedIndirectCount без участия CPU.
+//
+// С отсечением перекрытых форм работа делится на две фазы:
+// ранняя рисует формы, видимые в прошлом кадре, по их глубине строится Hi-Z,
+// поздняя проверяет по нему все формы и дорисовывает ставшие видимыми
+class Visibility : public ComputePass {
+ public:
+  typedef Visibility* Pass;
+  Scene::Manager scene;
+
+  void init() override;
+  void destroy() override;
+  void resize() override;
+
+  void update(uint32_t index);
+  void record(uint32_t index, VkCommandBuffer);      // Ранняя фаза (или единственная без Hi-Z)
+  void recordLate(uint32_t index, VkCommandBuffer);  // Поздняя фаза по построенному Hi-Z
+
+  // ~ cbuffer
+  struct uniform_t {
+    std::array<glm::float4, 6> planes;  // Пирамида видимости камеры
+    glm::float4x4 viewProjection;
+    glm::float3 camera;
+    float maxDistance;  // 0 - без проверки расстояния
+    uint32_t entryCount;
+    uint32_t groupCount;
+    uint32_t capacity;   // Шаг списков в буферах
+    uint32_t enabled;    // 0 - все формы видимы
+    glm::uint2 depthSize;
+    uint32_t levels;     // Число уровней Hi-Z
+    uint32_t occlusion;  // 0 - без проверки перекрытия
+  } uniform{};
+
+  // ~ Texture2D<float> - пирамида глубины со всеми уровнями
+  VkImageView pyramidView;
+
+  // Результаты прошлого использования буферов изображения
+  struct stats_t {
+    uint32_t draws;
+    uint32_t visible;
+    uint32_t occluded;
+  };
+  stats_t getStats(uint32_t index);
+
+  // Списки команд рендера
+  enum List {
+    LIST_EARLY,  // Видимые в прошлом кадре
+    LIST_LATE,   // Прошедшие проверку по Hi-Z (или все видимые без неё)
+  };
+
+  struct list_t {
+    VkBuffer indices;  // Поток индексов экземпляров по группам
+    VkDeviceSize indicesOffset;
+    VkBuffer commands;  // VkDrawIndexedIndirectCommand
+    VkDeviceSize commandsOffset;
+    VkBuffer count;  // Число команд
+    VkDeviceSize countOffset;
+    uint32_t maxDraws;
+  };
+  list_t getList(uint32_t index, List);
+
+  //=========================================================================
+  // Обработчики конвейера
+
+ private:
+  VkPushConstantRange getPushConstantRange() override;
+
+  enum Phase {
+    PHASE_EARLY_TEST,
+    PHASE_EARLY_COMMANDS,
+    PHASE_LATE_TEST,
+    PHASE_LATE_COMMANDS,
+  };
+  void dispatch(VkCommandBuffer, Phase, uint32_t count);
+
+  static constexpr uint32_t groupSize = 64;
+
+  //=========================================================================
+  // Выделенные ресурсы, привязанные к конвейеру
+
+ private:
+  // ~ StructuredBuffer - мировые объёмы формы
+  struct object_t {
+    glm::float3 min;
+    uint32_t group;
+    glm::float3 max;
+    uint32_t padding;
+    glm::float4 sphere;
+  };
+
+  // ~ StructuredBuffer - геометрия группы и её место в потоке индексов
+  struct group_t {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t offset;
+  };
+
+  std::vector<group_t> groups;
+  std::vector<uint32_t> entryGroups;
+  uint32_t groupsVersion = 0;
+  void updateGroups();
+
+  // Заголовок буфера счётчиков: числа команд списков и число перекрытых форм
+  static constexpr uint32_t countsHeader = 4;
+
+  // Буферы для каждого изображения цепочки показа
+  // Списки располагаются в буферах друг за другом с шагом capacity
+  typedef struct {
+    uint32_t capacity;
+    uint32_t version;
+    std::vector<uint32_t> pending;  // Формы, изменённые после прошлого использования
+    VkBuffer uniform;
+    VkDeviceMemory uniformMemory;
+    VkBuffer objects;
+    VkDeviceMemory objectsMemory;
+    VkBuffer groups;
+    VkDeviceMemory groupsMemory;
+    VkBuffer counts;  // Заголовок, затем число экземпляров групп каждого списка
+    VkDeviceMemory countsMemory;
+    VkBuffer indices;
+    VkDeviceMemory indicesMemory;
+    VkBuffer commands;
+    VkDeviceMemory commandsMemory;
+  } buffers_t;
+  std::vector<buffers_t> buffers;
+  uint32_t capacity = 1024;
+
+  // Видимость форм в прошлом кадре - общая для всех изображений
+  struct {
+    uint32_t capacity = 0;
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+  } history;
+
+  void createBuffers(uint32_t index, uint32_t capacity);
+  void destroyBuffers(uint32_t index);
+  void createHistory(uint32_t capacity);
+  void destroyHistory();
+  void writeObjects(uint32_t index, const uint32_t* entries, uint32_t count);
+  void writeGroups(uint32_t index);
+
+  void createDescriptorLayouts() override;
+  void createDescriptorSets() override;
+  void updateDescriptorSets() override;
+  void writeDescriptors(uint32_t index);
+
+  //=========================================================================
+};
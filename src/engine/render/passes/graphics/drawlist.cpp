@@ -0,0 +1,78 @@
+#include "drawlist.h"
+
+// Стандартные библиотеки
+#include <algorithm>
+#include <array>
+#include <bit>
+
+void DrawList::clear() {
+  items.clear();
+}
+
+void DrawList::add(uint64_t key, uint32_t payload) {
+  items.push_back({key, payload});
+}
+
+const std::vector<DrawList::item_t>& DrawList::getItems() {
+  return items;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DrawList::sort() {
+  if (items.size() < 2)
+    return;
+
+  // Разряды, совпадающие во всех ключах, не меняют порядок
+  uint64_t same = ~0ull, first = items[0].key;
+  for (auto& item : items)
+    same &= ~(item.key ^ first);
+
+  buffer.resize(items.size());
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    if (((same >> shift) & 0xFF) == 0xFF)
+      continue;
+
+    // Устойчивое распределение по корзинам младшего необработанного разряда
+    std::array<uint32_t, 256> offsets{};
+    for (auto& item : items)
+      offsets[(item.key >> shift) & 0xFF]++;
+    uint32_t total = 0;
+    for (auto& offset : offsets) {
+      uint32_t count = offset;
+      offset = total;
+      total += count;
+    }
+    for (auto& item : items)
+      buffer[offsets[(item.key >> shift) & 0xFF]++] = item;
+    items.swap(buffer);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t DrawList::makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t geometry, float depth) {
+  // Биты неотрицательного числа с плавающей точкой упорядочены как сами числа -
+  // старшие 24 бита дают квантование без заданного диапазона глубины
+  uint32_t depthBits = std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> 7;
+
+  return (static_cast<uint64_t>(pass & 0xF) << 60) |
+         (static_cast<uint64_t>(pipeline & 0xFF) << 52) |
+         (static_cast<uint64_t>(material & 0xFFFF) << 36) |
+         (static_cast<uint64_t>(geometry & 0xFFF) << 24) |
+         static_cast<uint64_t>(depthBits & 0xFFFFFF);
+}
+
+uint64_t DrawList::getState(uint64_t key) {
+  return key >> 24;
+}
+
+uint64_t DrawList::getMaterial(uint64_t key) {
+  return (key >> 36) & 0xFFFF;
+}
+
+uint64_t DrawList::getGeometry(uint64_t key) {
+  return (key >> 24) & 0xFFF;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,41 @@
+#pragma once
+
+// Стандартные библиотеки
+#include <cstdint>
+#include <vector>
+
+// Список отрисовки, упорядоченный 64-битными ключами сортировки
+// Старшие поля ключа - состояния, смена которых дороже всего,
+// младшее - квантованная глубина: одинаковые состояния рисуются от ближних к дальним
+//
+//   63..60  проход
+//   59..52  конвейер
+//   51..36  материал (текстура, сэмплер)
+//   35..24  геометрия (диапазон общих буферов)
+//   23..0   глубина
+class DrawList {
+ public:
+  struct item_t {
+    uint64_t key;
+    uint32_t payload;  // Индекс элемента у владельца списка
+  };
+
+  void clear();
+  void add(uint64_t key, uint32_t payload);
+
+  // Поразрядная сортировка по 8 бит - одинаковые во всех ключах разряды пропускаются
+  void sort();
+
+  const std::vector<item_t>& getItems();
+
+  static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t geometry, float depth);
+
+  // Поля состояния без глубины - смена означает новый вызов отрисовки
+  static uint64_t getState(uint64_t key);
+  static uint64_t getMaterial(uint64_t key);
+  static uint64_t getGeometry(uint64_t key);
+
+ private:
+  std::vector<item_t> items;
+  std::vector<item_t> buffer;  // Вспомогательный массив сортировки
+};
@@ -0,0 +1,423 @@
+#include "feedback.h"
+
+void Feedback::init() {
+  createUniformDescriptors();
+  createReadbackBuffers();
+  GraphicsPass::init();
+}
+
+void Feedback::update(uint32_t index) {
+  updateUniformDescriptors(index);
+  writeInstanceDescriptor(index);
+}
+
+void Feedback::reload() {
+  destroyUniformDescriptors();
+  createUniformDescriptors();
+  GraphicsPass::reload();
+}
+
+void Feedback::resize() {
+  destroyReadbackBuffers();
+  createReadbackBuffers();
+  GraphicsPass::resize();
+}
+
+void Feedback::destroy() {
+  GraphicsPass::destroy();
+  destroyUniformDescriptors();
+  destroyReadbackBuffers();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const uint32_t* Feedback::getData(uint32_t index) {
+  return reinterpret_cast<const uint32_t*>(readback[index].data);
+}
+
+size_t Feedback::getDataCount() {
+  return static_cast<size_t>(target.width) * target.height;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::record(uint32_t index, VkCommandBuffer cmd) {
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = pipeline.pass;
+  renderPassInfo.framebuffer = framebuffers[index];
+  renderPassInfo.renderArea.offset = {0, 0};
+  renderPassInfo.renderArea.extent = {target.width, target.height};
+
+  // Нулевое значение - страницы не требуются
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color.uint32[0] = 0;
+  clearValues[0].color.uint32[1] = 0;
+  clearValues[0].color.uint32[2] = 0;
+  clearValues[0].color.uint32[3] = 0;
+  clearValues[1].depthStencil = {1.0f, 0};
+  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+  renderPassInfo.pClearValues = clearValues.data();
+
+  VkViewport viewport{};
+  viewport.x = 0;
+  viewport.y = static_cast<float>(target.height);
+  viewport.width = static_cast<float>(target.width);
+  viewport.height = -static_cast<float>(target.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+  // Подключение конвейера и настройка его динамических частей
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.instance);
+  vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+  // Подключение множества ресурсов, используемых в конвейере
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &descriptor.sets[index], 0, nullptr);
+
+  // Производные координат в низком разрешении больше в scale раз
+  constants.levelBias = -std::log2(static_cast<float>(scale));
+  vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants_t), &constants);
+
+  // Видимые формы в режиме прохода геометрии - без перебора объектов на CPU
+  geometry->recordDraws(index, cmd);
+
+  vkCmdEndRenderPass(cmd);
+
+  //=========================================================================
+  // Копирование результата в память приложения
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {target.width, target.height, 1};
+  vkCmdCopyImageToBuffer(cmd, targetImages[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback[index].buffer, 1, &region);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = readback[index].buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(
+      cmd,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      0, nullptr,
+      1, &barrier,
+      0, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::createUniformDescriptors() {
+  uint32_t count = target.views.size();
+  VkDeviceSize bufferSize = sizeof(uniform_t);
+  uniformBuffers.resize(count);
+  uniformBuffersMemory.resize(count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    core->resources->createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        uniformBuffers[i], uniformBuffersMemory[i]);
+  }
+}
+
+void Feedback::destroyUniformDescriptors() {
+  for (uint32_t i = 0; i < target.views.size(); ++i)
+    core->resources->destroyBuffer(uniformBuffers[i], uniformBuffersMemory[i]);
+}
+
+void Feedback::updateUniformDescriptors(uint32_t imageIndex) {
+  void* data;
+  vkMapMemory(core->device, uniformBuffersMemory[imageIndex], 0, sizeof(uniform_t), 0, &data);
+  memcpy(data, &uniform, sizeof(uniform_t));
+  vkUnmapMemory(core->device, uniformBuffersMemory[imageIndex]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::createReadbackBuffers() {
+  VkDeviceSize size = getDataCount() * sizeof(uint32_t);
+  readback.resize(target.views.size());
+  for (auto& buffer : readback) {
+    core->resources->createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        buffer.buffer, buffer.memory);
+
+    // До первого кадра страницы не запрашиваются
+    vkMapMemory(core->device, buffer.memory, 0, size, 0, &buffer.data);
+    memset(buffer.data, 0, static_cast<size_t>(size));
+  }
+}
+
+void Feedback::destroyReadbackBuffers() {
+  for (auto& buffer : readback) {
+    vkUnmapMemory(core->device, buffer.memory);
+    core->resources->destroyBuffer(buffer.buffer, buffer.memory);
+  }
+  readback.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::createFramebuffers() {
+  framebuffers.resize(target.views.size());
+  for (uint32_t i = 0; i < target.views.size(); ++i) {
+    std::vector<VkImageView> attachment = {target.views[i], depth.views[i]};
+    framebuffers[i] = createFramebuffer(attachment, target.width, target.height);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkVertexInputBindingDescription Feedback::getVertexBinding() {
+  VkVertexInputBindingDescription bindingDescription{};
+  bindingDescription.binding = 0;
+  bindingDescription.stride = sizeof(Models::vertex_t);
+  bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDescription;
+}
+
+std::vector<VkVertexInputBindingDescription> Feedback::getVertexBindings() {
+  // Поток индексов экземпляров прохода геометрии
+  VkVertexInputBindingDescription instanceBinding{};
+  instanceBinding.binding = 1;
+  instanceBinding.stride = sizeof(uint32_t);
+  instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+  return {getVertexBinding(), instanceBinding};
+}
+
+std::vector<VkVertexInputAttributeDescription> Feedback::getVertexAttributes() {
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {};
+
+  VkVertexInputAttributeDescription attributeDescription{};
+  attributeDescription.binding = 0;
+  attributeDescription.location = 0;
+  attributeDescription.offset = offsetof(Models::vertex_t, position);
+  attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+  attributeDescriptions.emplace_back(attributeDescription);
+
+  attributeDescription.binding = 0;
+  attributeDescription.location = 1;
+  attributeDescription.offset = offsetof(Models::vertex_t, uv);
+  attributeDescription.format = VK_FORMAT_R32G32_SFLOAT;
+  attributeDescriptions.emplace_back(attributeDescription);
+
+  attributeDescription.binding = 1;
+  attributeDescription.location = 2;
+  attributeDescription.offset = 0;
+  attributeDescription.format = VK_FORMAT_R32_UINT;
+  attributeDescriptions.emplace_back(attributeDescription);
+
+  return attributeDescriptions;
+}
+
+VkPushConstantRange Feedback::getPushConstantRange() {
+  VkPushConstantRange pushConstant{};
+  pushConstant.offset = 0;
+  pushConstant.size = sizeof(constants_t);
+  pushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  return pushConstant;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::createRenderPass() {
+  //=================================================================================
+  // Описание цветового подключения - запросы страниц
+
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = target.format;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;  // Результат копируется в память приложения
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkAttachmentReference colorAttachmentRef{};
+  colorAttachmentRef.attachment = 0;
+  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  //=================================================================================
+  // Описание изобржения глубины
+
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = depth.format;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkAttachmentReference depthAttachmentRef{};
+  depthAttachmentRef.attachment = 1;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  //=================================================================================
+  // Подпроходы рендера
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  //=================================================================================
+  // Зависимости подпроходов рендера
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  // Копирование результата начинается после записи
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  //=================================================================================
+  // Создание прохода рендера
+
+  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(core->device, &renderPassInfo, nullptr, &pipeline.pass) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create render pass!");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::createDescriptorLayouts() {
+  VkDescriptorSetLayoutBinding uniformLayout{};
+  uniformLayout.binding = 0;
+  uniformLayout.descriptorCount = 1;
+  uniformLayout.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  uniformLayout.pImmutableSamplers = nullptr;
+  uniformLayout.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding virtualInfoLayout{};
+  virtualInfoLayout.binding = 1;
+  virtualInfoLayout.descriptorCount = 1;
+  virtualInfoLayout.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  virtualInfoLayout.pImmutableSamplers = nullptr;
+  virtualInfoLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding instancesLayout{};
+  instancesLayout.binding = 2;
+  instancesLayout.descriptorCount = 1;
+  instancesLayout.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  instancesLayout.pImmutableSamplers = nullptr;
+  instancesLayout.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings = {
+      uniformLayout,
+      virtualInfoLayout,
+      instancesLayout,
+  };
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(core->device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create descriptor set layout!");
+
+  descriptor.layouts.push_back(layout);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::createDescriptorSets() {
+  descriptor.sets.resize(target.views.size());
+  for (size_t i = 0; i < target.views.size(); ++i)
+    descriptor.sets[i] = core->resources->createDesciptorSet(descriptor.layouts[0]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Feedback::updateDescriptorSets() {
+  for (size_t i = 0; i < target.views.size(); ++i) {
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformBuffers[i];
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(uniform_t);
+
+    VkDescriptorBufferInfo virtualInfoInfo{};
+    virtualInfoInfo.buffer = virtualInfoBuffer;
+    virtualInfoInfo.offset = 0;
+    virtualInfoInfo.range = VK_WHOLE_SIZE;
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &bufferInfo;
+    descriptorWrites[0].dstSet = descriptor.sets[i];
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &virtualInfoInfo;
+    descriptorWrites[1].dstSet = descriptor.sets[i];
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    vkUpdateDescriptorSets(core->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    writeInstanceDescriptor(static_cast<uint32_t>(i));
+  }
+}
+
+void Feedback::writeInstanceDescriptor(uint32_t index) {
+  VkDescriptorBufferInfo instancesInfo{};
+  instancesInfo.buffer = geometry->getInstanceBuffer(index);
+  instancesInfo.offset = 0;
+  instancesInfo.range = VK_WHOLE_SIZE;
+
+  VkWriteDescriptorSet descriptorWrite{};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstBinding = 2;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pBufferInfo = &instancesInfo;
+  descriptorWrite.dstSet = descriptor.sets[index];
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  vkUpdateDescriptorSets(core->device, 1, &descriptorWrite, 0, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
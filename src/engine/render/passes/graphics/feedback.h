@@ -0,0 +1,107 @@
+#pragma once
+
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+
+// Внутренние библиотеки
+#include "graphics.h"
+#include "geometry.h"
+#include "scene.h"
+
+// Стандартные библиотеки
+#include <vector>
+#include <string>
+
+// Проход обратной связи виртуальных текстур
+// Рисует сцену в низком разрешении и сообщает, какие страницы нужны кадру.
+// Вызовы и данные экземпляров берутся у прохода геометрии - своего перебора форм нет
+class Feedback : public GraphicsPass {
+ public:
+  typedef Feedback* Pass;
+  Scene::Manager scene;
+  Geometry::Pass geometry;
+
+  void init() override;
+  void destroy() override;
+  void reload() override;
+  void resize() override;
+
+  void update(uint32_t index);
+  void record(uint32_t index, VkCommandBuffer);
+
+  // Результат прохода - доступен после завершения кадра с тем же индексом
+  const uint32_t* getData(uint32_t index);
+  size_t getDataCount();
+
+  //=========================================================================
+  // Обработчики конвейера и прохода рендера
+
+ private:
+  void createRenderPass() override;
+
+  VkVertexInputBindingDescription getVertexBinding() override;
+  std::vector<VkVertexInputBindingDescription> getVertexBindings() override;
+  std::vector<VkVertexInputAttributeDescription> getVertexAttributes() override;
+  VkPushConstantRange getPushConstantRange() override;
+
+  //=========================================================================
+  // Выделенные ресурсы, привязанные к конвейеру
+
+ public:
+  // Во сколько раз разрешение прохода меньше основного
+  static constexpr uint32_t scale = 8;
+
+  // ~ ConstantBuffer
+  struct constants_t {
+    float levelBias;
+  } constants;
+
+  // ~ cbuffer
+  struct uniform_t {
+    glm::float4x4 cameraView;
+    glm::float4x4 cameraProjection;
+  } uniform;
+
+  // ~ StructuredBuffer
+  VkBuffer virtualInfoBuffer;
+
+ private:
+  std::vector<VkBuffer> uniformBuffers;
+  std::vector<VkDeviceMemory> uniformBuffersMemory;
+
+  void createUniformDescriptors();
+  void destroyUniformDescriptors();
+  void updateUniformDescriptors(uint32_t index);
+
+  void createDescriptorLayouts() override;
+  void createDescriptorSets() override;
+  void updateDescriptorSets() override;
+  void writeInstanceDescriptor(uint32_t index);  // Буфер экземпляров геометрии пересоздаётся с ростом сцены
+
+  //=========================================================================
+  // Фреймбуфер - целевой объект графического рендера
+
+ public:
+  std::vector<VkImage> targetImages;  // Нужны для копирования результата
+
+  // Изображение для теста глубины - цель графа рендера
+  struct {
+    VkFormat format;
+    std::vector<VkImageView> views;
+  } depth;
+
+ private:
+  void createFramebuffers() override;
+
+  // Копии результата в памяти приложения
+  struct readback_t {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    void* data;
+  };
+  std::vector<readback_t> readback;
+  void createReadbackBuffers();
+  void destroyReadbackBuffers();
+
+  //=========================================================================
+};
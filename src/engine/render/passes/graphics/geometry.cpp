@@ -1,89 +1,367 @@
 #include "geometry.h"
 
 void Geometry::init() {
-  createDepthImage();
   createUniformDescriptors();
+  createInstanceBuffers();
+  createSecondaryBuffers();
+  startWorkers();
   GraphicsPass::init();
 }
 
 void Geometry::update(uint32_t index) {
   updateUniformDescriptors(index);
+  updateInstanceBuffers(index);
 }
 
 void Geometry::reload() {
-  destroyDepthImage();
+  clearShapeStates();
+  vkDestroyRenderPass(core->device, occludedPass, nullptr);
+  destroyPrepass();
+  destroyMerged();
   destroyUniformDescriptors();
-  createDepthImage();
+  destroyInstanceBuffers();
   createUniformDescriptors();
+  createInstanceBuffers();
   GraphicsPass::reload();
 }
 
 void Geometry::resize() {
-  destroyDepthImage();
-  createDepthImage();
+  vkDestroyRenderPass(core->device, occludedPass, nullptr);
+  destroyPrepass();
+  destroyMerged();
   GraphicsPass::resize();
 }
 
 void Geometry::destroy() {
+  clearShapeStates();
+  vkDestroyRenderPass(core->device, occludedPass, nullptr);
+  destroyPrepass();
+  destroyMerged();
   GraphicsPass::destroy();
-  destroyDepthImage();
   destroyUniformDescriptors();
+  destroyInstanceBuffers();
+  stopWorkers();
+  destroySecondaryBuffers();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Geometry::record(uint32_t index, VkCommandBuffer cmd) {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  // Проход глубины и цветовой проход записывают одни и те же вызовы
+  if (depthPrepass)
+    recordPass(index, cmd, prepass.pass);
+  recordPass(index, cmd, depthPrepass ? prepass.colorPass : pipeline.pass);
+
+  auto end = std::chrono::high_resolution_clock::now();
+  recordTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Geometry::recordMerged(uint32_t index, uint32_t image, VkCommandBuffer cmd, const Subpass& post) {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  merged.image = image;
+  recordPass(index, cmd, merged.pass, post);
+
+  auto end = std::chrono::high_resolution_clock::now();
+  recordTime = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+VkRenderPass Geometry::getMergedPass() {
+  return merged.pass;
+}
+
+void Geometry::recordPass(uint32_t index, VkCommandBuffer cmd, VkRenderPass pass, const std::function<void(VkCommandBuffer)>& next) {
+  // Список вызовов делится между потоками в режимах с отсечением на CPU
+  uint32_t threads = std::min(recordThreads, maxRecordThreads);
+  bool parallel = drawMode != DRAW_GPU && threads > 1 && batches.size() >= threads;
+  beginRenderPass(index, cmd, pass, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+  if (drawMode == DRAW_GPU) {
+    // С отсечением перекрытых форм сначала рисуются видимые в прошлом кадре
+    drawList(index, cmd, visibility->uniform.occlusion ? Visibility::LIST_EARLY : Visibility::LIST_LATE);
+  } else if (parallel) {
+    recordParallel(index, cmd, pass, threads);
+  } else if (!batches.empty()) {
+    bindBuffers(index, cmd);
+    if (drawMode == DRAW_INDIRECT) {
+      // Вся сцена - один вызов
+      uint32_t drawCount = static_cast<uint32_t>(commands.size());
+      vkCmdDrawIndexedIndirect(cmd, instanceData[index].commands, 0, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+    } else {
+      drawBatches(cmd, 0, static_cast<uint32_t>(batches.size()));
+    }
+  }
+
+  // Следующий подпроход того же прохода рендера записывает вызывающий
+  if (next != nullptr) {
+    vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+    next(cmd);
+  }
+
+  vkCmdEndRenderPass(cmd);
+}
+
+void Geometry::recordDraws(uint32_t index, VkCommandBuffer cmd) {
+  if (drawMode == DRAW_GPU) {
+    if (visibility->uniform.occlusion)
+      drawList(index, cmd, Visibility::LIST_EARLY);
+    drawList(index, cmd, Visibility::LIST_LATE);
+    return;
+  }
+
+  if (batches.empty())
+    return;
+  bindBuffers(index, cmd);
+  if (drawMode == DRAW_INDIRECT)
+    vkCmdDrawIndexedIndirect(cmd, instanceData[index].commands, 0, static_cast<uint32_t>(commands.size()), sizeof(VkDrawIndexedIndirectCommand));
+  else
+    drawBatches(cmd, 0, static_cast<uint32_t>(batches.size()));
+}
+
+VkBuffer Geometry::getInstanceBuffer(uint32_t index) {
+  return instanceData[index].instances;
+}
+
+void Geometry::bindBuffers(uint32_t index, VkCommandBuffer cmd) {
+  // Общие буферы вершин и индексов всех моделей, поток индексов экземпляров
+  auto models = scene->getModels();
+  VkBuffer vertexBuffers[] = {models->getVertexBuffer(), instanceData[index].indices};
+  VkDeviceSize offsets[] = {0, 0};
+  vkCmdBindVertexBuffers(cmd, 0, 2, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(cmd, models->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void Geometry::drawBatches(VkCommandBuffer cmd, uint32_t first, uint32_t count) {
+  // Все экземпляры группы одним вызовом
+  for (uint32_t i = first; i < first + count; ++i) {
+    auto& batch = batches[i];
+    vkCmdDrawIndexed(cmd, batch.shape->indicesCount, batch.count, batch.shape->firstIndex, batch.shape->vertexOffset, batch.first);
+  }
+}
+
+void Geometry::recordLate(uint32_t index, VkCommandBuffer cmd) {
+  // Дорисовка форм, прошедших проверку по Hi-Z, поверх изображений основного прохода
+  beginRenderPass(index, cmd, occludedPass);
+  drawList(index, cmd, Visibility::LIST_LATE);
+  vkCmdEndRenderPass(cmd);
+}
+
+void Geometry::beginRenderPass(uint32_t index, VkCommandBuffer cmd, VkRenderPass pass, VkSubpassContents contents) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = pipeline.pass;
-  renderPassInfo.framebuffer = framebuffers[index];
+  renderPassInfo.renderPass = pass;
+  renderPassInfo.framebuffer = getFramebuffer(index, pass);
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = {target.width, target.height};
 
-  // Заливка цвета вне всех примитивов
-  std::array<VkClearValue, 2> clearValues{};
+  // Заливка цвета вне всех примитивов (проход дорисовки загружает изображения)
+  std::array<VkClearValue, 3> clearValues{};
   clearValues[0].color = {0.2f, 0.3f, 0.3f, 1.0f};
   clearValues[1].depthStencil = {1.0f, 0};
+  clearValues[2].color = {backgroundVelocity, backgroundVelocity, 0.0f, 0.0f};
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  // Новое разрешение вывода
+  // Значения очистки выбираются по номерам подключений - у прохода глубины оно одно
+  if (pass == prepass.pass) {
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValues[1];
+  }
+
+  // Команды подпрохода из вторичных буферов - состояние подключают они сами
+  vkCmdBeginRenderPass(cmd, &renderPassInfo, contents);
+  if (contents == VK_SUBPASS_CONTENTS_INLINE)
+    bindState(index, cmd, pass);
+}
+
+VkExtent2D Geometry::getRenderExtent() {
+  // Не меньше пиксела и не больше цели вывода
+  auto scaled = [this](uint32_t size) {
+    uint32_t value = static_cast<uint32_t>(static_cast<float>(size) * renderScale + 0.5f);
+    return std::clamp(value, 1u, size);
+  };
+  return {scaled(target.width), scaled(target.height)};
+}
+
+VkPipeline Geometry::getPipeline(VkRenderPass pass) {
+  // Проход дорисовки продолжает основной с его конвейером
+  if (pass == prepass.pass)
+    return prepass.depth;
+  if (pass == prepass.colorPass)
+    return prepass.equal;
+  if (pass == merged.pass)
+    return merged.pipeline;
+  return pipeline.instance;
+}
+
+VkFramebuffer Geometry::getFramebuffer(uint32_t index, VkRenderPass pass) {
+  if (pass == merged.pass)
+    return merged.framebuffers[merged.image * target.views.size() + index];
+  return pass == prepass.pass ? prepass.framebuffers[index] : framebuffers[index];
+}
+
+void Geometry::bindState(uint32_t index, VkCommandBuffer cmd, VkRenderPass pass) {
+  // Новое разрешение вывода - часть цели вывода при динамическом разрешении.
+  // Проход очищает изображения целиком: глубина вне области вывода - дальняя для пирамиды глубины
+  VkExtent2D extent = getRenderExtent();
   VkViewport viewport{};
   viewport.x = 0;
-  viewport.y = static_cast<float>(target.height);
-  viewport.width = static_cast<float>(target.width);
-  viewport.height = -static_cast<float>(target.height);
+  viewport.y = static_cast<float>(extent.height);
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = -static_cast<float>(extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
-  vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
   // Подключение конвейера и настройка его динамических частей
-  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.instance);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, getPipeline(pass));
   vkCmdSetViewport(cmd, 0, 1, &viewport);
 
   // Подключение множества ресурсов, используемых в конвейере
-  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &descriptor.sets[index], 0, nullptr);
+  std::array<VkDescriptorSet, 2> sets = {descriptor.sets[index], textureTable.set};
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+}
 
-  int i = 0;
-  auto textures = scene->getTextures();
-  for (auto object : scene->objects) {
-    instance.objectModel = object->modelMatrix;
-    for (auto shape : object->model->shapes) {
-      // Буферы вершин
-      VkBuffer vertexBuffers[] = {shape->vertexBuffer};
-      VkDeviceSize offsets[] = {0};
-      vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+void Geometry::drawList(uint32_t index, VkCommandBuffer cmd, Visibility::List list) {
+  // Число команд известно только GPU
+  Visibility::list_t draws = visibility->getList(index, list);
+  if (draws.maxDraws == 0)
+    return;
+
+  auto models = scene->getModels();
+  VkBuffer vertexBuffers[] = {models->getVertexBuffer(), draws.indices};
+  VkDeviceSize offsets[] = {0, draws.indicesOffset};
+  vkCmdBindVertexBuffers(cmd, 0, 2, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(cmd, models->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  vkCmdDrawIndexedIndirectCount(
+      cmd,
+      draws.commands, draws.commandsOffset,
+      draws.count, draws.countOffset,
+      draws.maxDraws,
+      sizeof(VkDrawIndexedIndirectCommand));
+}
 
-      instance.objectTexture = shape->diffuseTextureID;
-      vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(instance_t), &instance);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      // Операция рендера
-      vkCmdDraw(cmd, shape->verticesCount, 1, 0, 0);
+void Geometry::createSecondaryBuffers() {
+  secondary.resize(target.views.size());
+  for (auto& workers : secondary) {
+    for (auto& worker : workers) {
+      worker.pool = core->commands->createCommandBufferPool(true);
+      worker.cmd = core->commands->createCommandBuffer(worker.pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
     }
   }
+}
 
-  vkCmdEndRenderPass(cmd);
+void Geometry::destroySecondaryBuffers() {
+  for (auto& workers : secondary)
+    for (auto& worker : workers)
+      core->commands->destroyCommandBufferPool(worker.pool);
+  secondary.clear();
+}
+
+void Geometry::recordParallel(uint32_t index, VkCommandBuffer cmd, VkRenderPass pass, uint32_t threads) {
+  VkCommandBufferInheritanceInfo inheritance{};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.renderPass = pass;
+  inheritance.subpass = 0;
+  inheritance.framebuffer = getFramebuffer(index, pass);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritance;
+
+  // Равные части групп по порядку - каждый поток пишет только в буфер из своего пула кадра.
+  // Косвенный режим рисует часть команд групп одним вызовом.
+  // Проход глубины записывается в другие пулы - его буферы выполняются в том же кадре
+  uint32_t count = static_cast<uint32_t>(batches.size());
+  uint32_t slot = pass == prepass.pass ? maxRecordThreads : 0;
+  runParts(threads, [this, index, pass, count, threads, slot, &beginInfo](uint32_t part) {
+    auto& worker = secondary[index][slot + part];
+    uint32_t first = count * part / threads;
+    uint32_t last = count * (part + 1) / threads;
+
+    core->commands->resetCommandBufferPool(worker.pool);
+    vkBeginCommandBuffer(worker.cmd, &beginInfo);
+    bindState(index, worker.cmd, pass);
+    bindBuffers(index, worker.cmd);
+    if (drawMode == DRAW_INDIRECT) {
+      VkDeviceSize offset = first * sizeof(VkDrawIndexedIndirectCommand);
+      vkCmdDrawIndexedIndirect(worker.cmd, instanceData[index].commands, offset, last - first, sizeof(VkDrawIndexedIndirectCommand));
+    } else {
+      drawBatches(worker.cmd, first, last - first);
+    }
+    vkEndCommandBuffer(worker.cmd);
+  });
+
+  std::array<VkCommandBuffer, maxRecordThreads> buffers;
+  for (uint32_t part = 0; part < threads; ++part)
+    buffers[part] = secondary[index][slot + part].cmd;
+  vkCmdExecuteCommands(cmd, threads, buffers.data());
+}
+
+void Geometry::startWorkers() {
+  workers.stop = false;
+  for (uint32_t part = 1; part < maxRecordThreads; ++part)
+    workers.threads.push_back(std::thread(&Geometry::runWorker, this, part));
+}
+
+void Geometry::stopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(workers.mutex);
+    workers.stop = true;
+  }
+  workers.wake.notify_all();
+  for (auto& thread : workers.threads)
+    thread.join();
+  workers.threads.clear();
+}
+
+void Geometry::runWorker(uint32_t part) {
+  uint64_t generation = 0;
+  while (true) {
+    Part task;
+    {
+      std::unique_lock<std::mutex> lock(workers.mutex);
+      workers.wake.wait(lock, [this, generation]() { return workers.stop || workers.generation != generation; });
+      if (workers.stop)
+        return;
+      generation = workers.generation;
+      if (part >= workers.parts)
+        continue;
+      task = workers.part;
+    }
+
+    task(part);
+
+    std::lock_guard<std::mutex> lock(workers.mutex);
+    if (--workers.remaining == 0)
+      workers.done.notify_one();
+  }
+}
+
+void Geometry::runParts(uint32_t parts, const Part& part) {
+  {
+    std::lock_guard<std::mutex> lock(workers.mutex);
+    workers.part = part;
+    workers.parts = parts;
+    workers.remaining = parts - 1;
+    workers.generation++;
+  }
+  workers.wake.notify_all();
+
+  // Первую часть пишет текущий поток
+  part(0);
+
+  std::unique_lock<std::mutex> lock(workers.mutex);
+  workers.done.wait(lock, [this]() { return workers.remaining == 0; });
+  workers.part = nullptr;
+}
+
+double Geometry::getRecordTime() {
+  return recordTime;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -118,30 +396,447 @@ void Geometry::updateUniformDescriptors(uint32_t imageIndex) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Geometry::createDepthImage() {
-  depth.format = core->resources->findSupportedFormat(
-      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
-      VK_IMAGE_TILING_OPTIMAL,
-      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+void Geometry::createInstanceData(uint32_t imageIndex, uint32_t capacity) {
+  instance_data_t& data = instanceData[imageIndex];
+  data.capacity = capacity;
+  data.entries = false;
+  data.version = 0;
+
+  core->resources->createBuffer(
+      capacity * sizeof(instance_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.instances, data.instancesMemory);
+
+  core->resources->createBuffer(
+      capacity * sizeof(uint32_t),
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.indices, data.indicesMemory);
+
+  core->resources->createBuffer(
+      capacity * sizeof(VkDrawIndexedIndirectCommand),
+      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      data.commands, data.commandsMemory);
+
+  // Поток индексов экземпляров постоянен: i-й экземпляр читает instances[i]
+  std::vector<uint32_t> identity(capacity);
+  for (uint32_t i = 0; i < capacity; ++i)
+    identity[i] = i;
+  core->commands->copyDataToBuffer(identity.data(), data.indices, capacity * sizeof(uint32_t));
+}
+
+void Geometry::destroyInstanceData(uint32_t imageIndex) {
+  instance_data_t& data = instanceData[imageIndex];
+  core->resources->destroyBuffer(data.instances, data.instancesMemory);
+  core->resources->destroyBuffer(data.indices, data.indicesMemory);
+  core->resources->destroyBuffer(data.commands, data.commandsMemory);
+}
+
+void Geometry::createInstanceBuffers() {
+  instanceData.resize(target.views.size());
+  for (uint32_t i = 0; i < instanceData.size(); ++i)
+    createInstanceData(i, instanceCapacity);
+}
+
+void Geometry::destroyInstanceBuffers() {
+  for (uint32_t i = 0; i < instanceData.size(); ++i)
+    destroyInstanceData(i);
+}
+
+void Geometry::updateInstanceBuffers(uint32_t imageIndex) {
+  batches.clear();
+  batchIndices.clear();
+  instances.clear();
+  commands.clear();
+
+  // Изменения нужны только буферам, расположенным по текущему набору форм -
+  // остальные при следующем использовании в режиме GPU записываются целиком
+  auto culling = scene->getCulling();
+  auto& changes = culling->getChanges();
+  for (auto& data : instanceData) {
+    if (!data.entries || data.version != culling->getVersion())
+      continue;
+    data.pending.insert(data.pending.end(), changes.begin(), changes.end());
+    data.pending.insert(data.pending.end(), moved.begin(), moved.end());
+  }
+  moved = changes;
+
+  if (drawMode == DRAW_GPU) {
+    updateEntryInstances(imageIndex);
+    return;
+  }
+
+  // Сгруппированные экземпляры заменяют расположение по формам
+  instanceData[imageIndex].entries = false;
+  instanceData[imageIndex].pending.clear();
+
+  if (sortDraws)
+    sortInstances();
+  else
+    groupInstances();
+  stateChanges = countStateChanges();
+  uint32_t total = static_cast<uint32_t>(instances.size());
+
+  // Команды косвенного рендера - по одной на группу
+  commands.resize(batches.size());
+  for (uint32_t i = 0; i < batches.size(); ++i) {
+    commands[i].indexCount = batches[i].shape->indicesCount;
+    commands[i].instanceCount = batches[i].count;
+    commands[i].firstIndex = batches[i].shape->firstIndex;
+    commands[i].vertexOffset = batches[i].shape->vertexOffset;
+    commands[i].firstInstance = batches[i].first;
+  }
+  if (total == 0)
+    return;
+
+  // Кадр, использовавший эти буферы, уже завершён - их можно пересоздать
+  if (total > instanceData[imageIndex].capacity) {
+    while (instanceCapacity < total)
+      instanceCapacity *= 2;
+    destroyInstanceData(imageIndex);
+    createInstanceData(imageIndex, instanceCapacity);
+    writeInstanceDescriptor(imageIndex);
+  }
+
+  instance_data_t& data = instanceData[imageIndex];
+  void* mapped;
+  VkDeviceSize size = total * sizeof(instance_t);
+  vkMapMemory(core->device, data.instancesMemory, 0, size, 0, &mapped);
+  memcpy(mapped, instances.data(), size);
+  vkUnmapMemory(core->device, data.instancesMemory);
+
+  size = commands.size() * sizeof(VkDrawIndexedIndirectCommand);
+  vkMapMemory(core->device, data.commandsMemory, 0, size, 0, &mapped);
+  memcpy(mapped, commands.data(), size);
+  vkUnmapMemory(core->device, data.commandsMemory);
+}
+
+void Geometry::groupInstances() {
+  auto culling = scene->getCulling();
 
-  core->resources->createImage(
-      core->swapchain.extent.width,
-      core->swapchain.extent.height,
-      depth.format,
-      VK_IMAGE_TILING_OPTIMAL,
-      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-      depth.image, depth.memory);
+  // Группировка видимых форм: сначала число экземпляров в каждой группе
+  for (auto object : scene->objects) {
+    uint32_t shapeIndex = 0;
+    for (auto shape : object->model->shapes) {
+      if (!culling->isVisible(object->transformID, shapeIndex++))
+        continue;
+      auto found = batchIndices.find(shape);
+      if (found == batchIndices.end()) {
+        batchIndices[shape] = static_cast<uint32_t>(batches.size());
+        batches.push_back({shape, 0, 1});
+      } else {
+        batches[found->second].count++;
+      }
+    }
+  }
 
-  depth.view = core->resources->createImageView(
-      depth.image,
-      depth.format,
-      VK_IMAGE_ASPECT_DEPTH_BIT);
+  // Группы располагаются в буфере подряд
+  uint32_t total = 0;
+  for (auto& batch : batches) {
+    batch.first = total;
+    total += batch.count;
+    batch.count = 0;
+  }
+  instances.resize(total);
+
+  for (auto object : scene->objects) {
+    uint32_t shapeIndex = 0;
+    for (auto shape : object->model->shapes) {
+      if (!culling->isVisible(object->transformID, shapeIndex++))
+        continue;
+      batch_t& batch = batches[batchIndices[shape]];
+      writeInstance(instances[batch.first + batch.count++], object->getModelMatrix(), object->getPreviousModelMatrix(), shape);
+    }
+  }
 }
 
-void Geometry::destroyDepthImage() {
-  core->resources->destroyImageView(depth.view);
-  core->resources->destroyImage(depth.image, depth.memory);
+void Geometry::sortInstances() {
+  auto culling = scene->getCulling();
+  drawKeys.clear();
+  drawItems.clear();
+
+  // Номера привязаны к адресам форм - после удаления или добавления моделей строятся заново
+  uint32_t modelsVersion = scene->getModels()->getVersion();
+  if (modelsVersion != shapeStatesVersion)
+    clearShapeStates();
+  shapeStatesVersion = modelsVersion;
+
+  // Ключ формы: материал и геометрия получают плотные номера при первой встрече
+  for (auto object : scene->objects) {
+    uint32_t shapeIndex = 0;
+    for (auto shape : object->model->shapes) {
+      if (!culling->isVisible(object->transformID, shapeIndex++))
+        continue;
+
+      auto found = shapeStates.find(shape);
+      if (found == shapeStates.end()) {
+        uint64_t material = (static_cast<uint64_t>(shape->diffuseTextureID & 0xFFFFF) << 40) |
+                            (static_cast<uint64_t>(shape->samplerID & 0xFFFFF) << 20) |
+                            (shape->virtualTextureID & 0xFFFFF);
+        uint64_t geometry = (static_cast<uint64_t>(shape->firstIndex) << 32) | static_cast<uint32_t>(shape->vertexOffset);
+        auto materialID = materialIDs.emplace(material, static_cast<uint32_t>(materialIDs.size())).first->second;
+        auto geometryID = geometryIDs.emplace(geometry, static_cast<uint32_t>(geometryIDs.size())).first->second;
+        found = shapeStates.emplace(shape, std::make_pair(materialID, geometryID)).first;
+      }
+
+      // Глубина центра формы в пространстве камеры
+      const glm::float4x4& model = object->getModelMatrix();
+      glm::float4 center = uniform.cameraView * (model * glm::float4(shape->bounds.center, 1.0f));
+      uint64_t key = DrawList::makeKey(0, 0, found->second.first, found->second.second, -center.z);
+
+      drawKeys.add(key, static_cast<uint32_t>(drawItems.size()));
+      drawItems.push_back({&model, &object->getPreviousModelMatrix(), shape});
+    }
+  }
+  drawKeys.sort();
+
+  // Подряд идущие элементы одного состояния и одной геометрии - один вызов,
+  // экземпляры внутри него упорядочены от ближних к дальним
+  auto& items = drawKeys.getItems();
+  instances.resize(items.size());
+  uint64_t state = 0;
+  for (uint32_t i = 0; i < items.size(); ++i) {
+    auto& item = drawItems[items[i].payload];
+    bool same = !batches.empty() && DrawList::getState(items[i].key) == state &&
+                batches.back().shape->firstIndex == item.shape->firstIndex &&
+                batches.back().shape->vertexOffset == item.shape->vertexOffset;
+    if (!same) {
+      batches.push_back({item.shape, i, 0});
+      state = DrawList::getState(items[i].key);
+    }
+    batches.back().count++;
+    writeInstance(instances[i], *item.model, *item.previous, item.shape);
+  }
+}
+
+void Geometry::writeInstance(instance_t& instance, const glm::float4x4& model, const glm::float4x4& previous, Models::model_t::shape_t* shape) {
+  instance.objectModel = model;
+  instance.objectPreviousModel = previous;
+  instance.objectTexture = shape->diffuseTextureID;
+  instance.objectSampler = shape->samplerID;
+  instance.objectVirtualTexture = shape->virtualTextureID;
+  instance.padding = 0;
+}
+
+void Geometry::clearShapeStates() {
+  shapeStates.clear();
+  materialIDs.clear();
+  geometryIDs.clear();
+}
+
+uint32_t Geometry::countStateChanges() {
+  // Материал или геометрия, отличающиеся от предыдущего вызова, - то, что пришлось бы подключить
+  uint32_t changes = 0;
+  for (uint32_t i = 1; i < batches.size(); ++i) {
+    auto previous = batches[i - 1].shape;
+    auto current = batches[i].shape;
+    if (previous->diffuseTextureID != current->diffuseTextureID ||
+        previous->samplerID != current->samplerID ||
+        previous->virtualTextureID != current->virtualTextureID)
+      changes++;
+    if (previous->firstIndex != current->firstIndex || previous->vertexOffset != current->vertexOffset)
+      changes++;
+  }
+  return changes;
+}
+
+void Geometry::updateEntryInstances(uint32_t imageIndex) {
+  auto culling = scene->getCulling();
+  auto transforms = scene->getTransforms();
+  uint32_t count = culling->getEntryCount();
+  if (count == 0)
+    return;
+
+  if (count > instanceData[imageIndex].capacity) {
+    while (instanceCapacity < count)
+      instanceCapacity *= 2;
+    destroyInstanceData(imageIndex);
+    createInstanceData(imageIndex, instanceCapacity);
+    writeInstanceDescriptor(imageIndex);
+  }
+
+  // Буфер после других режимов или новых форм записывается целиком, иначе - только изменённые формы
+  instance_data_t& data = instanceData[imageIndex];
+  bool full = !data.entries || data.version != culling->getVersion();
+  uint32_t writes = full ? count : static_cast<uint32_t>(data.pending.size());
+
+  if (writes > 0) {
+    instance_t* mapped;
+    vkMapMemory(core->device, data.instancesMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&mapped));
+    for (uint32_t i = 0; i < writes; ++i) {
+      uint32_t entry = full ? i : data.pending[i];
+      uint32_t transformID = culling->getTransformID(entry);
+      writeInstance(mapped[entry], transforms->getMatrix(transformID), transforms->getPreviousMatrix(transformID), culling->getShape(entry));
+    }
+    vkUnmapMemory(core->device, data.instancesMemory);
+  }
+
+  data.entries = true;
+  data.version = culling->getVersion();
+  data.pending.clear();
+}
+
+void Geometry::writeInstanceDescriptor(uint32_t imageIndex) {
+  VkDescriptorBufferInfo instancesInfo{};
+  instancesInfo.buffer = instanceData[imageIndex].instances;
+  instancesInfo.offset = 0;
+  instancesInfo.range = VK_WHOLE_SIZE;
+
+  VkWriteDescriptorSet instancesWrite{};
+  instancesWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  instancesWrite.dstBinding = 5;
+  instancesWrite.dstArrayElement = 0;
+  instancesWrite.descriptorCount = 1;
+  instancesWrite.pBufferInfo = &instancesInfo;
+  instancesWrite.dstSet = descriptor.sets[imageIndex];
+  instancesWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  vkUpdateDescriptorSets(core->device, 1, &instancesWrite, 0, nullptr);
+}
+
+uint32_t Geometry::getDrawCount() {
+  if (drawMode == DRAW_GPU) {
+    // Ранний и поздний списки - по вызову на каждый
+    if (visibility->getList(0, Visibility::LIST_LATE).maxDraws == 0)
+      return 0;
+    return visibility->uniform.occlusion ? 2 : 1;
+  }
+  return drawMode == DRAW_INDIRECT && !batches.empty() ? 1 : static_cast<uint32_t>(batches.size());
+}
+
+uint32_t Geometry::getStateChanges() {
+  return drawMode == DRAW_GPU ? 0 : stateChanges;
+}
+
+uint32_t Geometry::getInstanceCount() {
+  return static_cast<uint32_t>(instances.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Geometry::benchmark_t Geometry::benchmark(uint32_t count) {
+  benchmark_t result{};
+  result.count = count;
+
+  // Формы объектов сцены по кругу - вызовы с разными диапазонами индексов, как в реальном списке
+  std::vector<Models::model_t::shape_t*> shapes;
+  for (auto object : scene->objects)
+    for (auto shape : object->model->shapes)
+      shapes.push_back(shape);
+  if (shapes.empty())
+    return result;
+
+  auto models = scene->getModels();
+
+  // Вторичный буфер команд внутри прохода рендера геометрии
+  VkCommandPool pool = core->commands->createCommandBufferPool(true);
+  VkCommandBuffer cmd = core->commands->createCommandBuffer(pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+  VkCommandBufferInheritanceInfo inheritance{};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.renderPass = pipeline.pass;
+  inheritance.subpass = 0;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritance;
+
+  VkBuffer commandsBuffer;
+  VkDeviceMemory commandsMemory;
+  core->resources->createBuffer(
+      count * sizeof(VkDrawIndexedIndirectCommand),
+      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      commandsBuffer, commandsMemory);
+
+  VkBuffer vertexBuffers[] = {models->getVertexBuffer(), instanceData[0].indices};
+  VkDeviceSize offsets[] = {0, 0};
+
+  VkViewport viewport{0.0f, static_cast<float>(target.height), static_cast<float>(target.width), -static_cast<float>(target.height), 0.0f, 1.0f};
+  std::array<VkDescriptorSet, 2> sets = {descriptor.sets[0], textureTable.set};
+  auto bindCommon = [&](VkCommandBuffer cmd) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.instance);
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+    vkCmdBindIndexBuffer(cmd, models->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  };
+
+  // Отдельный вызов для каждой формы (путь до инстансирования)
+  auto start = std::chrono::high_resolution_clock::now();
+  vkBeginCommandBuffer(cmd, &beginInfo);
+  bindCommon(cmd);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto shape = shapes[i % shapes.size()];
+    vkCmdBindVertexBuffers(cmd, 0, 2, vertexBuffers, offsets);
+    vkCmdDrawIndexed(cmd, shape->indicesCount, 1, shape->firstIndex, shape->vertexOffset, 0);
+  }
+  vkEndCommandBuffer(cmd);
+  auto end = std::chrono::high_resolution_clock::now();
+  result.directTime = std::chrono::duration<double, std::milli>(end - start).count();
+  core->commands->resetCommandBuffer(cmd);
+
+  // Построение массива команд и один косвенный вызов
+  start = std::chrono::high_resolution_clock::now();
+  std::vector<VkDrawIndexedIndirectCommand> benchmarkCommands(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto shape = shapes[i % shapes.size()];
+    benchmarkCommands[i] = {shape->indicesCount, 1, shape->firstIndex, shape->vertexOffset, 0};
+  }
+  void* mapped;
+  vkMapMemory(core->device, commandsMemory, 0, count * sizeof(VkDrawIndexedIndirectCommand), 0, &mapped);
+  memcpy(mapped, benchmarkCommands.data(), count * sizeof(VkDrawIndexedIndirectCommand));
+  vkUnmapMemory(core->device, commandsMemory);
+  auto middle = std::chrono::high_resolution_clock::now();
+  result.indirectBuildTime = std::chrono::duration<double, std::milli>(middle - start).count();
+
+  // Несколько команд одним вызовом - только с multiDrawIndirect
+  if (core->physicalDevice.features.multiDrawIndirect) {
+    vkBeginCommandBuffer(cmd, &beginInfo);
+    bindCommon(cmd);
+    vkCmdBindVertexBuffers(cmd, 0, 2, vertexBuffers, offsets);
+    vkCmdDrawIndexedIndirect(cmd, commandsBuffer, 0, count, sizeof(VkDrawIndexedIndirectCommand));
+    vkEndCommandBuffer(cmd);
+    end = std::chrono::high_resolution_clock::now();
+    result.indirectTime = std::chrono::duration<double, std::milli>(end - middle).count();
+  }
+
+  // Те же отдельные вызовы, поделённые между потоками - у каждого свой пул и вторичный буфер
+  std::array<VkCommandPool, maxRecordThreads> threadPools;
+  std::array<VkCommandBuffer, maxRecordThreads> threadBuffers;
+  for (uint32_t i = 0; i < maxRecordThreads; ++i) {
+    threadPools[i] = core->commands->createCommandBufferPool(true);
+    threadBuffers[i] = core->commands->createCommandBuffer(threadPools[i], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  }
+
+  for (uint32_t t = 0; t < benchmarkThreads.size(); ++t) {
+    uint32_t threads = benchmarkThreads[t];
+    auto recordPart = [&](uint32_t part) {
+      VkCommandBuffer partCmd = threadBuffers[part];
+      core->commands->resetCommandBufferPool(threadPools[part]);
+      vkBeginCommandBuffer(partCmd, &beginInfo);
+      bindCommon(partCmd);
+      for (uint32_t i = count * part / threads; i < count * (part + 1) / threads; ++i) {
+        auto shape = shapes[i % shapes.size()];
+        vkCmdBindVertexBuffers(partCmd, 0, 2, vertexBuffers, offsets);
+        vkCmdDrawIndexed(partCmd, shape->indicesCount, 1, shape->firstIndex, shape->vertexOffset, 0);
+      }
+      vkEndCommandBuffer(partCmd);
+    };
+
+    // Те же постоянные потоки, что и при записи кадра
+    start = std::chrono::high_resolution_clock::now();
+    runParts(threads, recordPart);
+    end = std::chrono::high_resolution_clock::now();
+    result.threadTimes[t] = std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  for (auto threadPool : threadPools)
+    core->commands->destroyCommandBufferPool(threadPool);
+  core->resources->destroyBuffer(commandsBuffer, commandsMemory);
+  core->commands->destroyCommandBufferPool(pool);
+  return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -149,13 +844,38 @@ void Geometry::destroyDepthImage() {
 void Geometry::createFramebuffers() {
   framebuffers.resize(target.views.size());
   for (uint32_t i = 0; i < target.views.size(); ++i) {
-    std::vector<VkImageView> attachment = {target.views[i], depth.view};
+    std::vector<VkImageView> attachment = {target.views[i], depth.views[i], velocity.views[i]};
     framebuffers[i] = createFramebuffer(attachment, target.width, target.height);
   }
+
+  // Проход глубины пишет только в глубину - цветовой проход затем продолжает те же изображения
+  prepass.framebuffers.resize(target.views.size());
+  for (uint32_t i = 0; i < target.views.size(); ++i) {
+    std::vector<VkImageView> attachment = {depth.views[i]};
+    prepass.framebuffers[i] = createFramebuffer(attachment, target.width, target.height, prepass.pass);
+  }
+
+  // Слитый проход пишет ещё и в изображение показа - фреймбуфер на каждую пару с кадром
+  merged.framebuffers.resize(present.views.size() * target.views.size());
+  for (uint32_t image = 0; image < present.views.size(); ++image) {
+    for (uint32_t i = 0; i < target.views.size(); ++i) {
+      std::vector<VkImageView> attachment = {target.views[i], depth.views[i], velocity.views[i], present.views[image]};
+      merged.framebuffers[image * target.views.size() + i] = createFramebuffer(attachment, target.width, target.height, merged.pass);
+    }
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+std::vector<VkVertexInputBindingDescription> Geometry::getVertexBindings() {
+  // Индекс экземпляра выбирается по firstInstance + номеру экземпляра в вызове
+  VkVertexInputBindingDescription instanceBinding{};
+  instanceBinding.binding = 1;
+  instanceBinding.stride = sizeof(uint32_t);
+  instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+  return {getVertexBinding(), instanceBinding};
+}
+
 VkVertexInputBindingDescription Geometry::getVertexBinding() {
   // Описание структур, содержащихся в вершинном буфере
   VkVertexInputBindingDescription bindingDescription{};
@@ -182,20 +902,35 @@ std::vector<VkVertexInputAttributeDescription> Geometry::getVertexAttributes() {
   attributeDescription.format = VK_FORMAT_R32G32_SFLOAT;
   attributeDescriptions.emplace_back(attributeDescription);
 
+  attributeDescription.binding = 1;
+  attributeDescription.location = 2;
+  attributeDescription.offset = 0;
+  attributeDescription.format = VK_FORMAT_R32_UINT;
+  attributeDescriptions.emplace_back(attributeDescription);
+
   return attributeDescriptions;
 }
 
 VkPushConstantRange Geometry::getPushConstantRange() {
-  VkPushConstantRange pushConstant{};
-  pushConstant.offset = 0;
-  pushConstant.size = sizeof(instance_t);
-  pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  return pushConstant;
+  // Данные экземпляров выбираются из буфера - константы не нужны
+  return {};
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Geometry::createRenderPass() {
+  pipeline.pass = buildRenderPass(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+  occludedPass = buildRenderPass(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+  prepass.colorPass = buildRenderPass(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+  prepass.pass = buildDepthPass();
+  merged.pass = buildMergedPass();
+}
+
+VkRenderPass Geometry::buildRenderPass(VkImageLayout colorLayout, VkImageLayout depthLayout) {
+  // Проходы, загружающие изображения, продолжают основной - совместимы с ним и его конвейером
+  bool loadColor = colorLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+  bool loadDepth = depthLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+
   //=================================================================================
   // Описание цветового подключения - выходного изображения конвейера
 
@@ -203,7 +938,7 @@ void Geometry::createRenderPass() {
   colorAttachment.format = target.format;
 
   // Действия при работе с изображением
-  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.loadOp = loadColor ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 
   // Действия при работе с трафаретом
@@ -211,7 +946,7 @@ void Geometry::createRenderPass() {
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
   // Раскладка изображения
-  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;               // Не устанавливается автоматически
+  colorAttachment.initialLayout = colorLayout;
   colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;  // Устанавливается автоматически в конце прохода
 
   // Мультисэмплинг
@@ -222,23 +957,33 @@ void Geometry::createRenderPass() {
   colorAttachmentRef.attachment = 0;
   colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+  //=================================================================================
+  // Векторы движения - смещение пикселя с прошлого кадра для TAA, загружаются вместе с цветом
+
+  VkAttachmentDescription velocityAttachment = colorAttachment;
+  velocityAttachment.format = velocity.format;
+
+  VkAttachmentReference velocityAttachmentRef{};
+  velocityAttachmentRef.attachment = 2;
+  velocityAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
   //=================================================================================
   // Описание изобржения глубины
 
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = depth.format;
 
-  // Действия при работе с изображением
-  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  // Действия при работе с изображением - глубина сохраняется для пирамиды глубины
+  depthAttachment.loadOp = loadDepth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 
   // Действия при работе с трафаретом
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
-  // Раскладка изображения
-  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;                       // Не устанавливается автоматически
-  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;  // Устанавливается автоматически в конце прохода
+  // Раскладка изображения - по окончании прохода глубина читается вычислительным шейдером
+  depthAttachment.initialLayout = depthLayout;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
   // Мультисэмплинг
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;  // Число образцов (1 = выкл)
@@ -254,9 +999,10 @@ void Geometry::createRenderPass() {
   VkSubpassDescription subpass{};
   subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
-  // Цветовые подключения
-  subpass.colorAttachmentCount = 1;
-  subpass.pColorAttachments = &colorAttachmentRef;
+  // Цветовые подключения - выходы фрагментного шейдера по порядку
+  std::array<VkAttachmentReference, 2> colorAttachmentRefs = {colorAttachmentRef, velocityAttachmentRef};
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+  subpass.pColorAttachments = colorAttachmentRefs.data();
 
   // Подключение глубины-трафарета (только одно)
   subpass.pDepthStencilAttachment = &depthAttachmentRef;
@@ -264,29 +1010,237 @@ void Geometry::createRenderPass() {
   //=================================================================================
   // Зависимости подпроходов рендера
 
-  VkSubpassDependency dependency{};
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.srcAccessMask = 0;
-  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  // Глубину прошлого прохода читало построение пирамиды глубины
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  // Записанная глубина читается построением пирамиды, цвет - следующими проходами
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
   //=================================================================================
   // Создание прохода рендера
 
-  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+  std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, velocityAttachment};
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
 
-  if (vkCreateRenderPass(core->device, &renderPassInfo, nullptr, &pipeline.pass) != VK_SUCCESS)
+  VkRenderPass pass;
+  if (vkCreateRenderPass(core->device, &renderPassInfo, nullptr, &pass) != VK_SUCCESS)
     throw std::runtime_error("ERROR: Failed to create render pass!");
+  return pass;
+}
+
+VkRenderPass Geometry::buildDepthPass() {
+  // Единственное подключение - глубина, которую затем загружает цветовой проход
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = depth.format;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkAttachmentReference depthAttachmentRef{};
+  depthAttachmentRef.attachment = 0;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  // Подпроход без цветовых подключений
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 0;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  // Глубину прошлого кадра читало построение пирамиды глубины
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  // Записанную глубину проверяет цветовой проход
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &depthAttachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  VkRenderPass pass;
+  if (vkCreateRenderPass(core->device, &renderPassInfo, nullptr, &pass) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create render pass!");
+  return pass;
+}
+
+VkRenderPass Geometry::buildMergedPass() {
+  //=================================================================================
+  // Подключения: цвет, глубина и векторы движения живут только в памяти тайла
+
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = target.format;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkAttachmentDescription velocityAttachment = colorAttachment;
+  velocityAttachment.format = velocity.format;
+
+  VkAttachmentDescription depthAttachment = colorAttachment;
+  depthAttachment.format = depth.format;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  // Изображение показа перезаписывается вторым подпроходом целиком
+  VkAttachmentDescription presentAttachment = colorAttachment;
+  presentAttachment.format = present.format;
+  presentAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  presentAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+  //=================================================================================
+  // Подпроходы рендера: сцена - как у основного прохода, затем постпроцессинг
+
+  VkAttachmentReference depthAttachmentRef = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+  std::array<VkAttachmentReference, 2> sceneAttachmentRefs = {{
+      {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+      {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+  }};
+  VkAttachmentReference inputAttachmentRef = {0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  VkAttachmentReference presentAttachmentRef = {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+  std::array<VkSubpassDescription, 2> subpasses{};
+  subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[0].colorAttachmentCount = static_cast<uint32_t>(sceneAttachmentRefs.size());
+  subpasses[0].pColorAttachments = sceneAttachmentRefs.data();
+  subpasses[0].pDepthStencilAttachment = &depthAttachmentRef;
+
+  subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[1].inputAttachmentCount = 1;
+  subpasses[1].pInputAttachments = &inputAttachmentRef;
+  subpasses[1].colorAttachmentCount = 1;
+  subpasses[1].pColorAttachments = &presentAttachmentRef;
+
+  //=================================================================================
+  // Зависимости подпроходов рендера
+
+  std::array<VkSubpassDependency, 3> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  // Второй подпроход читает только свой пиксель - зависимость в пределах тайла
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = 1;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+  // Поверх изображения показа рисует интерфейс
+  dependencies[2].srcSubpass = 1;
+  dependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[2].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[2].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  //=================================================================================
+  // Создание прохода рендера
+
+  std::array<VkAttachmentDescription, 4> attachments = {colorAttachment, depthAttachment, velocityAttachment, presentAttachment};
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses = subpasses.data();
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  VkRenderPass pass;
+  if (vkCreateRenderPass(core->device, &renderPassInfo, nullptr, &pass) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create render pass!");
+  return pass;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Geometry::createPipeline() {
+  GraphicsPass::createPipeline();
+
+  // Проход глубины: тот же вершинный шейдер без фрагментного. Тест EQUAL требует одинаковой
+  // позиции в обоих проходах - разные модули её не гарантируют даже с теми же вычислениями
+  variant_t depthOnly;
+  depthOnly.pass = prepass.pass;
+  depthOnly.fragment = false;
+  prepass.depth = buildPipeline(depthOnly);
+
+  // Цветовой проход после него: фрагмент проходит только с глубиной, записанной проходом глубины
+  variant_t equal;
+  equal.depthWrite = false;
+  equal.depthCompare = VK_COMPARE_OP_EQUAL;
+  prepass.equal = buildPipeline(equal);
+
+  // Первый подпроход слитого прохода - проход с другим числом подпроходов несовместим с основным
+  variant_t mergedScene;
+  mergedScene.pass = merged.pass;
+  merged.pipeline = buildPipeline(mergedScene);
+}
+
+void Geometry::destroyPrepass() {
+  vkDestroyPipeline(core->device, prepass.depth, nullptr);
+  vkDestroyPipeline(core->device, prepass.equal, nullptr);
+  vkDestroyRenderPass(core->device, prepass.pass, nullptr);
+  vkDestroyRenderPass(core->device, prepass.colorPass, nullptr);
+  for (auto framebuffer : prepass.framebuffers)
+    vkDestroyFramebuffer(core->device, framebuffer, nullptr);
+  prepass.framebuffers.clear();
+}
+
+void Geometry::destroyMerged() {
+  vkDestroyPipeline(core->device, merged.pipeline, nullptr);
+  vkDestroyRenderPass(core->device, merged.pass, nullptr);
+  for (auto framebuffer : merged.framebuffers)
+    vkDestroyFramebuffer(core->device, framebuffer, nullptr);
+  merged.framebuffers.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -299,24 +1253,48 @@ void Geometry::createDescriptorLayouts() {
   uniformLayout.pImmutableSamplers = nullptr;
   uniformLayout.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
-  VkDescriptorSetLayoutBinding textureImageLayout{};
-  textureImageLayout.binding = 1;
-  textureImageLayout.descriptorCount = static_cast<uint32_t>(textureImageViews.size());
-  textureImageLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-  textureImageLayout.pImmutableSamplers = nullptr;
-  textureImageLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-  VkDescriptorSetLayoutBinding textureSamplerLayout{};
-  textureSamplerLayout.binding = 2;
-  textureSamplerLayout.descriptorCount = 1;
-  textureSamplerLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-  textureSamplerLayout.pImmutableSamplers = nullptr;
-  textureSamplerLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-  std::array<VkDescriptorSetLayoutBinding, 3> bindings = {
+  VkDescriptorSetLayoutBinding virtualCacheLayout{};
+  virtualCacheLayout.binding = 1;
+  virtualCacheLayout.descriptorCount = 1;
+  virtualCacheLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  virtualCacheLayout.pImmutableSamplers = nullptr;
+  virtualCacheLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding virtualSamplerLayout{};
+  virtualSamplerLayout.binding = 2;
+  virtualSamplerLayout.descriptorCount = 1;
+  virtualSamplerLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  virtualSamplerLayout.pImmutableSamplers = nullptr;
+  virtualSamplerLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding pageTablesLayout{};
+  pageTablesLayout.binding = 3;
+  pageTablesLayout.descriptorCount = static_cast<uint32_t>(virtualTextures.tableViews.size());
+  pageTablesLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  pageTablesLayout.pImmutableSamplers = nullptr;
+  pageTablesLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding virtualInfoLayout{};
+  virtualInfoLayout.binding = 4;
+  virtualInfoLayout.descriptorCount = 1;
+  virtualInfoLayout.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  virtualInfoLayout.pImmutableSamplers = nullptr;
+  virtualInfoLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding instancesLayout{};
+  instancesLayout.binding = 5;
+  instancesLayout.descriptorCount = 1;
+  instancesLayout.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  instancesLayout.pImmutableSamplers = nullptr;
+  instancesLayout.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  std::array<VkDescriptorSetLayoutBinding, 6> bindings = {
       uniformLayout,
-      textureImageLayout,
-      textureSamplerLayout,
+      virtualCacheLayout,
+      virtualSamplerLayout,
+      pageTablesLayout,
+      virtualInfoLayout,
+      instancesLayout,
   };
 
   VkDescriptorSetLayoutCreateInfo layoutInfo{};
@@ -329,6 +1307,10 @@ void Geometry::createDescriptorLayouts() {
     throw std::runtime_error("ERROR: Failed to create descriptor set layout!");
 
   descriptor.layouts.push_back(layout);
+
+  // Таблица текстур принадлежит менеджеру текстур
+  descriptor.layouts.push_back(textureTable.layout);
+  descriptor.shared.push_back(textureTable.layout);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -350,19 +1332,28 @@ void Geometry::updateDescriptorSets() {
     bufferInfo.offset = 0;
     bufferInfo.range = sizeof(uniform_t);
 
-    std::vector<VkDescriptorImageInfo> imageInfo(textureImageViews.size());
-    for (uint32_t textureID = 0; textureID < textureImageViews.size(); ++textureID) {
-      imageInfo[textureID].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfo[textureID].imageView = textureImageViews[textureID];
+    VkDescriptorImageInfo virtualCacheInfo{};
+    virtualCacheInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    virtualCacheInfo.imageView = virtualTextures.cacheView;
+
+    VkDescriptorImageInfo virtualSamplerInfo{};
+    virtualSamplerInfo.sampler = virtualTextures.cacheSampler;
+
+    std::vector<VkDescriptorImageInfo> pageTablesInfo(virtualTextures.tableViews.size());
+    for (uint32_t textureID = 0; textureID < virtualTextures.tableViews.size(); ++textureID) {
+      pageTablesInfo[textureID].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      pageTablesInfo[textureID].imageView = virtualTextures.tableViews[textureID];
     }
 
-    VkDescriptorImageInfo samplerInfo{};
-    samplerInfo.sampler = textureSampler;
+    VkDescriptorBufferInfo virtualInfoInfo{};
+    virtualInfoInfo.buffer = virtualTextures.infoBuffer;
+    virtualInfoInfo.offset = 0;
+    virtualInfoInfo.range = VK_WHOLE_SIZE;
 
     //=========================================================================
     // Запись ресурсов
 
-    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+    std::vector<VkWriteDescriptorSet> descriptorWrites(4);
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
@@ -374,8 +1365,8 @@ void Geometry::updateDescriptorSets() {
     descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[1].dstBinding = 1;
     descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorCount = static_cast<uint32_t>(textureImageViews.size());
-    descriptorWrites[1].pImageInfo = imageInfo.data();
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo = &virtualCacheInfo;
     descriptorWrites[1].dstSet = descriptor.sets[i];
     descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
 
@@ -383,11 +1374,31 @@ void Geometry::updateDescriptorSets() {
     descriptorWrites[2].dstBinding = 2;
     descriptorWrites[2].dstArrayElement = 0;
     descriptorWrites[2].descriptorCount = 1;
-    descriptorWrites[2].pImageInfo = &samplerInfo;
+    descriptorWrites[2].pImageInfo = &virtualSamplerInfo;
     descriptorWrites[2].dstSet = descriptor.sets[i];
     descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
 
+    descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[3].dstBinding = 4;
+    descriptorWrites[3].dstArrayElement = 0;
+    descriptorWrites[3].descriptorCount = 1;
+    descriptorWrites[3].pBufferInfo = &virtualInfoInfo;
+    descriptorWrites[3].dstSet = descriptor.sets[i];
+    descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    // Массив таблиц страниц - всегда полный, свободные элементы указывают на пустую таблицу
+    VkWriteDescriptorSet pageTablesWrite{};
+    pageTablesWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    pageTablesWrite.dstBinding = 3;
+    pageTablesWrite.dstArrayElement = 0;
+    pageTablesWrite.descriptorCount = static_cast<uint32_t>(pageTablesInfo.size());
+    pageTablesWrite.pImageInfo = pageTablesInfo.data();
+    pageTablesWrite.dstSet = descriptor.sets[i];
+    pageTablesWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    descriptorWrites.push_back(pageTablesWrite);
+
     vkUpdateDescriptorSets(core->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    writeInstanceDescriptor(i);
   }
 }
 
@@ -5,11 +5,20 @@
 
 // Внутренние библиотеки
 #include "graphics.h"
+#include "passes/compute/visibility.h"
+#include "drawlist.h"
 #include "scene.h"
 
 // Стандартные библиотеки
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 class Geometry : public GraphicsPass {
  public:
@@ -24,37 +33,77 @@ class Geometry : public GraphicsPass {
   void update(uint32_t index);
   void record(uint32_t index, VkCommandBuffer);
 
+  // Динамическое разрешение: сцена рисуется в левый верхний угол цели вывода
+  float renderScale = 1.0f;
+  VkExtent2D getRenderExtent();
+  void recordLate(uint32_t index, VkCommandBuffer);  // Дорисовка после проверки по Hi-Z (DRAW_GPU)
+
   //=========================================================================
   // Обработчики конвейера и прохода рендера
 
  private:
   void createRenderPass() override;
 
+  void createPipeline() override;
+
+  // Основной проход очищает изображения, проход дорисовки загружает их.
+  // Раскладка UNDEFINED - изображение очищается, иначе загружается из неё
+  VkRenderPass occludedPass;
+  VkRenderPass buildRenderPass(VkImageLayout colorLayout, VkImageLayout depthLayout);
+
+  // Каждый проход рендера геометрии записывается со своим конвейером и фреймбуфером
+  void recordPass(uint32_t index, VkCommandBuffer, VkRenderPass, const std::function<void(VkCommandBuffer)>& next = nullptr);
+  void beginRenderPass(uint32_t index, VkCommandBuffer, VkRenderPass, VkSubpassContents = VK_SUBPASS_CONTENTS_INLINE);
+  void bindState(uint32_t index, VkCommandBuffer, VkRenderPass);    // Конвейер, область вывода, дескрипторы
+  void bindBuffers(uint32_t index, VkCommandBuffer);  // Вершины, индексы, поток экземпляров
+  void drawBatches(VkCommandBuffer, uint32_t first, uint32_t count);
+  void drawList(uint32_t index, VkCommandBuffer, Visibility::List);
+  VkPipeline getPipeline(VkRenderPass);
+  VkFramebuffer getFramebuffer(uint32_t index, VkRenderPass);
+
   VkVertexInputBindingDescription getVertexBinding() override;
+  std::vector<VkVertexInputBindingDescription> getVertexBindings() override;
   std::vector<VkVertexInputAttributeDescription> getVertexAttributes() override;
   VkPushConstantRange getPushConstantRange() override;
+  uint32_t getColorAttachmentCount() override { return 2; }  // Цвет и векторы движения
 
   //=========================================================================
   // Выделенные ресурсы, привязанные к конвейеру
 
  public:
-  // ~ ConstantBuffer
+  // ~ StructuredBuffer - данные экземпляров, выбираемые по индексу из потока экземпляров
   struct instance_t {
     glm::float4x4 objectModel;
+    glm::float4x4 objectPreviousModel;  // Прошлого кадра - векторы движения
     uint32_t objectTexture;
-  } instance;
+    uint32_t objectSampler;
+    uint32_t objectVirtualTexture;
+    uint32_t padding;
+  };
 
   // ~ cbuffer
   struct uniform_t {
     glm::float4x4 cameraView;
-    glm::float4x4 cameraProjection;
+    glm::float4x4 cameraProjection;        // С дрожанием TAA
+    glm::float4x4 viewProjection;          // Без дрожания - векторы движения
+    glm::float4x4 previousViewProjection;  // То же для прошлого кадра
+    uint32_t fragmentCost = 0;  // Дополнительные итерации фрагментного шейдера - для замеров
+    uint32_t padding[3];
   } uniform;
 
-  // ~ Texture2D
-  std::vector<VkImageView> textureImageViews;
+  // ~ SamplerState[], Texture2D[] - общая таблица текстур (отдельное множество)
+  struct {
+    VkDescriptorSetLayout layout;
+    VkDescriptorSet set;
+  } textureTable;
 
-  // ~ SamplerState
-  VkSampler textureSampler;
+  // Виртуальные текстуры
+  struct {
+    VkImageView cacheView;                // ~ Texture2D
+    VkSampler cacheSampler;               // ~ SamplerState
+    std::vector<VkImageView> tableViews;  // ~ Texture2D<uint4>[VirtualTextures::maxTextures]
+    VkBuffer infoBuffer;                  // ~ StructuredBuffer
+  } virtualTextures;
 
  private:
   std::vector<VkBuffer> uniformBuffers;
@@ -68,21 +117,230 @@ class Geometry : public GraphicsPass {
   void createDescriptorSets() override;
   void updateDescriptorSets() override;
 
+  //=========================================================================
+  // Автоматическое инстансирование - видимые формы группируются по форме модели
+  // (геометрия и материал), каждая группа рисуется одним вызовом.
+  // Косвенный режим отправляет все группы одним vkCmdDrawIndexedIndirect.
+  // В режиме GPU список команд строит проход видимости, а данные экземпляров
+  // хранятся по формам сцены и обновляются только для изменённых
+
+ public:
+  enum DrawMode {
+    DRAW_INSTANCED,  // vkCmdDrawIndexed на группу
+    DRAW_INDIRECT,   // Один vkCmdDrawIndexedIndirect на проход
+    DRAW_GPU,        // vkCmdDrawIndexedIndirectCount по результатам отсечения на GPU
+  };
+  DrawMode drawMode = DRAW_INDIRECT;
+
+  // Источник команд для режима DRAW_GPU
+  Visibility::Pass visibility = nullptr;
+
+  // Те же вызовы для проходов с раскладкой вершин геометрии (обратная связь виртуальных текстур).
+  // В режиме DRAW_GPU рисуются списки прошлого использования буферов изображения -
+  // проход видимости этого кадра ещё не выполнен
+  void recordDraws(uint32_t index, VkCommandBuffer);
+  VkBuffer getInstanceBuffer(uint32_t index);  // ~ StructuredBuffer<instance_t>
+
+  uint32_t getDrawCount();
+  uint32_t getInstanceCount();
+
+  // Порядок вызовов по ключам сортировки (режимы с отсечением на CPU):
+  // одинаковые материал и геометрия подряд, экземпляры от ближних к дальним
+  bool sortDraws = true;
+  uint32_t getStateChanges();  // Смены материала и геометрии между вызовами
+
+  // Время записи команд для count форм (мс)
+  static constexpr std::array<uint32_t, 4> benchmarkThreads = {1, 2, 4, 8};
+  struct benchmark_t {
+    uint32_t count;
+    double directTime;         // Отдельный вызов на форму
+    double indirectBuildTime;  // Заполнение массива команд
+    double indirectTime;       // Запись одного косвенного вызова
+    std::array<double, 4> threadTimes;  // Отдельные вызовы, записанные benchmarkThreads потоками
+  };
+  benchmark_t benchmark(uint32_t count);
+
+ private:
+  struct batch_t {
+    Models::model_t::shape_t* shape;
+    uint32_t first;  // Смещение в буфере экземпляров
+    uint32_t count;
+  };
+  std::vector<batch_t> batches;
+  std::unordered_map<Models::model_t::shape_t*, uint32_t> batchIndices;
+  std::vector<instance_t> instances;
+  std::vector<VkDrawIndexedIndirectCommand> commands;
+  uint32_t stateChanges = 0;
+
+  void groupInstances();  // Группы в порядке первой встречи формы
+  void sortInstances();   // Группы в порядке ключей сортировки
+  uint32_t countStateChanges();
+  static void writeInstance(instance_t&, const glm::float4x4& model, const glm::float4x4& previous, Models::model_t::shape_t*);
+
+  struct draw_item_t {
+    const glm::float4x4* model;
+    const glm::float4x4* previous;
+    Models::model_t::shape_t* shape;
+  };
+  DrawList drawKeys;
+  std::vector<draw_item_t> drawItems;
+
+  // Плотные номера материала и геометрии формы для полей ключа - по версии набора моделей
+  std::unordered_map<Models::model_t::shape_t*, std::pair<uint32_t, uint32_t>> shapeStates;
+  std::unordered_map<uint64_t, uint32_t> materialIDs;
+  std::unordered_map<uint64_t, uint32_t> geometryIDs;
+  uint32_t shapeStatesVersion = 0;
+  void clearShapeStates();
+
+  // Буферы экземпляров для каждого изображения цепочки показа
+  typedef struct {
+    uint32_t capacity;
+    bool entries;                   // Экземпляры расположены по формам сцены (режим DRAW_GPU)
+    uint32_t version;               // Версия набора форм при последней полной записи
+    std::vector<uint32_t> pending;  // Формы, изменённые после прошлого использования
+    VkBuffer instances;  // ~ StructuredBuffer<instance_t>
+    VkDeviceMemory instancesMemory;
+    VkBuffer indices;    // Поток индексов экземпляров (0, 1, 2, ...)
+    VkDeviceMemory indicesMemory;
+    VkBuffer commands;   // VkDrawIndexedIndirectCommand на группу
+    VkDeviceMemory commandsMemory;
+  } instance_data_t;
+  std::vector<instance_data_t> instanceData;
+  uint32_t instanceCapacity = 1024;
+
+  // Формы, изменённые прошлым обновлением: их прошлая матрица ещё отличается от текущей,
+  // экземпляры перезаписываются ещё раз - иначе остановившаяся форма сохранит движение
+  std::vector<uint32_t> moved;
+
+  void createInstanceData(uint32_t index, uint32_t capacity);
+  void destroyInstanceData(uint32_t index);
+  void createInstanceBuffers();
+  void destroyInstanceBuffers();
+  void updateInstanceBuffers(uint32_t index);
+  void updateEntryInstances(uint32_t index);
+  void writeInstanceDescriptor(uint32_t index);
+
+  //=========================================================================
+  // Параллельная запись: список вызовов режимов с отсечением на CPU (группы или их косвенные
+  // команды) делится на равные части, каждую записывает свой поток во вторичный буфер
+  // из своего пула кадра, первичный буфер выполняет их через vkCmdExecuteCommands.
+  // Потоки записи постоянные - запускаются при создании прохода и ждут частей каждого кадра
+
+ public:
+  static constexpr uint32_t maxRecordThreads = 8;
+  uint32_t recordThreads = 1;  // 1 - запись прямо в первичный буфер
+  double getRecordTime();      // Время записи основного прохода на CPU (мс)
+
+ private:
+  struct secondary_t {
+    VkCommandPool pool;  // Сбрасывается целиком перед записью
+    VkCommandBuffer cmd;
+  };
+  std::vector<std::array<secondary_t, 2 * maxRecordThreads>> secondary;  // [кадр][поток], вторая половина - проход глубины
+  double recordTime = 0.0;
+
+  void createSecondaryBuffers();
+  void destroySecondaryBuffers();
+  void recordParallel(uint32_t index, VkCommandBuffer, VkRenderPass, uint32_t threads);
+
+  typedef std::function<void(uint32_t part)> Part;
+  struct {
+    std::vector<std::thread> threads;  // Части 1..maxRecordThreads-1, нулевую пишет вызывающий поток
+    std::mutex mutex;
+    std::condition_variable wake;      // Новая запись
+    std::condition_variable done;      // Все части записи готовы
+    Part part;
+    uint32_t parts = 0;
+    uint64_t generation = 0;  // Номер записи - каждый поток берёт её один раз
+    uint32_t remaining = 0;   // Части потоков, ещё не записанные
+    bool stop = false;
+  } workers;
+
+  void startWorkers();
+  void stopWorkers();
+  void runWorker(uint32_t part);
+  void runParts(uint32_t parts, const Part&);  // Возврат после записи всех частей
+
+  //=========================================================================
+  // Предварительный проход глубины: формы сначала рисуются только в глубину -
+  // тот же вершинный шейдер, без фрагментного. Цветовой проход с тестом EQUAL
+  // без записи глубины затем вызывает фрагментный шейдер раз на видимый пиксель
+
+ public:
+  bool depthPrepass = false;
+
+  // Время сцены и перерисовка без прохода глубины и с ним при стоимости фрагментного шейдера cost
+  static constexpr std::array<uint32_t, 4> prepassCosts = {0, 16, 64, 256};
+  struct prepass_benchmark_t {
+    uint32_t cost;
+    std::array<double, 2> sceneTime;  // [0] - без прохода глубины, [1] - с ним (мс), 0 - не измерено
+    std::array<double, 2> overdraw;   // Вызовы фрагментного шейдера на пиксель, 0 - не измерено
+  };
+
+ private:
+  struct {
+    VkRenderPass pass;       // Только глубина - очищается и сохраняется
+    VkRenderPass colorPass;  // Цвет очищается, глубина загружается после прохода глубины
+    VkPipeline depth;        // Только вершинный шейдер
+    VkPipeline equal;        // Тест EQUAL без записи глубины
+    std::vector<VkFramebuffer> framebuffers;
+  } prepass;
+
+  VkRenderPass buildDepthPass();
+  void destroyPrepass();
+
+  //=========================================================================
+  // Слитый проход для тайловых GPU: сцена и попиксельный постпроцессинг - подпроходы
+  // одного прохода рендера. Второй подпроход читает цвет как input attachment того же пикселя -
+  // цвет, глубина и векторы движения не покидают память тайла (сохранение DONT_CARE).
+  // Только для одного прохода сцены: без прохода глубины, дорисовки и доли разрешения
+
+ public:
+  typedef std::function<void(VkCommandBuffer)> Subpass;
+
+  // image - изображение показа, post - запись второго подпрохода
+  void recordMerged(uint32_t index, uint32_t image, VkCommandBuffer, const Subpass& post);
+  VkRenderPass getMergedPass();  // Для конвейера второго подпрохода
+
+  // Изображения показа - цель второго подпрохода
+  struct {
+    VkFormat format;
+    std::vector<VkImageView> views;
+  } present;
+
+ private:
+  struct {
+    VkRenderPass pass;
+    VkPipeline pipeline;  // Конвейер сцены в первом подпроходе
+    std::vector<VkFramebuffer> framebuffers;  // [изображение показа][кадр в работе]
+    uint32_t image;       // Изображение показа записываемого кадра
+  } merged;
+
+  VkRenderPass buildMergedPass();
+  void destroyMerged();
+
   //=========================================================================
   // Фреймбуфер - целевой объект графического рендера
 
  private:
   void createFramebuffers() override;
 
-  // Изображение для теста глубины
+ public:
+  // Изображение для теста глубины - цель графа рендера.
+  // Сохраняется после прохода - источник пирамиды глубины
   struct {
-    VkImage image;
-    VkImageView view;
     VkFormat format;
-    VkDeviceMemory memory;
+    std::vector<VkImageView> views;
   } depth;
-  void createDepthImage();
-  void destroyDepthImage();
+
+  // Векторы движения - смещение пикселя с прошлого кадра в долях сцены, цель графа рендера
+  struct {
+    VkFormat format;
+    std::vector<VkImageView> views;
+  } velocity;
+
+  // Значение очистки векторов движения - фон вне всех форм, его смещение считает TAA
+  static constexpr float backgroundVelocity = 1024.0f;
 
   //=========================================================================
 };
@@ -33,8 +33,8 @@ void GraphicsPass::createShaderModules() {
 
   try {
     // Попытка (пере)компиляции новых шейдеров в SPIR-V
-    Shaders::Instance instanceVertex = shader.manager->loadShader(shader.name, std::string("vertexMain"), SLANG_STAGE_VERTEX);
-    Shaders::Instance instanceFragment = shader.manager->loadShader(shader.name, std::string("fragmentMain"), SLANG_STAGE_FRAGMENT);
+    Shaders::Instance instanceVertex = shader.manager->loadShader(shader.name, std::string("vertexMain"), SLANG_STAGE_VERTEX, shader.defines);
+    Shaders::Instance instanceFragment = shader.manager->loadShader(shader.name, std::string("fragmentMain"), SLANG_STAGE_FRAGMENT, shader.defines);
 
     // Подключение модулей
     vertexShader = instanceVertex->module;
@@ -63,10 +63,10 @@ void GraphicsPass::createShaderModules() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VkFramebuffer GraphicsPass::createFramebuffer(std::vector<VkImageView>& attachment, uint32_t width, uint32_t height) {
+VkFramebuffer GraphicsPass::createFramebuffer(std::vector<VkImageView>& attachment, uint32_t width, uint32_t height, VkRenderPass pass) {
   VkFramebufferCreateInfo framebufferInfo{};
   framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-  framebufferInfo.renderPass = pipeline.pass;
+  framebufferInfo.renderPass = pass != VK_NULL_HANDLE ? pass : pipeline.pass;
 
   // Изображения, в которые будет идти результат
   framebufferInfo.attachmentCount = static_cast<uint32_t>(attachment.size());
@@ -85,11 +85,31 @@ VkFramebuffer GraphicsPass::createFramebuffer(std::vector<VkImageView>& attachme
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void GraphicsPass::createPipeline() {
+  createPipelineLayout();
+  pipeline.instance = buildPipeline({});
+}
+
+void GraphicsPass::createPipelineLayout() {
+  // Раскладка конвейера - общая для всех его вариантов
+  auto pushConstantRange = getPushConstantRange();
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.pushConstantRangeCount = pushConstantRange.size > 0 ? 1 : 0;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptor.layouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptor.layouts.data();
+
+  if (vkCreatePipelineLayout(core->device, &pipelineLayoutInfo, nullptr, &pipeline.layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create pipeline layout!");
+}
+
+VkPipeline GraphicsPass::buildPipeline(const variant_t& variant) {
   // Вершинный шейдер - обрабатывает одну вершину за раз
   VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
   vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  vertShaderStageInfo.module = vertexShader;
+  vertShaderStageInfo.module = variant.vertexShader != VK_NULL_HANDLE ? variant.vertexShader : vertexShader;
   vertShaderStageInfo.pName = "main";
 
   // Фрагментный шейдер - получает растеризованый примитив и выдаёт его цвет
@@ -99,21 +119,21 @@ void GraphicsPass::createPipeline() {
   fragShaderStageInfo.module = fragmentShader;
   fragShaderStageInfo.pName = "main";
 
-  std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {
-      vertShaderStageInfo,
-      fragShaderStageInfo,
-  };
+  // Без фрагментного шейдера конвейер пишет только глубину
+  std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {vertShaderStageInfo};
+  if (variant.fragment)
+    shaderStages.push_back(fragShaderStageInfo);
 
   //=================================================================================
   // Размещение геометрических данных в памяти
 
-  auto vertexBindingDescription = getVertexBinding();
-  auto vertexAttributesDescription = getVertexAttributes();
+  auto vertexBindingsDescription = variant.bindings.empty() ? getVertexBindings() : variant.bindings;
+  auto vertexAttributesDescription = variant.attributes.empty() ? getVertexAttributes() : variant.attributes;
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.vertexBindingDescriptionCount = 1;
-  vertexInputInfo.pVertexBindingDescriptions = &vertexBindingDescription;
+  vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindingsDescription.size());
+  vertexInputInfo.pVertexBindingDescriptions = vertexBindingsDescription.data();
   vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributesDescription.size());
   vertexInputInfo.pVertexAttributeDescriptions = vertexAttributesDescription.data();
 
@@ -199,9 +219,9 @@ void GraphicsPass::createPipeline() {
 
   // Тест глубины
   depthStencil.depthTestEnable = VK_TRUE;
-  depthStencil.depthWriteEnable = VK_TRUE;
+  depthStencil.depthWriteEnable = variant.depthWrite ? VK_TRUE : VK_FALSE;
   depthStencil.depthBoundsTestEnable = VK_FALSE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencil.depthCompareOp = variant.depthCompare;
 
   // Тест трафарета
   depthStencil.stencilTestEnable = VK_FALSE;
@@ -213,6 +233,7 @@ void GraphicsPass::createPipeline() {
   VkPipelineColorBlendAttachmentState colorBlendAttachment{};
   colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
   colorBlendAttachment.blendEnable = VK_FALSE;
+  std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(variant.fragment ? getColorAttachmentCount() : 0, colorBlendAttachment);
 
   VkPipelineColorBlendStateCreateInfo colorBlending{};
   colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -220,8 +241,8 @@ void GraphicsPass::createPipeline() {
   // Операции между фрагментным шейдером и цветовым подключением
   colorBlending.logicOpEnable = VK_FALSE;
   colorBlending.logicOp = VK_LOGIC_OP_COPY;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &colorBlendAttachment;
+  colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+  colorBlending.pAttachments = colorBlendAttachments.data();
   colorBlending.blendConstants[0] = 0.0f;
   colorBlending.blendConstants[1] = 0.0f;
   colorBlending.blendConstants[2] = 0.0f;
@@ -239,21 +260,6 @@ void GraphicsPass::createPipeline() {
   dynamicState.dynamicStateCount = states.size();
   dynamicState.pDynamicStates = states.data();
 
-  //=================================================================================
-  // Раскладка конвейера
-
-  auto pushConstantRange = getPushConstantRange();
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptor.layouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptor.layouts.data();
-
-  if (vkCreatePipelineLayout(core->device, &pipelineLayoutInfo, nullptr, &pipeline.layout) != VK_SUCCESS)
-    throw std::runtime_error("ERROR: Failed to create pipeline layout!");
-
   //=================================================================================
   // Создание конвейера
 
@@ -270,10 +276,12 @@ void GraphicsPass::createPipeline() {
   pipelineInfo.pColorBlendState = &colorBlending;
   pipelineInfo.pDynamicState = &dynamicState;
   pipelineInfo.layout = pipeline.layout;
-  pipelineInfo.renderPass = pipeline.pass;
-  pipelineInfo.subpass = 0;
+  pipelineInfo.renderPass = variant.pass != VK_NULL_HANDLE ? variant.pass : pipeline.pass;
+  pipelineInfo.subpass = variant.subpass;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-  if (vkCreateGraphicsPipelines(core->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.instance) != VK_SUCCESS)
+  VkPipeline instance;
+  if (vkCreateGraphicsPipelines(core->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &instance) != VK_SUCCESS)
     throw std::runtime_error("ERROR: Failed to create graphics pipeline!");
+  return instance;
 }
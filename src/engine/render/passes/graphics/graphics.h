@@ -19,11 +19,27 @@ class GraphicsPass : public Pass {
 
  protected:
   virtual void createPipeline();
+  void createPipelineLayout();
+
+  // Вариант конвейера на общей раскладке: пустые поля - как у основного
+  struct variant_t {
+    VkRenderPass pass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    bool fragment = true;  // false - без фрагментного шейдера и цветовых подключений
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    bool depthWrite = true;
+    VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+  };
+  VkPipeline buildPipeline(const variant_t&);
 
   // Опции графического конвейера
   virtual VkVertexInputBindingDescription getVertexBinding() = 0;
+  virtual std::vector<VkVertexInputBindingDescription> getVertexBindings() { return {getVertexBinding()}; }
   virtual std::vector<VkVertexInputAttributeDescription> getVertexAttributes() = 0;
   virtual VkPushConstantRange getPushConstantRange() = 0;
+  virtual uint32_t getColorAttachmentCount() { return 1; }  // Выходы фрагментного шейдера
 
   //=========================================================================
   // Шейдеры - ядро любого прохода
@@ -47,7 +63,7 @@ class GraphicsPass : public Pass {
   std::vector<VkFramebuffer> framebuffers;
 
   virtual void createFramebuffers() = 0;
-  VkFramebuffer createFramebuffer(std::vector<VkImageView>&, uint32_t width, uint32_t height);
+  VkFramebuffer createFramebuffer(std::vector<VkImageView>&, uint32_t width, uint32_t height, VkRenderPass = VK_NULL_HANDLE);
 
   //=========================================================================
 };
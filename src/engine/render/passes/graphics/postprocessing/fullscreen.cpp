@@ -19,21 +19,32 @@ void Fullscreen::destroy() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Fullscreen::record(uint32_t index, VkCommandBuffer cmd) {
+void Fullscreen::record(uint32_t frame, uint32_t image, VkCommandBuffer cmd) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = pipeline.pass;
-  renderPassInfo.framebuffer = framebuffers[index];
+  renderPassInfo.framebuffer = framebuffers[getFramebufferIndex(frame, image)];
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = {target.width, target.height};
 
   // Заливка цвета вне всех примитивов
-  std::array<VkClearValue, 2> clearValues{};
-  clearValues[0].color = {0.51f, 0.0f, 0.51f, 1.0f};
-  clearValues[1].depthStencil = {1.0f, 0};
+  std::vector<VkClearValue> clearValues(getColorAttachmentCount());
+  for (auto& clearValue : clearValues)
+    clearValue.color = {0.51f, 0.0f, 0.51f, 1.0f};
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
+  vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  recordDraw(frame, descriptor.sets[image], cmd);
+  vkCmdEndRenderPass(cmd);
+}
+
+void Fullscreen::recordSubpass(uint32_t frame, VkCommandBuffer cmd) {
+  // Вход - цвет кадра, множество ресурсов - на каждую его копию
+  recordDraw(frame, descriptor.sets[frame], cmd);
+}
+
+void Fullscreen::recordDraw(uint32_t frame, VkDescriptorSet set, VkCommandBuffer cmd) {
   VkViewport viewport{};
   viewport.x = 0;
   viewport.y = static_cast<float>(target.height);
@@ -42,23 +53,20 @@ void Fullscreen::record(uint32_t index, VkCommandBuffer cmd) {
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
-  vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
   // Подключение конвейера и настройка его динамических частей
   vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.instance);
   vkCmdSetViewport(cmd, 0, 1, &viewport);
 
   // Подключение множества ресурсов, используемых в конвейере
-  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &descriptor.sets[index], 0, nullptr);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &set, 0, nullptr);
 
   // Объявление констант шейдера
-  instance.colorImageIndex = index;
+  instance.colorImageIndex = frame;
+  instance.colorImageCount = static_cast<uint32_t>(colorImageViews.size());
   vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(instance_t), &instance);
 
   // Операция рендера
   vkCmdDraw(cmd, 3, 1, 0, 0);
-
-  vkCmdEndRenderPass(cmd);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -95,16 +103,37 @@ VkPushConstantRange Fullscreen::getPushConstantRange() {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Fullscreen::createFramebuffers() {
-  framebuffers.resize(target.views.size());
+  // Фреймбуферы подпрохода - у владельца прохода рендера
+  if (subpass.pass != VK_NULL_HANDLE)
+    return;
+
+  // С дополнительными целями - фреймбуфер на каждую пару изображения вывода и кадра в работе
+  uint32_t frames = outputs.empty() ? 1 : static_cast<uint32_t>(outputs[0].views.size());
+  framebuffers.resize(target.views.size() * frames);
   for (uint32_t i = 0; i < target.views.size(); ++i) {
-    std::vector<VkImageView> attachment = {target.views[i]};
-    framebuffers[i] = createFramebuffer(attachment, target.width, target.height);
+    for (uint32_t frame = 0; frame < frames; ++frame) {
+      std::vector<VkImageView> attachment = {target.views[i]};
+      for (auto& output : outputs)
+        attachment.push_back(output.views[frame]);
+      framebuffers[i * frames + frame] = createFramebuffer(attachment, target.width, target.height);
+    }
   }
 }
 
+uint32_t Fullscreen::getFramebufferIndex(uint32_t frame, uint32_t image) {
+  if (outputs.empty())
+    return image;
+  return image * static_cast<uint32_t>(outputs[0].views.size()) + frame;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Fullscreen::createRenderPass() {
+  if (subpass.pass != VK_NULL_HANDLE) {
+    pipeline.pass = VK_NULL_HANDLE;
+    return;
+  }
+
   //=================================================================================
   // Описание цветового подключения - выходного изображения конвейера
 
@@ -126,10 +155,21 @@ void Fullscreen::createRenderPass() {
   // Мультисэмплинг
   colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;  // Число образцов (1 = выкл)
 
-  // Элемент подпрохода
-  VkAttachmentReference colorAttachmentRef{};
-  colorAttachmentRef.attachment = 0;
-  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  // Дополнительные цели перезаписываются целиком - прошлое содержимое не нужно
+  std::vector<VkAttachmentDescription> attachments = {colorAttachment};
+  for (auto& output : outputs) {
+    VkAttachmentDescription outputAttachment = colorAttachment;
+    outputAttachment.format = output.format;
+    outputAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments.push_back(outputAttachment);
+  }
+
+  // Элементы подпрохода
+  std::vector<VkAttachmentReference> colorAttachmentRefs(attachments.size());
+  for (uint32_t i = 0; i < attachments.size(); ++i) {
+    colorAttachmentRefs[i].attachment = i;
+    colorAttachmentRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  }
 
   //=================================================================================
   // Подпроходы рендера
@@ -138,8 +178,8 @@ void Fullscreen::createRenderPass() {
   subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
   // Цветовые подключения
-  subpass.colorAttachmentCount = 1;
-  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+  subpass.pColorAttachments = colorAttachmentRefs.data();
 
   //=================================================================================
   // Зависимости подпроходов рендера
@@ -155,7 +195,6 @@ void Fullscreen::createRenderPass() {
   //=================================================================================
   // Создание прохода рендера
 
-  std::array<VkAttachmentDescription, 1> attachments = {colorAttachment};
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
@@ -169,9 +208,44 @@ void Fullscreen::createRenderPass() {
     throw std::runtime_error("ERROR: Failed to create render pass!");
 }
 
+void Fullscreen::createPipeline() {
+  if (subpass.pass == VK_NULL_HANDLE) {
+    GraphicsPass::createPipeline();
+    return;
+  }
+
+  // Конвейер совместим с проходом владельца и при его пересоздании
+  createPipelineLayout();
+  variant_t variant;
+  variant.pass = subpass.pass;
+  variant.subpass = subpass.index;
+  pipeline.instance = buildPipeline(variant);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Fullscreen::createDescriptorLayouts() {
+  // Подпроход читает единственный вход - цвет своего пикселя
+  if (subpass.pass != VK_NULL_HANDLE) {
+    VkDescriptorSetLayoutBinding inputLayout{};
+    inputLayout.binding = 0;
+    inputLayout.descriptorCount = 1;
+    inputLayout.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    inputLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &inputLayout;
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(core->device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+      throw std::runtime_error("ERROR: Failed to create descriptor set layout!");
+
+    descriptor.layouts.push_back(layout);
+    return;
+  }
+
   VkDescriptorSetLayoutBinding textureImageLayout{};
   textureImageLayout.binding = 0;
   textureImageLayout.descriptorCount = static_cast<uint32_t>(colorImageViews.size());
@@ -186,11 +260,18 @@ void Fullscreen::createDescriptorLayouts() {
   textureSamplerLayout.pImmutableSamplers = nullptr;
   textureSamplerLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {
+  std::vector<VkDescriptorSetLayoutBinding> bindings = {
       textureImageLayout,
       textureSamplerLayout,
   };
 
+  for (uint32_t input = 0; input < inputImageViews.size(); ++input) {
+    VkDescriptorSetLayoutBinding inputLayout = textureImageLayout;
+    inputLayout.binding = 2 + input;
+    inputLayout.descriptorCount = static_cast<uint32_t>(inputImageViews[input].size());
+    bindings.push_back(inputLayout);
+  }
+
   VkDescriptorSetLayoutCreateInfo layoutInfo{};
   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
   layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -206,14 +287,33 @@ void Fullscreen::createDescriptorLayouts() {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Fullscreen::createDescriptorSets() {
-  descriptor.sets.resize(target.views.size());
-  for (size_t i = 0; i < target.views.size(); ++i)
+  // Подпроходу - множество на каждую копию цвета, иначе - на каждую цель вывода
+  size_t count = subpass.pass != VK_NULL_HANDLE ? colorImageViews.size() : target.views.size();
+  descriptor.sets.resize(count);
+  for (size_t i = 0; i < count; ++i)
     descriptor.sets[i] = core->resources->createDesciptorSet(descriptor.layouts[0]);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Fullscreen::updateDescriptorSets() {
+  if (subpass.pass != VK_NULL_HANDLE) {
+    for (size_t i = 0; i < colorImageViews.size(); ++i) {
+      VkDescriptorImageInfo inputInfo{VK_NULL_HANDLE, colorImageViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+      VkWriteDescriptorSet descriptorWrite{};
+      descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      descriptorWrite.dstSet = descriptor.sets[i];
+      descriptorWrite.dstBinding = 0;
+      descriptorWrite.dstArrayElement = 0;
+      descriptorWrite.descriptorCount = 1;
+      descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+      descriptorWrite.pImageInfo = &inputInfo;
+      vkUpdateDescriptorSets(core->device, 1, &descriptorWrite, 0, nullptr);
+    }
+    return;
+  }
+
   for (size_t i = 0; i < target.views.size(); ++i) {
     //=========================================================================
     // Инициализация ресурсов
@@ -227,10 +327,16 @@ void Fullscreen::updateDescriptorSets() {
     VkDescriptorImageInfo samplerInfo{};
     samplerInfo.sampler = colorImageSampler;
 
+    std::vector<std::vector<VkDescriptorImageInfo>> inputInfos(inputImageViews.size());
+    for (uint32_t input = 0; input < inputImageViews.size(); ++input) {
+      for (auto view : inputImageViews[input])
+        inputInfos[input].push_back({VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+    }
+
     //=========================================================================
     // Запись ресурсов
 
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    std::vector<VkWriteDescriptorSet> descriptorWrites(2 + inputImageViews.size());
 
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[0].dstBinding = 0;
@@ -248,6 +354,14 @@ void Fullscreen::updateDescriptorSets() {
     descriptorWrites[1].dstSet = descriptor.sets[i];
     descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
 
+    for (uint32_t input = 0; input < inputImageViews.size(); ++input) {
+      auto& write = descriptorWrites[2 + input];
+      write = descriptorWrites[0];
+      write.dstBinding = 2 + input;
+      write.descriptorCount = static_cast<uint32_t>(inputInfos[input].size());
+      write.pImageInfo = inputInfos[input].data();
+    }
+
     vkUpdateDescriptorSets(core->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
   }
 }
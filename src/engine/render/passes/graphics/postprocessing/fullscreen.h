@@ -1,5 +1,8 @@
 #pragma once
 
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+
 // Внутренние библиотеки
 #include "passes/graphics/graphics.h"
 
@@ -16,7 +19,16 @@ class Fullscreen : public GraphicsPass {
   void reload() override;
   void resize() override;
 
-  void record(uint32_t index, VkCommandBuffer);
+  // frame - копия входов, image - цель вывода (изображение цепочки показа или копия кадра)
+  void record(uint32_t frame, uint32_t image, VkCommandBuffer);
+
+  // Подпроход чужого прохода рендера: цвет - input attachment того же пикселя,
+  // проход рендера и фреймбуферы - владельца. pass = VK_NULL_HANDLE - свой проход рендера
+  struct {
+    VkRenderPass pass = VK_NULL_HANDLE;
+    uint32_t index = 0;
+  } subpass;
+  void recordSubpass(uint32_t frame, VkCommandBuffer);  // Внутри прохода владельца
 
   //=========================================================================
   // Обработчики конвейера и прохода рендера
@@ -27,6 +39,9 @@ class Fullscreen : public GraphicsPass {
   VkVertexInputBindingDescription getVertexBinding() override;
   std::vector<VkVertexInputAttributeDescription> getVertexAttributes() override;
   VkPushConstantRange getPushConstantRange() override;
+  uint32_t getColorAttachmentCount() override { return 1 + static_cast<uint32_t>(outputs.size()); }
+  void createPipeline() override;
+  void recordDraw(uint32_t frame, VkDescriptorSet, VkCommandBuffer);
 
   //=========================================================================
   // Выделенные ресурсы, привязанные к конвейеру
@@ -34,12 +49,23 @@ class Fullscreen : public GraphicsPass {
  public:
   // ~ ConstantBuffer
   struct instance_t {
+    glm::float4x4 reprojection = glm::float4x4(1.0f);  // Точка фона -> прошлый кадр (TAA)
     uint32_t colorImageIndex;
+    uint32_t colorImageCount;
+    glm::float2 colorScale = {1.0f, 1.0f};  // Доля копии цвета, занятая сценой (динамическое разрешение)
+    glm::float2 jitter = {0.0f, 0.0f};      // Дрожание проекции кадра в долях сцены (TAA)
+    float historyWeight = 0.0f;             // Вес истории, 0 - истории нет (TAA)
+    float exposure = 0.0f;                  // Экспозиция тонального отображения, 0 - без него
+    float saturation = 1.0f;                // Цветокоррекция, 1 - без изменений
+    float contrast = 1.0f;
   } instance;
 
   std::vector<VkImageView> colorImageViews;  // ~ Texture2D
   VkSampler colorImageSampler;               // ~ SamplerState
 
+  // Дополнительные входы - binding 2, 3, ... по порядку, по копии на кадр в работе
+  std::vector<std::vector<VkImageView>> inputImageViews;  // ~ Texture2D[]
+
  protected:
   void createDescriptorLayouts() override;
   void createDescriptorSets() override;
@@ -50,5 +76,16 @@ class Fullscreen : public GraphicsPass {
 
   void createFramebuffers() override;
 
+ public:
+  // Дополнительные цели вывода - SV_TARGET1, 2, ... по порядку, по копии на кадр в работе
+  struct output_t {
+    VkFormat format;
+    std::vector<VkImageView> views;
+  };
+  std::vector<output_t> outputs;
+
+ protected:
+  uint32_t getFramebufferIndex(uint32_t frame, uint32_t image);
+
   //=========================================================================
 };
@@ -94,6 +94,205 @@ void GUI::updateUI() {
     ImGui::Text("     TAA");
     ImGui::SameLine();
     ImGui::Checkbox("###taaON", &options.taaON);
+    if (options.taaON) {
+      ImGui::SameLine();
+      ImGui::Text("Compute");
+      ImGui::SameLine();
+      ImGui::Checkbox("###computePostON", &options.computePostON);
+    }
+    ImGui::Text(" Tonemap");
+    ImGui::SameLine();
+    ImGui::Checkbox("###tonemapON", &options.tonemapON);
+    if (options.tonemapON) {
+      ImGui::SameLine();
+      ImGui::SliderFloat("###exposure", &options.exposure, 0.1f, 4.0f, "%.2f");
+    }
+    ImGui::Text(" Grading");
+    ImGui::SameLine();
+    ImGui::Checkbox("###gradingON", &options.gradingON);
+    if (options.gradingON) {
+      ImGui::SameLine();
+      ImGui::SliderFloat("###saturation", &options.saturation, 0.0f, 2.0f, "Saturation %.2f");
+      ImGui::Text("        ");
+      ImGui::SameLine();
+      ImGui::SliderFloat("###contrast", &options.contrast, 0.5f, 1.5f, "Contrast %.2f");
+    }
+    ImGui::Text("  Dither");
+    ImGui::SameLine();
+    ImGui::Checkbox("###ditherON", &options.ditherON);
+    ImGui::SameLine();
+    ImGui::Text("Fused");
+    ImGui::SameLine();
+    ImGui::Checkbox("###fusedPostON", &options.fusedPostON);
+    ImGui::SameLine();
+    ImGui::Text("Merged");
+    ImGui::SameLine();
+    ImGui::Checkbox("###mergedPassON", &options.mergedPassON);
+    ImGui::Text(" Culling");
+    ImGui::SameLine();
+    ImGui::Checkbox("###cullingON", &options.cullingON);
+    ImGui::SameLine();
+    const char* cullingMethods[] = {"Linear", "BVH"};
+    ImGui::Combo("###culling_method", &options.cullingMethod, cullingMethods, IM_ARRAYSIZE(cullingMethods));
+
+    const char* drawModes[] = {"Instanced", "Indirect", "GPU"};
+    ImGui::Text("   Draw");
+    ImGui::SameLine();
+    ImGui::Combo("###draw_mode", &options.drawMode, drawModes, IM_ARRAYSIZE(drawModes));
+    if (options.drawMode == Geometry::DRAW_GPU) {
+      ImGui::Text("Distance");
+      ImGui::SameLine();
+      ImGui::SliderFloat("###culling_distance", &options.cullingDistance, 0.0f, 1000.0f, options.cullingDistance > 0.0f ? "%.0f" : "off");
+      ImGui::Text("   Hi-Z");
+      ImGui::SameLine();
+      ImGui::Checkbox("###occlusionON", &options.occlusionON);
+    } else {
+      ImGui::Text("    Sort");
+      ImGui::SameLine();
+      ImGui::Checkbox("###sortON", &options.sortON);
+      ImGui::Text(" Threads");
+      ImGui::SameLine();
+      ImGui::SliderInt("###record_threads", &options.recordThreads, 1, Geometry::maxRecordThreads);
+    }
+    ImGui::Text("Pre-pass");
+    ImGui::SameLine();
+    ImGui::Checkbox("###prepassON", &options.prepassON);
+    ImGui::Text("    Cost");
+    ImGui::SameLine();
+    ImGui::SliderInt("###fragment_cost", &options.fragmentCost, 0, 256);
+
+    const char* samplerQualities[] = {"Low", "Medium", "High", "Ultra"};
+    ImGui::Text(" Filter");
+    ImGui::SameLine();
+    ImGui::Combo("###sampler_quality", &options.samplerQuality, samplerQualities, IM_ARRAYSIZE(samplerQualities));
+
+    const char* framesCounts[] = {"1", "2", "3"};
+    int framesIndex = options.framesInFlight - 1;
+    ImGui::Text("  Frames");
+    ImGui::SameLine();
+    ImGui::Combo("###frames_in_flight", &framesIndex, framesCounts, IM_ARRAYSIZE(framesCounts));
+    options.framesInFlight = framesIndex + 1;
+
+    ImGui::Text(" Dynamic");
+    ImGui::SameLine();
+    ImGui::Checkbox("###dynamicResolutionON", &options.dynamicResolutionON);
+    if (options.dynamicResolutionON) {
+      ImGui::Text("  Target");
+      ImGui::SameLine();
+      ImGui::SliderFloat("###target_frame_time", &options.targetFrameTime, 1.0f, 33.3f, "%.1f ms");
+    }
+
+    ImGui::Separator();
+    //================================================
+
+    ImGui::Text("Statistics");
+    ImGui::Text("   Frame %.3f ms (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+    // Цена фильтрации - по меткам времени GPU вокруг сцены, не по частоте кадров
+    ImGui::Text("   Scene %.3f ms on GPU (%s filtering)", statistics.sceneTime, samplerQualities[options.samplerQuality]);
+
+    // Значения для разного числа кадров в работе видны после переключения
+    for (uint32_t i = 0; i < statistics.frameTimes.size(); ++i)
+      if (statistics.frameTimes[i] > 0.0)
+        ImGui::Text("  Flight %u: %.3f ms frame, %.3f ms latency", i + 1, statistics.frameTimes[i], statistics.latencies[i]);
+    auto textures = scene->getTextures();
+    ImGui::Text("Textures %.2f MB saved by content sharing",
+                static_cast<float>(textures->getSavedBytes()) / (1024.0f * 1024.0f));
+    ImGui::Text("Textures %.2f MB saved by channel-aware formats",
+                static_cast<float>(textures->getCompactBytes()) / (1024.0f * 1024.0f));
+    ImGui::Text(" Targets %.1f MB (%.1f MB without aliasing, %.1f MB lazy)",
+                statistics.targetsMemory, statistics.targetsSeparate, statistics.targetsLazy);
+    ImGui::Text("   Scene %ux%u (%.0f%%), GPU frame %.3f ms", statistics.renderWidth, statistics.renderHeight,
+                statistics.resolutionScale * 100.0f, statistics.gpuFrameTime);
+    if (statistics.merged) {
+      // Подпроход идёт в одном проходе со сценой - время включает её хвост и не сравнимо с отдельными проходами
+      ImGui::Text("    Post %.3f ms on GPU (subpass, not comparable, %u passes)", statistics.postTime, statistics.postPasses);
+    } else {
+      ImGui::Text("    Post %.3f ms on GPU (%s, %u passes)", statistics.postTime,
+                  options.taaON && options.computePostON ? "compute" : "fragment", statistics.postPasses);
+    }
+    auto culling = scene->getCulling();
+    if (options.drawMode == Geometry::DRAW_GPU) {
+      // Отсечение выполнено на GPU - счётчики прочитаны из его буферов
+      ImGui::Text("   Draws %u (%u commands, %u instances)", statistics.draws, statistics.commands, statistics.instances);
+      ImGui::Text(" Culling %u visible / %u culled on GPU", statistics.instances, culling->getEntryCount() - statistics.instances);
+      ImGui::Text("Occluded %u", statistics.occluded);
+      ImGui::Text("     GPU %.3f ms", statistics.sceneTime);
+
+      // Экономия видна после первых парных замеров соседних кадров
+      if (statistics.occlusionTime > 0.0 && statistics.plainTime > 0.0)
+        ImGui::Text("   Saved %.3f ms (%.3f vs %.3f ms, matched frames)", statistics.plainTime - statistics.occlusionTime, statistics.occlusionTime, statistics.plainTime);
+    } else {
+      ImGui::Text("   Draws %u (%u instances)", statistics.draws, statistics.instances);
+      ImGui::Text("  Record %.3f ms on CPU", statistics.recordTime);
+      auto cullingStats = culling->getStats();
+      ImGui::Text(" Culling %u visible / %u culled", cullingStats.visible, cullingStats.culled);
+
+      // Значения обоих порядков видны после переключения сортировки
+      const char* orders[] = {"unsorted", "sorted"};
+      for (uint32_t order = 0; order < 2; ++order) {
+        if (statistics.stateChanges[order] == UINT32_MAX)
+          continue;
+        if (statistics.overdraw[order] > 0.0)
+          ImGui::Text("   State %u changes, overdraw %.2fx (%s)", statistics.stateChanges[order], statistics.overdraw[order], orders[order]);
+        else
+          ImGui::Text("   State %u changes (%s)", statistics.stateChanges[order], orders[order]);
+      }
+      if (statistics.overdraw[2] > 0.0)
+        ImGui::Text("   Overdraw %.2fx with depth pre-pass", statistics.overdraw[2]);
+    }
+
+    if (ImGui::Button("Benchmark transforms")) {
+      transformsBenchmark = Transforms::benchmark(100000);
+      std::cout << "Transforms benchmark (" << transformsBenchmark.count << "): "
+                << transformsBenchmark.objectsTime << " ms per-object path, "
+                << transformsBenchmark.batchTime << " ms batched" << std::endl;
+    }
+    if (transformsBenchmark.count > 0) {
+      ImGui::SameLine();
+      ImGui::Text("%.2f ms -> %.2f ms", transformsBenchmark.objectsTime, transformsBenchmark.batchTime);
+    }
+
+    if (ImGui::Button("Benchmark draws"))
+      drawsBenchmarkRequested = true;
+    for (auto& result : drawsBenchmark) {
+      ImGui::Text("   %u shapes: %.3f ms direct, %.3f + %.3f ms indirect", result.count,
+                  result.directTime, result.indirectBuildTime, result.indirectTime);
+      ImGui::Text("   1/2/4/8 threads: %.3f / %.3f / %.3f / %.3f ms direct",
+                  result.threadTimes[0], result.threadTimes[1], result.threadTimes[2], result.threadTimes[3]);
+    }
+
+    if (ImGui::Button("Benchmark pre-pass"))
+      prepassBenchmarkRequested = true;
+    for (auto& result : prepassBenchmark) {
+      const char* winner = result.sceneTime[1] < result.sceneTime[0] ? "pre-pass" : "single pass";
+      ImGui::Text("   Cost %u: %.3f vs %.3f ms, overdraw %.2fx -> %.2fx (%s)", result.cost,
+                  result.sceneTime[0], result.sceneTime[1], result.overdraw[0], result.overdraw[1], winner);
+    }
+
+    if (ImGui::Button("Benchmark post-process"))
+      postBenchmarkRequested = true;
+    for (auto& result : postBenchmark) {
+      if (result.group.width == 0)
+        ImGui::Text("   Fragment %s: %.3f ms", result.fused ? "fused" : "separate", result.time);
+      else
+        ImGui::Text("   Compute %ux%u: %.3f ms", result.group.width, result.group.height, result.time);
+    }
+
+    if (ImGui::Button("Benchmark BVH")) {
+      bvhBenchmark = BVH::benchmark(100000);
+      std::cout << "BVH benchmark (" << bvhBenchmark.count << "): "
+                << bvhBenchmark.buildTime << " ms build, "
+                << bvhBenchmark.refitTime << " ms refit, "
+                << bvhBenchmark.cullTime << " ms culling (linear " << bvhBenchmark.linearCullTime << " ms), "
+                << bvhBenchmark.raysPerSecond << " rays/s, "
+                << bvhBenchmark.overlapsPerSecond << " overlaps/s" << std::endl;
+    }
+    if (bvhBenchmark.count > 0) {
+      ImGui::Text("   Build %.2f ms, refit %.2f ms", bvhBenchmark.buildTime, bvhBenchmark.refitTime);
+      ImGui::Text("   Culling %.3f ms (linear %.3f ms)", bvhBenchmark.cullTime, bvhBenchmark.linearCullTime);
+      ImGui::Text("   %.2f M rays/s, %.2f M overlaps/s", bvhBenchmark.raysPerSecond / 1e6, bvhBenchmark.overlapsPerSecond / 1e6);
+    }
 
     ImGui::Separator();
     //================================================
@@ -5,6 +5,8 @@
 #include "scene.h"
 
 #include "passes/graphics/graphics.h"
+#include "passes/graphics/geometry.h"
+#include "passes/compute/postprocessing/effect.h"
 
 // Сторонние библиотеки
 #include "imgui.h"
@@ -12,6 +14,7 @@
 #include "backends/imgui_impl_vulkan.h"
 
 // Стандартные библиотеки
+#include <array>
 #include <vector>
 
 typedef ImGui_ImplVulkan_InitInfo ImGuiInit;
@@ -38,8 +41,80 @@ class GUI : public GraphicsPass {
   struct {
     bool menuHovered;
     bool taaON;
+    bool computePostON = false;  // TAA и Tone Mapping вычислительными шейдерами
+    bool tonemapON = false;      // Tone Mapping результата
+    float exposure = 1.0f;
+    bool gradingON = false;       // Цветокоррекция результата
+    float saturation = 1.0f;
+    float contrast = 1.0f;
+    bool ditherON = false;        // Шум перед 8-битным выводом
+    bool fusedPostON = true;      // Стадии постпроцессинга одним проходом, где это возможно
+    bool mergedPassON = false;    // Сцена и постпроцессинг без соседей одним проходом рендера (тайловые GPU)
+    bool cullingON = true;
+    int cullingMethod = Culling::CULLING_HIERARCHICAL;
+    int drawMode = Geometry::DRAW_INDIRECT;
+    float cullingDistance = 0.0f;  // Дальность отсечения на GPU, 0 - без ограничения
+    bool occlusionON = true;       // Отсечение перекрытых форм по Hi-Z в режиме GPU
+    bool sortON = true;            // Порядок вызовов по ключам сортировки
+    int recordThreads = 1;         // Потоки записи команд в режиме отдельных вызовов
+    bool prepassON = false;        // Проход глубины перед цветовым проходом
+    int fragmentCost = 0;          // Искусственная нагрузка фрагментного шейдера геометрии
+    int samplerQuality = Resources::SAMPLER_QUALITY_ULTRA;
+    int framesInFlight = 2;  // Кадры, которые CPU готовит, не дожидаясь GPU
+    bool dynamicResolutionON = false;  // Доля разрешения сцены по времени кадра на GPU
+    float targetFrameTime = 16.6f;     // Цель регулятора (мс)
   } options;
 
+  // Заполняется рендером перед обновлением интерфейса
+  struct {
+    uint32_t draws;
+    uint32_t commands;  // Команды, записанные проходом видимости
+    uint32_t instances;
+    uint32_t occluded;          // Формы, отброшенные проверкой по Hi-Z
+    double sceneTime;           // Время GPU на рендер сцены (мс)
+    double occlusionTime;       // Среднее время с отсечением перекрытых форм по парам соседних кадров (мс), 0 - не измерено
+    double plainTime;           // Среднее время без него по тем же парам (мс), 0 - не измерено
+    double postTime;            // Время GPU на постпроцессинг (мс)
+    uint32_t postPasses;        // Проходов постпроцессинга в кадре
+    bool merged;                // Постпроцессинг - подпроход прохода геометрии
+
+    // [0] - порядок вставки, [1] - порядок ключей сортировки, [2] - с проходом глубины
+    std::array<uint32_t, 2> stateChanges = {UINT32_MAX, UINT32_MAX};  // UINT32_MAX - не измерено
+    std::array<double, 3> overdraw;                                    // 0 - не измерено
+
+    double recordTime;  // Запись команд прохода геометрии на CPU (мс)
+
+    // Память целей графа рендера (МБ)
+    double targetsMemory;
+    double targetsSeparate;  // Без совмещения переходных целей
+    double targetsLazy;      // Выделяется устройством по требованию
+
+    // Динамическое разрешение
+    float resolutionScale;
+    uint32_t renderWidth, renderHeight;
+    double gpuFrameTime;  // Среднее время всего кадра на GPU (мс)
+
+    // Средние по числу кадров в работе (1, 2, 3), 0 - не измерено
+    std::array<double, 3> frameTimes;  // Интервал между кадрами (мс) - пропускная способность
+    std::array<double, 3> latencies;   // От начала подготовки кадра до его завершения на GPU (мс)
+  } statistics{};
+
+  // Замер записи команд выполняет рендер - ему доступен проход геометрии
+  bool drawsBenchmarkRequested = false;
+  std::vector<Geometry::benchmark_t> drawsBenchmark;
+
+  // Замер прохода глубины идёт на кадрах рендера - результаты появляются по его окончании
+  bool prepassBenchmarkRequested = false;
+  std::vector<Geometry::prepass_benchmark_t> prepassBenchmark;
+
+  // Замер постпроцессинга - так же на кадрах рендера
+  bool postBenchmarkRequested = false;
+  std::vector<ComputeEffect::benchmark_t> postBenchmark;
+
+ private:
+  Transforms::benchmark_t transformsBenchmark{};
+  BVH::benchmark_t bvhBenchmark{};
+
  private:
   struct {
     ImGuiIO io;
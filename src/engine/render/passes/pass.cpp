@@ -15,7 +15,8 @@ void Pass::destroy() {
   vkDestroyRenderPass(core->device, pipeline.pass, nullptr);
 
   for (auto layout : descriptor.layouts)
-    vkDestroyDescriptorSetLayout(core->device, layout, nullptr);
+    if (std::find(descriptor.shared.begin(), descriptor.shared.end(), layout) == descriptor.shared.end())
+      vkDestroyDescriptorSetLayout(core->device, layout, nullptr);
 }
 
 void Pass::reload() {
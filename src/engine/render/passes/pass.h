@@ -6,6 +6,7 @@
 
 // Стандартные библиотеки
 #include <array>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -39,6 +40,7 @@ class Pass {
   struct {
     std::string name;
     Shaders::Manager manager;
+    Shaders::Defines defines;  // Перестановка шейдера
   } shader;
 
  protected:
@@ -50,6 +52,7 @@ class Pass {
   struct {
     std::vector<VkDescriptorSet> sets;
     std::vector<VkDescriptorSetLayout> layouts;
+    std::vector<VkDescriptorSetLayout> shared;  // Макеты других владельцев, не удаляются проходом
   } descriptor;
 
   virtual void createDescriptorLayouts() = 0;  // Описание используемых ресурсов
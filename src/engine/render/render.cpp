@@ -7,7 +7,13 @@ Render::Render(Window::Manager window, Core::Manager core, Scene::Manager scene)
 
   initShaders();
   initFrames();
+  initTimestamps();
+  initOverdraw();
+  initGraph();
   initGeometry();
+  initPyramid();
+  initVisibility();
+  initFeedback();
   initPostProcess();
   initInterface();
 }
@@ -15,7 +21,13 @@ Render::Render(Window::Manager window, Core::Manager core, Scene::Manager scene)
 Render::~Render() {
   destroyInterface();
   destroyPostProcess();
+  destroyFeedback();
+  destroyVisibility();
+  destroyPyramid();
   destroyGeometry();
+  destroyGraph();
+  destroyOverdraw();
+  destroyTimestamps();
   destroyFrames();
   destroyShaders();
 }
@@ -27,11 +39,10 @@ void Render::reloadSwapchain() {
   // Пересоздадим список показа
   core->destroySwapchain();
   core->createSwapchain();
+  frames->resize();
 
-  // Обновим данные всех проходов рендера
-  reinitGeometry();
-  reinitPostProcess();
-  reinitInterface();
+  // Граф пересоздаст свои изображения и обновит все проходы рендера
+  graph->resize();
 
   // Обновим соотношение сторон для камеры
   auto camera = scene->getCamera();
@@ -43,11 +54,74 @@ void Render::reloadShaders() {
   vkDeviceWaitIdle(core->device);
 
   // Перезагрузим все проходы рендера
+  visibility.pass->reload();
+  pyramid.pass->reload();
   geometry.pass->reload();
-  postprocess.TAA->reload();
+  feedback.pass->reload();
+  for (auto& effect : postprocess.effects) {
+    // Конвейер подпрохода строится под новый слитый проход геометрии
+    for (auto& [stages, pass] : effect.permutations) {
+      bindPostProcess(pass, effect);
+      pass->reload();
+    }
+    if (effect.compute != nullptr)
+      effect.compute->reload();
+  }
   interface.pass->reload();
 }
 
+void Render::reloadFrames() {
+  vkDeviceWaitIdle(core->device);
+  core->framesInFlight = static_cast<uint32_t>(interface.pass->options.framesInFlight);
+
+  // Копии по кадрам есть у графа и почти у всех проходов - пересоздадим их целиком.
+  // Интерфейс рисует в изображения цепочки показа и остаётся прежним
+  destroyPostProcess();
+  destroyFeedback();
+  destroyVisibility();
+  destroyPyramid();
+  destroyGeometry();
+  destroyGraph();
+  destroyOverdraw();
+  destroyTimestamps();
+  destroyFrames();
+
+  initFrames();
+  initTimestamps();
+  initOverdraw();
+  initGraph();
+  initGeometry();
+  initPyramid();
+  initVisibility();
+  initFeedback();
+  initPostProcess();
+  reinitInterface();
+
+  // Ожидание устройства не входит в интервал между кадрами
+  pacing.last = {};
+  std::cout << "Frames in flight: " << core->framesInFlight << std::endl;
+}
+
+void Render::updatePacing(Frames::Instance frame) {
+  auto now = std::chrono::high_resolution_clock::now();
+  uint32_t slot = core->framesInFlight - 1;
+
+  // Забор кадра дождались - GPU завершил его не позже этого момента
+  if (frame->pending) {
+    double latency = std::chrono::duration<double, std::milli>(now - frame->started).count();
+    double& average = pacing.latencies[slot];
+    average = average > 0.0 ? average * 0.95 + latency * 0.05 : latency;
+    frame->pending = false;
+  }
+
+  if (pacing.last != std::chrono::high_resolution_clock::time_point{}) {
+    double frameTime = std::chrono::duration<double, std::milli>(now - pacing.last).count();
+    double& average = pacing.frameTimes[slot];
+    average = average > 0.0 ? average * 0.95 + frameTime * 0.05 : frameTime;
+  }
+  pacing.last = now;
+}
+
 GUI::Pass Render::getInterface() {
   return interface.pass;
 }
@@ -76,9 +150,173 @@ void Render::destroyFrames() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Render::initGraph() {
+  graph = new Graph(core);
+
+  //=========================================================================
+  // Цели вывода
+
+  // Цвет и векторы движения живут внутри кадра - прошлые кадры TAA хранит в своей истории
+  // Цвет сцены - в формате с плавающей точкой: TAA и тональное отображение получают значения больше 1
+  Graph::image_t color{};
+  color.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+  color.usage = VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;  // Слитый проход читает его вторым подпроходом
+  targets.color = graph->createImage("color", color);
+
+  Graph::image_t velocity{};
+  velocity.format = VK_FORMAT_R16G16_SFLOAT;
+  targets.velocity = graph->createImage("velocity", velocity);
+
+  // История TAA - в размере вывода при любой доле разрешения сцены.
+  // Формат с плавающей точкой: его пишет и вычислительный шейдер, формат списка показа - не всегда
+  Graph::image_t history{};
+  history.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+  targets.history = graph->createImage("history", history);
+
+  Graph::image_t display{};
+  display.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+  targets.display = graph->createImage("display", display);
+
+  // Глубина живёт внутри кадра - граф совмещает её память с другими переходными целями
+  Graph::image_t depth{};
+  depth.format = core->resources->findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+  depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+  depth.usage = VK_IMAGE_USAGE_SAMPLED_BIT;  // Пирамиду глубины строит сам проход геометрии
+  targets.depth = graph->createImage("depth", depth);
+
+  Graph::image_t requests{};
+  requests.format = VK_FORMAT_R8G8B8A8_UINT;
+  requests.divisor = Feedback::scale;
+  requests.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;  // Копируется самим проходом
+  targets.feedback = graph->createImage("feedback", requests);
+
+  // Только подключение прохода - память по требованию, если устройство её поддерживает
+  Graph::image_t requestsDepth{};
+  requestsDepth.format = core->resources->findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+  requestsDepth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+  requestsDepth.divisor = Feedback::scale;
+  targets.feedbackDepth = graph->createImage("feedback depth", requestsDepth);
+
+  targets.swapchain = graph->importSwapchain("swapchain");
+
+  // Обратная связь рисует по спискам прошлого использования буферов - раньше, чем их заполнит видимость
+  targets.lists = graph->importBuffer("visibility lists");
+
+  // Запросы страниц читает приложение, изображение показа - цепочка показа
+  graph->setOutput(targets.feedback);
+  graph->setOutput(targets.swapchain, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+  //=========================================================================
+  // Проходы - граф упорядочивает их по зависимостям, равные - в порядке добавления
+
+  feedback.node = graph->addPass(
+      "feedback",
+      [this](uint32_t frame, uint32_t image, VkCommandBuffer cmd) {
+        scene->getVirtualTextures()->update(frame, cmd);
+        feedback.pass->record(frame, cmd);
+      },
+      [this]() { reinitFeedback(); });
+  graph->use(feedback.node, targets.feedback, Graph::ACCESS_COLOR, true, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+  graph->use(feedback.node, targets.feedbackDepth, Graph::ACCESS_DEPTH, true);
+  graph->use(feedback.node, targets.lists, Graph::ACCESS_INDIRECT);
+
+  geometry.node = graph->addPass(
+      "geometry",
+      [this](uint32_t frame, uint32_t image, VkCommandBuffer cmd) { recordGeometry(frame, image, cmd, false); },
+      [this]() {
+        reinitGeometry();
+        reinitPyramid();
+        reinitVisibility();
+      });
+  graph->use(geometry.node, targets.color, Graph::ACCESS_COLOR, true);
+  graph->use(geometry.node, targets.depth, Graph::ACCESS_DEPTH, true, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+  graph->use(geometry.node, targets.velocity, Graph::ACCESS_COLOR, true);
+  graph->use(geometry.node, targets.lists, Graph::ACCESS_STORAGE);
+
+  // Сцена и постпроцессинг без соседей одним проходом - цвет, глубина и векторы движения
+  // не покидают память тайла, в изображение показа пишется только результат
+  geometry.merged = graph->addPass(
+      "merged",
+      [this](uint32_t frame, uint32_t image, VkCommandBuffer cmd) { recordGeometry(frame, image, cmd, true); },
+      [this]() { reinitPostProcess(postprocess.effects[postprocess.merged]); });
+  graph->use(geometry.merged, targets.color, Graph::ACCESS_COLOR, true);
+  graph->use(geometry.merged, targets.depth, Graph::ACCESS_DEPTH, true);
+  graph->use(geometry.merged, targets.velocity, Graph::ACCESS_COLOR, true);
+  graph->use(geometry.merged, targets.swapchain, Graph::ACCESS_COLOR, true);
+  graph->use(geometry.merged, targets.lists, Graph::ACCESS_STORAGE);
+
+  // Без TAA цвет сцены переводится в изображение показа сразу, с ним - вместе с историей
+  // одним проходом или через неё. Вычислительные эффекты не пишут в список показа -
+  // тональное отображение идёт в display
+  postprocess.origin = addPostProcess("origin", "shaders/post.hlsl", targets.color, {targets.swapchain});
+  postprocess.fused = addPostProcess("post", "shaders/post.hlsl", targets.color, {targets.swapchain, targets.history}, {targets.velocity, targets.history});
+  postprocess.TAA = addPostProcess("taa", "shaders/taa.hlsl", targets.color, {targets.history}, {targets.velocity, targets.history});
+  postprocess.TAACompute = addPostProcess("taa compute", "shaders/taa.hlsl", targets.color, {targets.history}, {targets.velocity, targets.history}, true);
+  postprocess.TM = addPostProcess("tonemap compute", "shaders/tonemap.hlsl", targets.history, {targets.display}, {}, true);
+  postprocess.present = addPostProcess("present", "shaders/post.hlsl", targets.history, {targets.swapchain});
+  postprocess.output = addPostProcess("output", "shaders/post.hlsl", targets.display, {targets.swapchain});
+
+  // Эффект слитого прохода записывает его узел - своего узла у него нет
+  effect_t merged;
+  merged.node = geometry.merged;
+  merged.source = targets.color;
+  merged.outputs = {targets.swapchain};
+  merged.shader = "shaders/post.hlsl";
+  merged.sampler = VK_NULL_HANDLE;
+  merged.subpass = true;
+  postprocess.merged = static_cast<uint32_t>(postprocess.effects.size());
+  postprocess.effects.push_back(merged);
+
+  interface.node = graph->addPass(
+      "interface",
+      [this](uint32_t frame, uint32_t image, VkCommandBuffer cmd) { interface.pass->record(image, cmd); },
+      [this]() { reinitInterface(); });
+  graph->use(interface.node, targets.swapchain, Graph::ACCESS_COLOR, false, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+}
+
+void Render::destroyGraph() {
+  if (graph != nullptr)
+    delete graph;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::initVisibility() {
+  visibility.pass = new Visibility();
+
+  // Основные параметры
+  visibility.pass->core = core;
+  visibility.pass->scene = scene;
+  visibility.pass->shader.manager = shaders;
+  visibility.pass->shader.name = std::string("shaders/visibility.hlsl");
+
+  // Дескрипторы прохода
+  visibility.pass->pyramidView = pyramid.pass->getView();
+
+  visibility.pass->init();
+  geometry.pass->visibility = visibility.pass;
+}
+
+void Render::reinitVisibility() {
+  visibility.pass->pyramidView = pyramid.pass->getView();
+  visibility.pass->resize();
+}
+
+void Render::destroyVisibility() {
+  visibility.pass->destroy();
+  delete visibility.pass;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Render::initGeometry() {
   geometry.pass = new Geometry();
-  createGeometryData();
 
   // Основные параметры
   geometry.pass->core = core;
@@ -87,144 +325,589 @@ void Render::initGeometry() {
   geometry.pass->shader.name = std::string("shaders/geometry.hlsl");
 
   // Дескрипторы прохода рендера
-  scene->getTextures()->getViews(geometry.pass->textureImageViews);
-  geometry.pass->textureSampler = core->resources->createImageSampler(VK_SAMPLER_ADDRESS_MODE_REPEAT);
+  geometry.pass->textureTable.layout = scene->getTextures()->table.layout;
+  geometry.pass->textureTable.set = scene->getTextures()->table.set;
+
+  auto virtualTextures = scene->getVirtualTextures();
+  geometry.pass->virtualTextures.cacheView = virtualTextures->cache.view;
+  geometry.pass->virtualTextures.cacheSampler = virtualTextures->cache.sampler;
+  geometry.pass->virtualTextures.infoBuffer = virtualTextures->infos.buffer;
+  virtualTextures->getTableViews(geometry.pass->virtualTextures.tableViews);
 
   // Цель вывода прохода рендера
-  geometry.pass->target.format = geometry.data.format;
-  geometry.pass->target.width = geometry.data.width;
-  geometry.pass->target.height = geometry.data.height;
-  geometry.pass->target.views = geometry.data.views;
+  auto extent = graph->getExtent(targets.color);
+  geometry.pass->target.format = graph->getFormat(targets.color);
+  geometry.pass->target.width = extent.width;
+  geometry.pass->target.height = extent.height;
+  geometry.pass->target.views = graph->getViews(targets.color);
+  geometry.pass->depth.format = graph->getFormat(targets.depth);
+  geometry.pass->depth.views = graph->getViews(targets.depth);
+  geometry.pass->velocity.format = graph->getFormat(targets.velocity);
+  geometry.pass->velocity.views = graph->getViews(targets.velocity);
+  geometry.pass->present.format = graph->getFormat(targets.swapchain);
+  geometry.pass->present.views = graph->getViews(targets.swapchain);
+  resolution.extents.assign(core->framesInFlight, extent);
 
   geometry.pass->init();
 }
 
 void Render::reinitGeometry() {
-  destroyGeometryData();
-  createGeometryData();
-  geometry.pass->target.format = geometry.data.format;
-  geometry.pass->target.width = geometry.data.width;
-  geometry.pass->target.height = geometry.data.height;
-  geometry.pass->target.views = geometry.data.views;
+  auto extent = graph->getExtent(targets.color);
+  geometry.pass->target.width = extent.width;
+  geometry.pass->target.height = extent.height;
+  geometry.pass->target.views = graph->getViews(targets.color);
+  geometry.pass->depth.views = graph->getViews(targets.depth);
+  geometry.pass->velocity.views = graph->getViews(targets.velocity);
+  geometry.pass->present.views = graph->getViews(targets.swapchain);
+  resolution.extents.assign(core->framesInFlight, extent);
   geometry.pass->resize();
 }
 
 void Render::destroyGeometry() {
-  core->resources->destroyImageSampler(geometry.pass->textureSampler);
-  destroyGeometryData();
   geometry.pass->destroy();
   delete geometry.pass;
 }
 
-void Render::createGeometryData() {
-  geometry.data.width = core->swapchain.extent.width;
-  geometry.data.height = core->swapchain.extent.height;
-  geometry.data.format = core->swapchain.format;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::initPyramid() {
+  pyramid.pass = new DepthPyramid();
+
+  // Основные параметры
+  pyramid.pass->core = core;
+  pyramid.pass->shader.manager = shaders;
+  pyramid.pass->shader.name = std::string("shaders/pyramid.hlsl");
+
+  // Источник - глубина прохода геометрии
+  pyramid.pass->depth.view = graph->getViews(targets.depth)[0];
+  pyramid.pass->depth.width = geometry.pass->target.width;
+  pyramid.pass->depth.height = geometry.pass->target.height;
+
+  pyramid.pass->init();
+}
+
+void Render::reinitPyramid() {
+  pyramid.pass->depth.view = graph->getViews(targets.depth)[0];
+  pyramid.pass->depth.width = geometry.pass->target.width;
+  pyramid.pass->depth.height = geometry.pass->target.height;
+  pyramid.pass->resize();
+}
+
+void Render::destroyPyramid() {
+  pyramid.pass->destroy();
+  delete pyramid.pass;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::initTimestamps() {
+  // Четыре пары меток на каждый кадр в работе
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = timestampsPerFrame * core->framesInFlight;
+
+  if (vkCreateQueryPool(core->device, &poolInfo, nullptr, &timestamps.pool) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create timestamp query pool!");
+
+  timestamps.modes.assign(core->framesInFlight, TIMESTAMP_NONE);
+  timestamps.frames.assign(core->framesInFlight, false);
+  timestamps.posts.assign(core->framesInFlight, false);
+  timestamps.frame = 0;
+  timestamps.pairs = 0;
+  timestamps.lastOcclusion = 0.0;
+  timestamps.occlusionTime = 0.0;
+  timestamps.plainTime = 0.0;
+}
+
+void Render::destroyTimestamps() {
+  vkDestroyQueryPool(core->device, timestamps.pool, nullptr);
+}
+
+double Render::readTimestamps(uint32_t index) {
+  if (index >= timestamps.modes.size() || timestamps.modes[index] == TIMESTAMP_NONE)
+    return -1.0;
+  return readQueries(timestampsPerFrame * index);
+}
+
+double Render::readFrameTime(uint32_t index) {
+  if (index >= timestamps.frames.size() || !timestamps.frames[index])
+    return -1.0;
+
+  // Обе части кадра без промежутка между ними - ожидания получения изображения показа
+  double before = readQueries(timestampsPerFrame * index + 2);
+  double after = readQueries(timestampsPerFrame * index + 6);
+  if (before < 0.0 || after < 0.0)
+    return -1.0;
+  return before + after;
+}
+
+double Render::readPostTime(uint32_t index) {
+  if (index >= timestamps.posts.size() || !timestamps.posts[index])
+    return -1.0;
+  return readQueries(timestampsPerFrame * index + 4);
+}
+
+double Render::readQueries(uint32_t first) {
+  std::array<uint64_t, 2> ticks;
+  VkResult result = vkGetQueryPoolResults(
+      core->device, timestamps.pool, first, 2,
+      sizeof(ticks), ticks.data(), sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS)
+    return -1.0;
+
+  // Период метки - в наносекундах
+  double period = core->physicalDevice.properties.limits.timestampPeriod;
+  return static_cast<double>(ticks[1] - ticks[0]) * period / 1000000.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::updateResolution(double frameTime) {
+  if (frameTime >= 0.0)
+    resolution.gpuTime = resolution.gpuTime > 0.0 ? resolution.gpuTime * 0.9 + frameTime * 0.1 : frameTime;
+
+  auto& options = interface.pass->options;
+  if (!options.dynamicResolutionON) {
+    resolution.scale = 1.0f;
+    return;
+  }
+  if (frameTime < 0.0)
+    return;
+
+  // Зона нечувствительности вокруг цели - без колебаний доли на границе
+  double ratio = resolution.gpuTime / options.targetFrameTime;
+  if (std::abs(ratio - 1.0) < 0.05)
+    return;
+
+  // Время кадра примерно пропорционально числу пикселей - квадрату доли.
+  // Шаг частичный: решение видно в замерах только через несколько кадров в работе
+  float desired = resolution.scale / static_cast<float>(std::sqrt(ratio));
+  resolution.scale += (desired - resolution.scale) * 0.1f;
+  resolution.scale = std::clamp(resolution.scale, minResolutionScale, 1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::initOverdraw() {
+  overdraw.pool = VK_NULL_HANDLE;
+  overdraw.modes.assign(core->framesInFlight, -1);
+  overdraw.averages = {0.0, 0.0, 0.0};
+  if (!core->physicalDevice.features.pipelineStatisticsQuery)
+    return;
+
+  // Один запрос на каждый кадр в работе
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  poolInfo.queryCount = core->framesInFlight;
+  poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+  if (vkCreateQueryPool(core->device, &poolInfo, nullptr, &overdraw.pool) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create pipeline statistics query pool!");
+}
+
+void Render::destroyOverdraw() {
+  if (overdraw.pool != VK_NULL_HANDLE)
+    vkDestroyQueryPool(core->device, overdraw.pool, nullptr);
+}
+
+double Render::readOverdraw(uint32_t index) {
+  if (overdraw.pool == VK_NULL_HANDLE || index >= overdraw.modes.size() || overdraw.modes[index] < 0)
+    return -1.0;
+
+  uint64_t invocations;
+  VkResult result = vkGetQueryPoolResults(
+      core->device, overdraw.pool, index, 1,
+      sizeof(uint64_t), &invocations, sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS)
+    return -1.0;
+
+  // Вызовы на пиксель сцены - в размере, с которым был записан кадр
+  VkExtent2D extent = resolution.extents[index];
+  double pixels = static_cast<double>(extent.width) * extent.height;
+  return static_cast<double>(invocations) / pixels;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::beginPrepassBenchmark() {
+  uint32_t steps = 2 * static_cast<uint32_t>(Geometry::prepassCosts.size());
+  prepassBenchmark.step = 0;
+  prepassBenchmark.frames = 0;
+  prepassBenchmark.steps.assign(core->framesInFlight, -1);
+  prepassBenchmark.timeSamples.assign(steps, 0);
+  prepassBenchmark.overdrawSamples.assign(steps, 0);
+  prepassBenchmark.results.clear();
+  for (uint32_t cost : Geometry::prepassCosts)
+    prepassBenchmark.results.push_back({cost, {0.0, 0.0}, {0.0, 0.0}});
+}
+
+void Render::updatePrepassBenchmark(uint32_t index, double sceneTime, double overdrawValue) {
+  if (prepassBenchmark.step < 0)
+    return;
+  if (prepassBenchmark.steps.size() != core->framesInFlight)
+    prepassBenchmark.steps.assign(core->framesInFlight, -1);
+
+  // Результаты прошлого использования кадра - сумма по его шагу
+  int32_t measured = prepassBenchmark.steps[index];
+  if (measured >= 0) {
+    auto& result = prepassBenchmark.results[measured / 2];
+    if (sceneTime >= 0.0) {
+      result.sceneTime[measured % 2] += sceneTime;
+      prepassBenchmark.timeSamples[measured]++;
+    }
+    if (overdrawValue >= 0.0) {
+      result.overdraw[measured % 2] += overdrawValue;
+      prepassBenchmark.overdrawSamples[measured]++;
+    }
+  }
+
+  // Кадр, записываемый сейчас, - с настройками текущего шага
+  bool warmup = prepassBenchmark.frames < prepassWarmupFrames;
+  prepassBenchmark.steps[index] = warmup ? -1 : prepassBenchmark.step;
+  if (++prepassBenchmark.frames < prepassWarmupFrames + prepassMeasureFrames)
+    return;
 
-  uint32_t count = core->swapchain.count;
-  geometry.data.images.resize(count);
-  geometry.data.memory.resize(count);
-  geometry.data.views.resize(count);
-  for (uint32_t i = 0; i < count; ++i) {
-    core->resources->createImage(
-        geometry.data.width, geometry.data.height, geometry.data.format,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        geometry.data.images[i], geometry.data.memory[i]);
-    geometry.data.views[i] = core->resources->createImageView(
-        geometry.data.images[i],
-        core->swapchain.format,
-        VK_IMAGE_ASPECT_COLOR_BIT);
-    core->commands->changeImageLayout(
-        nullptr,
-        geometry.data.images[i],
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  prepassBenchmark.frames = 0;
+  prepassBenchmark.step++;
+  if (prepassBenchmark.step < static_cast<int32_t>(prepassBenchmark.timeSamples.size()))
+    return;
+
+  // Кадры последнего шага ещё в работе - их результаты не нужны
+  prepassBenchmark.step = -1;
+  for (uint32_t i = 0; i < prepassBenchmark.results.size(); ++i) {
+    auto& result = prepassBenchmark.results[i];
+    for (uint32_t mode = 0; mode < 2; ++mode) {
+      uint32_t step = 2 * i + mode;
+      if (prepassBenchmark.timeSamples[step] > 0)
+        result.sceneTime[mode] /= prepassBenchmark.timeSamples[step];
+      if (prepassBenchmark.overdrawSamples[step] > 0)
+        result.overdraw[mode] /= prepassBenchmark.overdrawSamples[step];
+    }
+
+    // Проход глубины выигрывает, когда сэкономленные вызовы фрагментного шейдера
+    // дороже повторной обработки вершин
+    std::cout << "Pre-pass benchmark (cost " << result.cost << "): "
+              << result.sceneTime[0] << " ms without, " << result.sceneTime[1] << " ms with pre-pass, "
+              << "overdraw " << result.overdraw[0] << "x -> " << result.overdraw[1] << "x, "
+              << (result.sceneTime[1] < result.sceneTime[0] ? "pre-pass wins" : "pre-pass loses") << std::endl;
   }
+  interface.pass->prepassBenchmark = prepassBenchmark.results;
 }
 
-void Render::destroyGeometryData() {
-  for (uint32_t i = 0; i < geometry.data.images.size(); ++i) {
-    core->resources->destroyImageView(geometry.data.views[i]);
-    core->resources->destroyImage(geometry.data.images[i], geometry.data.memory[i]);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::beginPostBenchmark() {
+  uint32_t steps = 2 + static_cast<uint32_t>(postprocess.effects[postprocess.TAACompute].compute->groupSizes.size());
+  postBenchmark.step = 0;
+  postBenchmark.frames = 0;
+  postBenchmark.steps.assign(core->framesInFlight, -1);
+  postBenchmark.samples.assign(steps, 0);
+  postBenchmark.results.clear();
+  postBenchmark.results.push_back({{0, 0}, 0.0, false});
+  postBenchmark.results.push_back({{0, 0}, 0.0, true});
+  for (auto size : postprocess.effects[postprocess.TAACompute].compute->groupSizes)
+    postBenchmark.results.push_back({size, 0.0});
+}
+
+void Render::updatePostBenchmark(uint32_t index, double postTime) {
+  if (postBenchmark.step < 0)
+    return;
+  if (postBenchmark.steps.size() != core->framesInFlight)
+    postBenchmark.steps.assign(core->framesInFlight, -1);
+
+  // Результат прошлого использования кадра - сумма по его шагу
+  int32_t measured = postBenchmark.steps[index];
+  if (measured >= 0 && postTime >= 0.0) {
+    postBenchmark.results[measured].time += postTime;
+    postBenchmark.samples[measured]++;
   }
+
+  // Кадр, записываемый сейчас, - с настройками текущего шага
+  bool warmup = postBenchmark.frames < postWarmupFrames;
+  postBenchmark.steps[index] = warmup ? -1 : postBenchmark.step;
+  if (++postBenchmark.frames < postWarmupFrames + postMeasureFrames)
+    return;
+
+  postBenchmark.frames = 0;
+  postBenchmark.step++;
+  if (postBenchmark.step < static_cast<int32_t>(postBenchmark.samples.size()))
+    return;
+
+  // Вычислительные эффекты остаются с самым быстрым размером группы
+  postBenchmark.step = -1;
+  uint32_t fastest = UINT32_MAX;
+  for (uint32_t step = 0; step < postBenchmark.results.size(); ++step) {
+    auto& result = postBenchmark.results[step];
+    bool sampled = postBenchmark.samples[step] > 0;
+    if (sampled)
+      result.time /= postBenchmark.samples[step];
+    if (step > 1 && sampled && (fastest == UINT32_MAX || result.time < postBenchmark.results[fastest + 2].time))
+      fastest = step - 2;
+
+    if (step < 2)
+      std::cout << "Post-process benchmark (fragment, " << (result.fused ? "fused" : "separate") << "): "
+                << result.time << " ms" << std::endl;
+    else
+      std::cout << "Post-process benchmark (compute " << result.group.width << "x" << result.group.height << "): "
+                << result.time << " ms" << std::endl;
+  }
+  for (auto& effect : postprocess.effects)
+    if (effect.compute != nullptr && fastest != UINT32_MAX)
+      effect.compute->group = fastest;
+  interface.pass->postBenchmark = postBenchmark.results;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Render::initPostProcess() {
-  auto origin = new Fullscreen();
-  auto TAA = new Fullscreen();
+void Render::initFeedback() {
+  feedback.pass = new Feedback();
+
+  // Основные параметры
+  feedback.pass->core = core;
+  feedback.pass->scene = scene;
+  feedback.pass->shader.manager = shaders;
+  feedback.pass->shader.name = std::string("shaders/feedback.hlsl");
+  feedback.pass->geometry = geometry.pass;
 
-  postprocess.origin = origin;
-  postprocess.TAA = TAA;
+  // Дескрипторы прохода рендера
+  auto virtualTextures = scene->getVirtualTextures();
+  feedback.pass->virtualInfoBuffer = virtualTextures->infos.buffer;
+  virtualTextures->prepare(core->framesInFlight);
 
-  std::array<Fullscreen::Pass, 2> passes = {
-      postprocess.origin,
-      postprocess.TAA,
-  };
+  // Цель вывода прохода рендера
+  auto extent = graph->getExtent(targets.feedback);
+  feedback.pass->target.format = graph->getFormat(targets.feedback);
+  feedback.pass->target.width = extent.width;
+  feedback.pass->target.height = extent.height;
+  feedback.pass->target.views = graph->getViews(targets.feedback);
+  feedback.pass->targetImages = graph->getImages(targets.feedback);
+  feedback.pass->depth.format = graph->getFormat(targets.feedbackDepth);
+  feedback.pass->depth.views = graph->getViews(targets.feedbackDepth);
+
+  feedback.pass->init();
+}
 
-  for (auto& pass : passes) {
-    // Основные параметры
-    pass->core = core;
-    pass->shader.manager = shaders;
+void Render::reinitFeedback() {
+  auto extent = graph->getExtent(targets.feedback);
+  feedback.pass->target.width = extent.width;
+  feedback.pass->target.height = extent.height;
+  feedback.pass->target.views = graph->getViews(targets.feedback);
+  feedback.pass->targetImages = graph->getImages(targets.feedback);
+  feedback.pass->depth.views = graph->getViews(targets.feedbackDepth);
+  feedback.pass->resize();
+}
 
-    // Дескрипторы прохода рендера
-    pass->colorImageViews = geometry.data.views;
-    pass->colorImageSampler = core->resources->createImageSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER);
+void Render::destroyFeedback() {
+  feedback.pass->destroy();
+  delete feedback.pass;
+}
 
-    // Указание изображений, в которые будет идти результат
-    pass->target.width = core->swapchain.extent.width;
-    pass->target.height = core->swapchain.extent.height;
-    pass->target.format = core->swapchain.format;
-    pass->target.views = core->resources->createImageViews(
-        core->swapchain.images,
-        core->swapchain.format,
-        VK_IMAGE_ASPECT_COLOR_BIT);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::array<Render::post_stage_t, Render::POST_STAGE_COUNT> Render::postStages = {{
+    {"POST_TAA", true, true},
+    {"POST_TONEMAP", false, false},
+    {"POST_GRADING", false, false},
+    {"POST_DITHER", false, false},
+}};
+
+std::vector<std::pair<uint32_t, uint32_t>> Render::selectPostEffects(uint32_t stages, bool compute, bool fuse, bool merged) {
+  uint32_t taaStage = 1u << POST_TAA;
+  if (merged)
+    return {{postprocess.merged, stages}};
+
+  if ((stages & taaStage) && compute) {
+    // Вычислительный Tone Mapping пишет в display - в список показа его переносит отдельный эффект
+    uint32_t tail = stages & ~taaStage;
+    uint32_t computed = tail & ((1u << POST_TONEMAP) | (1u << POST_GRADING));
+    if (computed == 0)
+      return {{postprocess.TAACompute, 0}, {postprocess.present, tail}};
+    return {{postprocess.TAACompute, 0}, {postprocess.TM, 0}, {postprocess.output, tail & ~computed}};
   }
 
-  origin->shader.name = std::string("shaders/fullscreen.hlsl");
-  origin->init();
+  // Стадии сегодня читают соседей только у цвета сцены - цепочка делится лишь на TAA и вывод.
+  // initPostProcess проходит все маски - другая цепочка обнаруживается при создании эффектов
+  auto chain = compilePostChain(stages, fuse);
+  if (chain.size() > 2 || (chain.size() == 2 && chain[0] != taaStage))
+    throw std::runtime_error("ERROR: Unsupported post-processing chain!");
 
-  TAA->shader.name = std::string("shaders/taa.hlsl");
-  TAA->init();
+  if (chain.size() == 2)
+    return {{postprocess.TAA, 0}, {postprocess.present, chain.back()}};
+  return {{stages & taaStage ? postprocess.fused : postprocess.origin, chain.back()}};
 }
 
-void Render::destroyPostProcess() {
-  std::array<Fullscreen::Pass, 2> passes = {
-      postprocess.origin,
-      postprocess.TAA,
-  };
+std::vector<uint32_t> Render::compilePostChain(uint32_t stages, bool fuse) {
+  std::vector<uint32_t> chain = {0};
+  bool closed = false;  // Прошлая стадия сохраняется отдельным проходом
+  for (uint32_t stage = 0; stage < POST_STAGE_COUNT; ++stage) {
+    if (!(stages & (1u << stage)))
+      continue;
+
+    // Соседей можно читать только у записанного изображения - у результата прошлого прохода
+    bool split = chain.back() != 0 && (postStages[stage].neighborhood || closed);
+    if (split)
+      chain.push_back(0);
+    chain.back() |= 1u << stage;
+    closed = !fuse && postStages[stage].stored;
+  }
+
+  // Сохраняемый результат не пишется в список показа - его переносит проход без стадий
+  if (closed)
+    chain.push_back(0);
+  return chain;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t Render::addPostProcess(const std::string& name, const std::string& shader,
+                                Graph::Resource source, const std::vector<Graph::Resource>& outputs,
+                                const std::vector<Graph::Resource>& inputs, bool compute) {
+  effect_t effect;
+  effect.source = source;
+  effect.inputs = inputs;
+  effect.outputs = outputs;
+  effect.shader = shader;
+
+  Resources::sampler_t colorSampler;
+  colorSampler.address = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  colorSampler.anisotropy = 1.0f;
+  effect.sampler = core->resources->getSampler(colorSampler);
+
+  // Основные параметры - фрагментные перестановки создаются при выборе
+  if (compute) {
+    effect.compute = new ComputeEffect();
+    effect.compute->core = core;
+    effect.compute->shader.manager = shaders;
+    effect.compute->shader.name = shader;
+    effect.compute->colorImageSampler = effect.sampler;
+  }
 
-  for (auto pass : passes) {
-    core->resources->destroyImageSampler(pass->colorImageSampler);
-    core->resources->destroyImageViews(pass->target.views);
-    pass->destroy();
-    delete pass;
+  // Узел графа: входы -> цели вывода (изображение показа или копия кадра)
+  uint32_t id = static_cast<uint32_t>(postprocess.effects.size());
+  bool presents = outputs[0] == targets.swapchain;
+  effect.node = graph->addPass(
+      name,
+      [this, id, presents](uint32_t frame, uint32_t image, VkCommandBuffer cmd) {
+        // Начало - после завершения сцены: метка в начале конвейера записалась бы раньше
+        uint32_t query = timestampsPerFrame * frame + 4;
+        if (id == postprocess.first)
+          vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, query);
+
+        auto& effect = postprocess.effects[id];
+        if (effect.compute == nullptr)
+          effect.pass->record(frame, presents ? image : frame, cmd);
+        else
+          effect.compute->record(frame, cmd);
+
+        if (id == postprocess.last)
+          vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, query + 1);
+      },
+      [this, id]() { reinitPostProcess(postprocess.effects[id]); });
+  graph->use(effect.node, source, Graph::ACCESS_SAMPLED);
+
+  // Свой выход среди входов - копия прошлого кадра: граф готовит её к чтению в конце того кадра
+  for (auto input : inputs) {
+    bool history = std::find(outputs.begin(), outputs.end(), input) != outputs.end();
+    graph->use(effect.node, input, history ? Graph::ACCESS_HISTORY : Graph::ACCESS_SAMPLED);
   }
+  for (auto output : outputs)
+    graph->use(effect.node, output, compute ? Graph::ACCESS_STORAGE : Graph::ACCESS_COLOR, true);
+
+  postprocess.effects.push_back(effect);
+  return id;
 }
 
-void Render::reinitPostProcess() {
-  std::array<Fullscreen::Pass, 2> passes = {
-      postprocess.origin,
-      postprocess.TAA,
-  };
+void Render::usePostPermutation(effect_t& effect, uint32_t stages) {
+  auto found = effect.permutations.find(stages);
+  if (found != effect.permutations.end()) {
+    effect.pass = found->second;
+    return;
+  }
+
+  // Основные параметры - каждая стадия включается определением препроцессора
+  auto pass = new Fullscreen();
+  pass->core = core;
+  pass->shader.manager = shaders;
+  pass->shader.name = effect.shader;
+  for (uint32_t stage = 0; stage < POST_STAGE_COUNT; ++stage)
+    if (stages & (1u << stage))
+      pass->shader.defines.push_back({postStages[stage].define, "1"});
+
+  // Вывод в sRGB кодируется после шейдера - шум добавляется к кодированным значениям
+  VkFormat format = graph->getFormat(effect.outputs[0]);
+  bool srgb = format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+  if (srgb && (stages & (1u << POST_DITHER)))
+    pass->shader.defines.push_back({"POST_SRGB", "1"});
+
+  if (effect.subpass)
+    pass->shader.defines.push_back({"POST_SUBPASS", "1"});
+  pass->colorImageSampler = effect.sampler;
+
+  // Дескрипторы и изображения, в которые будет идти результат
+  bindPostProcess(pass, effect);
+  pass->target.format = format;
+  pass->init();
+
+  effect.permutations[stages] = pass;
+  effect.pass = pass;
+}
 
-  for (auto pass : passes) {
-    pass->colorImageViews = geometry.data.views;
-    pass->target.width = core->swapchain.extent.width;
-    pass->target.height = core->swapchain.extent.height;
-    pass->target.format = core->swapchain.format;
+void Render::initPostProcess() {
+  for (auto& effect : postprocess.effects) {
+    if (effect.compute != nullptr) {
+      bindPostProcess(effect.compute, effect);
+      effect.compute->init();
+    } else {
+      usePostPermutation(effect, 0);
+    }
+  }
 
-    core->resources->destroyImageViews(pass->target.views);
-    pass->target.views = core->resources->createImageViews(
-        core->swapchain.images,
-        core->swapchain.format,
-        VK_IMAGE_ASPECT_COLOR_BIT);
+  // Все достижимые перестановки - сразу: смена стадий в кадре не компилирует шейдеры.
+  // Слитый проход не читает соседей - без TAA
+  uint32_t taaStage = 1u << POST_TAA;
+  for (uint32_t stages = 0; stages < (1u << POST_STAGE_COUNT); ++stages) {
+    for (uint32_t mode = 0; mode < 8; ++mode) {
+      bool compute = mode & 1, fuse = mode & 2, merged = mode & 4;
+      if (merged && (stages & taaStage))
+        continue;
+      for (auto [id, permutation] : selectPostEffects(stages, compute, fuse, merged))
+        if (postprocess.effects[id].compute == nullptr)
+          usePostPermutation(postprocess.effects[id], permutation);
+    }
+  }
+  taa.valid = false;
+}
 
+void Render::reinitPostProcess(effect_t& effect) {
+  for (auto& [stages, pass] : effect.permutations) {
+    bindPostProcess(pass, effect);
     pass->resize();
   }
+  if (effect.compute != nullptr) {
+    bindPostProcess(effect.compute, effect);
+    effect.compute->resize();
+  }
+
+  // Новые изображения - история пуста
+  taa.valid = false;
+}
+
+void Render::destroyPostProcess() {
+  for (auto& effect : postprocess.effects) {
+    for (auto& [stages, pass] : effect.permutations) {
+      pass->destroy();
+      delete pass;
+    }
+    if (effect.compute != nullptr) {
+      effect.compute->destroy();
+      delete effect.compute;
+    }
+  }
+  postprocess.effects.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -238,32 +921,29 @@ void Render::initInterface() {
   interface.pass->scene = scene;
 
   // Цель вывода прохода рендера
-  interface.pass->target.width = core->swapchain.extent.width;
-  interface.pass->target.height = core->swapchain.extent.height;
-  interface.pass->target.format = core->swapchain.format;
-  interface.pass->target.views = core->resources->createImageViews(
-      core->swapchain.images,
-      core->swapchain.format,
-      VK_IMAGE_ASPECT_COLOR_BIT);
+  auto extent = graph->getExtent(targets.swapchain);
+  interface.pass->target.width = extent.width;
+  interface.pass->target.height = extent.height;
+  interface.pass->target.format = graph->getFormat(targets.swapchain);
+  interface.pass->target.views = graph->getViews(targets.swapchain);
+
+  // Тайловые GPU - по производителю (ARM, Qualcomm, Imagination, Apple): на них сцена не покидает память тайла.
+  // Встроенные GPU Intel и AMD рисуют без тайлов - для них слитый проход не выгоден
+  uint32_t vendor = core->physicalDevice.properties.vendorID;
+  interface.pass->options.mergedPassON = vendor == 0x13B5 || vendor == 0x5143 || vendor == 0x1010 || vendor == 0x106B;
 
   interface.pass->init();
 }
 
 void Render::reinitInterface() {
-  interface.pass->target.width = core->swapchain.extent.width;
-  interface.pass->target.height = core->swapchain.extent.height;
-  interface.pass->target.format = core->swapchain.format;
-
-  core->resources->destroyImageViews(interface.pass->target.views);
-  interface.pass->target.views = core->resources->createImageViews(
-      core->swapchain.images,
-      core->swapchain.format,
-      VK_IMAGE_ASPECT_COLOR_BIT);
+  auto extent = graph->getExtent(targets.swapchain);
+  interface.pass->target.width = extent.width;
+  interface.pass->target.height = extent.height;
+  interface.pass->target.views = graph->getViews(targets.swapchain);
   interface.pass->resize();
 }
 
 void Render::destroyInterface() {
-  core->resources->destroyImageViews(interface.pass->target.views);
   interface.pass->destroy();
   delete interface.pass;
 }
@@ -271,8 +951,15 @@ void Render::destroyInterface() {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Render::draw() {
+  // Число кадров в работе меняется между кадрами
+  if (static_cast<uint32_t>(interface.pass->options.framesInFlight) != core->framesInFlight)
+    reloadFrames();
+
+  // Ресурсы кадра свободны после завершения его прошлого использования
   auto currentFrame = frames->getCurrentFrame();
+  uint32_t frameIndex = frames->currentFrameIndex;
   vkWaitForFences(core->device, 1, &currentFrame->drawing, VK_TRUE, UINT64_MAX);
+  updatePacing(currentFrame);
 
   //=========================================================================
   // Получение изображения из списка показа
@@ -286,7 +973,15 @@ void Render::draw() {
     throw std::runtime_error("ERROR: Failed to acquire swapchain image!");
   }
 
-  auto targetFrame = frames->getFrame(swapchainImageIndex);
+  auto targetImage = frames->getImage(swapchainImageIndex);
+
+  //=========================================================================
+  // Синхронизация кадров
+
+  // Изображение свободно после завершения кадра, который в него рисовал
+  if (targetImage->showing != VK_NULL_HANDLE && targetImage->showing != currentFrame->drawing)
+    vkWaitForFences(core->device, 1, &targetImage->showing, VK_TRUE, UINT64_MAX);
+  targetImage->showing = currentFrame->drawing;
 
   //=========================================================================
   // Подготовка проходов рендера перед генерацией команд
@@ -301,25 +996,224 @@ void Render::draw() {
   float deltaFrame = std::chrono::duration<double, std::milli>(timeFrame - timeFrameStart).count() / 1000.0f;
   timeFrameStart = timeFrame;
 
+  // Отсюда кадр читает ввод и состояние сцены - начало задержки
+  currentFrame->started = timeFrame;
+  currentFrame->pending = true;
+
   // Получим объекты сцены
   auto object = scene->objects[scene->currentObject];
   object->setRotation({object->transform.rotation.x, deltaGlobal * 100.0f, object->transform.rotation.z});
   object->update();
+  scene->update();
 
   auto camera = scene->getCamera();
   camera->update(deltaFrame);
 
+  // Отсечение форм, не попадающих в пирамиду видимости камеры
+  // В режиме GPU формы проверяет проход видимости - на CPU все считаются видимыми
+  // Без возможностей устройства режим понижается: GPU -> косвенный -> отдельные вызовы
+  auto drawMode = static_cast<Geometry::DrawMode>(interface.pass->options.drawMode);
+  bool indirectSupported = core->physicalDevice.features.multiDrawIndirect && core->physicalDevice.features.drawIndirectFirstInstance;
+  if (drawMode == Geometry::DRAW_GPU && !(indirectSupported && core->physicalDevice.drawIndirectCount))
+    drawMode = Geometry::DRAW_INDIRECT;
+  if (drawMode == Geometry::DRAW_INDIRECT && !indirectSupported)
+    drawMode = Geometry::DRAW_INSTANCED;
+  interface.pass->options.drawMode = drawMode;
+  auto culling = scene->getCulling();
+  culling->enabled = interface.pass->options.cullingON && drawMode != Geometry::DRAW_GPU;
+  culling->method = static_cast<Culling::Method>(interface.pass->options.cullingMethod);
+  culling->cull(camera->projectionMatrix * camera->viewMatrix);
+
+  // Копии объёмов для GPU обновляются в любом режиме - только изменённые формы.
+  // Перекрытие проверяется по Hi-Z из глубины ранней фазы этого же кадра - формы,
+  // видимые в прошлом кадре, рисуются первыми
+  bool occlusionON = drawMode == Geometry::DRAW_GPU && interface.pass->options.occlusionON;
+
+  // С Hi-Z каждый occlusionPairInterval-й кадр рисуется без него - соседние кадры дают парный замер экономии
+  bool occlusion = occlusionON;
+  if (occlusionON && ++timestamps.frame % occlusionPairInterval == 0)
+    occlusion = false;
+
+  // Доля разрешения по времени GPU прошлого использования кадра - его забор уже дождались
+  updateResolution(readFrameTime(frameIndex));
+  geometry.pass->renderScale = resolution.scale;
+  VkExtent2D renderExtent = geometry.pass->getRenderExtent();
+
+  auto& uniform = visibility.pass->uniform;
+  uniform.planes = Culling::extractFrustum(camera->projectionMatrix * camera->viewMatrix);
+  uniform.viewProjection = camera->projectionMatrix * camera->viewMatrix;
+  uniform.camera = camera->transform.position;
+  uniform.maxDistance = interface.pass->options.cullingDistance;
+  uniform.enabled = interface.pass->options.cullingON;
+  uniform.depthSize = {renderExtent.width, renderExtent.height};  // Пирамида строится по части глубины
+  uniform.levels = pyramid.pass->getLevelCount();
+  uniform.occlusion = occlusion;
+  visibility.pass->update(frameIndex);
+
   // Обновим данные прохода рендера
+  geometry.pass->drawMode = drawMode;
+  geometry.pass->sortDraws = interface.pass->options.sortON;
+  geometry.pass->recordThreads = static_cast<uint32_t>(interface.pass->options.recordThreads);
+
+  // Замер постпроцессинга сам перебирает версии эффектов - со всеми стадиями
+  if (interface.pass->postBenchmarkRequested) {
+    interface.pass->postBenchmarkRequested = false;
+    beginPostBenchmark();
+  }
+  auto& options = interface.pass->options;
+
+  // История TAA - копия прошлого кадра в работе: с одним кадром проход читал бы изображение,
+  // в которое пишет, а граф отбрасывал бы его содержимое перед записью
+  bool historyON = core->framesInFlight > 1;
+  if (!historyON)
+    options.taaON = false;
+  bool taaON = options.taaON;
+  bool tonemapON = options.tonemapON;
+  bool gradingON = options.gradingON;
+  bool ditherON = options.ditherON;
+  bool computeON = options.computePostON;
+  bool fusedON = options.fusedPostON;
+  // Замер - без дрожания цвета: его выполняет только фрагментный шейдер, и перенос display
+  // в список показа после вычислительных эффектов остаётся чистой копией - её замер не учитывает
+  if (postBenchmark.step >= 0) {
+    taaON = historyON;
+    tonemapON = gradingON = true;
+    ditherON = false;
+    computeON = postBenchmark.step > 1;
+    fusedON = postBenchmark.step == 1;
+    for (auto& effect : postprocess.effects)
+      if (effect.compute != nullptr && computeON)
+        effect.compute->group = static_cast<uint32_t>(postBenchmark.step - 2);
+  }
+
+  // С TAA сцена рисуется со сдвигом внутри пикселя, векторы движения - без него
+  if (taaON)
+    camera->updateJitter(taa.frame++, renderExtent.width, renderExtent.height);
+  else
+    camera->updateJitter(0, 0, 0);
+  glm::float4x4 viewProjection = camera->projectionMatrix * camera->viewMatrix;
   geometry.pass->uniform.cameraView = camera->viewMatrix;
-  geometry.pass->uniform.cameraProjection = camera->projectionMatrix;
-  geometry.pass->update(swapchainImageIndex);
+  geometry.pass->uniform.cameraProjection = camera->jitteredProjectionMatrix;
+  geometry.pass->uniform.viewProjection = viewProjection;
+  geometry.pass->uniform.previousViewProjection = camera->previousViewProjection;
+  camera->previousViewProjection = viewProjection;
+
+  // Замер прохода глубины сам перебирает его режимы и стоимость фрагментного шейдера
+  if (interface.pass->prepassBenchmarkRequested) {
+    interface.pass->prepassBenchmarkRequested = false;
+    beginPrepassBenchmark();
+  }
+  geometry.pass->depthPrepass = interface.pass->options.prepassON;
+  geometry.pass->uniform.fragmentCost = static_cast<uint32_t>(interface.pass->options.fragmentCost);
+  if (prepassBenchmark.step >= 0) {
+    geometry.pass->depthPrepass = prepassBenchmark.step % 2 == 1;
+    geometry.pass->uniform.fragmentCost = Geometry::prepassCosts[prepassBenchmark.step / 2];
+  }
+  geometry.pass->update(frameIndex);
+
+  // Слитому проходу нужен только свой пиксель сцены в её полном размере и один проход рендера -
+  // иначе сцена и постпроцессинг идут отдельными проходами
+  bool mergedON = options.mergedPassON && !taaON && !occlusionON && !options.dynamicResolutionON &&
+                  !geometry.pass->depthPrepass && postBenchmark.step < 0;
+  graph->setEnabled(geometry.node, !mergedON);
+
+  // Освобождение ячеек таблицы текстур, не используемых кадрами в работе
+  auto textures = scene->getTextures();
+  textures->update();
+
+  // Смена качества фильтрации перезаписывает сэмплеры, которые могут использовать кадры в работе
+  auto samplerQuality = static_cast<Resources::SamplerQuality>(interface.pass->options.samplerQuality);
+  if (samplerQuality != core->resources->samplerQuality) {
+    vkDeviceWaitIdle(core->device);
+    textures->setSamplerQuality(samplerQuality);
+  }
+
+  // Запросы страниц виртуальных текстур от прошлого использования изображения
+  auto virtualTextures = scene->getVirtualTextures();
+  bool virtualTexturing = virtualTextures->getCount() > 0;
+  graph->setEnabled(feedback.node, virtualTexturing);
+  if (virtualTexturing) {
+    virtualTextures->request(feedback.pass->getData(frameIndex), feedback.pass->getDataCount());
+    feedback.pass->uniform.cameraView = camera->viewMatrix;
+    feedback.pass->uniform.cameraProjection = camera->projectionMatrix;
+    feedback.pass->update(frameIndex);
+  }
+
+  // Время записи команд при разном числе форм
+  if (interface.pass->drawsBenchmarkRequested) {
+    interface.pass->drawsBenchmarkRequested = false;
+    interface.pass->drawsBenchmark.clear();
+    for (uint32_t count : {1000, 10000, 100000}) {
+      auto result = geometry.pass->benchmark(count);
+      interface.pass->drawsBenchmark.push_back(result);
+    }
+  }
 
-  interface.pass->update(swapchainImageIndex);
+  interface.pass->statistics.draws = geometry.pass->getDrawCount();
+  interface.pass->statistics.recordTime = geometry.pass->getRecordTime();
+  interface.pass->statistics.instances = geometry.pass->getInstanceCount();
+  interface.pass->statistics.commands = 0;
+  interface.pass->statistics.occluded = 0;
+  if (drawMode == Geometry::DRAW_GPU) {
+    // Результаты прошлого использования изображения - кадр уже завершён
+    auto visibilityStats = visibility.pass->getStats(frameIndex);
+    interface.pass->statistics.commands = visibilityStats.draws;
+    interface.pass->statistics.instances = visibilityStats.visible;
+    interface.pass->statistics.occluded = visibilityStats.occluded;
+  }
+
+  // Время рендера сцены прошлым использованием изображения - средние отдельно по режимам
+  double sceneTime = readTimestamps(frameIndex);
+  if (sceneTime >= 0.0) {
+    // Замер без Hi-Z учитывается только в паре с соседним кадром с ним - оба в одних условиях
+    int32_t mode = timestamps.modes[frameIndex];
+    if (mode == TIMESTAMP_OCCLUSION) {
+      timestamps.lastOcclusion = sceneTime;
+    } else if (mode == TIMESTAMP_GPU && timestamps.lastOcclusion > 0.0) {
+      bool first = timestamps.pairs++ == 0;
+      timestamps.occlusionTime = first ? timestamps.lastOcclusion : timestamps.occlusionTime * 0.9 + timestamps.lastOcclusion * 0.1;
+      timestamps.plainTime = first ? sceneTime : timestamps.plainTime * 0.9 + sceneTime * 0.1;
+      timestamps.lastOcclusion = 0.0;
+    }
+    interface.pass->statistics.sceneTime = sceneTime;
+  }
+  interface.pass->statistics.occlusionTime = timestamps.occlusionTime;
+
+  double postTime = readPostTime(frameIndex);
+  if (postTime >= 0.0)
+    interface.pass->statistics.postTime = postTime;
+  updatePostBenchmark(frameIndex, postTime);
+  interface.pass->statistics.plainTime = timestamps.plainTime;
+
+  // Смены состояния и перерисовка - отдельно для порядка вставки и порядка ключей
+  if (drawMode != Geometry::DRAW_GPU)
+    interface.pass->statistics.stateChanges[geometry.pass->sortDraws] = geometry.pass->getStateChanges();
+  double overdrawValue = readOverdraw(frameIndex);
+  if (overdrawValue >= 0.0) {
+    double& average = overdraw.averages[overdraw.modes[frameIndex]];
+    average = average > 0.0 ? average * 0.95 + overdrawValue * 0.05 : overdrawValue;
+  }
+  interface.pass->statistics.overdraw = overdraw.averages;
+  updatePrepassBenchmark(frameIndex, sceneTime, overdrawValue);
+
+  auto targetsMemory = graph->getMemory();
+  interface.pass->statistics.targetsMemory = targetsMemory.allocated / (1024.0 * 1024.0);
+  interface.pass->statistics.targetsSeparate = targetsMemory.separate / (1024.0 * 1024.0);
+  interface.pass->statistics.targetsLazy = targetsMemory.lazy / (1024.0 * 1024.0);
+  interface.pass->statistics.resolutionScale = resolution.scale;
+  interface.pass->statistics.renderWidth = renderExtent.width;
+  interface.pass->statistics.renderHeight = renderExtent.height;
+  interface.pass->statistics.gpuFrameTime = resolution.gpuTime;
+  interface.pass->statistics.frameTimes = pacing.frameTimes;
+  interface.pass->statistics.latencies = pacing.latencies;
+  interface.pass->update(frameIndex);
 
   //=========================================================================
   // Подготовка буфера команд
 
-  VkCommandBuffer cmd = targetFrame->cmdBuffer;
+  VkCommandBuffer sceneCmd = currentFrame->sceneCmdBuffer;
+  VkCommandBuffer cmd = currentFrame->cmdBuffer;
+  core->commands->resetCommandBuffer(sceneCmd);
   core->commands->resetCommandBuffer(cmd);
 
   VkCommandBufferBeginInfo cmdBeginInfo = {};
@@ -328,45 +1222,101 @@ void Render::draw() {
   cmdBeginInfo.pInheritanceInfo = nullptr;
   cmdBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
+  vkBeginCommandBuffer(sceneCmd, &cmdBeginInfo);
   vkBeginCommandBuffer(cmd, &cmdBeginInfo);
 
+  // Время кадра на GPU - вход регулятора разрешения. Метки каждой части - после завершения
+  // предыдущей работы очереди: вторая часть начинается, когда изображение уже получено
+  uint32_t frameQuery = timestampsPerFrame * frameIndex + 2;
+  vkCmdResetQueryPool(sceneCmd, timestamps.pool, frameQuery, 6);
+  vkCmdWriteTimestamp(sceneCmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, frameQuery);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, frameQuery + 4);
+
   //=========================================================================
   // Генерация команд рендера
 
-  geometry.pass->record(swapchainImageIndex, cmd);
+  // Включённые стадии -> эффекты графа и их перестановки
+  uint32_t stages = (taaON ? 1u << POST_TAA : 0) | (tonemapON ? 1u << POST_TONEMAP : 0) |
+                    (gradingON ? 1u << POST_GRADING : 0) | (ditherON ? 1u << POST_DITHER : 0);
+  std::vector<bool> enabled(postprocess.effects.size(), false);
+  for (auto [id, permutation] : selectPostEffects(stages, computeON, fusedON, mergedON)) {
+    auto& effect = postprocess.effects[id];
+    enabled[id] = true;
+    if (effect.compute == nullptr)
+      usePostPermutation(effect, permutation);
+  }
 
-  core->commands->changeImageLayout(
-      cmd,
-      geometry.data.images[swapchainImageIndex],
-      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  postprocess.first = UINT32_MAX;
+  postprocess.passes = 0;
+  for (uint32_t i = 0; i < postprocess.effects.size(); ++i) {
+    graph->setEnabled(postprocess.effects[i].node, enabled[i]);
+    if (!enabled[i])
+      continue;
+    postprocess.first = std::min(postprocess.first, i);
+    if (postBenchmark.step < 0 || i != postprocess.output)
+      postprocess.last = i;
+    postprocess.passes++;
+  }
+  interface.pass->statistics.postPasses = postprocess.passes;
+  interface.pass->statistics.merged = mergedON;
+
+  // Цвет сцены растягивается на цель вывода, история TAA уже в её размере
+  resolution.extents[frameIndex] = renderExtent;
+  auto colorExtent = graph->getExtent(targets.color);
+  glm::float2 colorScale = {
+      static_cast<float>(renderExtent.width) / colorExtent.width,
+      static_cast<float>(renderExtent.height) / colorExtent.height};
+  for (auto& effect : postprocess.effects) {
+    auto& instance = effect.getInstance();
+    instance.colorScale = effect.source == targets.color ? colorScale : glm::float2(1.0f);
+
+    // Фрагментные перестановки включают стадии сами, вычислительный эффект - по значениям
+    instance.exposure = tonemapON ? options.exposure : 0.0f;
+    instance.saturation = gradingON ? options.saturation : 1.0f;
+    instance.contrast = gradingON ? options.contrast : 1.0f;
+  }
 
-  if (!interface.pass->options.taaON)
-    postprocess.origin->record(swapchainImageIndex, cmd);
-  else
-    postprocess.TAA->record(swapchainImageIndex, cmd);
-  interface.pass->record(swapchainImageIndex, cmd);
+  // Фон бесконечно далеко - его прошлое положение задаёт только поворот камеры
+  glm::float4x4 rotation = camera->projectionMatrix * glm::float4x4(glm::float3x3(camera->viewMatrix));
+  glm::float4x4 reprojection = taa.previousRotation * glm::inverse(rotation);
+  taa.previousRotation = rotation;
+
+  // Копия истории прошлого кадра - результат TAA, только если прошлый кадр его выполнил
+  for (uint32_t id : {postprocess.TAA, postprocess.fused, postprocess.TAACompute}) {
+    auto& taaInstance = postprocess.effects[id].getInstance();
+    taaInstance.jitter = camera->jitter / glm::float2(renderExtent.width, renderExtent.height);
+    taaInstance.historyWeight = taa.valid ? taaHistoryWeight : 0.0f;
+    taaInstance.reprojection = reprojection;
+  }
+  taa.valid = taaON;
 
-  //=========================================================================
-  // Завершение буфера команд
+  // Сцена не ждёт получения изображения показа - его ждут только проходы, которые в него пишут
+  graph->execute(frameIndex, swapchainImageIndex, sceneCmd, cmd);
 
-  if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
-    throw std::runtime_error("ERROR: ailed to record command buffer!");
+  vkCmdWriteTimestamp(sceneCmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, frameQuery + 1);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, frameQuery + 5);
+  timestamps.frames[frameIndex] = true;
+  timestamps.posts[frameIndex] = true;
 
   //=========================================================================
-  // Синхронизация кадров
+  // Завершение буфера команд
 
-  if (targetFrame->showing != VK_NULL_HANDLE)
-    vkWaitForFences(core->device, 1, &targetFrame->showing, VK_TRUE, UINT64_MAX);
-  targetFrame->showing = currentFrame->drawing;
+  if (vkEndCommandBuffer(sceneCmd) != VK_SUCCESS || vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: ailed to record command buffer!");
 
   //=========================================================================
   // Установка команд рендера
 
-  VkSubmitInfo submitInfo{};
+  // Сцена - без ожидания изображения
+  std::array<VkSubmitInfo, 2> submitInfos{};
+  submitInfos[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfos[0].commandBufferCount = 1;
+  submitInfos[0].pCommandBuffers = &currentFrame->sceneCmdBuffer;
+
+  VkSubmitInfo& submitInfo = submitInfos[1];
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &targetFrame->cmdBuffer;
+  submitInfo.pCommandBuffers = &currentFrame->cmdBuffer;
 
   // Синхронизация изображения
   VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -374,10 +1324,10 @@ void Render::draw() {
   submitInfo.pWaitSemaphores = &currentFrame->imageAvailable;  // ДО: Ждем, пока не получим изображение
   submitInfo.pWaitDstStageMask = waitStages;
   submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = &currentFrame->imageRendered;  // ПОСЛЕ: Укажем, что команды рендера выставлены в очередь
+  submitInfo.pSignalSemaphores = &targetImage->imageRendered;  // ПОСЛЕ: Укажем, что команды рендера выставлены в очередь
 
   vkResetFences(core->device, 1, &currentFrame->drawing);
-  if (vkQueueSubmit(core->graphicsQueue, 1, &submitInfo, currentFrame->drawing) != VK_SUCCESS)
+  if (vkQueueSubmit(core->graphicsQueue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), currentFrame->drawing) != VK_SUCCESS)
     throw std::runtime_error("ERROR: Failed to submit draw command buffer!");
 
   //=========================================================================
@@ -386,7 +1336,7 @@ void Render::draw() {
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = &currentFrame->imageRendered;  // Ждем команды рендера
+  presentInfo.pWaitSemaphores = &targetImage->imageRendered;  // Ждем команды рендера
   presentInfo.swapchainCount = 1;
   presentInfo.pSwapchains = &core->swapchain.handler;
   presentInfo.pImageIndices = &swapchainImageIndex;
@@ -398,6 +1348,56 @@ void Render::draw() {
     throw std::runtime_error("ERROR: Failed to present swapchain image!");
   }
 
-  frames->currentFrameIndex += 1;
-  frames->currentFrameIndex %= core->swapchain.count;
+  frames->next();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Render::recordGeometry(uint32_t index, uint32_t image, VkCommandBuffer cmd, bool merged) {
+  auto drawMode = geometry.pass->drawMode;
+  bool occlusion = visibility.pass->uniform.occlusion;
+
+  // Рендер сцены между метками времени. Начало - после завершения предыдущей работы очереди:
+  // метка в начале конвейера записалась бы раньше, чем освободится GPU
+  vkCmdResetQueryPool(cmd, timestamps.pool, timestampsPerFrame * index, 2);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, timestampsPerFrame * index);
+
+  // Перерисовка замеряется для режимов с отсечением на CPU - порядок вызовов задаёт CPU
+  bool measureOverdraw = overdraw.pool != VK_NULL_HANDLE && drawMode != Geometry::DRAW_GPU;
+  if (measureOverdraw) {
+    vkCmdResetQueryPool(cmd, overdraw.pool, index, 1);
+    vkCmdBeginQuery(cmd, overdraw.pool, index, 0);
+  }
+
+  // Две фазы: видимые в прошлом кадре, Hi-Z по их глубине, затем ставшие видимыми
+  if (drawMode == Geometry::DRAW_GPU)
+    visibility.pass->record(index, cmd);
+  if (merged) {
+    // Постпроцессинг - второй подпроход, метки времени вокруг него внутри прохода рендера
+    auto& effect = postprocess.effects[postprocess.merged];
+    uint32_t query = timestampsPerFrame * index + 4;
+    geometry.pass->recordMerged(index, image, cmd, [this, &effect, index, query](VkCommandBuffer subpassCmd) {
+      vkCmdWriteTimestamp(subpassCmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, query);
+      effect.pass->recordSubpass(index, subpassCmd);
+      vkCmdWriteTimestamp(subpassCmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, query + 1);
+    });
+  } else {
+    geometry.pass->record(index, cmd);
+  }
+  if (occlusion) {
+    pyramid.pass->record(cmd);
+    visibility.pass->recordLate(index, cmd);
+    geometry.pass->recordLate(index, cmd);
+  }
+
+  if (measureOverdraw)
+    vkCmdEndQuery(cmd, overdraw.pool, index);
+  int32_t overdrawMode = geometry.pass->depthPrepass ? 2 : geometry.pass->sortDraws;
+  overdraw.modes[index] = measureOverdraw ? overdrawMode : -1;
+
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps.pool, timestampsPerFrame * index + 1);
+  if (drawMode != Geometry::DRAW_GPU)
+    timestamps.modes[index] = TIMESTAMP_CPU;
+  else
+    timestamps.modes[index] = occlusion ? TIMESTAMP_OCCLUSION : TIMESTAMP_GPU;
 }
@@ -6,13 +6,22 @@
 
 #include "shaders/shaders.h"
 #include "frames/frames.h"
+#include "graph/graph.h"
+#include "passes/compute/visibility.h"
+#include "passes/compute/pyramid.h"
+#include "passes/compute/postprocessing/effect.h"
 #include "passes/graphics/geometry.h"
+#include "passes/graphics/feedback.h"
 #include "passes/graphics/postprocessing/fullscreen.h"
 #include "passes/graphics/postprocessing/gui.h"
 
 // Стандартные библиотеки
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 class Render {
@@ -26,6 +35,7 @@ class Render {
 
   void reloadSwapchain();
   void reloadShaders();
+  void reloadFrames();  // Новое число кадров в работе - пересоздание всех ресурсов кадров
 
   GUI::Pass getInterface();
 
@@ -46,46 +56,291 @@ class Render {
   void initFrames();
   void destroyFrames();
 
+  // Задержка и пропускная способность - средние по числу кадров в работе (1, 2, 3)
+  struct {
+    std::chrono::high_resolution_clock::time_point last;  // Начало прошлого кадра
+    std::array<double, 3> frameTimes;
+    std::array<double, 3> latencies;
+  } pacing{};
+  void updatePacing(Frames::Instance);
+
+  //=========================================================================
+  // Граф рендера - порядок проходов, барьеры между ними и их цели вывода
+
+  Graph::Manager graph;
+
+  struct {
+    Graph::Resource color;          // Цвет сцены
+    Graph::Resource depth;          // Глубина сцены - источник пирамиды глубины
+    Graph::Resource velocity;       // Векторы движения сцены
+    Graph::Resource history;        // Накопленный результат TAA
+    Graph::Resource display;        // Результат вычислительного тонального отображения
+    Graph::Resource feedback;       // Запросы страниц виртуальных текстур
+    Graph::Resource feedbackDepth;  // Глубина прохода запросов
+    Graph::Resource swapchain;      // Изображения показа
+    Graph::Resource lists;          // Списки видимых форм - буферы прохода видимости
+  } targets;
+
+  void initGraph();  // Цели и проходы графа - до создания самих проходов
+  void destroyGraph();
+
+  //=========================================================================
+  // Проход видимости - отсечение форм и построение списка команд на GPU
+
+  struct {
+    Visibility::Pass pass;
+  } visibility;
+
+  void initVisibility();
+  void reinitVisibility();
+  void destroyVisibility();
+
   //=========================================================================
   // Проход геометрии - основной механизм отрисовки объектов
 
   struct {
     Geometry::Pass pass;
-
-    struct {
-      VkFormat format;
-      uint32_t width, height;
-      std::vector<VkImageView> views;
-      std::vector<VkImage> images;
-      std::vector<VkDeviceMemory> memory;
-    } data;
+    Graph::Node node;
+    Graph::Node merged;  // Сцена и постпроцессинг подпроходами одного прохода - цвет не покидает тайл
   } geometry;
 
   void initGeometry();
   void reinitGeometry();
   void destroyGeometry();
+  void recordGeometry(uint32_t index, uint32_t image, VkCommandBuffer, bool merged);  // Отсечение на GPU, сцена и Hi-Z с замерами
+
+  //=========================================================================
+  // Пирамида глубины - Hi-Z по глубине прохода геометрии для отсечения перекрытых форм
+
+  struct {
+    DepthPyramid::Pass pass;
+  } pyramid;
+
+  void initPyramid();
+  void reinitPyramid();
+  void destroyPyramid();
+
+  //=========================================================================
+  // Замеры времени GPU - метки времени вокруг рендера сцены, всего кадра и постпроцессинга
+
+  struct {
+    VkQueryPool pool;            // По паре меток на кадр: сцена, весь кадр, постпроцессинг
+    std::vector<int32_t> modes;  // Режим прошлого замера изображения, -1 - не было
+    std::vector<bool> frames;    // Метки всего кадра записаны
+    std::vector<bool> posts;     // Метки постпроцессинга записаны
+    uint32_t frame;              // Кадры с отсечением перекрытых форм - для выбора кадров без него
+    uint32_t pairs;              // Парные замеры соседних кадров с Hi-Z и без него
+    double lastOcclusion;        // Последний замер с Hi-Z, ещё без пары (мс), 0 - нет
+    double occlusionTime;        // Скользящее среднее парных замеров с Hi-Z (мс)
+    double plainTime;            // Скользящее среднее парных замеров без него (мс)
+  } timestamps;
+
+  static constexpr uint32_t occlusionPairInterval = 8;
+
+  enum TimestampMode {
+    TIMESTAMP_NONE = -1,
+    TIMESTAMP_CPU,        // Отсечение на CPU
+    TIMESTAMP_GPU,        // Отсечение на GPU без Hi-Z
+    TIMESTAMP_OCCLUSION,  // Отсечение на GPU с Hi-Z
+  };
+
+  // Пары меток кадра в работе: сцена, буфер без ожидания изображения, постпроцессинг,
+  // буфер после получения изображения
+  static constexpr uint32_t timestampsPerFrame = 8;
+
+  void initTimestamps();
+  void destroyTimestamps();
+  double readTimestamps(uint32_t index);  // Время прошлого замера изображения (мс), -1 - нет данных
+  double readFrameTime(uint32_t index);   // Время GPU на прошлый кадр без ожидания изображения (мс), -1 - нет данных
+  double readPostTime(uint32_t index);    // Время GPU на постпроцессинг прошлого кадра (мс), -1 - нет данных
+  double readQueries(uint32_t first);     // Разность пары меток (мс), -1 - результат не готов
+
+  //=========================================================================
+  // Динамическое разрешение: цели вывода создаются в размере цепочки показа,
+  // сцена рисуется в их часть, доля которой подбирается по времени кадра на GPU.
+  // Изменение доли не пересоздаёт изображения - меняются только область вывода и выборка
+
+  struct {
+    float scale = 1.0f;
+    double gpuTime = 0.0;             // Скользящее среднее времени кадра на GPU (мс)
+    std::vector<VkExtent2D> extents;  // Размер сцены в копии цвета каждого кадра в работе
+  } resolution;
+
+  static constexpr float minResolutionScale = 0.5f;
+
+  void updateResolution(double frameTime);  // Новая доля по времени прошлого кадра
+
+  //=========================================================================
+  // Перерисовка - вызовы фрагментного шейдера прохода геометрии на пиксель
+
+  struct {
+    VkQueryPool pool;            // VK_NULL_HANDLE - устройство не поддерживает статистику конвейера
+    std::vector<int32_t> modes;  // Порядок вызовов прошлого замера изображения, -1 - не было
+    std::array<double, 3> averages;  // Скользящие средние без сортировки, с ней и с проходом глубины
+  } overdraw;
+
+  void initOverdraw();
+  void destroyOverdraw();
+  double readOverdraw(uint32_t index);  // Перерисовка прошлого замера изображения, -1 - нет данных
+
+  //=========================================================================
+  // Замер прохода глубины - по шагу на каждую стоимость фрагментного шейдера
+  // без прохода глубины и с ним, кадры шага записываются с его настройками
+
+  struct {
+    int32_t step = -1;           // Чётный - без прохода глубины, нечётный - с ним, -1 - замер не идёт
+    uint32_t frames;             // Кадров, записанных на текущем шаге
+    std::vector<int32_t> steps;  // Шаг, с которым записан кадр в работе, -1 - вне замера
+    std::vector<uint32_t> timeSamples;
+    std::vector<uint32_t> overdrawSamples;
+    std::vector<Geometry::prepass_benchmark_t> results;
+  } prepassBenchmark;
+
+  static constexpr uint32_t prepassWarmupFrames = 8;    // Пропускаются после смены режима
+  static constexpr uint32_t prepassMeasureFrames = 64;  // Усредняются
 
-  void createGeometryData();
-  void destroyGeometryData();
+  void beginPrepassBenchmark();
+  void updatePrepassBenchmark(uint32_t index, double sceneTime, double overdraw);
+
+  //=========================================================================
+  // Проход обратной связи - запросы страниц виртуальных текстур
+
+  struct {
+    Feedback::Pass pass;
+    Graph::Node node;
+  } feedback;
+
+  void initFeedback();
+  void reinitFeedback();
+  void destroyFeedback();
 
   //=========================================================================
   // Постпроцессинг - улучшение изображения, добавление эффектов
 
+  // Стадии цепочки - определения препроцессора перестановки shaders/post.hlsl, в порядке выполнения
+  enum PostStage {
+    POST_TAA,      // Temporal Anti-Aliasing - сцена и история -> новая история
+    POST_TONEMAP,  // Tone Mapping
+    POST_GRADING,  // Цветокоррекция
+    POST_DITHER,   // Шум перед 8-битным выводом
+    POST_STAGE_COUNT,
+  };
+
+  struct post_stage_t {
+    const char* define;
+    bool neighborhood;  // Читает соседей входа - вход должен быть уже записан
+    bool stored;        // Результат стадии нужен следующему кадру
+  };
+  static const std::array<post_stage_t, POST_STAGE_COUNT> postStages;
+
+  // Включённые стадии (маска) -> маски проходов. Стадии собираются в один проход, пока
+  // ни одна не читает соседей результата прошлой; fuse = false - проход на каждую сохраняемую
+  static std::vector<uint32_t> compilePostChain(uint32_t stages, bool fuse);
+
+  // Эффекты графа для стадий и режима вывода - пары (эффект, маска стадий его перестановки)
+  std::vector<std::pair<uint32_t, uint32_t>> selectPostEffects(uint32_t stages, bool compute, bool fuse, bool merged);
+
+  // Эффект - фрагментная или вычислительная версия с одинаковыми входами и константами
+  struct effect_t {
+    Fullscreen::Pass pass = nullptr;        // Текущая перестановка
+    ComputeEffect::Pass compute = nullptr;  // Пишет в изображение-хранилище - не в список показа
+    Graph::Node node;
+    Graph::Resource source;                // binding 0
+    std::vector<Graph::Resource> inputs;   // binding 2, 3, ...
+    std::vector<Graph::Resource> outputs;  // Цель вывода и дополнительные (SV_TARGET1, ...)
+
+    // Перестановки фрагментной версии по маске стадий - создаются при первом выборе
+    std::string shader;
+    VkSampler sampler;
+    std::unordered_map<uint32_t, Fullscreen::Pass> permutations;
+    bool subpass = false;  // Подпроход слитого прохода геометрии - сцена как input attachment
+
+    Fullscreen::instance_t& getInstance() { return pass != nullptr ? pass->instance : compute->instance; }
+  };
+
   struct {
-    Fullscreen::Pass origin;  // Перевод в список показа
-    Fullscreen::Pass TAA;     // Temporal Anti-Aliasing
-    Fullscreen::Pass TM;      // Tone Maping
+    std::vector<effect_t> effects;  // В порядке выполнения
+    uint32_t origin;                // Сцена без TAA -> список показа (перестановка стадий)
+    uint32_t TAA;                   // TAA отдельным проходом - сцена и история -> новая история
+    uint32_t present;               // История TAA -> список показа (перестановка стадий после TAA)
+    uint32_t fused;                 // Вся цепочка одним проходом - список показа и новая история
+    uint32_t TAACompute;            // TAA вычислительным шейдером
+    uint32_t TM;                    // Tone Mapping и цветокоррекция вычислительным шейдером - история -> display
+    uint32_t output;                // Перевод display в список показа (перестановка стадий)
+    uint32_t merged;                // Подпроход после сцены -> список показа (перестановка стадий без соседей)
+    uint32_t passes = 0;            // Выполняемых эффектов в последнем кадре
+
+    // Метки времени пишут первый и последний выполняемые эффекты
+    uint32_t first = UINT32_MAX;
+    uint32_t last = UINT32_MAX;
   } postprocess;
 
+  // TAA: копия истории прошлого кадра действительна, только если он записал её с теми же изображениями
+  struct {
+    bool valid = false;
+    uint32_t frame = 0;  // Номер точки дрожания
+    glm::float4x4 previousRotation = glm::float4x4(1.0f);  // Проекция поворота камеры прошлого кадра - смещение фона
+  } taa;
+
+  static constexpr float taaHistoryWeight = 0.9f;
+
+  // Эффект читает source и inputs, пишет в outputs - достаточно добавить его в граф
+  uint32_t addPostProcess(const std::string& name, const std::string& shader,
+                          Graph::Resource source, const std::vector<Graph::Resource>& outputs,
+                          const std::vector<Graph::Resource>& inputs = {}, bool compute = false);
+
+  // Изображения графа - в поля эффекта, одинаковые у обеих версий
+  template <typename T>
+  void bindPostProcess(T pass, const effect_t& effect) {
+    auto extent = graph->getExtent(effect.outputs[0]);
+    pass->colorImageViews = graph->getViews(effect.source);
+    pass->inputImageViews.clear();
+    for (auto input : effect.inputs)
+      pass->inputImageViews.push_back(graph->getViews(input));
+    pass->target.width = extent.width;
+    pass->target.height = extent.height;
+    pass->target.views = graph->getViews(effect.outputs[0]);
+
+    // Дополнительные цели пишет только фрагментная версия
+    if constexpr (std::is_same_v<T, Fullscreen::Pass>) {
+      pass->outputs.clear();
+      for (uint32_t i = 1; i < effect.outputs.size(); ++i)
+        pass->outputs.push_back({graph->getFormat(effect.outputs[i]), graph->getViews(effect.outputs[i])});
+      if (effect.subpass)
+        pass->subpass = {geometry.pass->getMergedPass(), 1};
+    }
+  }
+
+  // Перестановка фрагментной версии эффекта становится текущей, 0 - без стадий
+  void usePostPermutation(effect_t&, uint32_t stages);
+
   void initPostProcess();
-  void reinitPostProcess();
+  void reinitPostProcess(effect_t&);
   void destroyPostProcess();
 
+  //=========================================================================
+  // Замер постпроцессинга - все стадии, кроме дрожания цвета, фрагментными шейдерами отдельными
+  // проходами и собранной цепочкой, затем вычислительными с каждым допустимым размером группы
+  struct {
+    int32_t step = -1;           // 0 - отдельные проходы, 1 - собранная цепочка, n - вычислительные с размером группы n - 2, -1 - замер не идёт
+    uint32_t frames;             // Кадров, записанных на текущем шаге
+    std::vector<int32_t> steps;  // Шаг, с которым записан кадр в работе, -1 - вне замера
+    std::vector<uint32_t> samples;
+    std::vector<ComputeEffect::benchmark_t> results;
+  } postBenchmark;
+
+  static constexpr uint32_t postWarmupFrames = 8;    // Пропускаются после смены режима
+  static constexpr uint32_t postMeasureFrames = 64;  // Усредняются
+
+  void beginPostBenchmark();
+  void updatePostBenchmark(uint32_t index, double postTime);
+
   //=========================================================================
   // Проход интерфейса - отрисовка меню управления
 
   struct {
     GUI::Pass pass;
+    Graph::Node node;
   } interface;
 
   void initInterface();
@@ -20,6 +20,8 @@ void Shaders::compileShader(Instance shader) {
   int targetIndex = spAddCodeGenTarget(slangRequest, SLANG_SPIRV);
   SlangProfileID profileID = spFindProfile(slangSession, "sm_6_3");
   spSetTargetProfile(slangRequest, targetIndex, profileID);
+  for (auto& define : shader->defines)
+    spAddPreprocessorDefine(slangRequest, define.first.c_str(), define.second.c_str());
   int translationUnitIndex = spAddTranslationUnit(slangRequest, SLANG_SOURCE_LANGUAGE_SLANG, nullptr);
   spAddTranslationUnitSourceFile(slangRequest, translationUnitIndex, shader->name.c_str());
   int entryPointIndex = spAddEntryPoint(slangRequest, translationUnitIndex, shader->entryPoint.c_str(), shader->stage);
@@ -55,9 +57,17 @@ void Shaders::compileShader(Instance shader) {
     throw std::runtime_error("ERROR: Failed to create shader module!");
 }
 
-Shaders::Instance Shaders::loadShader(const std::string& name, const std::string& entryPoint, SlangStage stage) {
-  // Найдем уже загруженный шейдер
-  auto el = idList.find(name + entryPoint);
+std::string Shaders::getKey(const std::string& name, const std::string& entryPoint, const Defines& defines) {
+  std::string key = name + entryPoint;
+  for (auto& define : defines)
+    key += ";" + define.first + "=" + define.second;
+  return key;
+}
+
+Shaders::Instance Shaders::loadShader(const std::string& name, const std::string& entryPoint, SlangStage stage, const Defines& defines) {
+  // Найдем уже загруженный шейдер - перестановки загружаются отдельно
+  std::string key = getKey(name, entryPoint, defines);
+  auto el = idList.find(key);
   if (el != idList.end()) {
     // Перезагрузка шейдера
     compileShader(handlers[el->second]);
@@ -68,12 +78,13 @@ Shaders::Instance Shaders::loadShader(const std::string& name, const std::string
   Instance shader = new shader_t;
   shader->name = name;
   shader->entryPoint = entryPoint;
+  shader->defines = defines;
   shader->stage = stage;
   compileShader(shader);
 
   // Сохраним новый шейдер
   uint32_t id = static_cast<uint32_t>(handlers.size());
-  idList.insert(std::make_pair(name + entryPoint, id));
+  idList.insert(std::make_pair(key, id));
   handlers.push_back(shader);
 
   return shader;
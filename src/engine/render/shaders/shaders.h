@@ -21,9 +21,13 @@ class Shaders {
   typedef Shaders* Manager;
   Core::Manager core;
 
+  // Определения препроцессора - перестановка шейдера
+  typedef std::vector<std::pair<std::string, std::string>> Defines;
+
   typedef struct shader_t {
     std::string name;
     std::string entryPoint;
+    Defines defines;
 
     SlangStage stage;
     std::vector<char> code;
@@ -40,11 +44,12 @@ class Shaders {
   ~Shaders();
   void reload();
 
-  Instance loadShader(const std::string& name, const std::string& entryPoint, SlangStage);
+  Instance loadShader(const std::string& name, const std::string& entryPoint, SlangStage, const Defines& = {});
   void reloadShader(const std::string& name, const std::string& entryPoint);
   void destroyShader(const std::string& name, const std::string& entryPoint);
 
  private:
   void compileShader(Instance);
+  static std::string getKey(const std::string& name, const std::string& entryPoint, const Defines&);
   void destroyShader(Instance);
 };
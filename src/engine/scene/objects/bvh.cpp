@@ -0,0 +1,471 @@
+#include "bvh.h"
+
+// Стандартные библиотеки
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BVH::build(const std::vector<box_t>& boxes) {
+  nodes.clear();
+  itemBoxes = boxes;
+  items.resize(boxes.size());
+  for (uint32_t i = 0; i < items.size(); ++i)
+    items[i] = i;
+
+  builtCost = 0.0f;
+  if (boxes.empty())
+    return;
+
+  std::vector<glm::float3> centers(boxes.size());
+  for (uint32_t i = 0; i < boxes.size(); ++i)
+    centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+
+  // Узлов не больше 2N - 1, ссылки на них не инвалидируются
+  nodes.reserve(boxes.size() * 2);
+  nodes.push_back({empty(), 0, static_cast<uint32_t>(boxes.size())});
+
+  std::vector<uint32_t> stack = {0};
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    subdivide(node, boxes, centers);
+    if (nodes[node].count == 0) {
+      stack.push_back(nodes[node].first);
+      stack.push_back(nodes[node].first + 1);
+    }
+  }
+
+  builtCost = cost();
+}
+
+void BVH::subdivide(uint32_t index, const std::vector<box_t>& boxes, const std::vector<glm::float3>& centers) {
+  node_t& node = nodes[index];
+
+  // Объём узла и границы центров его элементов
+  node.box = empty();
+  box_t centerBounds = empty();
+  for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+    node.box = merge(node.box, boxes[items[i]]);
+    centerBounds = merge(centerBounds, {centers[items[i]], centers[items[i]]});
+  }
+  if (node.count <= 1)
+    return;
+
+  // Поиск лучшего разбиения по корзинам вдоль каждой оси
+  struct bin_t {
+    box_t box;
+    uint32_t count;
+  };
+
+  float leafCost = area(node.box) * node.count;
+  float bestCost = FLT_MAX;
+  int bestAxis = -1;
+  uint32_t bestSplit = 0;
+
+  for (int axis = 0; axis < 3; ++axis) {
+    float extent = centerBounds.max[axis] - centerBounds.min[axis];
+    if (extent <= 0.0f)
+      continue;
+
+    std::array<bin_t, binsCount> bins;
+    bins.fill({empty(), 0});
+    float scale = binsCount / extent;
+    for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+      uint32_t bin = std::min(binsCount - 1, static_cast<uint32_t>((centers[items[i]][axis] - centerBounds.min[axis]) * scale));
+      bins[bin].box = merge(bins[bin].box, boxes[items[i]]);
+      bins[bin].count++;
+    }
+
+    // Площади и количества слева и справа от каждой границы
+    std::array<float, binsCount - 1> leftArea, rightArea;
+    std::array<uint32_t, binsCount - 1> leftCount, rightCount;
+    box_t left = empty(), right = empty();
+    uint32_t leftSum = 0, rightSum = 0;
+    for (uint32_t i = 0; i < binsCount - 1; ++i) {
+      leftSum += bins[i].count;
+      leftCount[i] = leftSum;
+      left = merge(left, bins[i].box);
+      leftArea[i] = leftSum > 0 ? area(left) : 0.0f;
+
+      rightSum += bins[binsCount - 1 - i].count;
+      rightCount[binsCount - 2 - i] = rightSum;
+      right = merge(right, bins[binsCount - 1 - i].box);
+      rightArea[binsCount - 2 - i] = rightSum > 0 ? area(right) : 0.0f;
+    }
+
+    for (uint32_t i = 0; i < binsCount - 1; ++i) {
+      if (leftCount[i] == 0 || rightCount[i] == 0)
+        continue;
+      float splitCost = leftArea[i] * leftCount[i] + rightArea[i] * rightCount[i];
+      if (splitCost < bestCost) {
+        bestCost = splitCost;
+        bestAxis = axis;
+        bestSplit = i;
+      }
+    }
+  }
+
+  // Лист, если разбиение не выгодно или невозможно (все центры совпадают)
+  if (bestAxis < 0 || (bestCost >= leafCost && node.count <= maxLeafSize))
+    return;
+
+  // Разделение элементов узла на месте
+  float scale = binsCount / (centerBounds.max[bestAxis] - centerBounds.min[bestAxis]);
+  auto middle = std::partition(items.begin() + node.first, items.begin() + node.first + node.count, [&](uint32_t item) {
+    uint32_t bin = std::min(binsCount - 1, static_cast<uint32_t>((centers[item][bestAxis] - centerBounds.min[bestAxis]) * scale));
+    return bin <= bestSplit;
+  });
+  uint32_t leftCount = static_cast<uint32_t>(middle - items.begin()) - node.first;
+
+  uint32_t first = node.first;
+  uint32_t count = node.count;
+  uint32_t child = static_cast<uint32_t>(nodes.size());
+  node.first = child;
+  node.count = 0;
+  nodes.push_back({empty(), first, leftCount});
+  nodes.push_back({empty(), first + leftCount, count - leftCount});
+}
+
+bool BVH::refit(const std::vector<box_t>& boxes) {
+  if (nodes.empty() || boxes.size() != items.size()) {
+    build(boxes);
+    return true;
+  }
+
+  itemBoxes = boxes;
+
+  // Потомки всегда расположены после родителя - обход с конца
+  for (uint32_t i = static_cast<uint32_t>(nodes.size()); i-- > 0;) {
+    node_t& node = nodes[i];
+    if (node.count > 0) {
+      node.box = empty();
+      for (uint32_t j = node.first; j < node.first + node.count; ++j)
+        node.box = merge(node.box, boxes[items[j]]);
+    } else {
+      node.box = merge(nodes[node.first].box, nodes[node.first + 1].box);
+    }
+  }
+
+  // Разъехавшиеся элементы раздувают узлы - тогда дешевле построить заново
+  if (cost() > builtCost * rebuildRatio) {
+    build(boxes);
+    return true;
+  }
+  return false;
+}
+
+float BVH::cost() {
+  // Сумма площадей узлов, взвешенная числом элементов в листьях, относительно корня
+  float rootArea = area(nodes[0].box);
+  if (rootArea <= 0.0f)
+    return 0.0f;
+
+  float sum = 0.0f;
+  for (auto& node : nodes)
+    sum += area(node.box) * (node.count > 0 ? node.count : 1);
+  return sum / rootArea;
+}
+
+bool BVH::isEmpty() {
+  return nodes.empty();
+}
+
+uint32_t BVH::getNodeCount() {
+  return static_cast<uint32_t>(nodes.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BVH::cull(const frustum_t& planes, std::vector<uint32_t>& result) {
+  if (nodes.empty())
+    return;
+
+  // Маска плоскостей, которые ещё пересекают объём узла
+  struct entry_t {
+    uint32_t node;
+    uint32_t mask;
+  };
+  std::vector<entry_t> stack = {{0, (1u << planes.size()) - 1}};
+
+  while (!stack.empty()) {
+    entry_t entry = stack.back();
+    stack.pop_back();
+    const node_t& node = nodes[entry.node];
+    if (!visible(node.box, planes, entry.mask))
+      continue;
+
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        uint32_t mask = entry.mask;
+        if (mask == 0 || visible(itemBoxes[items[i]], planes, mask))
+          result.push_back(items[i]);
+      }
+    } else {
+      stack.push_back({node.first, entry.mask});
+      stack.push_back({node.first + 1, entry.mask});
+    }
+  }
+}
+
+BVH::hit_t BVH::raycast(glm::float3 origin, glm::float3 direction, float maxDistance) {
+  hit_t hit;
+  hit.distance = maxDistance;
+  if (nodes.empty())
+    return hit;
+
+  glm::float3 inverse = 1.0f / direction;
+  float distance;
+  if (!intersect(nodes[0].box, origin, inverse, hit.distance, distance))
+    return hit;
+
+  std::vector<uint32_t> stack = {0};
+  std::vector<float> distances = {distance};
+  while (!stack.empty()) {
+    uint32_t index = stack.back();
+    float entry = distances.back();
+    stack.pop_back();
+    distances.pop_back();
+
+    // Узел дальше уже найденного пересечения
+    if (entry > hit.distance)
+      continue;
+
+    const node_t& node = nodes[index];
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        if (intersect(itemBoxes[items[i]], origin, inverse, hit.distance, distance) && distance < hit.distance) {
+          hit.item = items[i];
+          hit.distance = distance;
+        }
+      }
+      continue;
+    }
+
+    // Ближний потомок обходится первым
+    float left, right;
+    bool hitLeft = intersect(nodes[node.first].box, origin, inverse, hit.distance, left);
+    bool hitRight = intersect(nodes[node.first + 1].box, origin, inverse, hit.distance, right);
+    if (hitLeft && hitRight) {
+      bool leftFirst = left <= right;
+      stack.push_back(leftFirst ? node.first + 1 : node.first);
+      distances.push_back(leftFirst ? right : left);
+      stack.push_back(leftFirst ? node.first : node.first + 1);
+      distances.push_back(leftFirst ? left : right);
+    } else if (hitLeft) {
+      stack.push_back(node.first);
+      distances.push_back(left);
+    } else if (hitRight) {
+      stack.push_back(node.first + 1);
+      distances.push_back(right);
+    }
+  }
+  return hit;
+}
+
+void BVH::overlapSphere(glm::float3 center, float radius, std::vector<uint32_t>& result) {
+  if (nodes.empty())
+    return;
+
+  // Расстояние от центра до ближайшей точки AABB
+  auto overlapsSphere = [center, radius](const box_t& box) {
+    glm::float3 closest = glm::clamp(center, box.min, box.max);
+    glm::float3 offset = closest - center;
+    return glm::dot(offset, offset) <= radius * radius;
+  };
+
+  std::vector<uint32_t> stack = {0};
+  while (!stack.empty()) {
+    const node_t& node = nodes[stack.back()];
+    stack.pop_back();
+    if (!overlapsSphere(node.box))
+      continue;
+
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        if (overlapsSphere(itemBoxes[items[i]]))
+          result.push_back(items[i]);
+    } else {
+      stack.push_back(node.first);
+      stack.push_back(node.first + 1);
+    }
+  }
+}
+
+void BVH::overlapBox(const box_t& box, std::vector<uint32_t>& result) {
+  if (nodes.empty())
+    return;
+
+  std::vector<uint32_t> stack = {0};
+  while (!stack.empty()) {
+    const node_t& node = nodes[stack.back()];
+    stack.pop_back();
+    if (!overlaps(node.box, box))
+      continue;
+
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        if (overlaps(itemBoxes[items[i]], box))
+          result.push_back(items[i]);
+    } else {
+      stack.push_back(node.first);
+      stack.push_back(node.first + 1);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BVH::box_t BVH::empty() {
+  return {glm::float3(FLT_MAX), glm::float3(-FLT_MAX)};
+}
+
+BVH::box_t BVH::merge(const box_t& a, const box_t& b) {
+  return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+float BVH::area(const box_t& box) {
+  glm::float3 size = glm::max(box.max - box.min, glm::float3(0.0f));
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool BVH::overlaps(const box_t& a, const box_t& b) {
+  return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+}
+
+bool BVH::visible(const box_t& box, const frustum_t& planes, uint32_t& mask) {
+  for (uint32_t i = 0; i < planes.size(); ++i) {
+    if (!(mask & (1u << i)))
+      continue;
+    const glm::float4& plane = planes[i];
+    glm::float3 normal = glm::float3(plane);
+
+    // Самая дальняя вдоль нормали вершина за плоскостью - объём снаружи,
+    // ближайшая перед плоскостью - объём целиком по внутреннюю сторону
+    glm::bvec3 positive = glm::greaterThan(normal, glm::float3(0.0f));
+    glm::float3 farthest = glm::mix(box.min, box.max, positive);
+    glm::float3 nearest = glm::mix(box.max, box.min, positive);
+    if (glm::dot(normal, farthest) + plane.w < 0.0f)
+      return false;
+    if (glm::dot(normal, nearest) + plane.w >= 0.0f)
+      mask &= ~(1u << i);
+  }
+  return true;
+}
+
+bool BVH::intersect(const box_t& box, glm::float3 origin, glm::float3 inverse, float maxDistance, float& distance) {
+  // Метод плит
+  glm::float3 t0 = (box.min - origin) * inverse;
+  glm::float3 t1 = (box.max - origin) * inverse;
+  float near = glm::compMax(glm::min(t0, t1));
+  float far = glm::compMin(glm::max(t0, t1));
+  distance = std::max(near, 0.0f);
+  return near <= far && far >= 0.0f && distance <= maxDistance;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BVH::benchmark_t BVH::benchmark(uint32_t count) {
+  std::mt19937 random(count);
+  std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> size(0.5f, 5.0f);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  // Случайный город: элементы разбросаны по кубу со стороной 1000
+  std::vector<box_t> boxes(count);
+  for (auto& box : boxes) {
+    glm::float3 center = {position(random), position(random), position(random)};
+    glm::float3 extent = {size(random), size(random), size(random)};
+    box = {center - extent, center + extent};
+  }
+
+  benchmark_t result{};
+  result.count = count;
+  BVH bvh;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  bvh.build(boxes);
+  auto end = std::chrono::high_resolution_clock::now();
+  result.buildTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+  // Смещение каждого десятого элемента
+  for (uint32_t i = 0; i < count; i += 10) {
+    glm::float3 shift = glm::float3(unit(random), unit(random), unit(random)) * 10.0f;
+    boxes[i].min += shift;
+    boxes[i].max += shift;
+  }
+  start = std::chrono::high_resolution_clock::now();
+  bvh.refit(boxes);
+  end = std::chrono::high_resolution_clock::now();
+  result.refitTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+  // Пирамиды камер, смотрящих из центра в разные стороны
+  const uint32_t frustumsCount = 64;
+  std::vector<frustum_t> frustums(frustumsCount);
+  glm::float4x4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 256.0f);
+  for (auto& frustum : frustums) {
+    glm::float3 direction = glm::normalize(glm::float3(unit(random), unit(random) * 0.2f, unit(random)) + glm::float3(0.0f, 0.0f, 1e-3f));
+    glm::float3 eye = {position(random) * 0.5f, 0.0f, position(random) * 0.5f};
+    glm::float4x4 viewProjection = projection * glm::lookAt(eye, eye + direction, glm::float3(0.0f, 1.0f, 0.0f));
+    glm::float4 rows[4];
+    for (int i = 0; i < 4; ++i)
+      rows[i] = glm::float4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    frustum = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+               rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]};
+  }
+
+  std::vector<uint32_t> visibleItems;
+  visibleItems.reserve(count);
+  size_t hierarchicalVisible = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto& frustum : frustums) {
+    visibleItems.clear();
+    bvh.cull(frustum, visibleItems);
+    hierarchicalVisible += visibleItems.size();
+  }
+  end = std::chrono::high_resolution_clock::now();
+  result.cullTime = std::chrono::duration<double, std::milli>(end - start).count() / frustumsCount;
+
+  size_t linearVisible = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto& frustum : frustums) {
+    visibleItems.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t mask = (1u << frustum.size()) - 1;
+      if (visible(boxes[i], frustum, mask))
+        visibleItems.push_back(i);
+    }
+    linearVisible += visibleItems.size();
+  }
+  end = std::chrono::high_resolution_clock::now();
+  result.linearCullTime = std::chrono::duration<double, std::milli>(end - start).count() / frustumsCount;
+
+  if (hierarchicalVisible != linearVisible)
+    throw std::runtime_error("ERROR: BVH culling result differs from linear culling!");
+
+  // Лучи из случайных точек в случайных направлениях
+  const uint32_t raysCount = 100000;
+  start = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < raysCount; ++i) {
+    glm::float3 origin = {position(random), position(random), position(random)};
+    glm::float3 direction = glm::normalize(glm::float3(unit(random), unit(random), unit(random)) + glm::float3(1e-3f));
+    bvh.raycast(origin, direction);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  result.raysPerSecond = raysCount / std::chrono::duration<double>(end - start).count();
+
+  const uint32_t overlapsCount = 100000;
+  std::vector<uint32_t> overlapped;
+  start = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < overlapsCount; ++i) {
+    overlapped.clear();
+    bvh.overlapSphere({position(random), position(random), position(random)}, 20.0f, overlapped);
+  }
+  end = std::chrono::high_resolution_clock::now();
+  result.overlapsPerSecond = overlapsCount / std::chrono::duration<double>(end - start).count();
+
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,107 @@
+#pragma once
+
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+#include <glm/gtx/component_wise.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Стандартные библиотеки
+#include <array>
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+// Иерархия ограничивающих объёмов (BVH) над AABB элементов сцены
+// Строится по эвристике площади поверхности (SAH) с разбиением по корзинам.
+// При движении элементов объёмы узлов уточняются снизу вверх (refit),
+// а при заметном ухудшении качества дерево перестраивается целиком
+class BVH {
+ public:
+  typedef BVH* Manager;
+
+  static constexpr uint32_t none = UINT32_MAX;
+
+  BVH() = default;
+  ~BVH() = default;
+
+  struct box_t {
+    glm::float3 min;
+    glm::float3 max;
+  };
+
+  // Плоскости пирамиды видимости (ax + by + cz + d >= 0 - внутри)
+  typedef std::array<glm::float4, 6> frustum_t;
+
+  struct hit_t {
+    uint32_t item = none;
+    float distance = FLT_MAX;
+  };
+
+  // Индексы элементов совпадают с индексами в массиве boxes
+  void build(const std::vector<box_t>& boxes);
+
+  // Пересчёт объёмов узлов без изменения топологии
+  // Возвращает true, если дерево пришлось перестроить
+  bool refit(const std::vector<box_t>& boxes);
+
+  bool isEmpty();
+  uint32_t getNodeCount();
+
+  //=========================================================================
+  // Запросы
+
+  // Поддеревья целиком внутри пирамиды добавляются без проверок
+  void cull(const frustum_t&, std::vector<uint32_t>& result);
+
+  // Ближайшее пересечение луча с AABB элементов
+  hit_t raycast(glm::float3 origin, glm::float3 direction, float maxDistance = FLT_MAX);
+
+  void overlapSphere(glm::float3 center, float radius, std::vector<uint32_t>& result);
+  void overlapBox(const box_t&, std::vector<uint32_t>& result);
+
+  // Сравнение с линейным перебором элементов
+  struct benchmark_t {
+    uint32_t count;
+    double buildTime;          // Построение (мс)
+    double refitTime;          // Уточнение после смещения 10% элементов (мс)
+    double cullTime;           // Иерархическое отсечение (мс на пирамиду)
+    double linearCullTime;     // Перебор всех элементов (мс на пирамиду)
+    double raysPerSecond;      // Лучей в секунду
+    double overlapsPerSecond;  // Запросов пересечения со сферой в секунду
+  };
+  static benchmark_t benchmark(uint32_t count);
+
+ private:
+  // Лист: count > 0, элементы items[first, first + count)
+  // Внутренний узел: count = 0, потомки nodes[first] и nodes[first + 1]
+  struct node_t {
+    box_t box;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  std::vector<node_t> nodes;
+  std::vector<uint32_t> items;      // Индексы элементов, упорядоченные по листьям
+  std::vector<box_t> itemBoxes;
+
+  // Стоимость дерева после построения - для оценки деградации
+  float builtCost = 0.0f;
+
+  static constexpr uint32_t binsCount = 12;
+  static constexpr uint32_t maxLeafSize = 8;
+  static constexpr float rebuildRatio = 1.5f;
+
+  void subdivide(uint32_t node, const std::vector<box_t>& boxes, const std::vector<glm::float3>& centers);
+  float cost();
+
+  static box_t empty();
+  static box_t merge(const box_t&, const box_t&);
+  static float area(const box_t&);
+  static bool overlaps(const box_t&, const box_t&);
+
+  // Снимает с маски плоскости, по внутреннюю сторону которых объём лежит целиком
+  static bool visible(const box_t&, const frustum_t&, uint32_t& mask);
+  static bool intersect(const box_t&, glm::float3 origin, glm::float3 inverse, float maxDistance, float& distance);
+};
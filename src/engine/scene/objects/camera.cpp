@@ -1,5 +1,8 @@
 #include "camera.h"
 
+// Стандартные библиотеки
+#include <algorithm>
+
 void Camera::update(float deltaTime) {
   updatePosition(deltaTime);
   updateDirections();
@@ -21,6 +24,25 @@ void Camera::updateProjection() {
       projection.far);
 }
 
+void Camera::updateJitter(uint32_t frame, uint32_t width, uint32_t height) {
+  jitter = glm::float2(0.0f);
+  if (width > 0 && height > 0) {
+    // Последовательность Халтона - равномерное покрытие пикселя за jitterSamples кадров
+    auto halton = [](uint32_t index, uint32_t base) {
+      float result = 0.0f;
+      for (float fraction = 1.0f / base; index > 0; index /= base, fraction /= base)
+        result += fraction * (index % base);
+      return result;
+    };
+    uint32_t index = frame % jitterSamples + 1;
+    jitter = glm::float2(halton(index, 2), halton(index, 3)) - 0.5f;
+  }
+
+  // Сдвиг после перспективного деления; ось Y области вывода направлена вниз
+  glm::float2 offset = 2.0f * jitter / glm::float2(std::max(width, 1u), std::max(height, 1u));
+  jitteredProjectionMatrix = glm::translate(glm::float4x4(1.0f), glm::float3(offset.x, -offset.y, 0.0f)) * projectionMatrix;
+}
+
 void Camera::updateProjection(Projection& projection) {
   this->projection.fov = projection.fov;
   this->projection.aspect = projection.aspect;
@@ -57,6 +79,19 @@ void Camera::updateRotation(double xpos, double ypos) {
   updateView();
 }
 
+void Camera::getRay(glm::double2 cursor, uint32_t width, uint32_t height, glm::float3& origin, glm::float3& direction) {
+  // Область вывода перевёрнута по вертикали - ось Y экрана направлена вниз
+  glm::float4 target = {
+      2.0f * static_cast<float>(cursor.x) / width - 1.0f,
+      1.0f - 2.0f * static_cast<float>(cursor.y) / height,
+      1.0f,  // Дальняя плоскость
+      1.0f};
+  target = glm::inverse(projectionMatrix * viewMatrix) * target;
+
+  origin = transform.position;
+  direction = glm::normalize(glm::float3(target) / target.w - origin);
+}
+
 void Camera::updateDirections() {
   // Обновим векторы направления движения (вектор вверх всегда константен)
   glm::float3 front;
@@ -24,7 +24,14 @@ class Camera : public Object {
   } projection;
 
   glm::float4x4 viewMatrix;
-  glm::float4x4 projectionMatrix;
+  glm::float4x4 projectionMatrix;  // Без дрожания - отсечение, лучи, векторы движения
+
+  // Субпиксельное дрожание проекции для TAA: каждый кадр сцена сдвигается
+  // на точку последовательности Халтона (2, 3) внутри пикселя
+  static constexpr uint32_t jitterSamples = 8;
+  glm::float2 jitter = glm::float2(0.0f);  // Сдвиг в пикселях сцены, вниз и вправо
+  glm::float4x4 jitteredProjectionMatrix;
+  glm::float4x4 previousViewProjection = glm::float4x4(1.0f);  // Прошлого кадра, без дрожания
 
   struct Speed {
     float movement = 2.5f;
@@ -59,4 +66,8 @@ class Camera : public Object {
   void updateView();
   void updateProjection();
   void updateProjection(Projection&);
+  void updateJitter(uint32_t frame, uint32_t width, uint32_t height);  // width = 0 - без дрожания
+
+  // Луч из камеры через точку экрана (в пикселях, от левого верхнего угла)
+  void getRay(glm::double2 cursor, uint32_t width, uint32_t height, glm::float3& origin, glm::float3& direction);  // Курсор и размеры окна - в экранных координатах
 };
@@ -0,0 +1,234 @@
+#include "culling.h"
+
+// Внутренние библиотеки
+#include "simd.h"
+
+// Стандартные библиотеки
+#include <algorithm>
+
+Culling::Culling(Transforms::Manager transforms) {
+  this->transforms = transforms;
+  bvh = new BVH();
+}
+
+Culling::~Culling() {
+  if (bvh != nullptr)
+    delete bvh;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Culling::add(PhysicalObject::Instance object) {
+  uint32_t id = object->transformID;
+  if (id == Transforms::none)
+    throw std::runtime_error("ERROR: Culling requires an object with transform!");
+  if (id >= firstEntry.size()) {
+    firstEntry.resize(id + 1, 0);
+    entryCount.resize(id + 1, 0);
+  }
+
+  // Формы объекта хранятся подряд
+  firstEntry[id] = static_cast<uint32_t>(entries.transformID.size());
+  entryCount[id] = static_cast<uint32_t>(object->model->shapes.size());
+  for (auto shape : object->model->shapes) {
+    entries.transformID.push_back(id);
+    entries.local.push_back(shape->bounds);
+    entries.shape.push_back(shape);
+    boxes.push_back({});
+    visible.push_back(1);
+  }
+  rebuild = true;
+  version++;
+
+  // Размер мировых массивов кратен числу полос - пакеты читаются без проверок границ
+  uint32_t count = static_cast<uint32_t>(visible.size());
+  uint32_t padded = (count + simd::lanes - 1) / simd::lanes * simd::lanes;
+  for (auto array : {&world.minX, &world.minY, &world.minZ, &world.maxX, &world.maxY, &world.maxZ,
+                     &world.centerX, &world.centerY, &world.centerZ, &world.radius})
+    array->resize(padded, 0.0f);
+
+  for (uint32_t i = 0; i < entryCount[id]; ++i)
+    updateEntry(firstEntry[id] + i, transforms->getMatrix(id));
+}
+
+void Culling::update() {
+  changes.clear();
+  for (auto id : transforms->getChanges()) {
+    if (id >= firstEntry.size())
+      continue;
+    for (uint32_t i = 0; i < entryCount[id]; ++i) {
+      updateEntry(firstEntry[id] + i, transforms->getMatrix(id));
+      changes.push_back(firstEntry[id] + i);
+    }
+    refit = true;
+  }
+
+  // Новые формы требуют построения заново, сдвинутые - уточнения объёмов узлов
+  if (rebuild)
+    bvh->build(boxes);
+  else if (refit)
+    bvh->refit(boxes);
+  rebuild = false;
+  refit = false;
+}
+
+void Culling::updateEntry(uint32_t entry, const glm::float4x4& matrix) {
+  const Models::bounds_t& bounds = entries.local[entry];
+
+  // AABB: центр переносится матрицей, полуразмеры - модулем её линейной части
+  glm::float3 center = glm::float3(matrix * glm::float4((bounds.min + bounds.max) * 0.5f, 1.0f));
+  glm::float3 extent = (bounds.max - bounds.min) * 0.5f;
+  glm::float3 worldExtent =
+      glm::abs(glm::float3(matrix[0])) * extent.x +
+      glm::abs(glm::float3(matrix[1])) * extent.y +
+      glm::abs(glm::float3(matrix[2])) * extent.z;
+
+  world.minX[entry] = center.x - worldExtent.x;
+  world.minY[entry] = center.y - worldExtent.y;
+  world.minZ[entry] = center.z - worldExtent.z;
+  world.maxX[entry] = center.x + worldExtent.x;
+  world.maxY[entry] = center.y + worldExtent.y;
+  world.maxZ[entry] = center.z + worldExtent.z;
+
+  // Сфера: радиус умножается на наибольший масштаб
+  glm::float3 sphere = glm::float3(matrix * glm::float4(bounds.center, 1.0f));
+  float scale = std::max({glm::length(glm::float3(matrix[0])),
+                          glm::length(glm::float3(matrix[1])),
+                          glm::length(glm::float3(matrix[2]))});
+  world.centerX[entry] = sphere.x;
+  world.centerY[entry] = sphere.y;
+  world.centerZ[entry] = sphere.z;
+  world.radius[entry] = bounds.radius * scale;
+
+  boxes[entry] = {center - worldExtent, center + worldExtent};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Culling::frustum_t Culling::extractFrustum(const glm::float4x4& viewProjection) {
+  // Строки матрицы (glm хранит матрицы по столбцам)
+  glm::float4 rows[4];
+  for (int i = 0; i < 4; ++i)
+    rows[i] = glm::float4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+  frustum_t planes = {
+      rows[3] + rows[0],  // Левая
+      rows[3] - rows[0],  // Правая
+      rows[3] + rows[1],  // Нижняя
+      rows[3] - rows[1],  // Верхняя
+      rows[3] + rows[2],  // Ближняя (с запасом и для глубины [0, 1])
+      rows[3] - rows[2],  // Дальняя
+  };
+
+  // Нормировка - для проверки сфер
+  for (auto& plane : planes)
+    plane /= glm::length(glm::float3(plane));
+  return planes;
+}
+
+void Culling::cull(const glm::float4x4& viewProjection) {
+  uint32_t count = static_cast<uint32_t>(visible.size());
+  if (!enabled) {
+    // Новые формы добавляются видимыми - после первого заполнения перебор не нужен
+    if (!allVisible)
+      std::fill(visible.begin(), visible.end(), 1);
+    allVisible = true;
+    stats = {count, 0};
+    return;
+  }
+
+  frustum_t planes = extractFrustum(viewProjection);
+  stats = {0, 0};
+  allVisible = false;
+
+  if (method == CULLING_HIERARCHICAL) {
+    std::fill(visible.begin(), visible.end(), 0);
+    candidates.clear();
+    bvh->cull(planes, candidates);
+    for (auto entry : candidates)
+      visible[entry] = 1;
+    stats.visible = static_cast<uint32_t>(candidates.size());
+    stats.culled = count - stats.visible;
+    return;
+  }
+
+  const simd::lane_t zero = simd::set1(0.0f);
+  for (uint32_t i = 0; i < count; i += simd::lanes) {
+    simd::lane_t outside = zero;
+    for (auto& plane : planes) {
+      // Сфера целиком за плоскостью
+      simd::lane_t distance = simd::add(
+          simd::add(simd::mul(simd::load(&world.centerX[i]), simd::set1(plane.x)),
+                    simd::mul(simd::load(&world.centerY[i]), simd::set1(plane.y))),
+          simd::add(simd::mul(simd::load(&world.centerZ[i]), simd::set1(plane.z)),
+                    simd::set1(plane.w)));
+      outside = simd::orMask(outside, simd::less(simd::add(distance, simd::load(&world.radius[i])), zero));
+
+      // Самая дальняя вдоль нормали вершина AABB за плоскостью
+      const float* x = plane.x > 0.0f ? &world.maxX[i] : &world.minX[i];
+      const float* y = plane.y > 0.0f ? &world.maxY[i] : &world.minY[i];
+      const float* z = plane.z > 0.0f ? &world.maxZ[i] : &world.minZ[i];
+      distance = simd::add(
+          simd::add(simd::mul(simd::load(x), simd::set1(plane.x)),
+                    simd::mul(simd::load(y), simd::set1(plane.y))),
+          simd::add(simd::mul(simd::load(z), simd::set1(plane.z)),
+                    simd::set1(plane.w)));
+      outside = simd::orMask(outside, simd::less(distance, zero));
+    }
+
+    uint32_t mask = simd::mask(outside);
+    uint32_t last = std::min(simd::lanes, count - i);
+    for (uint32_t lane = 0; lane < last; ++lane) {
+      bool inside = (mask & (1u << lane)) == 0;
+      visible[i + lane] = inside;
+      if (inside)
+        stats.visible++;
+      else
+        stats.culled++;
+    }
+  }
+}
+
+bool Culling::isVisible(uint32_t transformID, uint32_t shape) {
+  if (transformID >= firstEntry.size() || shape >= entryCount[transformID])
+    return true;
+  return visible[firstEntry[transformID] + shape];
+}
+
+Culling::stats_t Culling::getStats() {
+  return stats;
+}
+
+BVH::Manager Culling::getBVH() {
+  return bvh;
+}
+
+uint32_t Culling::getTransformID(uint32_t entry) {
+  return entries.transformID[entry];
+}
+
+uint32_t Culling::getEntryCount() {
+  return static_cast<uint32_t>(entries.transformID.size());
+}
+
+Models::model_t::shape_t* Culling::getShape(uint32_t entry) {
+  return entries.shape[entry];
+}
+
+const BVH::box_t& Culling::getBox(uint32_t entry) {
+  return boxes[entry];
+}
+
+glm::float4 Culling::getSphere(uint32_t entry) {
+  return {world.centerX[entry], world.centerY[entry], world.centerZ[entry], world.radius[entry]};
+}
+
+const std::vector<uint32_t>& Culling::getChanges() {
+  return changes;
+}
+
+uint32_t Culling::getVersion() {
+  return version;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
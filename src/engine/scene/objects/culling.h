@@ -0,0 +1,108 @@
+#pragma once
+
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+
+// Внутренние библиотеки
+#include "objects/object.h"
+#include "objects/transforms.h"
+#include "objects/bvh.h"
+
+// Стандартные библиотеки
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// Отсечение форм объектов по пирамиде видимости камеры
+// Мировые ограничивающие объёмы хранятся структурой массивов
+// и обновляются только для изменённых преобразований.
+// Над ними же строится BVH для иерархического отсечения и запросов к сцене
+class Culling {
+ public:
+  typedef Culling* Manager;
+
+  explicit Culling(Transforms::Manager);
+  ~Culling();
+
+  enum Method {
+    CULLING_LINEAR,        // Перебор всех форм пакетами SIMD
+    CULLING_HIERARCHICAL,  // Обход BVH с пропуском поддеревьев
+  };
+
+  bool enabled = true;
+  Method method = CULLING_HIERARCHICAL;
+
+  struct stats_t {
+    uint32_t visible;
+    uint32_t culled;
+  };
+
+  void add(PhysicalObject::Instance);
+
+  // Пересчёт мировых объёмов по списку изменённых преобразований
+  void update();
+
+  // Проверка форм - перебором пакетами по 4 (SSE или поэлементно), либо обходом BVH
+  void cull(const glm::float4x4& viewProjection);
+
+  bool isVisible(uint32_t transformID, uint32_t shape);
+  stats_t getStats();
+
+  // Элементы BVH - формы объектов
+  BVH::Manager getBVH();
+  uint32_t getTransformID(uint32_t entry);
+
+  //=========================================================================
+  // Данные форм для отсечения на GPU
+
+  uint32_t getEntryCount();
+  Models::model_t::shape_t* getShape(uint32_t entry);
+  const BVH::box_t& getBox(uint32_t entry);
+  glm::float4 getSphere(uint32_t entry);  // Центр и радиус
+
+  // Формы с изменёнными объёмами за последнее обновление
+  const std::vector<uint32_t>& getChanges();
+
+  // Меняется при добавлении форм - копии данных требуют полной перезаписи
+  uint32_t getVersion();
+
+  typedef BVH::frustum_t frustum_t;
+  static frustum_t extractFrustum(const glm::float4x4& viewProjection);
+
+ private:
+  Transforms::Manager transforms;
+
+  // Формы всех объектов
+  struct {
+    std::vector<uint32_t> transformID;
+    std::vector<Models::bounds_t> local;
+    std::vector<Models::model_t::shape_t*> shape;
+  } entries;
+
+  std::vector<uint32_t> changes;
+  uint32_t version = 0;
+
+  // Мировые объёмы форм
+  struct {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+    std::vector<float> centerX, centerY, centerZ, radius;
+  } world;
+
+  // Те же объёмы для BVH
+  BVH::Manager bvh;
+  std::vector<BVH::box_t> boxes;
+  std::vector<uint32_t> candidates;
+  bool rebuild = false;
+  bool refit = false;
+
+  std::vector<uint8_t> visible;
+  bool allVisible = false;  // Отсечение выключено и все формы уже отмечены видимыми
+  stats_t stats{};
+
+  // Первая форма и число форм по преобразованию
+  std::vector<uint32_t> firstEntry;
+  std::vector<uint32_t> entryCount;
+
+  void updateEntry(uint32_t entry, const glm::float4x4& matrix);
+};
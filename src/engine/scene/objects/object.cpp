@@ -26,7 +26,36 @@ void Object::scale(glm::float3 scale) {
   this->transform.scale += scale;
 }
 
+const glm::float4x4& Object::getModelMatrix() {
+  if (transforms != nullptr)
+    return transforms->getMatrix(transformID);
+  return modelMatrix;
+}
+
+const glm::float4x4& Object::getPreviousModelMatrix() {
+  if (transforms != nullptr)
+    return transforms->getPreviousMatrix(transformID);
+  return modelMatrix;
+}
+
+void Object::setParent(Object* parent) {
+  this->parent = parent;
+  if (transforms != nullptr)
+    transforms->setParent(transformID, parent != nullptr ? parent->transformID : Transforms::none);
+}
+
 void Object::update() {
+  // Матрица будет вычислена пакетно вместе с остальными (Transforms::update),
+  // неизменное преобразование не помечается как изменённое
+  if (transforms != nullptr) {
+    if (appliedOnce && transform == applied)
+      return;
+    transforms->set(transformID, transform.position, transform.rotation, transform.scale);
+    applied = transform;
+    appliedOnce = true;
+    return;
+  }
+
   modelMatrix = glm::translate(glm::mat4(1.0f), transform.position);
   modelMatrix = glm::rotate(modelMatrix, glm::radians(transform.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
   modelMatrix = glm::rotate(modelMatrix, glm::radians(transform.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -3,6 +3,7 @@
 // Внутренние библиотеки
 #include "resources/textures.h"
 #include "resources/models.h"
+#include "objects/transforms.h"
 
 class Object {
  public:
@@ -10,10 +11,23 @@ class Object {
     glm::float3 position = glm::float3(0, 0, 0);
     glm::float3 rotation = glm::float3(0, 0, 0);
     glm::float3 scale = glm::float3(1, 1, 1);
+
+    bool operator==(const Transform&) const = default;
   } transform;
 
   glm::float4x4 modelMatrix = glm::mat4(1.0f);
 
+  // Преобразование в общем хранилище (если объект к нему подключен)
+  Transforms::Manager transforms = nullptr;
+  uint32_t transformID = Transforms::none;
+
+  const glm::float4x4& getModelMatrix();
+  const glm::float4x4& getPreviousModelMatrix();  // На момент прошлого обновления хранилища
+
+  // Иерархия объектов - преобразование потомка задаётся относительно родителя
+  Object* parent = nullptr;
+  void setParent(Object* parent);
+
   virtual void setPosition(glm::float3 position);
   virtual void setRotation(glm::float3 rotation);
   virtual void setScale(glm::float3 scale);
@@ -23,6 +37,11 @@ class Object {
   virtual void scale(glm::float3 scale);
 
   virtual void update();
+
+ private:
+  // Последнее переданное в хранилище преобразование
+  Transform applied;
+  bool appliedOnce = false;
 };
 
 class PhysicalObject : public Object {
@@ -0,0 +1,72 @@
+#pragma once
+
+// Стандартные библиотеки
+#include <bit>
+#include <cstdint>
+
+// Векторные регистры есть не на каждой архитектуре - на остальных тот же интерфейс скалярный
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_SSE
+#include <immintrin.h>
+#endif
+
+// Обёртки над векторными регистрами для пакетной обработки данных сцены
+// Обрабатывается 4 значения за раз: SSE на x86, иначе поэлементно
+namespace simd {
+
+constexpr uint32_t lanes = 4;
+
+#if defined(SIMD_SSE)
+typedef __m128 lane_t;
+
+inline lane_t set1(float value) { return _mm_set1_ps(value); }
+inline lane_t load(const float* src) { return _mm_loadu_ps(src); }
+inline void store(float* dst, lane_t a) { _mm_store_ps(dst, a); }
+inline lane_t add(lane_t a, lane_t b) { return _mm_add_ps(a, b); }
+inline lane_t sub(lane_t a, lane_t b) { return _mm_sub_ps(a, b); }
+inline lane_t mul(lane_t a, lane_t b) { return _mm_mul_ps(a, b); }
+inline lane_t less(lane_t a, lane_t b) { return _mm_cmplt_ps(a, b); }
+inline lane_t orMask(lane_t a, lane_t b) { return _mm_or_ps(a, b); }
+inline uint32_t mask(lane_t a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+inline lane_t gather(const float* base, const int32_t* ids) {
+  return _mm_set_ps(base[ids[3]], base[ids[2]], base[ids[1]], base[ids[0]]);
+}
+#else
+// Маска сравнения - все биты значения, как у SSE
+struct lane_t {
+  float v[lanes];
+};
+
+inline lane_t set1(float value) { return {{value, value, value, value}}; }
+inline lane_t load(const float* src) { return {{src[0], src[1], src[2], src[3]}}; }
+inline void store(float* dst, lane_t a) {
+  for (uint32_t i = 0; i < lanes; ++i)
+    dst[i] = a.v[i];
+}
+inline lane_t add(lane_t a, lane_t b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline lane_t sub(lane_t a, lane_t b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline lane_t mul(lane_t a, lane_t b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+inline lane_t less(lane_t a, lane_t b) {
+  lane_t result;
+  for (uint32_t i = 0; i < lanes; ++i)
+    result.v[i] = std::bit_cast<float>(a.v[i] < b.v[i] ? UINT32_MAX : 0u);
+  return result;
+}
+inline lane_t orMask(lane_t a, lane_t b) {
+  lane_t result;
+  for (uint32_t i = 0; i < lanes; ++i)
+    result.v[i] = std::bit_cast<float>(std::bit_cast<uint32_t>(a.v[i]) | std::bit_cast<uint32_t>(b.v[i]));
+  return result;
+}
+inline uint32_t mask(lane_t a) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < lanes; ++i)
+    result |= (std::bit_cast<uint32_t>(a.v[i]) >> 31) << i;
+  return result;
+}
+inline lane_t gather(const float* base, const int32_t* ids) {
+  return {{base[ids[0]], base[ids[1]], base[ids[2]], base[ids[3]]}};
+}
+#endif
+
+}  // namespace simd
@@ -0,0 +1,341 @@
+#include "transforms.h"
+
+// Внутренние библиотеки
+#include "simd.h"
+
+// Стандартные библиотеки
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using simd::lane_t;
+using simd::lanes;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t Transforms::create() {
+  uint32_t id;
+  if (!freeList.empty()) {
+    id = freeList.back();
+    freeList.pop_back();
+  } else {
+    // Новый корень - в конец: родителей у него нет, порядок не нарушается
+    id = static_cast<uint32_t>(slots.size());
+    for (auto array : {&positions.x, &positions.y, &positions.z, &scales.x, &scales.y, &scales.z})
+      array->push_back(0.0f);
+    for (auto array : {&rotations.x, &rotations.y, &rotations.z, &rotations.w})
+      array->push_back(0.0f);
+    locals.push_back(glm::float4x4(1.0f));
+    matrices.push_back(glm::float4x4(1.0f));
+    previous.push_back(glm::float4x4(1.0f));
+    parentSlots.push_back(none);
+    dirtyFlags.push_back(0);
+    changedFlags.push_back(0);
+    slots.push_back(static_cast<uint32_t>(ids.size()));
+    ids.push_back(id);
+    parents.push_back(none);
+    children.emplace_back();
+    aliveFlags.push_back(0);
+  }
+
+  aliveFlags[id] = 1;
+  set(id, glm::float3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::float3(1.0f));
+  return id;
+}
+
+void Transforms::destroy(uint32_t id) {
+  if (id >= slots.size() || !aliveFlags[id])
+    throw std::runtime_error("ERROR: Failed to destroy transform!");
+
+  // Потомки становятся корнями - setParent убирает их из списка, обход идёт по копии
+  auto orphans = children[id];
+  for (auto child : orphans)
+    setParent(child, none);
+  setParent(id, none);
+  aliveFlags[id] = 0;
+  freeList.push_back(id);
+}
+
+void Transforms::setParent(uint32_t id, uint32_t parent) {
+  if (parents[id] == parent)
+    return;
+  if (parent != none && (parent >= slots.size() || !aliveFlags[parent]))
+    throw std::runtime_error("ERROR: Transform parent does not exist!");
+
+  // Запрет циклов
+  for (uint32_t ancestor = parent; ancestor != none; ancestor = parents[ancestor])
+    if (ancestor == id)
+      throw std::runtime_error("ERROR: Transform cannot be a parent of its ancestor!");
+
+  // Список потомков прежнего родителя - без учёта порядка
+  if (parents[id] != none) {
+    auto& siblings = children[parents[id]];
+    auto found = std::find(siblings.begin(), siblings.end(), id);
+    *found = siblings.back();
+    siblings.pop_back();
+  }
+  if (parent != none)
+    children[parent].push_back(id);
+
+  parents[id] = parent;
+  orderChanged = true;
+
+  // Поддерево пересчитается от изменённого корня
+  if (!dirtyFlags[slots[id]]) {
+    dirtyFlags[slots[id]] = 1;
+    dirtyList.push_back(id);
+  }
+}
+
+uint32_t Transforms::getParent(uint32_t id) {
+  return parents[id];
+}
+
+void Transforms::set(uint32_t id, glm::float3 position, glm::float3 rotation, glm::float3 scale) {
+  glm::quat quaternion =
+      glm::angleAxis(glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+      glm::angleAxis(glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+      glm::angleAxis(glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+  set(id, position, quaternion, scale);
+}
+
+void Transforms::set(uint32_t id, glm::float3 position, glm::quat rotation, glm::float3 scale) {
+  uint32_t slot = slots[id];
+  positions.x[slot] = position.x;
+  positions.y[slot] = position.y;
+  positions.z[slot] = position.z;
+  rotations.x[slot] = rotation.x;
+  rotations.y[slot] = rotation.y;
+  rotations.z[slot] = rotation.z;
+  rotations.w[slot] = rotation.w;
+  scales.x[slot] = scale.x;
+  scales.y[slot] = scale.y;
+  scales.z[slot] = scale.z;
+
+  if (!dirtyFlags[slot]) {
+    dirtyFlags[slot] = 1;
+    dirtyList.push_back(id);
+  }
+}
+
+const glm::float4x4& Transforms::getMatrix(uint32_t id) {
+  return matrices[slots[id]];
+}
+
+const glm::float4x4& Transforms::getPreviousMatrix(uint32_t id) {
+  return previous[slots[id]];
+}
+
+uint32_t Transforms::getCount() {
+  return static_cast<uint32_t>(slots.size());
+}
+
+const std::vector<uint32_t>& Transforms::getChanges() {
+  return changes;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Transforms::update() {
+  // Прошлые матрицы отстают от текущих только у изменённых прошлым обновлением
+  for (auto id : changes) {
+    changedFlags[slots[id]] = 0;
+    previous[slots[id]] = matrices[slots[id]];
+  }
+  changes.clear();
+
+  if (dirtyList.empty())
+    return;
+
+  // Смена иерархии переставляет сами массивы - места изменённых берутся после неё
+  if (orderChanged)
+    sortOrder();
+
+  // Упорядоченные места - выборка идёт по памяти вперёд
+  dirtySlots.clear();
+  for (auto id : dirtyList)
+    dirtySlots.push_back(slots[id]);
+  std::sort(dirtySlots.begin(), dirtySlots.end());
+  compose(dirtySlots.data(), static_cast<uint32_t>(dirtySlots.size()));
+  propagate(dirtySlots.front());
+
+  for (auto slot : dirtySlots)
+    dirtyFlags[slot] = 0;
+  dirtyList.clear();
+}
+
+void Transforms::propagate(uint32_t first) {
+  // Родители расположены раньше детей - их мировые матрицы уже готовы.
+  // Обход начинается с первого изменённого места
+  for (uint32_t slot = first; slot < ids.size(); ++slot) {
+    uint32_t parent = parentSlots[slot];
+    bool changed = dirtyFlags[slot] || (parent != none && changedFlags[parent]);
+    if (!changed)
+      continue;
+
+    matrices[slot] = parent == none ? locals[slot] : matrices[parent] * locals[slot];
+    changedFlags[slot] = 1;
+    changes.push_back(ids[slot]);
+  }
+}
+
+// Перестановка массива по местам: from[новое место] - старое место
+template <typename T>
+static void permute(std::vector<T>& array, const std::vector<uint32_t>& from) {
+  std::vector<T> sorted(array.size());
+  for (uint32_t slot = 0; slot < from.size(); ++slot)
+    sorted[slot] = array[from[slot]];
+  array.swap(sorted);
+}
+
+void Transforms::sortOrder() {
+  // Глубина каждого преобразования
+  std::vector<uint32_t> depths(parents.size(), none);
+  for (uint32_t id = 0; id < parents.size(); ++id) {
+    uint32_t depth = 0;
+    for (uint32_t ancestor = parents[id]; ancestor != none; ancestor = parents[ancestor])
+      depth++;
+    depths[id] = depth;
+  }
+
+  // Устойчивая сортировка по глубине сохраняет прежний порядок внутри уровня
+  std::vector<uint32_t> sorted = ids;
+  std::stable_sort(sorted.begin(), sorted.end(), [&depths](uint32_t a, uint32_t b) {
+    return depths[a] < depths[b];
+  });
+  std::vector<uint32_t> from(sorted.size());
+  for (uint32_t slot = 0; slot < sorted.size(); ++slot)
+    from[slot] = slots[sorted[slot]];
+
+  // Все массивы по месту переставляются одинаково
+  for (auto array : {&positions.x, &positions.y, &positions.z, &scales.x, &scales.y, &scales.z})
+    permute(*array, from);
+  for (auto array : {&rotations.x, &rotations.y, &rotations.z, &rotations.w})
+    permute(*array, from);
+  for (auto array : {&locals, &matrices, &previous})
+    permute(*array, from);
+  permute(dirtyFlags, from);
+  permute(changedFlags, from);
+
+  ids = sorted;
+  for (uint32_t slot = 0; slot < ids.size(); ++slot)
+    slots[ids[slot]] = slot;
+  for (uint32_t slot = 0; slot < ids.size(); ++slot)
+    parentSlots[slot] = parents[ids[slot]] == none ? none : slots[parents[ids[slot]]];
+  orderChanged = false;
+}
+
+void Transforms::compose(const uint32_t* dirty, uint32_t count) {
+  const lane_t one = simd::set1(1.0f);
+  const lane_t two = simd::set1(2.0f);
+
+  alignas(16) int32_t index[lanes];
+  alignas(16) float result[12][lanes];
+
+  for (uint32_t i = 0; i < count; i += lanes) {
+    // Неполный пакет дополняется последним местом
+    for (uint32_t lane = 0; lane < lanes; ++lane)
+      index[lane] = static_cast<int32_t>(dirty[std::min(i + lane, count - 1)]);
+
+    lane_t x = simd::gather(rotations.x.data(), index);
+    lane_t y = simd::gather(rotations.y.data(), index);
+    lane_t z = simd::gather(rotations.z.data(), index);
+    lane_t w = simd::gather(rotations.w.data(), index);
+
+    lane_t xx = simd::mul(x, x), yy = simd::mul(y, y), zz = simd::mul(z, z);
+    lane_t xy = simd::mul(x, y), xz = simd::mul(x, z), yz = simd::mul(y, z);
+    lane_t wx = simd::mul(w, x), wy = simd::mul(w, y), wz = simd::mul(w, z);
+
+    lane_t sx = simd::gather(scales.x.data(), index);
+    lane_t sy = simd::gather(scales.y.data(), index);
+    lane_t sz = simd::gather(scales.z.data(), index);
+
+    // Столбцы матрицы поворота, умноженные на масштаб
+    simd::store(result[0], simd::mul(simd::sub(one, simd::mul(two, simd::add(yy, zz))), sx));
+    simd::store(result[1], simd::mul(simd::mul(two, simd::add(xy, wz)), sx));
+    simd::store(result[2], simd::mul(simd::mul(two, simd::sub(xz, wy)), sx));
+
+    simd::store(result[3], simd::mul(simd::mul(two, simd::sub(xy, wz)), sy));
+    simd::store(result[4], simd::mul(simd::sub(one, simd::mul(two, simd::add(xx, zz))), sy));
+    simd::store(result[5], simd::mul(simd::mul(two, simd::add(yz, wx)), sy));
+
+    simd::store(result[6], simd::mul(simd::mul(two, simd::add(xz, wy)), sz));
+    simd::store(result[7], simd::mul(simd::mul(two, simd::sub(yz, wx)), sz));
+    simd::store(result[8], simd::mul(simd::sub(one, simd::mul(two, simd::add(xx, yy))), sz));
+
+    simd::store(result[9], simd::gather(positions.x.data(), index));
+    simd::store(result[10], simd::gather(positions.y.data(), index));
+    simd::store(result[11], simd::gather(positions.z.data(), index));
+
+    // Запись матриц по столбцам
+    uint32_t last = std::min(lanes, count - i);
+    for (uint32_t lane = 0; lane < last; ++lane) {
+      glm::float4x4& matrix = locals[index[lane]];
+      matrix[0] = glm::float4(result[0][lane], result[1][lane], result[2][lane], 0.0f);
+      matrix[1] = glm::float4(result[3][lane], result[4][lane], result[5][lane], 0.0f);
+      matrix[2] = glm::float4(result[6][lane], result[7][lane], result[8][lane], 0.0f);
+      matrix[3] = glm::float4(result[9][lane], result[10][lane], result[11][lane], 1.0f);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Transforms::benchmark_t Transforms::benchmark(uint32_t count) {
+  struct object_t {
+    glm::float3 position, rotation, scale;
+    glm::float4x4 modelMatrix;
+  };
+
+  std::mt19937 random(count);
+  std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+  // Объекты, созданные по отдельности
+  std::vector<object_t*> objects(count);
+  Transforms transforms;
+  for (uint32_t i = 0; i < count; ++i) {
+    objects[i] = new object_t;
+    objects[i]->position = {distribution(random), distribution(random), distribution(random)};
+    objects[i]->rotation = {distribution(random), distribution(random), distribution(random)};
+    objects[i]->scale = glm::float3(1.0f) + glm::abs(glm::float3(distribution(random))) / 100.0f;
+    transforms.create();
+  }
+
+  // Отдельно для каждого объекта
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto object : objects) {
+    object->modelMatrix = glm::translate(glm::mat4(1.0f), object->position);
+    object->modelMatrix = glm::rotate(object->modelMatrix, glm::radians(object->rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    object->modelMatrix = glm::rotate(object->modelMatrix, glm::radians(object->rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    object->modelMatrix = glm::rotate(object->modelMatrix, glm::radians(object->rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    object->modelMatrix = glm::scale(object->modelMatrix, object->scale);
+  }
+  auto middle = std::chrono::high_resolution_clock::now();
+
+  // Пакетно - все преобразования изменены. Из тех же углов Эйлера в те же матрицы:
+  // перевод в кватернион при записи входит в замер
+  auto batchStart = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < count; ++i)
+    transforms.set(i, objects[i]->position, objects[i]->rotation, objects[i]->scale);
+  transforms.update();
+  auto end = std::chrono::high_resolution_clock::now();
+
+  // Проверка совпадения результатов
+  float error = 0.0f;
+  for (uint32_t i = 0; i < count; ++i)
+    for (int column = 0; column < 4; ++column)
+      error = std::max(error, glm::compMax(glm::abs(objects[i]->modelMatrix[column] - transforms.getMatrix(i)[column])));
+  if (error > 1e-2f)
+    std::cout << "WARNING: Transforms benchmark mismatch " << error << std::endl;
+
+  for (auto object : objects)
+    delete object;
+
+  benchmark_t result;
+  result.count = count;
+  result.objectsTime = std::chrono::duration<double, std::milli>(middle - start).count();
+  result.batchTime = std::chrono::duration<double, std::milli>(end - batchStart).count();
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,93 @@
+#pragma once
+
+// Сторонние библиотеки
+#include <glm/gtx/compatibility.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/component_wise.hpp>
+
+// Стандартные библиотеки
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+// Хранилище преобразований объектов в виде структуры массивов
+// Локальные матрицы изменённых преобразований вычисляются пакетно (SIMD),
+// мировые - обходом иерархии. Сами массивы упорядочены по глубине (родители раньше детей):
+// обход идёт по памяти подряд, а идентификатор преобразования - постоянная ссылка на его место
+class Transforms {
+ public:
+  typedef Transforms* Manager;
+
+  static constexpr uint32_t none = UINT32_MAX;
+
+  Transforms() = default;
+  ~Transforms() = default;
+
+  uint32_t create();
+  void destroy(uint32_t id);
+
+  // Поворот задаётся углами Эйлера в градусах (порядок X, Y, Z - как в Object)
+  void set(uint32_t id, glm::float3 position, glm::float3 rotation, glm::float3 scale);
+  void set(uint32_t id, glm::float3 position, glm::quat rotation, glm::float3 scale);
+
+  // Иерархия - мировая матрица потомка равна произведению матрицы родителя на локальную
+  void setParent(uint32_t id, uint32_t parent);
+  uint32_t getParent(uint32_t id);
+
+  // Пересчёт матриц изменённых преобразований и их поддеревьев
+  void update();
+
+  // Мировые матрицы
+  const glm::float4x4& getMatrix(uint32_t id);
+  uint32_t getCount();
+
+  // Мировые матрицы на момент прошлого обновления - векторы движения для TAA
+  const glm::float4x4& getPreviousMatrix(uint32_t id);
+
+  // Преобразования, мировые матрицы которых изменились при последнем обновлении
+  const std::vector<uint32_t>& getChanges();
+
+  // Сравнение с вычислением матриц отдельно для каждого объекта
+  struct benchmark_t {
+    uint32_t count;
+    double objectsTime;  // Цепочка glm::translate/rotate/scale по указателям (мс)
+    double batchTime;    // Пакетное вычисление вместе с записью углов Эйлера (мс)
+  };
+  static benchmark_t benchmark(uint32_t count);
+
+ private:
+  struct {
+    std::vector<float> x, y, z;
+  } positions, scales;
+
+  struct {
+    std::vector<float> x, y, z, w;
+  } rotations;
+
+  std::vector<glm::float4x4> locals;
+  std::vector<glm::float4x4> matrices;
+  std::vector<glm::float4x4> previous;
+
+  // Массивы выше и ниже - по месту, иерархия в плоском виде
+  std::vector<uint32_t> parentSlots;  // Место родителя, none - корень
+  std::vector<uint8_t> dirtyFlags;
+  std::vector<uint8_t> changedFlags;
+  std::vector<uint32_t> ids;  // Идентификатор по месту
+
+  // По идентификатору
+  std::vector<uint32_t> slots;                  // Место в массивах
+  std::vector<uint32_t> parents;                // Идентификатор родителя
+  std::vector<std::vector<uint32_t>> children;  // Идентификаторы потомков
+  std::vector<uint8_t> aliveFlags;              // Создан и не удалён - повторное удаление запрещено
+
+  std::vector<uint32_t> freeList;
+  std::vector<uint32_t> dirtyList;   // Идентификаторы
+  std::vector<uint32_t> dirtySlots;  // Их места при обновлении
+  std::vector<uint32_t> changes;     // Идентификаторы
+  bool orderChanged = false;
+
+  void compose(const uint32_t* dirty, uint32_t count);
+  void propagate(uint32_t first);
+  void sortOrder();
+};
@@ -5,17 +5,22 @@
 
 #include "models.h"
 
-Models::Models(Core::Manager core, Textures::Manager textures) {
+// Общий счётчик всех менеджеров - версия не повторяется и после пересоздания сцены
+static uint32_t versions = 0;
+
+Models::Models(Core::Manager core, Textures::Manager textures, VirtualTextures::Manager virtualTextures) {
   this->core = core;
   this->textures = textures;
+  this->virtualTextures = virtualTextures;
 }
 
 Models::~Models() {
   for (auto model : handlers) {
     for (auto shape : model->shapes)
-      core->resources->destroyBuffer(shape->vertexBuffer, shape->vertexBufferMemory);
+      delete shape;
     delete model;
   }
+  destroyGeometry();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -26,34 +31,70 @@ Models::Instance Models::load(const std::string& name) {
   if (el != idList.end())
     return handlers[el->second];
 
-  // Инициализация модели
-  Instance model = new model_t;
-  model->name = name;
-  model->objPath = "misc\\models\\" + name + "\\" + name + ".obj";
-  model->mtlPath = "misc\\models\\" + name;
+  source_t source;
+  source.name = name;
+  readSource(source);
+  return addSource(source);
+}
 
-  // Чтение данных из файла .obj
-  tinyobj::ObjReader reader;
-  tinyobj::ObjReaderConfig readerConfig;
-  readerConfig.mtl_search_path = model->mtlPath;
-  reader.ParseFromFile(model->objPath, readerConfig);
+Models::Instance Models::load(const std::string& name, const material_t& material) {
+  std::string variant = name + "@" + material.name;
+  auto el = idList.find(variant);
+  if (el != idList.end())
+    return handlers[el->second];
 
-  // Проверка корректного чтения
-  if (!reader.Error().empty())
-    throw std::runtime_error("ERROR: " + reader.Error());
-  else if (!reader.Warning().empty())
-    std::cerr << "WARNING [TinyObjReader]:" << reader.Warning() << std::endl;
+  // Формы варианта ссылаются на те же диапазоны общих буферов
+  Instance base = load(name);
+  Instance model = new model_t(*base);
+  model->name = variant;
+  model->shapes.clear();
 
-  // Получение данных от TOL
-  parseData(model, reader);
+  Resources::sampler_t sampler;
+  if (material.clamp)
+    sampler.address = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  sampler.lodBias = material.lodBias;
+  for (auto shape : base->shapes) {
+    model_t::shape_t* shapeData = new model_t::shape_t(*shape);
+    shapeData->diffuseTextureID = 0;
+    shapeData->samplerID = 0;
+    shapeData->virtualTextureID = 0;
+    if (!material.texture.empty())  // Без текстуры - материал по умолчанию
+      setTexture(shapeData, material.texture, sampler);
+    model->shapes.push_back(shapeData);
+  }
 
-  // Запись модели
   uint32_t id = static_cast<uint32_t>(handlers.size());
-  idList.insert(std::make_pair(name, id));
+  idList.insert(std::make_pair(variant, id));
   handlers.push_back(model);
+  version = ++versions;
+  return model;
+}
+
+void Models::load(const std::vector<std::string>& names) {
+  // Различные незагруженные модели
+  std::vector<std::string> missing;
+  std::set<std::string> unique;
+  for (auto& name : names)
+    if (idList.find(name) == idList.end() && unique.insert(name).second)
+      missing.push_back(name);
+
+  // Разбор файлов не затрагивает общих данных - каждая модель в своём потоке
+  std::vector<source_t> sources(missing.size());
+  std::vector<std::future<void>> tasks;
+  for (uint32_t i = 0; i < missing.size(); ++i) {
+    sources[i].name = missing[i];
+    tasks.push_back(std::async(std::launch::async, readSource, std::ref(sources[i])));
+  }
 
-  std::cout << "Model \"" << name << "\" was loaded successfully" << std::endl;
-  return handlers[id];
+  // Ошибка чтения передаётся через get() после завершения всех потоков
+  for (auto& task : tasks)
+    task.wait();
+  for (auto& task : tasks)
+    task.get();
+
+  // Общие буферы и текстуры заполняются последовательно, в порядке запроса
+  for (auto& source : sources)
+    addSource(source);
 }
 
 Models::Instance Models::get(const std::string& name) {
@@ -70,29 +111,45 @@ void Models::destroy(const std::string& name) {
     return;
   }
 
+  // Диапазоны в общих буферах не переиспользуются до перезапуска
   Instance model = handlers[el->second];
   for (auto shape : model->shapes)
-    core->resources->destroyBuffer(shape->vertexBuffer, shape->vertexBufferMemory);
+    delete shape;
   handlers.erase(handlers.begin() + el->second);
   delete model;
   idList.erase(el);
+  version = ++versions;
+}
+
+uint32_t Models::getVersion() {
+  return version;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Models::parseData(Instance model, tinyobj::ObjReader& reader) {
+void Models::readSource(source_t& source) {
+  // Чтение данных из файла .obj
+  tinyobj::ObjReaderConfig readerConfig;
+  readerConfig.mtl_search_path = "misc\\models\\" + source.name;
+  source.reader.ParseFromFile("misc\\models\\" + source.name + "\\" + source.name + ".obj", readerConfig);
+
+  // Проверка корректного чтения
+  if (!source.reader.Error().empty())
+    throw std::runtime_error("ERROR: " + source.reader.Error());
+
   // Данные TOL
-  auto& attributes = reader.GetAttrib();    // Координаты, нормали, UV, ...
-  auto& shapes = reader.GetShapes();        // Объекты, в виде наборов индексов атрибуты
-  auto& materials = reader.GetMaterials();  // Дополнительные параметры
+  auto& attributes = source.reader.GetAttrib();  // Координаты, нормали, UV, ...
+  auto& shapes = source.reader.GetShapes();      // Объекты, в виде наборов индексов атрибуты
 
   // Прочитаем каждый объект
-  for (auto& shape : shapes) {
+  source.shapes.resize(shapes.size());
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    auto& shape = shapes[i];
+    auto& shapeData = source.shapes[i];
     size_t index_offset = 0;
 
-    std::vector<float> bufferData;
-    model_t::shape_t* shapeData = new model_t::shape_t;
-    shapeData->verticesCount = 0;
+    // Повторяющиеся пары (позиция, UV) становятся одной вершиной
+    std::unordered_map<uint64_t, uint32_t> uniqueVertices;
 
     // Количество полигонов в объекте
     size_t faces_count = shape.mesh.num_face_vertices.size();
@@ -112,48 +169,180 @@ void Models::parseData(Instance model, tinyobj::ObjReader& reader) {
         uint32_t vertexIndex = idx.vertex_index;
         uint32_t texcoordIndex = idx.texcoord_index;
 
-        // Мировые координаты
-        bufferData.push_back(attributes.vertices[3 * vertexIndex + 0]);
-        bufferData.push_back(attributes.vertices[3 * vertexIndex + 1]);
-        bufferData.push_back(attributes.vertices[3 * vertexIndex + 2]);
+        uint64_t key = (static_cast<uint64_t>(vertexIndex) << 32) | texcoordIndex;
+        auto found = uniqueVertices.find(key);
+        if (found != uniqueVertices.end()) {
+          shapeData.indices.push_back(found->second);
+          continue;
+        }
+        uint32_t index = static_cast<uint32_t>(uniqueVertices.size());
+        uniqueVertices.insert(std::make_pair(key, index));
+        shapeData.indices.push_back(index);
 
-        // Текстурные координаты
-        bufferData.push_back(attributes.texcoords[2 * texcoordIndex + 0]);
-        bufferData.push_back(1.0f - attributes.texcoords[2 * texcoordIndex + 1]);
+        // Мировые и текстурные координаты
+        shapeData.vertices.push_back({
+            glm::make_vec3(&attributes.vertices[3 * vertexIndex]),
+            {attributes.texcoords[2 * texcoordIndex + 0], 1.0f - attributes.texcoords[2 * texcoordIndex + 1]}});
       }
 
       // Переход к следующему полигону
       index_offset += face_vertices_count;
     }
-    shapeData->verticesCount = bufferData.size() / 5;
 
-    // Получим материалы объекта
-    if (materials.empty()) continue;
-    auto idx = shape.mesh.material_ids[0];
+    // Вершина - 5 плотно упакованных чисел
+    shapeData.bounds = computeBounds(reinterpret_cast<const float*>(shapeData.vertices.data()), shapeData.vertices.size(), 5);
+  }
+}
+
+Models::Instance Models::addSource(source_t& source) {
+  if (!source.reader.Warning().empty())
+    std::cerr << "WARNING [TinyObjReader]:" << source.reader.Warning() << std::endl;
+
+  // Инициализация модели
+  Instance model = new model_t;
+  model->name = source.name;
+  model->objPath = "misc\\models\\" + source.name + "\\" + source.name + ".obj";
+  model->mtlPath = "misc\\models\\" + source.name;
+
+  auto& shapes = source.reader.GetShapes();
+  auto& materials = source.reader.GetMaterials();  // Дополнительные параметры
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    auto& shapeSource = source.shapes[i];
+    model_t::shape_t* shapeData = new model_t::shape_t;
+    shapeData->verticesCount = static_cast<uint32_t>(shapeSource.vertices.size());
+    shapeData->indicesCount = static_cast<uint32_t>(shapeSource.indices.size());
+    shapeData->bounds = shapeSource.bounds;
+    model->bounds = model->shapes.empty() ? shapeData->bounds : mergeBounds(model->bounds, shapeData->bounds);
+
+    // Добавление в общие буферы
+    shapeData->firstIndex = static_cast<uint32_t>(indices.size());
+    shapeData->vertexOffset = static_cast<int32_t>(vertices.size());
+    indices.insert(indices.end(), shapeSource.indices.begin(), shapeSource.indices.end());
+    vertices.insert(vertices.end(), shapeSource.vertices.begin(), shapeSource.vertices.end());
+    geometry.changed = true;
 
-    // Загрузка текстур
+    // Материал по умолчанию - текстура и сэмплер с индексом 0
     shapeData->diffuseTextureID = 0;
-    if (materials[idx].diffuse_texname.length() > 1) {
-      std::string texturePath = model->mtlPath + "\\" + materials[idx].diffuse_texname;
-      textures->load(texturePath);
-      shapeData->diffuseTextureID = textures->getID(texturePath);
+    shapeData->samplerID = 0;
+    shapeData->virtualTextureID = 0;
+
+    // Получим материалы объекта (часть форм может быть без материала)
+    auto& materialIDs = shapes[i].mesh.material_ids;
+    int idx = materialIDs.empty() ? -1 : materialIDs[0];
+    if (idx >= 0 && idx < static_cast<int>(materials.size()) && materials[idx].diffuse_texname.length() > 1) {
+      // Параметры фильтрации материала (-clamp on, -boost value)
+      auto& options = materials[idx].diffuse_texopt;
+      Resources::sampler_t sampler;
+      if (options.clamp)
+        sampler.address = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+      sampler.lodBias = 1.0f - options.sharpness;
+      setTexture(shapeData, model->mtlPath + "\\" + materials[idx].diffuse_texname, sampler);
     }
 
-    // Отправка данных на устройство
-    VkDeviceSize size = bufferData.size() * sizeof(float);
-    core->resources->createBuffer(
-        size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        shapeData->vertexBuffer, shapeData->vertexBufferMemory);
+    model->shapes.push_back(shapeData);
+  }
 
-    core->commands->copyDataToBuffer(
-        bufferData.data(),
-        shapeData->vertexBuffer,
-        size);
+  // Запись модели
+  uint32_t id = static_cast<uint32_t>(handlers.size());
+  idList.insert(std::make_pair(source.name, id));
+  handlers.push_back(model);
+  version = ++versions;
 
-    model->shapes.push_back(shapeData);
+  std::cout << "Model \"" << source.name << "\" was loaded successfully" << std::endl;
+  return model;
+}
+
+void Models::setTexture(model_t::shape_t* shape, const std::string& texturePath, const Resources::sampler_t& sampler) {
+  std::string extension = ".vt";
+  bool isVirtual = texturePath.size() > extension.size() &&
+                   texturePath.compare(texturePath.size() - extension.size(), extension.size(), extension) == 0;
+  if (isVirtual) {
+    // Заранее нарезанная текстура подгружается по страницам
+    virtualTextures->load(texturePath);
+    shape->virtualTextureID = virtualTextures->getID(texturePath) + 1;
+  } else {
+    textures->load(texturePath);
+    shape->diffuseTextureID = textures->getID(texturePath);
+    shape->samplerID = textures->getSamplerID(sampler);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Models::update() {
+  if (!geometry.changed)
+    return;
+
+  // Буферы могут использоваться кадрами в работе
+  if (geometry.vertexBuffer != VK_NULL_HANDLE)
+    vkDeviceWaitIdle(core->device);
+  destroyGeometry();
+
+  VkDeviceSize size = vertices.size() * sizeof(vertex_t);
+  core->resources->createBuffer(
+      size,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      geometry.vertexBuffer, geometry.vertexMemory);
+  core->commands->copyDataToBuffer(vertices.data(), geometry.vertexBuffer, size);
+
+  size = indices.size() * sizeof(uint32_t);
+  core->resources->createBuffer(
+      size,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      geometry.indexBuffer, geometry.indexMemory);
+  core->commands->copyDataToBuffer(indices.data(), geometry.indexBuffer, size);
+
+  geometry.changed = false;
+}
+
+void Models::destroyGeometry() {
+  if (geometry.vertexBuffer != VK_NULL_HANDLE)
+    core->resources->destroyBuffer(geometry.vertexBuffer, geometry.vertexMemory);
+  if (geometry.indexBuffer != VK_NULL_HANDLE)
+    core->resources->destroyBuffer(geometry.indexBuffer, geometry.indexMemory);
+  geometry.vertexBuffer = VK_NULL_HANDLE;
+  geometry.indexBuffer = VK_NULL_HANDLE;
+}
+
+VkBuffer Models::getVertexBuffer() {
+  return geometry.vertexBuffer;
+}
+
+VkBuffer Models::getIndexBuffer() {
+  return geometry.indexBuffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Models::bounds_t Models::computeBounds(const float* vertices, size_t count, size_t stride) {
+  bounds_t bounds;
+  if (count == 0)
+    return bounds;
+
+  bounds.min = bounds.max = glm::make_vec3(vertices);
+  for (size_t i = 1; i < count; ++i) {
+    glm::float3 position = glm::make_vec3(vertices + i * stride);
+    bounds.min = glm::min(bounds.min, position);
+    bounds.max = glm::max(bounds.max, position);
   }
+
+  // Сфера вокруг центра AABB - радиус по самой дальней вершине
+  bounds.center = (bounds.min + bounds.max) * 0.5f;
+  for (size_t i = 0; i < count; ++i)
+    bounds.radius = std::max(bounds.radius, glm::distance(bounds.center, glm::make_vec3(vertices + i * stride)));
+  return bounds;
+}
+
+Models::bounds_t Models::mergeBounds(const bounds_t& a, const bounds_t& b) {
+  bounds_t bounds;
+  bounds.min = glm::min(a.min, b.min);
+  bounds.max = glm::max(a.max, b.max);
+  bounds.center = (bounds.min + bounds.max) * 0.5f;
+  bounds.radius = std::max(glm::distance(bounds.center, a.center) + a.radius,
+                           glm::distance(bounds.center, b.center) + b.radius);
+  return bounds;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3,10 +3,12 @@
 // Сторонние библиотеки
 #include <tiny_obj_loader.h>
 #include <glm/gtx/compatibility.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 // Внутренние библиотеки
 #include "core.h"
 #include "resources/textures.h"
+#include "resources/virtual.h"
 
 // Стандартные библиотеки
 #include <iostream>
@@ -15,6 +17,7 @@
 #include <set>
 #include <utility>
 #include <unordered_map>
+#include <future>
 
 class Models {
  public:
@@ -25,6 +28,14 @@ class Models {
     glm::float2 uv;
   } * Vertex;
 
+  // Ограничивающие объёмы в локальных координатах
+  struct bounds_t {
+    glm::float3 min = glm::float3(0.0f);     // AABB
+    glm::float3 max = glm::float3(0.0f);
+    glm::float3 center = glm::float3(0.0f);  // Сфера
+    float radius = 0.0f;
+  };
+
   typedef struct model_t {
     // Метаданные
     std::string name;
@@ -32,31 +43,89 @@ class Models {
     std::string mtlPath;
 
     struct shape_t {
+      // Диапазон в общих буферах вершин и индексов
       uint32_t verticesCount;
-      uint32_t diffuseTextureID;
+      uint32_t indicesCount;
+      uint32_t firstIndex;
+      int32_t vertexOffset;
 
-      VkBuffer vertexBuffer;
-      VkDeviceMemory vertexBufferMemory;
+      uint32_t diffuseTextureID;
+      uint32_t samplerID;  // Ячейка сэмплера материала в таблице текстур
+      uint32_t virtualTextureID;  // 0 - нет виртуальной текстуры, иначе id + 1
+      bounds_t bounds;
     };
 
     std::vector<shape_t*> shapes;
+    bounds_t bounds;
   } * Instance;
 
  private:
   Core::Manager core;
   Textures::Manager textures;
+  VirtualTextures::Manager virtualTextures;
 
   std::vector<Instance> handlers;
   std::unordered_map<std::string, uint32_t> idList;
+  uint32_t version = 0;
+
+  // Геометрия всех моделей в общих буферах - подключается один раз за проход
+  std::vector<vertex_t> vertices;
+  std::vector<uint32_t> indices;
+  struct {
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+    bool changed = false;
+  } geometry;
 
  public:
-  Models(Core::Manager, Textures::Manager);
+  Models(Core::Manager, Textures::Manager, VirtualTextures::Manager);
   ~Models();
 
+  // Переопределение материала всех форм модели
+  struct material_t {
+    std::string name;
+    std::string texture;  // Путь к диффузной текстуре
+    bool clamp = false;
+    float lodBias = 0.0f;
+  };
+
   Instance load(const std::string& name);
+  Instance load(const std::string& name, const material_t&);  // Вариант модели с общей геометрией
+
+  // Чтение и разбор незагруженных моделей в параллельных потоках,
+  // затем последовательное добавление геометрии и текстур
+  void load(const std::vector<std::string>& names);
+
   Instance get(const std::string& name);
   void destroy(const std::string& name);
 
+  // Меняется при добавлении и удалении моделей - данные, привязанные к адресам форм, устаревают
+  uint32_t getVersion();
+
+  // Отправка новой геометрии на устройство (с ожиданием устройства, если буферы уже используются)
+  void update();
+  VkBuffer getVertexBuffer();
+  VkBuffer getIndexBuffer();
+
  private:
-  void parseData(Instance, tinyobj::ObjReader&);
+  // Данные модели, прочитанные с диска - без обращения к устройству и общим буферам
+  struct source_t {
+    std::string name;
+    tinyobj::ObjReader reader;
+    struct shape_t {
+      std::vector<vertex_t> vertices;
+      std::vector<uint32_t> indices;
+      bounds_t bounds;
+    };
+    std::vector<shape_t> shapes;
+  };
+
+  static void readSource(source_t&);
+  Instance addSource(source_t&);
+  void setTexture(model_t::shape_t*, const std::string& path, const Resources::sampler_t&);
+  void destroyGeometry();
+  static bounds_t computeBounds(const float* vertices, size_t count, size_t stride);
+  static bounds_t mergeBounds(const bounds_t&, const bounds_t&);
 };
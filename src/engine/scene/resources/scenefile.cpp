@@ -0,0 +1,536 @@
+#include "scenefile.h"
+
+// Стандартные библиотеки
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+// Отображение файлов в память
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Значение JSON - достаточное для описания сцены
+struct json_t {
+  enum Type {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+  } type = JSON_NULL;
+
+  double number = 0.0;
+  std::string string;
+  std::vector<json_t> items;
+  std::vector<std::pair<std::string, json_t>> members;
+
+  const json_t* find(const char* key) const {
+    for (auto& member : members)
+      if (member.first == key)
+        return &member.second;
+    return nullptr;
+  }
+};
+
+// Разбор рекурсивным спуском
+class JsonParser {
+ public:
+  JsonParser(const char* begin, const char* end, const std::string& path) : current(begin), end(end), path(path) {}
+
+  json_t parse() {
+    json_t value = parseValue();
+    skipSpaces();
+    if (current != end)
+      fail("unexpected data after the root value");
+    return value;
+  }
+
+ private:
+  const char* current;
+  const char* end;
+  const std::string& path;
+  uint32_t line = 1;
+
+  [[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error("ERROR: Failed to parse scene " + path + " (line " + std::to_string(line) + "): " + message);
+  }
+
+  void skipSpaces() {
+    while (current != end && (*current == ' ' || *current == '\t' || *current == '\r' || *current == '\n')) {
+      if (*current == '\n')
+        line++;
+      current++;
+    }
+  }
+
+  void expect(char symbol) {
+    skipSpaces();
+    if (current == end || *current != symbol)
+      fail(std::string("expected '") + symbol + "'");
+    current++;
+  }
+
+  bool consume(char symbol) {
+    skipSpaces();
+    if (current != end && *current == symbol) {
+      current++;
+      return true;
+    }
+    return false;
+  }
+
+  json_t parseValue() {
+    skipSpaces();
+    if (current == end)
+      fail("unexpected end of file");
+
+    json_t value;
+    switch (*current) {
+      case '{':
+        value.type = json_t::JSON_OBJECT;
+        current++;
+        if (consume('}'))
+          return value;
+        do {
+          skipSpaces();
+          std::string key = parseString();
+          expect(':');
+          value.members.emplace_back(std::move(key), parseValue());
+        } while (consume(','));
+        expect('}');
+        return value;
+
+      case '[':
+        value.type = json_t::JSON_ARRAY;
+        current++;
+        if (consume(']'))
+          return value;
+        do {
+          value.items.push_back(parseValue());
+        } while (consume(','));
+        expect(']');
+        return value;
+
+      case '"':
+        value.type = json_t::JSON_STRING;
+        value.string = parseString();
+        return value;
+
+      case 't':
+      case 'f':
+      case 'n':
+        return parseLiteral();
+
+      default:
+        value.type = json_t::JSON_NUMBER;
+        value.number = parseNumber();
+        return value;
+    }
+  }
+
+  std::string parseString() {
+    if (current == end || *current != '"')
+      fail("expected string");
+    current++;
+
+    std::string result;
+    while (current != end && *current != '"') {
+      char symbol = *current++;
+      if (symbol == '\n')
+        fail("unterminated string");
+      if (symbol != '\\') {
+        result.push_back(symbol);
+        continue;
+      }
+      if (current == end)
+        fail("unterminated string");
+
+      // Пути Windows пишутся с экранированной обратной чертой
+      switch (*current++) {
+        case '"': result.push_back('"'); break;
+        case '\\': result.push_back('\\'); break;
+        case '/': result.push_back('/'); break;
+        case 'n': result.push_back('\n'); break;
+        case 't': result.push_back('\t'); break;
+        default: fail("unsupported escape sequence");
+      }
+    }
+    if (current == end)
+      fail("unterminated string");
+    current++;
+    return result;
+  }
+
+  double parseNumber() {
+    const char* start = current;
+    while (current != end && (std::strchr("+-.eE", *current) != nullptr || (*current >= '0' && *current <= '9')))
+      current++;
+    if (start == current)
+      fail("unexpected symbol");
+
+    std::string text(start, current);
+    char* last;
+    double number = std::strtod(text.c_str(), &last);
+    if (*last != '\0')
+      fail("invalid number " + text);
+    return number;
+  }
+
+  json_t parseLiteral() {
+    json_t value;
+    for (const char* literal : {"true", "false", "null"}) {
+      size_t length = std::strlen(literal);
+      if (static_cast<size_t>(end - current) >= length && std::strncmp(current, literal, length) == 0) {
+        current += length;
+        value.type = literal[0] == 'n' ? json_t::JSON_NULL : json_t::JSON_BOOL;
+        value.number = literal[0] == 't' ? 1.0 : 0.0;
+        return value;
+      }
+    }
+    fail("unexpected symbol");
+  }
+};
+
+void readVector(const json_t* value, float* result, const std::string& path) {
+  if (value == nullptr)
+    return;
+  if (value->type != json_t::JSON_ARRAY || value->items.size() != 3)
+    throw std::runtime_error("ERROR: Scene " + path + ": vectors must be arrays of 3 numbers");
+  for (uint32_t i = 0; i < 3; ++i)
+    result[i] = static_cast<float>(value->items[i].number);
+}
+
+// Строки пишутся с экранированием кавычек и обратной черты
+void writeString(std::ostream& stream, const std::string& string) {
+  stream << '"';
+  for (char symbol : string) {
+    if (symbol == '"' || symbol == '\\')
+      stream << '\\';
+    stream << symbol;
+  }
+  stream << '"';
+}
+
+void writeVector(std::ostream& stream, const float* vector) {
+  char buffer[96];
+  std::snprintf(buffer, sizeof(buffer), "[%.9g, %.9g, %.9g]", vector[0], vector[1], vector[2]);
+  stream << buffer;
+}
+
+}  // namespace
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SceneFile::~SceneFile() {
+  unmap();
+}
+
+bool SceneFile::isText(const std::string& path) {
+  std::string extension = ".json";
+  return path.size() > extension.size() &&
+         path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+void SceneFile::load(const std::string& path) {
+  if (isText(path))
+    loadText(path);
+  else
+    loadBinary(path);
+}
+
+void SceneFile::save(const std::string& path) {
+  if (isText(path))
+    saveText(path);
+  else
+    saveBinary(path);
+}
+
+std::span<const SceneFile::object_t> SceneFile::getObjects() const {
+  return {objects, objectCount};
+}
+
+void SceneFile::setObjects(std::vector<object_t>&& objects) {
+  unmap();
+  storage = std::move(objects);
+  this->objects = storage.data();
+  objectCount = static_cast<uint32_t>(storage.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneFile::loadText(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    throw std::runtime_error("ERROR: Failed to open scene: " + path);
+  std::stringstream content;
+  content << file.rdbuf();
+  std::string text = content.str();
+
+  json_t root = JsonParser(text.data(), text.data() + text.size(), path).parse();
+  if (root.type != json_t::JSON_OBJECT)
+    throw std::runtime_error("ERROR: Scene " + path + ": root must be an object");
+
+  models.clear();
+  materials.clear();
+
+  // Материалы задаются по имени: "materials": {"имя": {"texture": ..., "clamp": ..., "lodBias": ...}}
+  std::unordered_map<std::string, uint32_t> materialIDs;
+  if (auto list = root.find("materials")) {
+    for (auto& [name, value] : list->members) {
+      material_t material;
+      material.name = name;
+      if (auto texture = value.find("texture"))
+        material.texture = texture->string;
+      if (auto clamp = value.find("clamp"))
+        material.clamp = clamp->number != 0.0;
+      if (auto lodBias = value.find("lodBias"))
+        material.lodBias = static_cast<float>(lodBias->number);
+      materialIDs[name] = static_cast<uint32_t>(materials.size());
+      materials.push_back(material);
+    }
+  }
+
+  // Таблица моделей - различные модели объектов в порядке появления
+  std::unordered_map<std::string, uint32_t> modelIDs;
+  std::vector<object_t> result;
+  auto list = root.find("objects");
+  if (list == nullptr || list->type != json_t::JSON_ARRAY)
+    throw std::runtime_error("ERROR: Scene " + path + ": \"objects\" array is required");
+  result.reserve(list->items.size());
+
+  for (auto& value : list->items) {
+    object_t object{};
+    object.material = none;
+    object.parent = none;
+    object.scale[0] = object.scale[1] = object.scale[2] = 1.0f;
+
+    auto model = value.find("model");
+    if (model == nullptr || model->type != json_t::JSON_STRING)
+      throw std::runtime_error("ERROR: Scene " + path + ": object #" + std::to_string(result.size()) + " has no model");
+    auto found = modelIDs.find(model->string);
+    if (found == modelIDs.end()) {
+      found = modelIDs.emplace(model->string, static_cast<uint32_t>(models.size())).first;
+      models.push_back(model->string);
+    }
+    object.model = found->second;
+
+    if (auto material = value.find("material")) {
+      auto id = materialIDs.find(material->string);
+      if (id == materialIDs.end())
+        throw std::runtime_error("ERROR: Scene " + path + ": unknown material " + material->string);
+      object.material = id->second;
+    }
+
+    // Родитель - индекс объекта, описанного раньше: целое число проверяется до приведения
+    if (auto parent = value.find("parent")) {
+      double number = parent->number;
+      bool index = parent->type == json_t::JSON_NUMBER && number == std::floor(number);
+      if (!index || number < 0.0 || number >= static_cast<double>(result.size()))
+        throw std::runtime_error("ERROR: Scene " + path + ": parent must precede object #" + std::to_string(result.size()));
+      object.parent = static_cast<uint32_t>(number);
+    }
+
+    readVector(value.find("position"), object.position, path);
+    readVector(value.find("rotation"), object.rotation, path);
+    readVector(value.find("scale"), object.scale, path);
+    result.push_back(object);
+  }
+
+  setObjects(std::move(result));
+}
+
+void SceneFile::saveText(const std::string& path) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open())
+    throw std::runtime_error("ERROR: Failed to create scene: " + path);
+
+  file << "{\n  \"materials\": {";
+  for (uint32_t i = 0; i < materials.size(); ++i) {
+    auto& material = materials[i];
+    file << (i == 0 ? "\n" : ",\n") << "    ";
+    writeString(file, material.name);
+    file << ": {\"texture\": ";
+    writeString(file, material.texture);
+    file << ", \"clamp\": " << (material.clamp ? "true" : "false")
+         << ", \"lodBias\": " << material.lodBias << "}";
+  }
+  file << (materials.empty() ? "},\n" : "\n  },\n");
+
+  file << "  \"objects\": [";
+  auto list = getObjects();
+  for (uint32_t i = 0; i < list.size(); ++i) {
+    auto& object = list[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\"model\": ";
+    writeString(file, models[object.model]);
+    if (object.material != none) {
+      file << ", \"material\": ";
+      writeString(file, materials[object.material].name);
+    }
+    if (object.parent != none)
+      file << ", \"parent\": " << object.parent;
+    file << ", \"position\": ";
+    writeVector(file, object.position);
+    file << ", \"rotation\": ";
+    writeVector(file, object.rotation);
+    file << ", \"scale\": ";
+    writeVector(file, object.scale);
+    file << "}";
+  }
+  file << (list.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneFile::loadBinary(const std::string& path) {
+  unmap();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("ERROR: Failed to open scene: " + path);
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (data == nullptr) {
+    if (mapping != nullptr)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("ERROR: Failed to map scene: " + path);
+  }
+  mapped.file = file;
+  mapped.mapping = mapping;
+  mapped.size = static_cast<size_t>(size.QuadPart);
+#else
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0)
+    throw std::runtime_error("ERROR: Failed to open scene: " + path);
+  struct stat info;
+  fstat(file, &info);
+  void* data = info.st_size > 0 ? mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+  close(file);
+  if (data == MAP_FAILED)
+    throw std::runtime_error("ERROR: Failed to map scene: " + path);
+  mapped.size = static_cast<size_t>(info.st_size);
+#endif
+  mapped.data = data;
+
+  // Проверка размеров таблиц до обращения к ним
+  const char* bytes = static_cast<const char*>(mapped.data);
+  header_t header;
+  if (mapped.size < sizeof(header_t))
+    throw std::runtime_error("ERROR: Scene is truncated: " + path);
+  std::memcpy(&header, bytes, sizeof(header_t));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version)
+    throw std::runtime_error("ERROR: Unsupported scene format: " + path);
+
+  size_t modelsOffset = sizeof(header_t);
+  size_t materialsOffset = modelsOffset + header.modelCount * sizeof(model_t);
+  size_t objectsOffset = materialsOffset + header.materialCount * sizeof(material_record_t);
+  size_t stringsOffset = objectsOffset + static_cast<size_t>(header.objectCount) * sizeof(object_t);
+  if (stringsOffset + header.stringsSize != mapped.size)
+    throw std::runtime_error("ERROR: Scene is truncated: " + path);
+
+  const char* strings = bytes + stringsOffset;
+  auto getString = [&](uint32_t offset) {
+    if (offset >= header.stringsSize)
+      throw std::runtime_error("ERROR: Scene has invalid string offset: " + path);
+    return std::string(strings + offset, strnlen(strings + offset, header.stringsSize - offset));
+  };
+
+  // Малые таблицы копируются, объекты читаются прямо из отображения
+  models.resize(header.modelCount);
+  auto modelRecords = reinterpret_cast<const model_t*>(bytes + modelsOffset);
+  for (uint32_t i = 0; i < header.modelCount; ++i)
+    models[i] = getString(modelRecords[i].name);
+
+  materials.resize(header.materialCount);
+  auto materialRecords = reinterpret_cast<const material_record_t*>(bytes + materialsOffset);
+  for (uint32_t i = 0; i < header.materialCount; ++i) {
+    materials[i].name = getString(materialRecords[i].name);
+    materials[i].texture = getString(materialRecords[i].texture);
+    materials[i].clamp = materialRecords[i].clamp != 0;
+    materials[i].lodBias = materialRecords[i].lodBias;
+  }
+
+  storage.clear();
+  objects = reinterpret_cast<const object_t*>(bytes + objectsOffset);
+  objectCount = header.objectCount;
+}
+
+void SceneFile::saveBinary(const std::string& path) {
+  // Таблица строк: имена моделей и материалов, пути текстур
+  std::string strings;
+  auto addString = [&](const std::string& string) {
+    uint32_t offset = static_cast<uint32_t>(strings.size());
+    strings.append(string);
+    strings.push_back('\0');
+    return offset;
+  };
+
+  std::vector<model_t> modelRecords(models.size());
+  for (uint32_t i = 0; i < models.size(); ++i)
+    modelRecords[i].name = addString(models[i]);
+
+  std::vector<material_record_t> materialRecords(materials.size());
+  for (uint32_t i = 0; i < materials.size(); ++i) {
+    materialRecords[i].name = addString(materials[i].name);
+    materialRecords[i].texture = addString(materials[i].texture);
+    materialRecords[i].clamp = materials[i].clamp ? 1 : 0;
+    materialRecords[i].lodBias = materials[i].lodBias;
+  }
+
+  auto list = getObjects();
+  header_t header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.modelCount = static_cast<uint32_t>(modelRecords.size());
+  header.materialCount = static_cast<uint32_t>(materialRecords.size());
+  header.objectCount = static_cast<uint32_t>(list.size());
+  header.stringsSize = static_cast<uint32_t>(strings.size());
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open())
+    throw std::runtime_error("ERROR: Failed to create scene: " + path);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header_t));
+  file.write(reinterpret_cast<const char*>(modelRecords.data()), modelRecords.size() * sizeof(model_t));
+  file.write(reinterpret_cast<const char*>(materialRecords.data()), materialRecords.size() * sizeof(material_record_t));
+  file.write(reinterpret_cast<const char*>(list.data()), list.size() * sizeof(object_t));
+  file.write(strings.data(), strings.size());
+  if (!file)
+    throw std::runtime_error("ERROR: Failed to write scene: " + path);
+}
+
+void SceneFile::unmap() {
+  if (mapped.data == nullptr)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(mapped.data);
+  CloseHandle(static_cast<HANDLE>(mapped.mapping));
+  CloseHandle(static_cast<HANDLE>(mapped.file));
+#else
+  munmap(mapped.data, mapped.size);
+#endif
+  mapped = {};
+  objects = nullptr;
+  objectCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,100 @@
+#pragma once
+
+// Стандартные библиотеки
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Описание сцены: таблицы моделей, переопределений материалов и объектов
+// Текстовая форма (JSON) редактируется вручную, двоичная - отображается в память
+// и читается за один проход: таблица объектов используется прямо из отображения.
+// Не зависит от устройства - используется и движком, и инструментом преобразования
+class SceneFile {
+ public:
+  typedef SceneFile* Instance;
+
+  static constexpr uint32_t none = UINT32_MAX;
+
+  SceneFile() = default;
+  ~SceneFile();
+
+  SceneFile(const SceneFile&) = delete;
+  SceneFile& operator=(const SceneFile&) = delete;
+
+  // Переопределение материала всех форм модели
+  struct material_t {
+    std::string name;
+    std::string texture;  // Путь к диффузной текстуре
+    bool clamp = false;
+    float lodBias = 0.0f;
+  };
+
+  // ~ Запись таблицы объектов двоичной формы
+  struct object_t {
+    uint32_t model;     // Индекс в таблице моделей
+    uint32_t material;  // Индекс в таблице материалов или none
+    uint32_t parent;    // Индекс объекта, записанного раньше, или none
+    uint32_t padding;
+    float position[3];
+    float rotation[3];  // Углы Эйлера в градусах
+    float scale[3];
+  };
+
+  std::vector<std::string> models;
+  std::vector<material_t> materials;
+
+  // Форма выбирается по расширению: .json - текстовая, иначе двоичная
+  void load(const std::string& path);
+  void save(const std::string& path);
+
+  void loadText(const std::string& path);
+  void saveText(const std::string& path);
+  void loadBinary(const std::string& path);
+  void saveBinary(const std::string& path);
+
+  std::span<const object_t> getObjects() const;
+  void setObjects(std::vector<object_t>&& objects);
+
+  static bool isText(const std::string& path);
+
+ private:
+  // Объекты текстовой формы или созданные в коде
+  std::vector<object_t> storage;
+
+  // Отображение двоичной формы - таблица объектов указывает в него
+  struct {
+    void* data = nullptr;
+    size_t size = 0;
+    void* file = nullptr;     // Дескрипторы Windows
+    void* mapping = nullptr;
+  } mapped;
+  const object_t* objects = nullptr;
+  uint32_t objectCount = 0;
+
+  void unmap();
+
+  // ~ Заголовок двоичной формы, за ним таблицы моделей, материалов, объектов и строки
+  struct header_t {
+    char magic[4];
+    uint32_t version;
+    uint32_t modelCount;
+    uint32_t materialCount;
+    uint32_t objectCount;
+    uint32_t stringsSize;
+  };
+
+  // ~ Записи таблиц моделей и материалов - строки задаются смещением в таблице строк
+  struct model_t {
+    uint32_t name;
+  };
+  struct material_record_t {
+    uint32_t name;
+    uint32_t texture;
+    uint32_t clamp;
+    float lodBias;
+  };
+
+  static constexpr char magic[4] = {'N', 'V', 'S', 'C'};
+  static constexpr uint32_t version = 1;
+};
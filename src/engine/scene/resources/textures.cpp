@@ -1,38 +1,143 @@
-#define STB_IMAGE_STATIC
+// Единственная реализация stb_image движка - её используют и виртуальные текстуры
 #define STB_IMAGE_IMPLEMENTATION
 
 #include "textures.h"
 
 Textures::Textures(Core::Manager core) {
   this->core = core;
+  createTable();
+
+  // Сэмплер по умолчанию - ячейка 0
+  getSamplerID(Resources::sampler_t());
 }
 
 Textures::~Textures() {
+  for (auto& el : retired)
+    handlers.push_back(el.texture);
   for (auto texture : handlers) {
+    if (texture == nullptr)
+      continue;
     core->resources->destroyImageView(texture->view);
     core->resources->destroyImage(texture->image, texture->memory);
     delete texture;
   }
+  destroyTable();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 Textures::Instance Textures::load(const std::string& name) {
+  return load(name, detectUsage(name));
+}
+
+Textures::Instance Textures::load(const std::string& name, Usage usage) {
   // Найдем уже загруженную текстуру
   auto el = idList.find(name);
   if (el != idList.end())
     return handlers[el->second];
 
+  // Найдем текстуру с тем же файлом и назначением
+  std::vector<char> file = read(name);
+  uint64_t fileHash = hash(&usage, sizeof(usage));
+  fileHash = hash(file.data(), file.size(), fileHash);
+  auto same = fileHashList.find(fileHash);
+  bool sameFile = same != fileHashList.end() && handlers[same->second.id]->usage == usage &&
+                  read(same->second.file) == file;
+  if (sameFile) {
+    auto texture = handlers[insert(name, handlers[same->second.id])];
+    std::cout << "Texture \"" << name << "\" shares image by file content (" << texture->size << " bytes saved)" << std::endl;
+    return texture;
+  }
+
+  // Получим изображение в виде набора пикселов
+  int width, height;
+  stbi_uc* pixels = stbi_load_from_memory(
+      reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+      &width, &height, nullptr, STBI_rgb_alpha);
+  if (!pixels)
+    throw std::runtime_error(std::string("ERROR: Failed to load texture image: ") + name);
+
+  // Найдем текстуру с теми же пикселами
+  uint64_t pixelsHash = hash(&usage, sizeof(usage));
+  pixelsHash = hash(&width, sizeof(width), pixelsHash);
+  pixelsHash = hash(&height, sizeof(height), pixelsHash);
+  pixelsHash = hash(pixels, static_cast<size_t>(width) * height * 4, pixelsHash);
+  same = pixelsHashList.find(pixelsHash);
+  bool sameContent = same != pixelsHashList.end() && handlers[same->second.id]->usage == usage &&
+                     samePixels(same->second.file, pixels, width, height);
+  if (sameContent) {
+    stbi_image_free(pixels);
+    auto texture = handlers[insert(name, handlers[same->second.id])];
+    fileHashList.insert(std::make_pair(fileHash, source_t{idList[name], name}));
+    std::cout << "Texture \"" << name << "\" shares image by pixels (" << texture->size << " bytes saved)" << std::endl;
+    return texture;
+  }
+
   // Запишем новую текстуру
-  texture_t* texture = create(name);
-  uint32_t id = static_cast<uint32_t>(handlers.size());
-  idList.insert(std::make_pair(name, id));
-  handlers.push_back(texture);
+  texture_t* texture = create(file, pixels, usage);
+  texture->references = 0;
+  uint32_t id = insert(name, texture);
+  fileHashList.insert(std::make_pair(fileHash, source_t{id, name}));
+  pixelsHashList.insert(std::make_pair(pixelsHash, source_t{id, name}));
 
-  std::cout << "Texture \"" << name << "\" was loaded successfully" << std::endl;
+  std::cout << "Texture \"" << name << "\" was loaded successfully ("
+            << texture->channels << " channels, "
+            << texture->width * texture->height * 4 - texture->size << " bytes saved)" << std::endl;
   return handlers[id];
 }
 
+uint32_t Textures::insert(const std::string& name, Instance texture) {
+  // Повторное использование уже загруженного изображения
+  if (texture->references > 0) {
+    uint32_t id = idList[texture->name];
+    texture->references++;
+    savedBytes += texture->size;
+    idList.insert(std::make_pair(name, id));
+    return id;
+  }
+
+  texture->references = 1;
+  texture->name = name;
+  uint32_t id = allocateSlot();
+  idList.insert(std::make_pair(name, id));
+  handlers[id] = texture;
+  writeSlot(id, texture->view);
+  return id;
+}
+
+uint32_t Textures::allocateSlot() {
+  if (!freeSlots.empty()) {
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+
+  if (handlers.size() >= capacity)
+    throw std::runtime_error("ERROR: Texture table is full!");
+  handlers.push_back(nullptr);
+  return static_cast<uint32_t>(handlers.size() - 1);
+}
+
+void Textures::update() {
+  frameNumber++;
+  while (!retired.empty() && retired.front().frame <= frameNumber) {
+    auto texture = retired.front().texture;
+    core->resources->destroyImageView(texture->view);
+    core->resources->destroyImage(texture->image, texture->memory);
+    freeSlots.push_back(retired.front().slot);
+    retired.pop_front();
+    delete texture;
+  }
+}
+
+VkDeviceSize Textures::getSavedBytes() {
+  return savedBytes;
+}
+
+VkDeviceSize Textures::getCompactBytes() {
+  return compactBytes;
+}
+
 Textures::Instance Textures::get(const std::string& name) {
   auto el = idList.find(name);
   if (el == idList.end())
@@ -40,12 +145,6 @@ Textures::Instance Textures::get(const std::string& name) {
   return handlers[el->second];
 }
 
-void Textures::getViews(std::vector<VkImageView>& views) {
-  views.clear();
-  for (auto texture : handlers)
-    views.push_back(texture->view);
-}
-
 uint32_t Textures::getID(const std::string& name) {
   auto el = idList.find(name);
   if (el != idList.end())
@@ -55,49 +154,362 @@ uint32_t Textures::getID(const std::string& name) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-Textures::Instance Textures::create(const std::string& name) {
+Textures::Instance Textures::create(const std::vector<char>& file, stbi_uc* pixels, Usage usage) {
   Instance texture = new texture_t;
+  texture->usage = usage;
 
-  // Получим изображение в виде набора пикселов
-  stbi_uc* pixels = stbi_load(name.c_str(), &texture->width, &texture->height, nullptr, STBI_rgb_alpha);
-  texture->size = texture->width * texture->height * 4;
-  if (!pixels)
-    throw std::runtime_error(std::string("ERROR: Failed to load texture image: ") + name);
+  // Размеры изображения
+  stbi_info_from_memory(
+      reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+      &texture->width, &texture->height, nullptr);
+
+  // Формат хранения по числу используемых каналов
+  texture->channels = countChannels(file, pixels, texture->width, texture->height, usage);
+  texture->format = chooseFormat(texture->channels, usage);
+  texture->size = texture->width * texture->height * texture->channels;
+  compactBytes += texture->width * texture->height * 4 - texture->size;
+
+  // Упакуем каналы (пикселы получены в RGBA)
+  size_t count = static_cast<size_t>(texture->width) * texture->height;
+  std::vector<stbi_uc> packed(count * texture->channels);
+  for (size_t i = 0; i < count; ++i) {
+    stbi_uc* src = pixels + i * 4;
+    stbi_uc* dst = packed.data() + i * texture->channels;
+    if (texture->channels == 2 && usage != TEXTURE_NORMAL) {
+      dst[0] = src[0];  // Яркость
+      dst[1] = src[3];  // Прозрачность
+    } else {
+      memcpy(dst, src, texture->channels);
+    }
+  }
+
+  // Удалим сырые данные
+  stbi_image_free(pixels);
 
   // Создание изображения для хранения текстуры
   core->resources->createImage(
       texture->width, texture->height,
-      VK_FORMAT_R8G8B8A8_SRGB,
+      texture->format,
       VK_IMAGE_TILING_OPTIMAL,
       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
       texture->image, texture->memory);
 
   // Заполнение изображения данными
-  core->commands->copyDataToImage(pixels, texture->image, texture->size, texture->width, texture->height);
+  core->commands->copyDataToImage(packed.data(), texture->image, texture->size, texture->width, texture->height);
 
-  // Удалим сырые данные
-  stbi_image_free(pixels);
+  // Шейдеры читают текстуры как RGBA - недостающие каналы восстанавливаются видом изображения
+  VkComponentMapping components{};
+  if (texture->channels == 1) {
+    components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE};
+  } else if (texture->channels == 2 && usage != TEXTURE_NORMAL) {
+    components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G};
+  }
 
   // Создание вида изображения
   texture->view = core->resources->createImageView(
       texture->image,
-      VK_FORMAT_R8G8B8A8_SRGB,
-      VK_IMAGE_ASPECT_COLOR_BIT);
+      texture->format,
+      VK_IMAGE_ASPECT_COLOR_BIT,
+      components);
 
   return texture;
 }
 
+uint32_t Textures::countChannels(const std::vector<char>& file, const stbi_uc* pixels, int width, int height, Usage usage) {
+  // Число каналов, записанных в файле
+  int channels;
+  stbi_info_from_memory(
+      reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+      nullptr, nullptr, &channels);
+
+  if (usage == TEXTURE_NORMAL)
+    return compactNormals ? 2 : 4;
+
+  // Фактически используемые каналы
+  if (analyzeContent) {
+    bool gray = true, opaque = true;
+    size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count && (gray || opaque); ++i) {
+      const stbi_uc* pixel = pixels + i * 4;
+      gray = gray && pixel[0] == pixel[1] && pixel[0] == pixel[2];
+      opaque = opaque && pixel[3] == 255;
+    }
+    if (gray)
+      channels = opaque ? 1 : 2;
+    else
+      channels = opaque ? 3 : 4;
+  }
+
+  // Два канала - яркость и прозрачность, RGB хранится как RGBA
+  return channels >= 3 ? 4 : static_cast<uint32_t>(channels);
+}
+
+Textures::Usage Textures::detectUsage(const std::string& name) {
+  // Слова имени файла без каталога и расширения: "wall_normal.png" -> "wall", "normal"
+  size_t start = name.find_last_of("/\\");
+  start = start == std::string::npos ? 0 : start + 1;
+  size_t end = name.find_last_of('.');
+  if (end == std::string::npos || end < start)
+    end = name.size();
+
+  static const std::unordered_set<std::string> normalWords = {"n", "nrm", "norm", "normal", "normals", "normalmap"};
+  static const std::unordered_set<std::string> dataWords = {
+      "r", "rough", "roughness", "m", "metal", "metallic", "metalness", "ao", "occlusion",
+      "mask", "height", "disp", "displacement", "spec", "specular", "gloss", "opacity", "orm"};
+
+  Usage usage = TEXTURE_COLOR;
+  std::string word;
+  for (size_t i = start; i <= end; ++i) {
+    char symbol = i < end ? static_cast<char>(std::tolower(static_cast<unsigned char>(name[i]))) : '_';
+    if (std::isalnum(static_cast<unsigned char>(symbol))) {
+      word.push_back(symbol);
+      continue;
+    }
+    if (normalWords.count(word))
+      return TEXTURE_NORMAL;
+    if (dataWords.count(word))
+      usage = TEXTURE_DATA;
+    word.clear();
+  }
+  return usage;
+}
+
+VkFormat Textures::chooseFormat(uint32_t& channels, Usage usage) {
+  bool srgb = usage == TEXTURE_COLOR;
+  std::vector<VkFormat> candidates;
+  if (channels == 1)
+    candidates.push_back(srgb ? VK_FORMAT_R8_SRGB : VK_FORMAT_R8_UNORM);
+  if (channels <= 2)
+    candidates.push_back(srgb ? VK_FORMAT_R8G8_SRGB : VK_FORMAT_R8G8_UNORM);
+  candidates.push_back(srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM);
+
+  // Форматы sRGB с одним и двумя каналами поддерживаются не везде
+  VkFormat format = core->resources->findSupportedFormat(
+      candidates,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+
+  switch (format) {
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_R8_UNORM:
+      channels = 1;
+      break;
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R8G8_UNORM:
+      channels = 2;
+      break;
+    default:
+      channels = 4;
+      break;
+  }
+  return format;
+}
+
 void Textures::destroy(const std::string& name) {
   auto el = idList.find(name);
   if (el == idList.end())
     throw std::runtime_error(std::string("ERROR: Failed to destroy texture: ") + name);
-  auto texture = handlers[el->second];
-  core->resources->destroyImageView(texture->view);
-  core->resources->destroyImage(texture->image, texture->memory);
-  handlers.erase(handlers.begin() + el->second);
+  uint32_t id = el->second;
+  auto texture = handlers[id];
   idList.erase(el);
-  delete texture;
+
+  // Хэши, подтверждаемые файлом этого имени, больше нельзя проверить
+  std::erase_if(fileHashList, [&name](const auto& el) { return el.second.file == name; });
+  std::erase_if(pixelsHashList, [&name](const auto& el) { return el.second.file == name; });
+
+  // Изображение используется под другими именами
+  if (--texture->references > 0) {
+    savedBytes -= texture->size;
+    if (texture->name == name)
+      for (auto& other : idList)
+        if (other.second == id) {
+          texture->name = other.first;
+          break;
+        }
+    return;
+  }
+
+  // Ячейка и изображение освобождаются после завершения кадров, использующих их
+  handlers[id] = nullptr;
+  compactBytes -= texture->width * texture->height * 4 - texture->size;
+  retired.push_back({frameNumber + core->framesInFlight, id, texture});
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<char> Textures::read(const std::string& name) {
+  std::ifstream file(name, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+    throw std::runtime_error(std::string("ERROR: Failed to open texture file: ") + name);
+  std::vector<char> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(data.data(), data.size());
+  return data;
+}
+
+bool Textures::samePixels(const std::string& name, const stbi_uc* pixels, int width, int height) {
+  std::vector<char> file = read(name);
+  int otherWidth, otherHeight;
+  stbi_uc* other = stbi_load_from_memory(
+      reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+      &otherWidth, &otherHeight, nullptr, STBI_rgb_alpha);
+  if (!other)
+    return false;
+
+  bool same = otherWidth == width && otherHeight == height &&
+              std::memcmp(other, pixels, static_cast<size_t>(width) * height * 4) == 0;
+  stbi_image_free(other);
+  return same;
+}
+
+// FNV-1a
+uint64_t Textures::hash(const void* data, size_t size, uint64_t seed) {
+  auto bytes = reinterpret_cast<const uint8_t*>(data);
+  uint64_t result = seed;
+  for (size_t i = 0; i < size; ++i) {
+    result ^= bytes[i];
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Textures::createTable() {
+  VkDescriptorSetLayoutBinding samplersLayout{};
+  samplersLayout.binding = 0;
+  samplersLayout.descriptorCount = samplersCapacity;
+  samplersLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  samplersLayout.pImmutableSamplers = nullptr;
+  samplersLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutBinding texturesLayout{};
+  texturesLayout.binding = 1;
+  texturesLayout.descriptorCount = capacity;
+  texturesLayout.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  texturesLayout.pImmutableSamplers = nullptr;
+  texturesLayout.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  // Ячейки записываются по мере загрузки текстур, в том числе во время рендера
+  // Массив переменной длины должен быть последним
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {samplersLayout, texturesLayout};
+  std::array<VkDescriptorBindingFlags, 2> flags = {
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+          VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT,
+  };
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+  flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  flagsInfo.bindingCount = static_cast<uint32_t>(flags.size());
+  flagsInfo.pBindingFlags = flags.data();
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.pNext = &flagsInfo;
+  layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(core->device, &layoutInfo, nullptr, &table.layout) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create texture table layout!");
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes = {{
+      {VK_DESCRIPTOR_TYPE_SAMPLER, samplersCapacity},
+      {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, capacity},
+  }};
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = 1;
+
+  if (vkCreateDescriptorPool(core->device, &poolInfo, nullptr, &table.pool) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to create texture table pool!");
+
+  uint32_t count = capacity;
+  VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{};
+  countInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+  countInfo.descriptorSetCount = 1;
+  countInfo.pDescriptorCounts = &count;
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.pNext = &countInfo;
+  allocInfo.descriptorPool = table.pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &table.layout;
+
+  if (vkAllocateDescriptorSets(core->device, &allocInfo, &table.set) != VK_SUCCESS)
+    throw std::runtime_error("ERROR: Failed to allocate texture table!");
+}
+
+void Textures::destroyTable() {
+  vkDestroyDescriptorPool(core->device, table.pool, nullptr);
+  vkDestroyDescriptorSetLayout(core->device, table.layout, nullptr);
+}
+
+void Textures::writeSlot(uint32_t slot, VkImageView view) {
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView = view;
+
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = table.set;
+  write.dstBinding = 1;
+  write.dstArrayElement = slot;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  write.pImageInfo = &imageInfo;
+
+  vkUpdateDescriptorSets(core->device, 1, &write, 0, nullptr);
+}
+
+void Textures::writeSamplerSlot(uint32_t slot) {
+  VkDescriptorImageInfo samplerInfo{};
+  samplerInfo.sampler = core->resources->getSampler(samplerStates[slot]);
+
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = table.set;
+  write.dstBinding = 0;
+  write.dstArrayElement = slot;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  write.pImageInfo = &samplerInfo;
+
+  vkUpdateDescriptorSets(core->device, 1, &write, 0, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t Textures::getSamplerID(const Resources::sampler_t& state) {
+  for (uint32_t slot = 0; slot < samplerStates.size(); ++slot)
+    if (samplerStates[slot] == state)
+      return slot;
+
+  if (samplerStates.size() >= samplersCapacity)
+    throw std::runtime_error("ERROR: Sampler table is full!");
+  samplerStates.push_back(state);
+  uint32_t slot = static_cast<uint32_t>(samplerStates.size() - 1);
+  writeSamplerSlot(slot);
+  return slot;
+}
+
+void Textures::setSamplerQuality(Resources::SamplerQuality quality) {
+  core->resources->samplerQuality = quality;
+  for (uint32_t slot = 0; slot < samplerStates.size(); ++slot)
+    writeSamplerSlot(slot);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
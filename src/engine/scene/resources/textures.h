@@ -7,40 +7,140 @@
 #include "core.h"
 
 // Стандартные библиотеки
+#include <cctype>
 #include <list>
+#include <array>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <utility>
 #include <unordered_map>
+#include <unordered_set>
 
 class Textures {
  public:
   typedef Textures* Manager;
+
+  // Назначение текстуры определяет формат хранения
+  enum Usage {
+    TEXTURE_COLOR,   // Цвет - хранится в sRGB
+    TEXTURE_DATA,    // Линейные данные (маски, шероховатость и т.п.)
+    TEXTURE_NORMAL,  // Карта нормалей - линейные данные
+  };
+
   typedef struct texture_t {
     int width, height;
+    Usage usage;
+    VkFormat format;
+    uint32_t channels;  // Число хранимых каналов
     VkImage image;
     VkImageView view;
     VkDeviceSize size;
     VkDeviceMemory memory;
+
+    // Имя первой загрузки - одно изображение может использоваться под разными именами
+    std::string name;
+    uint32_t references;
   } * Instance;
 
+  //=========================================================================
+  // Таблица текстур (bindless) - один набор дескрипторов на все проходы
+  // Идентификатор текстуры - постоянный номер её ячейки в таблице
+  // Рядом хранится таблица сэмплеров материалов (binding 0)
+
+  static constexpr uint32_t capacity = 4096;
+  static constexpr uint32_t samplersCapacity = 64;
+
+  struct {
+    VkDescriptorSetLayout layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+  } table;
+
  private:
   Core::Manager core;
 
-  std::vector<Instance> handlers;
+  std::vector<Instance> handlers;  // По номеру ячейки, пустые ячейки - nullptr
   std::unordered_map<std::string, uint32_t> idList;
 
+  // Освобождённые ячейки переиспользуются только после завершения
+  // всех кадров, которые могли к ним обращаться
+  struct retired_t {
+    uint64_t frame;  // Кадр, начиная с которого ячейка свободна
+    uint32_t slot;
+    Instance texture;
+  };
+  std::vector<uint32_t> freeSlots;
+  std::list<retired_t> retired;
+  uint64_t frameNumber = 0;
+
+  // Запрошенные материалами состояния сэмплеров по номеру ячейки
+  std::vector<Resources::sampler_t> samplerStates;
+
+  // Поиск одинаковых текстур по содержимому:
+  // сначала по байтам файла, затем по декодированным пикселам (при разных форматах файлов).
+  // Хэш лишь находит кандидата - совпадение подтверждается сравнением с файлом, давшим хэш
+  struct source_t {
+    uint32_t id;
+    std::string file;
+  };
+  std::unordered_map<uint64_t, source_t> fileHashList;
+  std::unordered_map<uint64_t, source_t> pixelsHashList;
+  VkDeviceSize savedBytes = 0;
+
+  // Память, сэкономленная выбором формата по числу каналов (относительно RGBA8)
+  VkDeviceSize compactBytes = 0;
+
+ public:
+  // Анализ пикселов: серое изображение хранится в одном канале, непрозрачное - без альфы
+  bool analyzeContent = true;
+
+  // Карты нормалей хранятся в R8G8, компонента z восстанавливается в шейдере
+  bool compactNormals = false;
+
  public:
   explicit Textures(Core::Manager);
   ~Textures();
 
+  // Назначение без явного указания - по словам имени файла (detectUsage)
   Instance load(const std::string& name);
+  Instance load(const std::string& name, Usage usage);
   void destroy(const std::string& name);
 
   Instance get(const std::string& name);
   uint32_t getID(const std::string& name);
-  void getViews(std::vector<VkImageView>&);
+
+  // Отложенное освобождение ячеек - вызывается раз в кадр
+  void update();
+
+  // Номер ячейки сэмплера с заданным состоянием
+  uint32_t getSamplerID(const Resources::sampler_t&);
+
+  // Смена уровня качества фильтрации - устройство не должно исполнять команды
+  void setSamplerQuality(Resources::SamplerQuality);
+
+  // Объём памяти, не выделенной благодаря совпадению содержимого
+  VkDeviceSize getSavedBytes();
+
+  // Объём памяти, не выделенной благодаря выбору формата
+  VkDeviceSize getCompactBytes();
 
  private:
-  Instance create(const std::string& name);
+  Instance create(const std::vector<char>& file, stbi_uc* pixels, Usage usage);
+  uint32_t countChannels(const std::vector<char>& file, const stbi_uc* pixels, int width, int height, Usage usage);
+  VkFormat chooseFormat(uint32_t& channels, Usage usage);
+
+  // "_normal", "_nrm", "_n" - карта нормалей, "_rough", "_mask", "_ao" и т.п. - данные, иначе цвет
+  static Usage detectUsage(const std::string& name);
+  uint32_t insert(const std::string& name, Instance);
+  uint32_t allocateSlot();
+  void writeSlot(uint32_t slot, VkImageView);
+  void writeSamplerSlot(uint32_t slot);
+
+  void createTable();
+  void destroyTable();
+
+  static std::vector<char> read(const std::string& name);
+  static bool samePixels(const std::string& name, const stbi_uc* pixels, int width, int height);
+  static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
 };
@@ -0,0 +1,497 @@
+#include "virtual.h"
+
+// Стандартные библиотеки
+#include <algorithm>
+#include <cmath>
+
+VirtualTextures::VirtualTextures(Core::Manager core) {
+  this->core = core;
+  createCache();
+
+  // Параметры виртуальных текстур для шейдеров
+  core->resources->createBuffer(
+      sizeof(info_t) * maxTextures,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      infos.buffer, infos.memory);
+
+  // Пустая таблица: нулевой признак загрузки - выборка возвращает заглушку
+  uint8_t empty[4] = {0, 0, 0, 0};
+  core->resources->createImage(
+      1, 1,
+      VK_FORMAT_R8G8B8A8_UINT,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      emptyTable.image, emptyTable.memory);
+  core->commands->copyDataToImage(empty, emptyTable.image, sizeof(empty), 1, 1);
+  emptyTable.view = core->resources->createImageView(emptyTable.image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+  loader.thread = std::thread(&VirtualTextures::runLoader, this);
+}
+
+VirtualTextures::~VirtualTextures() {
+  {
+    std::lock_guard<std::mutex> lock(loader.mutex);
+    loader.stop = true;
+  }
+  loader.wake.notify_all();
+  loader.thread.join();
+
+  destroyStaging();
+  for (auto texture : handlers) {
+    core->resources->destroyImageView(texture->tableView);
+    core->resources->destroyImage(texture->tableImage, texture->tableMemory);
+    delete texture;
+  }
+  core->resources->destroyImageView(emptyTable.view);
+  core->resources->destroyImage(emptyTable.image, emptyTable.memory);
+  core->resources->destroyBuffer(infos.buffer, infos.memory);
+  destroyCache();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VirtualTextures::Instance VirtualTextures::load(const std::string& name) {
+  // Найдем уже загруженную текстуру
+  auto el = idList.find(name);
+  if (el != idList.end())
+    return handlers[el->second];
+
+  if (handlers.size() >= maxTextures)
+    throw std::runtime_error(std::string("ERROR: Too many virtual textures: ") + name);
+
+  Instance texture = new virtual_texture_t;
+  texture->name = name;
+
+  // Чтение заголовка файла
+  texture->file.open(name, std::ios::binary);
+  if (!texture->file.is_open())
+    throw std::runtime_error(std::string("ERROR: Failed to open virtual texture: ") + name);
+  texture->header = VirtualTextureFile::readHeader(texture->file, name);
+
+  // Страницы файла должны совпадать с ячейками кэша
+  auto& header = texture->header;
+  if (header.pageSize + 2 * header.pageBorder != cache.slotSize)
+    throw std::runtime_error(std::string("ERROR: Virtual texture page size does not match cache: ") + name);
+
+  // Параметры для шейдеров
+  texture->info.width = header.width;
+  texture->info.height = header.height;
+  texture->info.pagesX = header.width / header.pageSize;
+  texture->info.pagesY = header.height / header.pageSize;
+  texture->info.levels = header.levels;
+  texture->info.pageSize = header.pageSize;
+  texture->info.pageBorder = header.pageBorder;
+  texture->info.cacheSlots = cacheSlots;
+
+  // Смещения уровней детализации в файле
+  VkDeviceSize pageBytes = cache.slotSize * cache.slotSize * 4;
+  uint64_t offset = sizeof(header_t);
+  for (uint32_t level = 0; level < header.levels; ++level) {
+    texture->levelOffsets.push_back(offset);
+    uint32_t pagesX = std::max(texture->info.pagesX >> level, 1u);
+    uint32_t pagesY = std::max(texture->info.pagesY >> level, 1u);
+    offset += pagesX * pagesY * pageBytes;
+  }
+
+  // Таблица страниц - таблицы всех уровней в одном изображении
+  texture->tableWidth = 0;
+  for (uint32_t level = 0; level < header.levels; ++level)
+    texture->tableWidth += std::max(texture->info.pagesX >> level, 1u);
+  core->resources->createImage(
+      texture->tableWidth, texture->info.pagesY,
+      VK_FORMAT_R8G8B8A8_UINT,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      texture->tableImage, texture->tableMemory);
+  texture->tableView = core->resources->createImageView(
+      texture->tableImage,
+      VK_FORMAT_R8G8B8A8_UINT,
+      VK_IMAGE_ASPECT_COLOR_BIT);
+  core->commands->changeImageLayout(
+      nullptr,
+      texture->tableImage,
+      VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  texture->table.assign(texture->tableWidth * texture->info.pagesY * 4, 0);
+  texture->tableChanged = true;
+
+  // Запишем новую текстуру
+  uint32_t id = static_cast<uint32_t>(handlers.size());
+  idList.insert(std::make_pair(name, id));
+  handlers.push_back(texture);
+  updateInfos();
+
+  // Самый грубый уровень всегда находится в кэше
+  pendingPages.insert(makeKey(id, header.levels - 1, 0, 0));
+
+  // Таблицы страниц изменились - пересоздадим промежуточные буферы
+  if (!staging.empty())
+    prepare(static_cast<uint32_t>(staging.size()));
+
+  std::cout << "Virtual texture \"" << name << "\" was loaded successfully" << std::endl;
+  return texture;
+}
+
+uint32_t VirtualTextures::getID(const std::string& name) {
+  auto el = idList.find(name);
+  if (el != idList.end())
+    return el->second;
+  throw std::runtime_error(std::string("ERROR: Failed to get virtual texture: ") + name);
+}
+
+uint32_t VirtualTextures::getCount() {
+  return static_cast<uint32_t>(handlers.size());
+}
+
+void VirtualTextures::getTableViews(std::vector<VkImageView>& views) {
+  views.assign(maxTextures, emptyTable.view);
+  for (uint32_t id = 0; id < handlers.size(); ++id)
+    views[id] = handlers[id]->tableView;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextures::createCache() {
+  cache.format = VK_FORMAT_R8G8B8A8_SRGB;
+  cache.slotSize = pageSize + 2 * pageBorder;
+  cache.size = cache.slotSize * cacheSlots;
+
+  core->resources->createImage(
+      cache.size, cache.size,
+      cache.format,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      cache.image, cache.memory);
+  cache.view = core->resources->createImageView(
+      cache.image,
+      cache.format,
+      VK_IMAGE_ASPECT_COLOR_BIT);
+  core->commands->changeImageLayout(
+      nullptr,
+      cache.image,
+      VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  // Рамка страниц позволяет фильтровать без выхода за пределы ячейки
+  cache.sampler = core->resources->getSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+  slots.assign(cacheSlots * cacheSlots, {0, 0, false});
+}
+
+void VirtualTextures::destroyCache() {
+  core->resources->destroyImageView(cache.view);
+  core->resources->destroyImage(cache.image, cache.memory);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextures::prepare(uint32_t count) {
+  vkDeviceWaitIdle(core->device);
+  destroyStaging();
+  createStaging(count);
+}
+
+void VirtualTextures::createStaging(uint32_t count) {
+  // Место под страницы одного кадра и все таблицы страниц
+  stagingSize = uploadsPerFrame * cache.slotSize * cache.slotSize * 4;
+  for (auto texture : handlers)
+    stagingSize += texture->table.size();
+
+  staging.resize(count);
+  for (auto& stage : staging) {
+    core->resources->createBuffer(
+        stagingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        stage.buffer, stage.memory);
+    vkMapMemory(core->device, stage.memory, 0, stagingSize, 0, &stage.data);
+  }
+}
+
+void VirtualTextures::destroyStaging() {
+  for (auto& stage : staging) {
+    vkUnmapMemory(core->device, stage.memory);
+    core->resources->destroyBuffer(stage.buffer, stage.memory);
+  }
+  staging.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t VirtualTextures::makeKey(uint32_t id, uint32_t level, uint32_t x, uint32_t y) {
+  // Нулевой ключ обозначает свободную ячейку
+  return (static_cast<uint64_t>(id + 1) << 40) |
+         (static_cast<uint64_t>(level & 0xFF) << 32) |
+         (static_cast<uint64_t>(x & 0xFFFF) << 16) |
+         static_cast<uint64_t>(y & 0xFFFF);
+}
+
+void VirtualTextures::parseKey(uint64_t key, uint32_t& id, uint32_t& level, uint32_t& x, uint32_t& y) {
+  id = static_cast<uint32_t>(key >> 40) - 1;
+  level = static_cast<uint32_t>(key >> 32) & 0xFF;
+  x = static_cast<uint32_t>(key >> 16) & 0xFFFF;
+  y = static_cast<uint32_t>(key) & 0xFFFF;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextures::request(const uint32_t* feedback, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t value = feedback[i];
+    uint32_t id = value >> 24;
+    if (id == 0 || id > handlers.size())
+      continue;
+    id -= 1;
+
+    // Ограничим запрос размерами текстуры
+    auto& info = handlers[id]->info;
+    uint32_t level = std::min((value >> 16) & 0xFF, info.levels - 1);
+    uint32_t x = std::min(value & 0xFF, std::max(info.pagesX >> level, 1u) - 1);
+    uint32_t y = std::min((value >> 8) & 0xFF, std::max(info.pagesY >> level, 1u) - 1);
+
+    uint64_t key = makeKey(id, level, x, y);
+    auto resident = residentPages.find(key);
+    if (resident != residentPages.end())
+      slots[resident->second].lastUsed = frameNumber;
+    else
+      pendingPages.insert(key);
+  }
+}
+
+uint32_t VirtualTextures::allocateSlot() {
+  // Свободная ячейка, либо давно не используемая страница
+  uint32_t victim = UINT32_MAX;
+  uint64_t oldest = frameNumber;
+  for (uint32_t i = 0; i < slots.size(); ++i) {
+    if (slots[i].key == 0)
+      return i;
+    if (!slots[i].pinned && slots[i].lastUsed < oldest) {
+      oldest = slots[i].lastUsed;
+      victim = i;
+    }
+  }
+
+  // Все ячейки заняты страницами текущего кадра
+  if (victim == UINT32_MAX)
+    return victim;
+
+  // Вытеснение страницы
+  uint32_t id, level, x, y;
+  parseKey(slots[victim].key, id, level, x, y);
+  residentPages.erase(slots[victim].key);
+  handlers[id]->tableChanged = true;
+  slots[victim].key = 0;
+  return victim;
+}
+
+void VirtualTextures::readPage(Instance texture, uint32_t level, uint32_t x, uint32_t y, void* dst) {
+  VkDeviceSize pageBytes = cache.slotSize * cache.slotSize * 4;
+  uint32_t pagesX = std::max(texture->info.pagesX >> level, 1u);
+  uint64_t offset = texture->levelOffsets[level] + (static_cast<uint64_t>(y) * pagesX + x) * pageBytes;
+
+  texture->file.seekg(offset, std::ios::beg);
+  texture->file.read(reinterpret_cast<char*>(dst), pageBytes);
+  if (!texture->file)
+    throw std::runtime_error(std::string("ERROR: Failed to read virtual texture page: ") + texture->name);
+}
+
+void VirtualTextures::runLoader() {
+  VkDeviceSize pageBytes = cache.slotSize * cache.slotSize * 4;
+  while (true) {
+    page_t page;
+    {
+      std::unique_lock<std::mutex> lock(loader.mutex);
+      loader.wake.wait(lock, [this]() { return loader.stop || !loader.requests.empty(); });
+      if (loader.stop)
+        return;
+      page = std::move(loader.requests.front());
+      loader.requests.pop_front();
+    }
+
+    // Файлы текстур после загрузки заголовка читает только этот поток
+    uint32_t id, level, x, y;
+    parseKey(page.key, id, level, x, y);
+    page.data.resize(pageBytes);
+    std::string error;
+    try {
+      readPage(page.texture, level, x, y, page.data.data());
+    } catch (std::exception& exception) {
+      error = exception.what();
+    }
+
+    std::lock_guard<std::mutex> lock(loader.mutex);
+    if (error.empty())
+      loader.loaded.push_back(std::move(page));
+    else
+      loader.error = error;
+  }
+}
+
+void VirtualTextures::updateTable(Instance texture) {
+  auto& info = texture->info;
+  uint32_t id = getID(texture->name);
+
+  // Для каждой страницы каждого уровня найдём самую детальную загруженную страницу не детальнее его
+  uint32_t offset = 0;
+  for (uint32_t level = 0; level < info.levels; ++level) {
+    uint32_t pagesX = std::max(info.pagesX >> level, 1u);
+    uint32_t pagesY = std::max(info.pagesY >> level, 1u);
+    for (uint32_t y = 0; y < pagesY; ++y) {
+      for (uint32_t x = 0; x < pagesX; ++x) {
+        uint8_t* entry = &texture->table[(y * texture->tableWidth + offset + x) * 4];
+        entry[0] = entry[1] = entry[2] = entry[3] = 0;
+        for (uint32_t coarse = level; coarse < info.levels; ++coarse) {
+          uint32_t shift = coarse - level;
+          uint32_t coarseX = std::min(x >> shift, std::max(info.pagesX >> coarse, 1u) - 1);
+          uint32_t coarseY = std::min(y >> shift, std::max(info.pagesY >> coarse, 1u) - 1);
+          auto resident = residentPages.find(makeKey(id, coarse, coarseX, coarseY));
+          if (resident == residentPages.end())
+            continue;
+          entry[0] = static_cast<uint8_t>(resident->second % cacheSlots);
+          entry[1] = static_cast<uint8_t>(resident->second / cacheSlots);
+          entry[2] = static_cast<uint8_t>(coarse);
+          entry[3] = 1;
+          break;
+        }
+      }
+    }
+    offset += pagesX;
+  }
+  texture->tableChanged = false;
+}
+
+void VirtualTextures::updateInfos() {
+  std::vector<info_t> data;
+  for (auto texture : handlers)
+    data.push_back(texture->info);
+
+  void* memory;
+  vkMapMemory(core->device, infos.memory, 0, sizeof(info_t) * maxTextures, 0, &memory);
+  memcpy(memory, data.data(), sizeof(info_t) * data.size());
+  vkUnmapMemory(core->device, infos.memory);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextures::update(uint32_t index, VkCommandBuffer cmd) {
+  if (staging.empty() || handlers.empty())
+    return;
+
+  auto& stage = staging[index];
+  auto stageData = reinterpret_cast<uint8_t*>(stage.data);
+  VkDeviceSize stageOffset = 0;
+  VkDeviceSize pageBytes = cache.slotSize * cache.slotSize * 4;
+
+  //=========================================================================
+  // Страницы, прочитанные потоком чтения
+
+  {
+    std::lock_guard<std::mutex> lock(loader.mutex);
+    if (!loader.error.empty())
+      throw std::runtime_error(loader.error);
+    for (auto& page : loader.loaded)
+      readyPages.push_back(std::move(page));
+    loader.loaded.clear();
+  }
+
+  std::vector<VkBufferImageCopy> pageRegions;
+  while (!readyPages.empty() && pageRegions.size() < uploadsPerFrame) {
+    uint32_t slot = allocateSlot();
+    if (slot == UINT32_MAX)
+      break;
+
+    auto& page = readyPages.front();
+    uint64_t key = page.key;
+    uint32_t id, level, x, y;
+    parseKey(key, id, level, x, y);
+    auto texture = page.texture;
+    std::memcpy(stageData + stageOffset, page.data.data(), pageBytes);
+    readyPages.pop_front();
+    readingPages.erase(key);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = stageOffset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {
+        static_cast<int32_t>((slot % cacheSlots) * cache.slotSize),
+        static_cast<int32_t>((slot / cacheSlots) * cache.slotSize),
+        0};
+    region.imageExtent = {cache.slotSize, cache.slotSize, 1};
+    pageRegions.push_back(region);
+    stageOffset += pageBytes;
+
+    slots[slot].key = key;
+    slots[slot].lastUsed = frameNumber;
+    slots[slot].pinned = (level == texture->info.levels - 1);
+    residentPages[key] = slot;
+    texture->tableChanged = true;
+  }
+
+  //=========================================================================
+  // Новые запросы потоку чтения - сначала грубые уровни, чтобы быстрее закрыть пробелы
+
+  std::vector<uint64_t> queue;
+  for (auto key : pendingPages)
+    if (!readingPages.count(key) && !residentPages.count(key))
+      queue.push_back(key);
+  std::sort(queue.begin(), queue.end(), [](uint64_t a, uint64_t b) {
+    return ((a >> 32) & 0xFF) > ((b >> 32) & 0xFF);
+  });
+  pendingPages.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(loader.mutex);
+    for (auto key : queue) {
+      if (readingPages.size() >= readsInFlight)
+        break;
+      uint32_t id, level, x, y;
+      parseKey(key, id, level, x, y);
+      loader.requests.push_back({key, handlers[id], {}});
+      readingPages.insert(key);
+    }
+  }
+  loader.wake.notify_one();
+
+  if (!pageRegions.empty()) {
+    core->commands->changeImageLayout(cmd, cache.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdCopyBufferToImage(cmd, stage.buffer, cache.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(pageRegions.size()), pageRegions.data());
+    core->commands->changeImageLayout(cmd, cache.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
+
+  //=========================================================================
+  // Обновление таблиц страниц
+
+  stageOffset = uploadsPerFrame * pageBytes;
+  for (auto texture : handlers) {
+    if (!texture->tableChanged)
+      continue;
+
+    updateTable(texture);
+    memcpy(stageData + stageOffset, texture->table.data(), texture->table.size());
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = stageOffset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {texture->tableWidth, texture->info.pagesY, 1};
+    stageOffset += texture->table.size();
+
+    core->commands->changeImageLayout(cmd, texture->tableImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdCopyBufferToImage(cmd, stage.buffer, texture->tableImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    core->commands->changeImageLayout(cmd, texture->tableImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
+
+  frameNumber++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
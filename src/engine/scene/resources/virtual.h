@@ -0,0 +1,184 @@
+#pragma once
+
+// Внутренние библиотеки
+#include "core.h"
+#include "virtualfile.h"
+
+// Стандартные библиотеки
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+
+// Виртуальные текстуры - программная страничная подкачка текстур
+// Не требует поддержки sparse residency со стороны устройства:
+// страницы хранятся в общем физическом кэше, а адресация идёт через таблицу страниц
+class VirtualTextures {
+ public:
+  typedef VirtualTextures* Manager;
+
+  // Заголовок файла с заранее нарезанной текстурой (.vt)
+  typedef VirtualTextureFile::header_t header_t;
+
+  // ~ StructuredBuffer<virtual_info_t> (см. shaders/library/virtual.hlsl)
+  struct info_t {
+    uint32_t width, height;
+    uint32_t pagesX, pagesY;
+    uint32_t levels;
+    uint32_t pageSize;
+    uint32_t pageBorder;
+    uint32_t cacheSlots;
+  };
+
+  typedef struct virtual_texture_t {
+    std::string name;
+    std::ifstream file;
+    header_t header;
+    info_t info;
+
+    // Смещения уровней детализации в файле
+    std::vector<uint64_t> levelOffsets;
+
+    // Таблица страниц - для каждой страницы каждого уровня хранит ячейку кэша и уровень
+    // лучшей загруженной страницы не детальнее его. Таблицы уровней лежат в одном
+    // изображении слева направо (shaders/library/virtual.hlsl: vtTableOffset)
+    VkImage tableImage;
+    VkImageView tableView;
+    VkDeviceMemory tableMemory;
+    uint32_t tableWidth;         // Сумма ширин таблиц всех уровней
+    std::vector<uint8_t> table;  // RGBA8_UINT: ячейка X, ячейка Y, уровень, признак загрузки
+    bool tableChanged;
+  } * Instance;
+
+  //=========================================================================
+  // Физический кэш страниц
+
+  static constexpr uint32_t cacheSlots = 16;      // Число ячеек кэша по одной оси
+  static constexpr uint32_t pageSize = VirtualTextureFile::pageSize;
+  static constexpr uint32_t pageBorder = VirtualTextureFile::pageBorder;
+  static constexpr uint32_t uploadsPerFrame = 8;  // Лимит загрузки страниц за кадр
+  static constexpr uint32_t readsInFlight = 16;   // Лимит страниц, отданных потоку чтения
+  static constexpr uint32_t maxTextures = 64;     // Лимит виртуальных текстур - размер массива таблиц страниц
+
+  // Обратная связь хранит id + 1 в 8 битах, таблица страниц - координаты ячейки в 8 битах
+  static_assert(maxTextures < 256 && cacheSlots <= 256);
+
+  struct {
+    VkFormat format;
+    uint32_t slotSize;  // Размер ячейки вместе с рамкой
+    uint32_t size;      // Размер изображения кэша
+    VkImage image;
+    VkImageView view;
+    VkDeviceMemory memory;
+    VkSampler sampler;
+  } cache;
+
+  // Параметры всех виртуальных текстур для шейдеров
+  struct {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+  } infos;
+
+  // Таблица страниц 1x1 без загруженных страниц - для свободных элементов массива таблиц
+  struct {
+    VkImage image;
+    VkImageView view;
+    VkDeviceMemory memory;
+  } emptyTable;
+
+ private:
+  Core::Manager core;
+
+  std::vector<Instance> handlers;
+  std::unordered_map<std::string, uint32_t> idList;
+
+  // Ячейки кэша
+  struct slot_t {
+    uint64_t key;       // Загруженная страница (0 - свободна)
+    uint64_t lastUsed;  // Номер кадра последнего обращения
+    bool pinned;        // Страница не может быть вытеснена
+  };
+  std::vector<slot_t> slots;
+  std::unordered_map<uint64_t, uint32_t> residentPages;
+
+  // Запросы страниц, ожидающие загрузки
+  std::unordered_set<uint64_t> pendingPages;
+  uint64_t frameNumber = 0;
+
+  //=========================================================================
+  // Поток чтения - файлы страниц читаются вне потока рендера
+
+  struct page_t {
+    uint64_t key;
+    Instance texture;
+    std::vector<uint8_t> data;
+  };
+
+  struct {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<page_t> requests;  // Ожидают чтения
+    std::vector<page_t> loaded;   // Прочитаны, ожидают копирования в кэш
+    std::string error;            // Ошибка чтения - бросается в потоке рендера
+    bool stop = false;
+  } loader;
+
+  // Только в потоке рендера
+  std::unordered_set<uint64_t> readingPages;  // Отданы потоку чтения
+  std::deque<page_t> readyPages;              // Прочитаны, ждут свободной ячейки или лимита кадра
+
+  // Промежуточные буферы загрузки (по одному на изображение списка показа)
+  struct staging_t {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    void* data;
+  };
+  std::vector<staging_t> staging;
+  VkDeviceSize stagingSize = 0;
+
+ public:
+  explicit VirtualTextures(Core::Manager);
+  ~VirtualTextures();
+
+  Instance load(const std::string& name);
+  uint32_t getID(const std::string& name);
+  uint32_t getCount();
+
+  // Всегда maxTextures видов: свободные элементы - пустая таблица (страницы не загружены),
+  // размер массива дескрипторов прохода не зависит от числа загруженных текстур
+  void getTableViews(std::vector<VkImageView>&);
+
+  // Подготовка промежуточных буферов под число кадров
+  void prepare(uint32_t count);
+
+  // Обработка обратной связи прохода рендера (RGBA8_UINT: страница X, страница Y, уровень, id + 1).
+  // Координаты страниц - по 8 бит: больших текстур load не допускает (VirtualTextureFile::maxPages)
+  void request(const uint32_t* feedback, size_t count);
+
+  // Загрузка запрошенных страниц и обновление таблиц страниц
+  void update(uint32_t index, VkCommandBuffer);
+
+ private:
+  void createCache();
+  void destroyCache();
+
+  void createStaging(uint32_t count);
+  void destroyStaging();
+
+  void updateInfos();
+  void updateTable(Instance);
+
+  uint32_t allocateSlot();
+  void readPage(Instance, uint32_t level, uint32_t x, uint32_t y, void* dst);
+  void runLoader();
+
+  static uint64_t makeKey(uint32_t id, uint32_t level, uint32_t x, uint32_t y);
+  static void parseKey(uint64_t key, uint32_t& id, uint32_t& level, uint32_t& x, uint32_t& y);
+};
@@ -0,0 +1,140 @@
+#include "virtualfile.h"
+
+// Сторонние библиотеки (реализация - в textures.cpp движка и в инструменте сцены)
+#include <stb_image.h>
+
+// Стандартные библиотеки
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+VirtualTextureFile::header_t VirtualTextureFile::readHeader(std::ifstream& file, const std::string& name) {
+  header_t header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header_t));
+  if (!file || std::memcmp(header.magic, "NVT1", 4) != 0)
+    throw std::runtime_error(std::string("ERROR: Invalid virtual texture file: ") + name);
+
+  // Размеры - целое число страниц в пределах формата, уровни - до одной страницы
+  bool valid = header.pageSize > 0 && header.width % header.pageSize == 0 && header.height % header.pageSize == 0;
+  uint32_t pagesX = valid ? header.width / header.pageSize : 0;
+  uint32_t pagesY = valid ? header.height / header.pageSize : 0;
+  valid &= pagesX > 0 && pagesY > 0 && pagesX <= maxPages && pagesY <= maxPages;
+  if (!valid || header.levels != countLevels(pagesX, pagesY))
+    throw std::runtime_error(std::string("ERROR: Invalid virtual texture size: ") + name);
+  return header;
+}
+
+uint32_t VirtualTextureFile::countLevels(uint32_t pagesX, uint32_t pagesY) {
+  // Последний уровень - одна страница
+  uint32_t levels = 1;
+  while ((std::max(pagesX, pagesY) >> (levels - 1)) > 1)
+    levels++;
+  return levels;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Билинейное масштабирование RGBA8 изображения
+static void resizeImage(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+                        uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight) {
+  for (uint32_t y = 0; y < dstHeight; ++y) {
+    float sy = std::max((y + 0.5f) * srcHeight / dstHeight - 0.5f, 0.0f);
+    uint32_t y0 = std::min(static_cast<uint32_t>(sy), srcHeight - 1);
+    uint32_t y1 = std::min(y0 + 1, srcHeight - 1);
+    float fy = sy - y0;
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+      float sx = std::max((x + 0.5f) * srcWidth / dstWidth - 0.5f, 0.0f);
+      uint32_t x0 = std::min(static_cast<uint32_t>(sx), srcWidth - 1);
+      uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+      float fx = sx - x0;
+      for (uint32_t c = 0; c < 4; ++c) {
+        float top = src[(y0 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[(y0 * srcWidth + x1) * 4 + c] * fx;
+        float bottom = src[(y1 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[(y1 * srcWidth + x1) * 4 + c] * fx;
+        dst[(y * dstWidth + x) * 4 + c] = static_cast<uint8_t>(top * (1.0f - fy) + bottom * fy + 0.5f);
+      }
+    }
+  }
+}
+
+static uint32_t nextPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result < value)
+    result <<= 1;
+  return result;
+}
+
+void VirtualTextureFile::bake(const std::string& image, const std::string& output, uint32_t pageSize, uint32_t pageBorder) {
+  if (pageSize == 0)
+    throw std::runtime_error("ERROR: Virtual texture page size must be positive!");
+
+  int width, height;
+  stbi_uc* pixels = stbi_load(image.c_str(), &width, &height, nullptr, STBI_rgb_alpha);
+  if (!pixels)
+    throw std::runtime_error(std::string("ERROR: Failed to load texture image: ") + image);
+
+  // Число страниц нулевого уровня - степень двойки не больше предела формата
+  uint32_t pagesX = nextPowerOfTwo((width + pageSize - 1) / pageSize);
+  uint32_t pagesY = nextPowerOfTwo((height + pageSize - 1) / pageSize);
+  if (pagesX > maxPages || pagesY > maxPages) {
+    stbi_image_free(pixels);
+    throw std::runtime_error("ERROR: Texture image is too large for a virtual texture (" +
+                             std::to_string(maxPages * pageSize) + " texels per axis at most): " + image);
+  }
+  uint32_t levels = countLevels(pagesX, pagesY);
+
+  header_t header{};
+  std::memcpy(header.magic, "NVT1", 4);
+  header.width = pagesX * pageSize;
+  header.height = pagesY * pageSize;
+  header.pageSize = pageSize;
+  header.pageBorder = pageBorder;
+  header.levels = levels;
+
+  std::ofstream file(output, std::ios::binary);
+  if (!file.is_open())
+    throw std::runtime_error(std::string("ERROR: Failed to create virtual texture: ") + output);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header_t));
+
+  // Нулевой уровень приводится к размеру, кратному странице
+  uint32_t levelWidth = header.width, levelHeight = header.height;
+  std::vector<uint8_t> level(levelWidth * levelHeight * 4);
+  resizeImage(pixels, width, height, level.data(), levelWidth, levelHeight);
+  stbi_image_free(pixels);
+
+  uint32_t slotSize = pageSize + 2 * pageBorder;
+  std::vector<uint8_t> page(slotSize * slotSize * 4);
+  for (uint32_t l = 0; l < levels; ++l) {
+    uint32_t levelPagesX = std::max(pagesX >> l, 1u);
+    uint32_t levelPagesY = std::max(pagesY >> l, 1u);
+
+    // Уменьшение предыдущего уровня
+    if (l > 0) {
+      uint32_t nextWidth = levelPagesX * pageSize, nextHeight = levelPagesY * pageSize;
+      std::vector<uint8_t> next(nextWidth * nextHeight * 4);
+      resizeImage(level.data(), levelWidth, levelHeight, next.data(), nextWidth, nextHeight);
+      level.swap(next);
+      levelWidth = nextWidth;
+      levelHeight = nextHeight;
+    }
+
+    // Нарезка уровня на страницы с рамкой (текстура повторяется по краям)
+    for (uint32_t py = 0; py < levelPagesY; ++py) {
+      for (uint32_t px = 0; px < levelPagesX; ++px) {
+        for (uint32_t y = 0; y < slotSize; ++y) {
+          int64_t srcY = static_cast<int64_t>(py * pageSize + y) - pageBorder;
+          srcY = (srcY % levelHeight + levelHeight) % levelHeight;
+          for (uint32_t x = 0; x < slotSize; ++x) {
+            int64_t srcX = static_cast<int64_t>(px * pageSize + x) - pageBorder;
+            srcX = (srcX % levelWidth + levelWidth) % levelWidth;
+            std::memcpy(&page[(y * slotSize + x) * 4], &level[(srcY * levelWidth + srcX) * 4], 4);
+          }
+        }
+        file.write(reinterpret_cast<const char*>(page.data()), page.size());
+      }
+    }
+  }
+
+  std::cout << "Virtual texture \"" << output << "\" was baked successfully" << std::endl;
+}
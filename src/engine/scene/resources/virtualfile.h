@@ -0,0 +1,39 @@
+#pragma once
+
+// Стандартные библиотеки
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Файл заранее нарезанной виртуальной текстуры (.vt)
+// За заголовком следуют страницы всех уровней детализации (от нулевого),
+// каждая страница - (pageSize + 2 * pageBorder)^2 пикселов RGBA8, построчно.
+// Не зависит от устройства - используется и движком, и инструментом нарезки
+class VirtualTextureFile {
+ public:
+  struct header_t {
+    char magic[4];        // "NVT1"
+    uint32_t width;       // Размер нулевого уровня (в текселах)
+    uint32_t height;      //
+    uint32_t pageSize;    // Размер страницы без рамки
+    uint32_t pageBorder;  // Рамка страницы для фильтрации
+    uint32_t levels;      // Число уровней детализации
+  };
+
+  static constexpr uint32_t pageSize = 128;  // Размер страницы по умолчанию
+  static constexpr uint32_t pageBorder = 4;  // Рамка страницы по умолчанию
+
+  // Страниц нулевого уровня по оси: обратная связь (RGBA8_UINT) хранит координату страницы
+  // в 8 битах - при странице по умолчанию текстура не больше 32768 текселов по оси
+  static constexpr uint32_t maxPages = 256;
+
+  // Нарезка обычного изображения в файл виртуальной текстуры
+  static void bake(const std::string& image, const std::string& output,
+                   uint32_t pageSize = VirtualTextureFile::pageSize,
+                   uint32_t pageBorder = VirtualTextureFile::pageBorder);
+
+  // Чтение и проверка заголовка - поток остаётся в начале страниц
+  static header_t readHeader(std::ifstream&, const std::string& name);
+
+  static uint32_t countLevels(uint32_t pagesX, uint32_t pagesY);
+};
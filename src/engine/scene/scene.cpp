@@ -5,7 +5,10 @@
 Scene::Scene(Core::Manager core) {
   this->core = core;
 
+  initTransforms();
+  initCulling();
   initTextures();
+  initVirtualTextures();
   initModels();
   initCamera();
 }
@@ -15,7 +18,10 @@ Scene::~Scene() {
     delete obj;
   destroyCamera();
   destroyModels();
+  destroyVirtualTextures();
   destroyTextures();
+  destroyCulling();
+  destroyTransforms();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -25,9 +31,89 @@ void Scene::loadObject(const char* model) {
 }
 
 void Scene::loadObject(const std::string& model) {
+  addObject(models->load(model));
+}
+
+PhysicalObject::Instance Scene::addObject(Models::Instance model) {
   PhysicalObject::Instance object = new PhysicalObject();
-  object->model = models->load(model);
+  object->model = model;
+  object->transforms = transforms;
+  object->transformID = transforms->create();
+  culling->add(object);
   objects.push_back(object);
+  return object;
+}
+
+void Scene::load(const std::string& path) {
+  auto start = std::chrono::high_resolution_clock::now();
+  SceneFile file;
+  file.load(path);
+  auto read = std::chrono::high_resolution_clock::now();
+
+  // Различные модели разбираются параллельно, варианты с материалами используют их геометрию
+  models->load(file.models);
+  std::vector<Models::Instance> instances(file.models.size());
+  for (uint32_t i = 0; i < instances.size(); ++i)
+    instances[i] = models->get(file.models[i]);
+  std::vector<Models::material_t> materials(file.materials.size());
+  for (uint32_t i = 0; i < materials.size(); ++i)
+    materials[i] = {file.materials[i].name, file.materials[i].texture, file.materials[i].clamp, file.materials[i].lodBias};
+  std::unordered_map<uint64_t, Models::Instance> variants;
+  auto loaded = std::chrono::high_resolution_clock::now();
+
+  // Объекты создаются за один проход по таблице - родители записаны раньше потомков
+  uint32_t first = static_cast<uint32_t>(objects.size());
+  auto list = file.getObjects();
+  objects.reserve(objects.size() + list.size());
+  for (uint32_t i = 0; i < list.size(); ++i) {
+    auto& record = list[i];
+    if (record.model >= instances.size() || (record.material != SceneFile::none && record.material >= materials.size()))
+      throw std::runtime_error("ERROR: Scene has invalid object: " + path);
+    if (record.parent != SceneFile::none && record.parent >= i)
+      throw std::runtime_error("ERROR: Scene object is listed before its parent: " + path);
+
+    Models::Instance model = instances[record.model];
+    if (record.material != SceneFile::none) {
+      uint64_t key = (static_cast<uint64_t>(record.model) << 32) | record.material;
+      auto found = variants.find(key);
+      if (found == variants.end())
+        found = variants.emplace(key, models->load(file.models[record.model], materials[record.material])).first;
+      model = found->second;
+    }
+
+    PhysicalObject::Instance object = addObject(model);
+    if (record.parent != SceneFile::none)
+      object->setParent(objects[first + record.parent]);
+    object->setPosition(glm::make_vec3(record.position));
+    object->setRotation(glm::make_vec3(record.rotation));
+    object->setScale(glm::make_vec3(record.scale));
+    object->update();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  std::cout << "Scene \"" << path << "\" was loaded: "
+            << list.size() << " objects, " << file.models.size() << " models ("
+            << std::chrono::duration<double, std::milli>(read - start).count() << " ms read, "
+            << std::chrono::duration<double, std::milli>(loaded - read).count() << " ms models, "
+            << std::chrono::duration<double, std::milli>(end - loaded).count() << " ms objects)" << std::endl;
+}
+
+void Scene::update() {
+  models->update();
+  transforms->update();
+  culling->update();
+}
+
+uint32_t Scene::pick(glm::float3 origin, glm::float3 direction) {
+  BVH::hit_t hit = culling->getBVH()->raycast(origin, direction);
+  if (hit.item == BVH::none)
+    return UINT32_MAX;
+
+  uint32_t transformID = culling->getTransformID(hit.item);
+  for (uint32_t i = 0; i < objects.size(); ++i)
+    if (objects[i]->transformID == transformID)
+      return i;
+  return UINT32_MAX;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -54,6 +140,36 @@ Camera::Manager Scene::getCamera() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Scene::initTransforms() {
+  transforms = new Transforms();
+}
+
+void Scene::destroyTransforms() {
+  if (transforms != nullptr)
+    delete transforms;
+}
+
+Transforms::Manager Scene::getTransforms() {
+  return transforms;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Scene::initCulling() {
+  culling = new Culling(transforms);
+}
+
+void Scene::destroyCulling() {
+  if (culling != nullptr)
+    delete culling;
+}
+
+Culling::Manager Scene::getCulling() {
+  return culling;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Scene::initTextures() {
   textures = new Textures(core);
 }
@@ -69,25 +185,32 @@ Textures::Manager Scene::getTextures() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Scene::initVirtualTextures() {
+  virtualTextures = new VirtualTextures(core);
+}
+
+void Scene::destroyVirtualTextures() {
+  if (virtualTextures != nullptr)
+    delete virtualTextures;
+}
+
+VirtualTextures::Manager Scene::getVirtualTextures() {
+  return virtualTextures;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Scene::initModels() {
-  models = new Models(core, textures);
-  PhysicalObject::Instance object;
-  loadObject("test");
-  loadObject("cube");
-  object = objects.back();
-  object->setPosition({5.0f, 0.0f, 0.0f});
-  object->update();
-  loadObject("teapot");
-  object = objects.back();
-  object->setPosition({-5.0f, 0.0f, 0.0f});
-  object->update();
-  loadObject("tree");
-  object = objects.back();
-  object->setPosition({0.0f, 0.0f, -5.0f});
-  object->update();
+  models = new Models(core, textures, virtualTextures);
+  load("misc\\scenes\\default.json");
+  update();
 }
 
 void Scene::destroyModels() {
   if (models != nullptr)
     delete models;
 }
+
+Models::Manager Scene::getModels() {
+  return models;
+}
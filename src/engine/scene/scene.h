@@ -4,13 +4,19 @@
 #include "core.h"
 #include "objects/object.h"
 #include "objects/camera.h"
+#include "objects/transforms.h"
+#include "objects/culling.h"
 #include "resources/textures.h"
+#include "resources/virtual.h"
 #include "resources/models.h"
+#include "resources/scenefile.h"
 
 // Стандартные библиотеки
+#include <chrono>
 #include <list>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 class Scene {
  public:
@@ -24,8 +30,21 @@ class Scene {
   void loadObject(const char* model);
   void loadObject(const std::string& model);
 
+  // Загрузка объектов из описания сцены (.json или двоичного)
+  void load(const std::string& path);
+
+  // Отправка новой геометрии, пересчёт преобразований и зависящих от них ограничивающих объёмов
+  void update();
+
+  // Индекс объекта, ближайшего вдоль луча, или UINT32_MAX
+  uint32_t pick(glm::float3 origin, glm::float3 direction);
+
   Camera::Manager getCamera();
+  Transforms::Manager getTransforms();
+  Culling::Manager getCulling();
+  Models::Manager getModels();
   Textures::Manager getTextures();
+  VirtualTextures::Manager getVirtualTextures();
 
  private:
   Core::Manager core;
@@ -34,11 +53,25 @@ class Scene {
   void initCamera();
   void destroyCamera();
 
+  Transforms::Manager transforms;
+  void initTransforms();
+  void destroyTransforms();
+
+  Culling::Manager culling;
+  void initCulling();
+  void destroyCulling();
+
   Textures::Manager textures;
   void initTextures();
   void destroyTextures();
 
+  VirtualTextures::Manager virtualTextures;
+  void initVirtualTextures();
+  void destroyVirtualTextures();
+
   Models::Manager models;
   void initModels();
   void destroyModels();
+
+  PhysicalObject::Instance addObject(Models::Instance);
 };
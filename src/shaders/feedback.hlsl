@@ -0,0 +1,69 @@
+#include "library/virtual.hlsl"
+
+// Вход вершинного шейдера
+struct VS_INPUT {
+    float3 position : POSITION;
+    float2 uv;
+    uint instanceID; // Поток экземпляров прохода геометрии
+};
+
+// Вход фрагментного шейдера
+struct PS_INPUT {
+    float4 position : SV_POSITION;
+    float2 uv;
+    nointerpolation uint virtualTexture;
+};
+
+// Данные экземпляра - общие с проходом геометрии
+struct instance_t {
+    float4x4 objectModel;
+    float4x4 objectPreviousModel;
+    uint objectTexture;
+    uint objectSampler;
+    uint objectVirtualTexture; // 0 - объект без виртуальной текстуры
+    uint padding;
+};
+
+// Константы прохода
+struct constants_t {
+    float levelBias; // Поправка уровня детализации на разрешение прохода
+};
+[[vk::push_constant]] ConstantBuffer<constants_t> constants;
+
+
+// Ресурсы, привязанные к конвейеру
+cbuffer ubo // VkBuffer
+{
+    float4x4 cameraView;
+    float4x4 cameraProjection;
+}
+StructuredBuffer<virtual_info_t> virtualInfo; // VkBuffer
+StructuredBuffer<instance_t> instances; // VkBuffer
+
+
+[shader("vertex")]
+PS_INPUT vertexMain(VS_INPUT vertex)
+{
+    PS_INPUT data;
+
+    instance_t instance = instances[vertex.instanceID];
+    float4x4 modelViewProj = mul(cameraProjection, mul(cameraView, instance.objectModel));
+    data.position = mul(modelViewProj, float4(vertex.position, 1.0f));
+    data.uv = vertex.uv;
+    data.virtualTexture = instance.objectVirtualTexture;
+
+    return data;
+}
+
+[shader("fragment")]
+uint4 fragmentMain(PS_INPUT data) : SV_TARGET
+{
+    // Объект не требует страниц, но перекрывает объекты за собой
+    if (data.virtualTexture == 0)
+        return uint4(0, 0, 0, 0);
+
+    uint id = data.virtualTexture - 1;
+    virtual_info_t info = virtualInfo[id];
+    float level = vtLevel(info, ddx(data.uv), ddy(data.uv), constants.levelBias);
+    return vtFeedback(info, id, data.uv, level);
+}
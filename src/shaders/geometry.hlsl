@@ -1,47 +1,121 @@
+#include "library/virtual.hlsl"
+
 // Вход вершинного шейдера
 struct VS_INPUT {
     float3 position : POSITION;
     float2 uv;
+    uint instanceID; // Поток экземпляров - firstInstance группы + номер экземпляра
 };
 
 // Вход фрагментного шейдера
 struct PS_INPUT {
     float4 position : SV_POSITION;
     float2 uv;
+    nointerpolation uint instanceID;
+    float4 currentPosition;  // Без дрожания - векторы движения
+    float4 previousPosition; // В прошлом кадре
+};
+
+// Выход фрагментного шейдера
+struct PS_OUTPUT {
+    float4 color : SV_TARGET0;
+    float2 velocity : SV_TARGET1; // Смещение с прошлого кадра в долях сцены
 };
 
-// Константы, задаваемые для каждого объекта
-struct constants_t {
+// Данные экземпляра
+struct instance_t {
     float4x4 objectModel;
-    int objectTexture;
+    float4x4 objectPreviousModel;
+    uint objectTexture;
+    uint objectSampler;
+    uint objectVirtualTexture; // 0 - объект без виртуальной текстуры
+    uint padding;
 };
-[[vk::push_constant]] ConstantBuffer<constants_t> instance;
 
 
 // Ресурсы, привязанные к конвейеру
 cbuffer ubo // VkBuffer
 {
     float4x4 cameraView;
-    float4x4 cameraProjection;
+    float4x4 cameraProjection; // С дрожанием TAA
+    float4x4 viewProjection; // Без дрожания
+    float4x4 previousViewProjection;
+    uint fragmentCost; // Дополнительные итерации фрагментного шейдера - для замеров
 }
-Texture2D textures[]; // VkImageView
-SamplerState textureSampler; // VkSampler
+
+// Общая таблица текстур - отдельное множество, заполняется по мере загрузки
+[[vk::binding(0, 1)]] SamplerState samplers[]; // VkSampler
+[[vk::binding(1, 1)]] Texture2D textures[]; // VkImageView
+
+// Виртуальные текстуры
+Texture2D virtualCache; // VkImageView
+SamplerState virtualSampler; // VkSampler
+Texture2D<uint4> pageTables[]; // VkImageView
+StructuredBuffer<virtual_info_t> virtualInfo; // VkBuffer
+
+// Экземпляры всех групп, видимых в кадре
+StructuredBuffer<instance_t> instances; // VkBuffer
 
 
+// Проход глубины и цветовой проход - один модуль вершинного шейдера: тест EQUAL после прохода глубины
+float4 project(float3 position, uint instanceID)
+{
+    instance_t instance = instances[instanceID];
+    float4x4 modelViewProj = mul(cameraProjection, mul(cameraView, instance.objectModel));
+    precise float4 result = mul(modelViewProj, float4(position, 1.0f));
+    return result;
+}
+
 [shader("vertex")]
 PS_INPUT vertexMain(VS_INPUT vertex)
 {
     PS_INPUT data;
-
-    float4x4 modelViewProj = mul(cameraProjection, mul(cameraView, instance.objectModel));
-    data.position = mul(modelViewProj, float4(vertex.position, 1.0f));
+    data.instanceID = vertex.instanceID;
+    data.position = project(vertex.position, vertex.instanceID);
     data.uv = vertex.uv;
 
+    instance_t instance = instances[vertex.instanceID];
+    data.currentPosition = mul(viewProjection, mul(instance.objectModel, float4(vertex.position, 1.0f)));
+    data.previousPosition = mul(previousViewProjection, mul(instance.objectPreviousModel, float4(vertex.position, 1.0f)));
+
     return data;
 }
 
+// Искусственная нагрузка: результат не меняет цвет, но не может быть отброшен компилятором
+float4 addCost(float4 color, float2 uv)
+{
+    float value = uv.x + uv.y;
+    for (uint i = 0; i < fragmentCost; ++i)
+        value = frac(sin(value * 12.9898f + 78.233f) * 43758.5453f);
+    return fragmentCost > 0 && value >= 1.0f ? float4(0.0f, 0.0f, 0.0f, 1.0f) : color;
+}
+
+// Координаты изображения: ось Y области вывода направлена вниз
+float2 getVelocity(PS_INPUT data)
+{
+    float2 current = data.currentPosition.xy / data.currentPosition.w;
+    float2 previous = data.previousPosition.xy / data.previousPosition.w;
+    return (current - previous) * float2(0.5f, -0.5f);
+}
+
+float4 getColor(PS_INPUT data)
+{
+    instance_t instance = instances[data.instanceID];
+    if (instance.objectVirtualTexture != 0) {
+        uint id = instance.objectVirtualTexture - 1;
+        virtual_info_t info = virtualInfo[id];
+        float level = vtLevel(info, ddx(data.uv), ddy(data.uv), 0.0f);
+        return vtSample(virtualCache, virtualSampler, pageTables[NonUniformResourceIndex(id)], info, data.uv, level);
+    }
+
+    return float4(textures[NonUniformResourceIndex(instance.objectTexture)].Sample(samplers[NonUniformResourceIndex(instance.objectSampler)], data.uv));
+}
+
 [shader("fragment")]
-float4 fragmentMain(PS_INPUT data) : SV_TARGET
+PS_OUTPUT fragmentMain(PS_INPUT data)
 {
-    return float4(textures[NonUniformResourceIndex(instance.objectTexture)].Sample(textureSampler, data.uv));
+    PS_OUTPUT output;
+    output.color = addCost(getColor(data), data.uv);
+    output.velocity = getVelocity(data);
+    return output;
 }
@@ -0,0 +1,182 @@
+// Постпроцессинг - общие функции эффектов
+// Константы эффекта: src/engine/render/passes/graphics/postprocessing/fullscreen.h
+
+// Константы, задаваемые для каждого кадра
+struct constants_t {
+    float4x4 reprojection; // Точка фона -> прошлый кадр, только поворот камеры (TAA)
+    int imageIndex;
+    int imageCount;
+    float2 scale; // Доля изображения, занятая сценой (динамическое разрешение)
+    float2 jitter; // Дрожание проекции кадра в долях сцены (TAA)
+    float historyWeight; // Вес истории, 0 - история недействительна (TAA)
+    float exposure; // Экспозиция тонального отображения, 0 - без него
+    float saturation; // Цветокоррекция, 1 - без изменений
+    float contrast;
+};
+
+// Сцена занимает часть изображения - растягивается билинейной выборкой, не заходя за её край
+float4 sampleScene(Texture2D image, SamplerState imageSampler, float2 uv, float2 scale)
+{
+    uint2 imageDim;
+    uint imageLevels;
+    image.GetDimensions(0, imageDim.x, imageDim.y, imageLevels);
+    float2 sampleUV = min(uv * scale, scale - 0.5f / float2(imageDim));
+
+    return image.SampleLevel(imageSampler, sampleUV, 0);
+}
+
+//=========================================================================
+// TAA
+
+// Окрестность сравнивается в YCoCg - яркость и цветность ограничиваются отдельно
+float3 toYCoCg(float3 color)
+{
+    return float3(
+        dot(color, float3(0.25f, 0.5f, 0.25f)),
+        dot(color, float3(0.5f, 0.0f, -0.5f)),
+        dot(color, float3(-0.25f, 0.5f, -0.25f)));
+}
+
+float3 fromYCoCg(float3 color)
+{
+    return float3(
+        color.x + color.y - color.z,
+        color.x + color.z,
+        color.x - color.y - color.z);
+}
+
+// Отсечение цвета истории по направлению к центру границ окрестности
+float3 clipToBox(float3 history, float3 boxMin, float3 boxMax)
+{
+    float3 center = 0.5f * (boxMax + boxMin);
+    float3 extent = 0.5f * (boxMax - boxMin) + 0.0001f;
+    float3 offset = history - center;
+    float3 units = abs(offset / extent);
+    float maxUnit = max(units.x, max(units.y, units.z));
+    return maxUnit > 1.0f ? center + offset / maxUnit : history;
+}
+
+// Окрестность 3x3: границы допустимого цвета истории и самое длинное смещение -
+// края движущихся объектов репроецируются вместе с объектом, а не с фоном
+struct neighborhood_t {
+    float3 boxMin;
+    float3 boxMax;
+    float2 velocity;
+};
+
+void addNeighbor(inout neighborhood_t neighborhood, float3 color, float2 velocity)
+{
+    neighborhood.boxMin = min(neighborhood.boxMin, color);
+    neighborhood.boxMax = max(neighborhood.boxMax, color);
+    if (dot(velocity, velocity) > dot(neighborhood.velocity, neighborhood.velocity))
+        neighborhood.velocity = velocity;
+}
+
+// Значение очистки векторов движения вне всех форм - Geometry::backgroundVelocity
+static const float backgroundVelocity = 1024.0f;
+
+// Вектор движения точки сцены. Фон бесконечно далеко - его смещение задаёт только поворот камеры
+float2 loadVelocity(Texture2D<float2> velocityImage, int3 pos, float2 sceneDim, constants_t constants)
+{
+    float2 velocity = velocityImage.Load(pos);
+    if (velocity.x < backgroundVelocity)
+        return velocity;
+
+    float2 uv = (float2(pos.xy) + 0.5f) / sceneDim;
+    float4 current = float4(uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, 1.0f, 1.0f);
+    float4 previous = mul(constants.reprojection, current);
+    if (previous.w <= 0.0f)
+        return float2(1.0f, 1.0f); // Позади камеры прошлого кадра - истории нет
+    return (current.xy - previous.xy / previous.w) * float2(0.5f, -0.5f);
+}
+
+// Репроекция и смешение с историей. История в размере вывода - доля сцены прошлого кадра не важна
+float4 blendHistory(float2 uv, float3 current, neighborhood_t neighborhood,
+                    Texture2D historyImage, SamplerState imageSampler, float historyWeight)
+{
+    float2 prevUV = uv - neighborhood.velocity;
+    bool offscreen = any(prevUV < 0.0f) || any(prevUV > 1.0f);
+    if (historyWeight <= 0.0f || offscreen)
+        return float4(fromYCoCg(current), 1.0f);
+
+    // История, не совпадающая с окрестностью (открывшиеся области, смена освещения), отсекается
+    float3 history = toYCoCg(historyImage.SampleLevel(imageSampler, prevUV, 0).rgb);
+    history = clipToBox(history, neighborhood.boxMin, neighborhood.boxMax);
+
+    float3 finalColor = lerp(current, history, historyWeight);
+    return float4(fromYCoCg(finalColor), 1.0f);
+}
+
+// TAA пикселя, читающего свою окрестность сам.
+// Точка сцены, попадающая в центр пикселя без дрожания, сдвинута на величину дрожания
+float4 resolveTAA(float2 uv, constants_t constants, Texture2D currImage, Texture2D<float2> velocityImage,
+                  Texture2D historyImage, SamplerState imageSampler)
+{
+    // Размер кадра - сцена занимает его часть
+    uint2 imageDim;
+    uint imageLevels;
+    currImage.GetDimensions(0, imageDim.x, imageDim.y, imageLevels);
+    float2 sceneDim = float2(imageDim) * constants.scale;
+    int2 lastPos = int2(sceneDim) - 1;
+
+    float2 sceneUV = uv + constants.jitter;
+    float3 current = toYCoCg(sampleScene(currImage, imageSampler, sceneUV, constants.scale).rgb);
+    int2 currPos = clamp(int2(sceneUV * sceneDim), 0, lastPos);
+
+    neighborhood_t neighborhood = {current, current, float2(0.0f, 0.0f)};
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            int3 pos = int3(clamp(currPos + int2(x, y), 0, lastPos), 0);
+            addNeighbor(neighborhood, toYCoCg(currImage.Load(pos).rgb), loadVelocity(velocityImage, pos, sceneDim, constants));
+        }
+    }
+
+    return blendHistory(uv, current, neighborhood, historyImage, imageSampler, constants.historyWeight);
+}
+
+//=========================================================================
+// Эффекты пикселя - соседи не нужны
+
+// Кривая ACES в приближении Narkowicz - насыщение светлых участков без резкой границы
+float3 tonemap(float3 color, float exposure)
+{
+    if (exposure <= 0.0f)
+        return color;
+
+    color *= exposure;
+    return saturate((color * (2.51f * color + 0.03f)) / (color * (2.43f * color + 0.59f) + 0.14f));
+}
+
+// Цветокоррекция: насыщенность относительно яркости, контраст относительно середины
+float3 grade(float3 color, float saturation, float contrast)
+{
+    float luma = dot(color, float3(0.2126f, 0.7152f, 0.0722f));
+    color = lerp(float3(luma, luma, luma), color, saturation);
+    color = (color - 0.5f) * contrast + 0.5f;
+    return max(color, 0.0f);
+}
+
+// sRGB-кодирование вывода - шаг 8-битного вывода задан в кодированных значениях
+float3 toSRGB(float3 color)
+{
+    color = max(color, 0.0f);
+    float3 low = color * 12.92f;
+    float3 high = 1.055f * pow(color, 1.0f / 2.4f) - 0.055f;
+    return lerp(low, high, step(0.0031308f, color));
+}
+
+float3 fromSRGB(float3 color)
+{
+    color = max(color, 0.0f);
+    float3 low = color / 12.92f;
+    float3 high = pow((color + 0.055f) / 1.055f, 2.4f);
+    return lerp(low, high, step(0.04045f, color));
+}
+
+// Треугольный шум в шаг 8-битного вывода - без полос на плавных градиентах
+float3 dither(float3 color, uint2 pixel)
+{
+    float noise0 = frac(52.9829189f * frac(dot(float2(pixel), float2(0.06711056f, 0.00583715f))));
+    float noise1 = frac(52.9829189f * frac(dot(float2(pixel) + 17.0f, float2(0.06711056f, 0.00583715f))));
+    return color + (noise0 + noise1 - 1.0f) / 255.0f;
+}
@@ -0,0 +1,76 @@
+// Виртуальные текстуры - общие функции для проходов рендера
+// Описание формата страниц и таблиц: src/engine/scene/resources/virtual.h
+
+// Параметры виртуальной текстуры
+struct virtual_info_t {
+    uint width;       // Размер нулевого уровня (в текселах)
+    uint height;
+    uint pagesX;      // Число страниц нулевого уровня
+    uint pagesY;
+    uint levels;      // Число уровней детализации
+    uint pageSize;    // Размер страницы без рамки
+    uint pageBorder;  // Рамка страницы
+    uint cacheSlots;  // Число ячеек кэша по одной оси
+};
+
+// Число страниц на уровне детализации
+uint2 vtPages(virtual_info_t info, uint level)
+{
+    return max(uint2(info.pagesX, info.pagesY) >> level, uint2(1, 1));
+}
+
+// Уровень детализации по производным текстурных координат
+// bias - поправка на разрешение прохода обратной связи
+float vtLevel(virtual_info_t info, float2 dx, float2 dy, float bias)
+{
+    float2 size = float2(info.width, info.height);
+    dx *= size;
+    dy *= size;
+    float rho = max(dot(dx, dx), dot(dy, dy));
+    float level = 0.5f * log2(max(rho, 1e-8f)) + bias;
+    return clamp(level, 0.0f, float(info.levels - 1));
+}
+
+// Запрос страницы для прохода обратной связи (RGBA8_UINT) - страниц по оси не больше 256
+// (VirtualTextureFile::maxPages), id + 1 - не больше 255
+uint4 vtFeedback(virtual_info_t info, uint id, float2 uv, float level)
+{
+    uint l = uint(level);
+    uint2 pages = vtPages(info, l);
+    uint2 page = min(uint2(frac(uv) * pages), pages - 1);
+    return uint4(page, l, id + 1);
+}
+
+// Таблицы уровней лежат в одном изображении слева направо
+uint vtTableOffset(virtual_info_t info, uint level)
+{
+    uint offset = 0;
+    for (uint l = 0; l < level; ++l)
+        offset += vtPages(info, l).x;
+    return offset;
+}
+
+// Выборка из физического кэша через таблицу страниц
+// level - уровень детализации области (vtLevel), детальнее него страницы не берутся
+float4 vtSample(Texture2D cache, SamplerState cacheSampler, Texture2D<uint4> table, virtual_info_t info, float2 uv, float level)
+{
+    uv = frac(uv);
+
+    // Самая детальная загруженная страница не детальнее запрошенного уровня
+    uint l = uint(level);
+    uint2 pages = vtPages(info, l);
+    uint2 tile = min(uint2(uv * pages), pages - 1);
+    uint4 entry = table.Load(int3(tile.x + vtTableOffset(info, l), tile.y, 0));
+
+    // Страница ещё не загружена
+    if (entry.a == 0)
+        return float4(0.5f, 0.5f, 0.5f, 1.0f);
+
+    // Координаты внутри страницы
+    float2 inPage = frac(uv * vtPages(info, entry.b));
+
+    // Координаты в кэше с учётом рамки
+    float slotSize = float(info.pageSize + 2 * info.pageBorder);
+    float2 texel = float2(entry.rg) * slotSize + info.pageBorder + inPage * info.pageSize;
+    return cache.SampleLevel(cacheSampler, texel / (slotSize * info.cacheSlots), 0);
+}
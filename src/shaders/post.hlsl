@@ -0,0 +1,92 @@
+#include "library/post.hlsl"
+
+// Собранная цепочка постпроцессинга: каждая включённая стадия - определение препроцессора,
+// вся цепочка - одна перестановка шейдера с одним чтением цвета сцены и одной записью вывода.
+// Стадии: POST_TAA, POST_TONEMAP, POST_GRADING, POST_DITHER (src/engine/render/render.h)
+// POST_SUBPASS - второй подпроход слитого прохода геометрии: цвет сцены читается
+// как input attachment того же пикселя, стадии с соседями недоступны
+
+// Вход вершинного шейдера
+struct VS_INPUT {
+    uint id: SV_VertexID;
+    float3 position : POSITION;
+};
+
+// Вход фрагментного шейдера
+struct PS_INPUT
+{
+    float4 position : SV_POSITION;
+    float2 uv;
+};
+
+// Выход фрагментного шейдера
+struct PS_OUTPUT
+{
+    float4 color : SV_TARGET0;
+#if POST_TAA
+    float4 history : SV_TARGET1; // Результат TAA до остальных стадий - история следующего кадра
+#endif
+};
+
+[[vk::push_constant]] ConstantBuffer<constants_t> instance;
+
+// Ресурсы, привязанные к конвейеру
+#if POST_SUBPASS
+[[vk::input_attachment_index(0)]] SubpassInput<float4> sceneColor; // VkImageView - цвет сцены этого пикселя
+#else
+Texture2D images[]; // VkImageView - цвет сцены
+SamplerState imageSampler; // VkSampler
+#endif
+#if POST_TAA
+Texture2D<float2> velocities[]; // VkImageView - смещение пикселя с прошлого кадра в долях сцены
+Texture2D histories[]; // VkImageView - результат TAA, по копии на кадр в работе
+#endif
+
+[shader("vertex")]
+PS_INPUT vertexMain(VS_INPUT vertex)
+{
+    PS_INPUT data;
+
+    data.uv = float2((vertex.id << 1) & 2, vertex.id & 2);
+    data.position = float4(data.uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+
+    return data;
+}
+
+[shader("fragment")]
+PS_OUTPUT fragmentMain(PS_INPUT fragment)
+{
+    PS_OUTPUT output;
+    int currImageIndex = instance.imageIndex;
+
+#if POST_SUBPASS
+    float4 color = sceneColor.SubpassLoad();
+#elif POST_TAA
+    int prevImageIndex = (currImageIndex + instance.imageCount - 1) % instance.imageCount;
+    float4 color = resolveTAA(fragment.uv, instance,
+                              images[NonUniformResourceIndex(currImageIndex)],
+                              velocities[NonUniformResourceIndex(currImageIndex)],
+                              histories[NonUniformResourceIndex(prevImageIndex)],
+                              imageSampler);
+    output.history = color;
+#else
+    float4 color = sampleScene(images[NonUniformResourceIndex(currImageIndex)], imageSampler, fragment.uv, instance.scale);
+#endif
+
+#if POST_TONEMAP
+    color.rgb = tonemap(color.rgb, instance.exposure);
+#endif
+
+#if POST_GRADING
+    color.rgb = grade(color.rgb, instance.saturation, instance.contrast);
+#endif
+
+#if POST_DITHER && POST_SRGB
+    color.rgb = fromSRGB(dither(toSRGB(color.rgb), uint2(fragment.position.xy)));
+#elif POST_DITHER
+    color.rgb = dither(color.rgb, uint2(fragment.position.xy));
+#endif
+
+    output.color = color;
+    return output;
+}
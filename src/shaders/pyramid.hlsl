@@ -0,0 +1,37 @@
+// Размеры источника и строимого уровня
+struct constants_t {
+    uint2 sourceSize;
+    uint2 size;
+};
+[[vk::push_constant]] ConstantBuffer<constants_t> constants;
+
+// Ресурсы, привязанные к конвейеру
+Texture2D<float> source; // VkImageView: глубина или предыдущий уровень
+RWTexture2D<float> destination; // VkImageView: строимый уровень
+
+[shader("compute")]
+[numthreads(8, 8, 1)]
+void computeMain(uint3 thread : SV_DispatchThreadID)
+{
+    uint2 texel = thread.xy;
+    if (any(texel >= constants.size))
+        return;
+
+    // Наибольшая (самая дальняя) глубина блока 2x2
+    int2 base = int2(texel * 2);
+    float depth = max(
+        max(source.Load(int3(base, 0)), source.Load(int3(base + int2(1, 0), 0))),
+        max(source.Load(int3(base + int2(0, 1), 0)), source.Load(int3(base + int2(1, 1), 0))));
+
+    // При нечётном размере источника крайний блок захватывает оставшийся столбец и строку
+    bool lastColumn = texel.x == constants.size.x - 1 && (constants.sourceSize.x & 1) != 0 && constants.sourceSize.x > 1;
+    bool lastRow = texel.y == constants.size.y - 1 && (constants.sourceSize.y & 1) != 0 && constants.sourceSize.y > 1;
+    if (lastColumn)
+        depth = max(depth, max(source.Load(int3(base + int2(2, 0), 0)), source.Load(int3(base + int2(2, 1), 0))));
+    if (lastRow)
+        depth = max(depth, max(source.Load(int3(base + int2(0, 2), 0)), source.Load(int3(base + int2(1, 2), 0))));
+    if (lastColumn && lastRow)
+        depth = max(depth, source.Load(int3(base + int2(2, 2), 0)));
+
+    destination[texel] = depth;
+}
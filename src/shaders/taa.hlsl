@@ -1,3 +1,5 @@
+#include "library/post.hlsl"
+
 // Вход вершинного шейдера
 struct VS_INPUT {
     uint id: SV_VertexID;
@@ -11,15 +13,14 @@ struct PS_INPUT
     float2 uv;
 };
 
-// Константы, задаваемые для каждого кадра
-struct constants_t {
-    int imageIndex;
-};
 [[vk::push_constant]] ConstantBuffer<constants_t> instance;
 
 // Ресурсы, привязанные к конвейеру
-Texture2D images[]; // VkImageView
+Texture2D images[]; // VkImageView - цвет сцены
 SamplerState imageSampler; // VkSampler
+Texture2D<float2> velocities[]; // VkImageView - смещение пикселя с прошлого кадра в долях сцены
+Texture2D histories[]; // VkImageView - результат TAA, по копии на кадр в работе
+[format("rgba16f")] RWTexture2D<float4> outputs[]; // VkImageView - результат вычислительной версии
 
 [shader("vertex")]
 PS_INPUT vertexMain(VS_INPUT vertex)
@@ -32,65 +33,105 @@ PS_INPUT vertexMain(VS_INPUT vertex)
     return data;
 }
 
+// Точка сцены, попадающая в центр пикселя без дрожания, сдвинута на величину дрожания
+float2 getSceneUV(float2 uv)
+{
+    return uv + instance.jitter;
+}
+
 [shader("fragment")]
 float4 fragmentMain(PS_INPUT fragment) : SV_TARGET
 {
     // Индексы кадров
     int currImageIndex = instance.imageIndex;
-    int prevImageIndex = (currImageIndex == 0) ? 1 : currImageIndex - 1;
+    int prevImageIndex = (currImageIndex + instance.imageCount - 1) % instance.imageCount;
+
+    // Каждый пиксель читает свою окрестность сам
+    return resolveTAA(fragment.uv, instance,
+                      images[NonUniformResourceIndex(currImageIndex)],
+                      velocities[NonUniformResourceIndex(currImageIndex)],
+                      histories[NonUniformResourceIndex(prevImageIndex)],
+                      imageSampler);
+}
+
+//=========================================================================
+// Вычислительная версия: окрестности пикселей группы перекрываются - плитка цвета
+// и смещений загружается в общую память один раз на группу (9 выборок на пиксель -> 1.3-1.6).
+// Сцена не больше вывода, поэтому пиксели группы попадают не более чем в groupSize
+// точек сцены по каждой оси - плитке достаточно рамки в одну точку
+
+static const uint maxGroupSize = 16;
+static const uint maxTileSize = maxGroupSize + 2;
+
+groupshared float3 tileColors[maxTileSize * maxTileSize]; // YCoCg
+groupshared float2 tileVelocities[maxTileSize * maxTileSize];
+
+void resolveTile(uint2 groupID, uint2 localID, uint groupSize)
+{
+    // Индексы кадров
+    int currImageIndex = instance.imageIndex;
+    int prevImageIndex = (currImageIndex + instance.imageCount - 1) % instance.imageCount;
 
-    // Изображение кадров
     Texture2D currImage = images[NonUniformResourceIndex(currImageIndex)];
-    Texture2D prevImage = images[NonUniformResourceIndex(prevImageIndex)];
+    Texture2D<float2> velocityImage = velocities[NonUniformResourceIndex(currImageIndex)];
+    Texture2D historyImage = histories[NonUniformResourceIndex(prevImageIndex)];
+    RWTexture2D<float4> outputImage = outputs[NonUniformResourceIndex(currImageIndex)];
 
-    // Размер кадра
+    // Размеры кадра и вывода
     uint2 imageDim;
     uint imageLevels;
     currImage.GetDimensions(0, imageDim.x, imageDim.y, imageLevels);
-
-    // Позиция кадра
-    int2 currPos = int2(fragment.uv * imageDim);
-
-    // Цвет кадров
-    float4 currImageColor = currImage.Load(int3(currPos, 0));
-    float4 prevImageColor = prevImage.Load(int3(currPos, 0));
-
-    float3 finalColor = currImageColor.rgb;
-
-    // Смешивание текущего и предыдущего кадров
-    finalColor += prevImageColor.rgb;
-    finalColor /= 2.0f;
-
-    // Субпиксельное дрожание 
-    {
-        const float step = 1.2f;
-        const float2 offset[8] = { 
-            {-step, -step}, 
-            {-step,  step},
-            { step, -step},
-            { step,  step}, 
-            {-step,  0},
-            { step,  0},
-            { 0, -step}, 
-            { 0,  step},
-        };
-
-        // Смешивание всех изображений со сдвигом
-        float3 centerColor = currImageColor.rgb;
-        for (int i = 0; i < 8; ++i)
-        {
-            // Смотрим соседние точки
-            float3 neighborColor = currImage.Load(int3(currPos + offset[i], 0)).rgb;
-
-            // Смотрим разницу
-            float3 diffColor = abs(neighborColor - centerColor);
-            if (length(diffColor.yz) < 0.35f) 
-                neighborColor = centerColor;
-            finalColor += neighborColor;
+    float2 sceneDim = float2(imageDim) * instance.scale;
+    int2 lastPos = int2(sceneDim) - 1;
+
+    uint2 outputDim;
+    outputImage.GetDimensions(outputDim.x, outputDim.y);
+
+    // Плитка начинается в точке сцены первого пикселя группы
+    uint2 groupOrigin = groupID * groupSize;
+    float2 originUV = (float2(groupOrigin) + 0.5f) / float2(outputDim);
+    int2 tileOrigin = clamp(int2(getSceneUV(originUV) * sceneDim), 0, lastPos) - 1;
+
+    uint tileSize = groupSize + 2;
+    uint threadCount = groupSize * groupSize;
+    for (uint i = localID.y * groupSize + localID.x; i < tileSize * tileSize; i += threadCount) {
+        int3 pos = int3(clamp(tileOrigin + int2(i % tileSize, i / tileSize), 0, lastPos), 0);
+        tileColors[i] = toYCoCg(currImage.Load(pos).rgb);
+        tileVelocities[i] = loadVelocity(velocityImage, pos, sceneDim, instance);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Потоки за краем вывода участвуют только в загрузке плитки
+    uint2 pixel = groupOrigin + localID;
+    if (any(pixel >= outputDim))
+        return;
+
+    float2 uv = (float2(pixel) + 0.5f) / float2(outputDim);
+    float2 sceneUV = getSceneUV(uv);
+    float3 current = toYCoCg(sampleScene(currImage, imageSampler, sceneUV, instance.scale).rgb);
+    int2 center = clamp(int2(sceneUV * sceneDim), 0, lastPos) - tileOrigin;
+
+    neighborhood_t neighborhood = {current, current, float2(0.0f, 0.0f)};
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            uint index = (center.y + y) * tileSize + (center.x + x);
+            addNeighbor(neighborhood, tileColors[index], tileVelocities[index]);
         }
-        finalColor /= 9.0f;
     }
 
-    return float4(finalColor, 1.0f);
-    //return currImageColor;
+    outputImage[pixel] = blendHistory(uv, current, neighborhood, historyImage, imageSampler, instance.historyWeight);
+}
+
+[shader("compute")]
+[numthreads(8, 8, 1)]
+void computeMain8x8(uint3 group : SV_GroupID, uint3 local : SV_GroupThreadID)
+{
+    resolveTile(group.xy, local.xy, 8);
+}
+
+[shader("compute")]
+[numthreads(16, 16, 1)]
+void computeMain16x16(uint3 group : SV_GroupID, uint3 local : SV_GroupThreadID)
+{
+    resolveTile(group.xy, local.xy, 16);
 }
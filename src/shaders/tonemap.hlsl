@@ -0,0 +1,42 @@
+#include "library/post.hlsl"
+
+// Тональное отображение и цветокоррекция вычислительного пути - пиксель на поток, соседи не нужны.
+// Во фрагментном пути эти стадии собираются в перестановку post.hlsl
+
+[[vk::push_constant]] ConstantBuffer<constants_t> instance;
+
+// Ресурсы, привязанные к конвейеру
+Texture2D images[]; // VkImageView
+SamplerState imageSampler; // VkSampler
+[format("rgba16f")] RWTexture2D<float4> outputs[]; // VkImageView - результат
+
+void tonemapPixel(uint2 pixel)
+{
+    Texture2D image = images[NonUniformResourceIndex(instance.imageIndex)];
+    RWTexture2D<float4> outputImage = outputs[NonUniformResourceIndex(instance.imageIndex)];
+
+    uint2 outputDim;
+    outputImage.GetDimensions(outputDim.x, outputDim.y);
+    if (any(pixel >= outputDim))
+        return;
+
+    float2 uv = (float2(pixel) + 0.5f) / float2(outputDim);
+    float4 color = sampleScene(image, imageSampler, uv, instance.scale);
+    color.rgb = tonemap(color.rgb, instance.exposure);
+    color.rgb = grade(color.rgb, instance.saturation, instance.contrast);
+    outputImage[pixel] = color;
+}
+
+[shader("compute")]
+[numthreads(8, 8, 1)]
+void computeMain8x8(uint3 thread : SV_DispatchThreadID)
+{
+    tonemapPixel(thread.xy);
+}
+
+[shader("compute")]
+[numthreads(16, 16, 1)]
+void computeMain16x16(uint3 thread : SV_DispatchThreadID)
+{
+    tonemapPixel(thread.xy);
+}
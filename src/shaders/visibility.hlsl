@@ -0,0 +1,193 @@
+// Мировые объёмы формы
+struct object_t {
+    float3 min;
+    uint group;
+    float3 max;
+    uint padding;
+    float4 sphere; // Центр и радиус
+};
+
+// Геометрия группы и начало её экземпляров в потоке индексов
+struct group_t {
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint offset;
+};
+
+// ~ VkDrawIndexedIndirectCommand
+struct command_t {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+// Фаза запуска
+struct constants_t {
+    uint phase; // 0, 1 - ранняя проверка и команды, 2, 3 - поздняя проверка и команды
+};
+[[vk::push_constant]] ConstantBuffer<constants_t> constants;
+
+
+// Ресурсы, привязанные к конвейеру
+cbuffer ubo // VkBuffer
+{
+    float4 planes[6]; // Пирамида видимости (ax + by + cz + d >= 0 - внутри)
+    float4x4 viewProjection;
+    float3 camera;
+    float maxDistance; // 0 - без проверки расстояния
+    uint entryCount;
+    uint groupCount;
+    uint capacity; // Шаг списков в буферах
+    uint enabled; // 0 - все формы видимы
+    uint2 depthSize;
+    uint levels;
+    uint occlusion; // 0 - без проверки перекрытия
+}
+StructuredBuffer<object_t> objects; // VkBuffer
+StructuredBuffer<group_t> groups; // VkBuffer
+RWStructuredBuffer<uint> counts; // VkBuffer: [список] - число команд, [2] - перекрытые формы, [4 + список * capacity + группа] - экземпляры
+RWStructuredBuffer<uint> indices; // VkBuffer: поток индексов экземпляров списков
+RWStructuredBuffer<command_t> commands; // VkBuffer
+RWStructuredBuffer<uint> history; // VkBuffer: видимость форм в прошлом кадре
+Texture2D<float> pyramid; // VkImageView: наибольшая глубина блоков
+
+
+static const uint countsHeader = 4;
+static const uint occludedCounter = 2;
+
+bool isInside(object_t object)
+{
+    if (enabled == 0)
+        return true;
+
+    // Слишком далёкие формы
+    if (maxDistance > 0.0f && length(object.sphere.xyz - camera) - object.sphere.w > maxDistance)
+        return false;
+
+    for (uint i = 0; i < 6; ++i) {
+        float4 plane = planes[i];
+
+        // Сфера целиком за плоскостью
+        if (dot(plane.xyz, object.sphere.xyz) + plane.w + object.sphere.w < 0.0f)
+            return false;
+
+        // Самая дальняя вдоль нормали вершина AABB за плоскостью
+        float3 vertex = select(plane.xyz > 0.0f, object.max, object.min);
+        if (dot(plane.xyz, vertex) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool isOccluded(object_t object)
+{
+    // Прямоугольник AABB на экране и ближайшая глубина
+    float2 minUV = float2(1.0f, 1.0f);
+    float2 maxUV = float2(0.0f, 0.0f);
+    float closest = 1.0f;
+    for (uint i = 0; i < 8; ++i) {
+        float3 corner = float3(
+            (i & 1) != 0 ? object.max.x : object.min.x,
+            (i & 2) != 0 ? object.max.y : object.min.y,
+            (i & 4) != 0 ? object.max.z : object.min.z);
+        float4 clip = mul(viewProjection, float4(corner, 1.0f));
+
+        // Форма пересекает ближнюю плоскость - считается видимой
+        if (clip.w <= 0.0f || clip.z < 0.0f)
+            return false;
+
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv = float2(0.5f + 0.5f * ndc.x, 0.5f - 0.5f * ndc.y); // Область вывода перевёрнута по y
+        minUV = min(minUV, uv);
+        maxUV = max(maxUV, uv);
+        closest = min(closest, ndc.z);
+    }
+    minUV = saturate(minUV);
+    maxUV = saturate(maxUV);
+
+    // Уровень, на котором прямоугольник покрывает не больше 2x2 блоков
+    float2 size = (maxUV - minUV) * float2(depthSize);
+    uint level = uint(ceil(log2(max(max(size.x, size.y), 1.0f))));
+    level = min(level, levels - 1);
+
+    // Блок уровня L покрывает 2^(L+1) пикселей глубины
+    uint2 levelSize = max(depthSize >> (level + 1), uint2(1, 1));
+    uint2 lo = min(uint2(minUV * float2(depthSize)) >> (level + 1), levelSize - 1);
+    uint2 hi = min(uint2(maxUV * float2(depthSize)) >> (level + 1), levelSize - 1);
+
+    float farthest = max(
+        max(pyramid.Load(int3(lo.x, lo.y, level)), pyramid.Load(int3(hi.x, lo.y, level))),
+        max(pyramid.Load(int3(lo.x, hi.y, level)), pyramid.Load(int3(hi.x, hi.y, level))));
+    return closest > farthest;
+}
+
+// Видимая форма занимает следующее место своей группы в списке
+void append(uint list, uint id, uint group)
+{
+    uint slot;
+    InterlockedAdd(counts[countsHeader + list * capacity + group], 1, slot);
+    indices[list * capacity + groups[group].offset + slot] = id;
+}
+
+// Команды непустых групп располагаются подряд
+void writeCommand(uint list, uint id)
+{
+    uint count = counts[countsHeader + list * capacity + id];
+    if (count == 0)
+        return;
+
+    uint draw;
+    InterlockedAdd(counts[list], 1, draw);
+
+    group_t group = groups[id];
+    command_t command;
+    command.indexCount = group.indexCount;
+    command.instanceCount = count;
+    command.firstIndex = group.firstIndex;
+    command.vertexOffset = group.vertexOffset;
+    command.firstInstance = group.offset;
+    commands[list * capacity + draw] = command;
+}
+
+[shader("compute")]
+[numthreads(64, 1, 1)]
+void computeMain(uint3 thread : SV_DispatchThreadID)
+{
+    uint id = thread.x;
+
+    switch (constants.phase) {
+    // Ранняя фаза: формы, видимые в прошлом кадре
+    case 0:
+        if (id < entryCount && history[id] != 0 && isInside(objects[id]))
+            append(0, id, objects[id].group);
+        break;
+    case 1:
+        if (id < groupCount)
+            writeCommand(0, id);
+        break;
+
+    // Поздняя фаза: проверка всех форм по Hi-Z, дорисовка не попавших в раннюю
+    case 2:
+        if (id < entryCount) {
+            object_t object = objects[id];
+            bool inside = isInside(object);
+            bool drawn = occlusion != 0 && history[id] != 0 && inside;
+            bool visible = inside;
+            if (inside && occlusion != 0 && enabled != 0 && isOccluded(object)) {
+                visible = false;
+                InterlockedAdd(counts[occludedCounter], 1);
+            }
+            history[id] = visible ? 1 : 0;
+            if (visible && !drawn)
+                append(1, id, object.group);
+        }
+        break;
+    case 3:
+        if (id < groupCount)
+            writeCommand(1, id);
+        break;
+    }
+}
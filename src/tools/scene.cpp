@@ -0,0 +1,118 @@
+// Преобразование описаний сцены между текстовой и двоичной формами
+//
+//   nevk-scene convert <вход> <выход>        - форма определяется по расширению (.json - текстовая)
+//   nevk-scene generate <число> <выход>      - сетка объектов из моделей misc/models
+//   nevk-scene benchmark <файл> [повторы]    - время чтения описания
+//   nevk-scene bake <изображение> <выход>    - нарезка виртуальной текстуры (.vt)
+
+// Внутренние библиотеки
+#include "resources/scenefile.h"
+#include "resources/virtualfile.h"
+
+// Сторонние библиотеки (реализация stb_image - движок с его textures.cpp инструмент не включает)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// Стандартные библиотеки
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void convert(const std::string& input, const std::string& output) {
+  SceneFile scene;
+  scene.load(input);
+  scene.save(output);
+  std::cout << "Scene \"" << input << "\" -> \"" << output << "\": "
+            << scene.getObjects().size() << " objects, "
+            << scene.models.size() << " models, "
+            << scene.materials.size() << " materials" << std::endl;
+}
+
+void generate(uint32_t count, const std::string& output) {
+  SceneFile scene;
+  scene.models = {"test", "cube", "teapot", "tree"};
+
+  SceneFile::material_t material;
+  material.name = "brick";
+  material.texture = "misc\\models\\cube\\brickwall.png";
+  scene.materials.push_back(material);
+
+  // Квадратная сетка с шагом 4, каждый восьмой объект - с переопределённым материалом
+  uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+  std::vector<SceneFile::object_t> objects(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto& object = objects[i];
+    object.model = i % scene.models.size();
+    object.material = i % 8 == 7 ? 0 : SceneFile::none;
+    object.parent = SceneFile::none;
+    object.padding = 0;
+    object.position[0] = (static_cast<float>(i % side) - side * 0.5f) * 4.0f;
+    object.position[1] = 0.0f;
+    object.position[2] = -(static_cast<float>(i / side)) * 4.0f;
+    object.rotation[0] = 0.0f;
+    object.rotation[1] = static_cast<float>((i * 37) % 360);
+    object.rotation[2] = 0.0f;
+    object.scale[0] = object.scale[1] = object.scale[2] = 1.0f;
+  }
+  scene.setObjects(std::move(objects));
+  scene.save(output);
+  std::cout << "Scene \"" << output << "\" was generated: " << count << " objects" << std::endl;
+}
+
+// Результат прохода, который не должен быть удалён оптимизатором
+volatile float sink;
+
+void benchmark(const std::string& path, uint32_t repeats) {
+  double total = 0.0;
+  size_t count = 0;
+  for (uint32_t i = 0; i < repeats; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+    SceneFile scene;
+    scene.load(path);
+
+    // Один проход по таблице объектов - как при создании объектов сцены
+    float checksum = 0.0f;
+    for (auto& object : scene.getObjects())
+      checksum += object.position[0] + object.model;
+    sink = checksum;
+    auto end = std::chrono::high_resolution_clock::now();
+
+    total += std::chrono::duration<double, std::milli>(end - start).count();
+    count = scene.getObjects().size();
+  }
+  std::cout << "Scene benchmark (" << count << " objects): "
+            << total / repeats << " ms per load of \"" << path << "\"" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "convert" && argc == 4) {
+      convert(argv[2], argv[3]);
+    } else if (command == "generate" && argc == 4) {
+      generate(static_cast<uint32_t>(std::stoul(argv[2])), argv[3]);
+    } else if (command == "benchmark" && (argc == 3 || argc == 4)) {
+      benchmark(argv[2], argc == 4 ? static_cast<uint32_t>(std::stoul(argv[3])) : 10);
+    } else if (command == "bake" && argc == 4) {
+      VirtualTextureFile::bake(argv[2], argv[3]);
+    } else {
+      std::cerr << "Usage:\n"
+                << "  nevk-scene convert <input> <output>\n"
+                << "  nevk-scene generate <count> <output>\n"
+                << "  nevk-scene benchmark <scene> [repeats]\n"
+                << "  nevk-scene bake <image> <output.vt>" << std::endl;
+      return 1;
+    }
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}